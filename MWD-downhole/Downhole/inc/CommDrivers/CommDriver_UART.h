@@ -51,8 +51,11 @@ extern "C" {
 	void Initialize_UARTs(void);
     void UART_InitPins(void);
     void UART_Init(void);
-    void UART_ServiceRxBufferDMA(void);
     void UART_ServiceRxBuffer(void);
+    U_INT16 UART_RxPeek(UART_CLIENT eClient, const U_BYTE **ppData);
+    void UART_RxRelease(UART_CLIENT eClient, U_INT16 nLength);
+    BOOL UART_RxFindDelimiter(UART_CLIENT eClient, U_BYTE nDelimiter,
+    U_INT16 *pLength);
 //	void UART_ProcessRxData(void);
     void UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen);
 
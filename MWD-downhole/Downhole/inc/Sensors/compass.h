@@ -47,6 +47,8 @@ extern "C" {
 	// Retrieves data from the UART and places the data into the compass message buffer
 	// nData the incoming character to be put in the buffer
 	void Compass_ServiceRxData(U_BYTE nData);
+	// Same as Compass_ServiceRxData() for a span of the UART receive buffer
+	void Compass_ServiceRxSpan(const U_BYTE *pData, U_INT16 nLength);
 	// Processes the data in the compass message buffer
 	void Compass_ProcessRxData(void);
 	// Manages states and transitions between states for the compass State Machine
@@ -58,6 +58,7 @@ extern "C" {
     void ModemData_ResetRxResponse(void);
     void ModemData_ResetRxIndication(void);
 	void ModemData_ReceiveData(U_BYTE nData);
+	void ModemData_ReceiveSpan(const U_BYTE *pData, U_INT16 nLength);
 	U_BYTE getBufferByte(void);
 	void ProcessModemBuffer(void);
 
@@ -39,15 +39,14 @@
 #define BAUD_RATE_57600			57600
 #define BAUD_RATE_115200		115200
 
-// UART buffers are serviced from cycleHandler() every 10ms. At 19200 baud,
-// we could receive approximately 20 bytes per 10ms cycle. (20 is the absolute
-// minimum size of the RX_DMA buffer)
+// UART buffers are serviced from cycleHandler() every 10ms. At 115200 baud,
+// we could receive approximately 115 bytes per 10ms cycle.
 //
-// The RX buffer is twice the size of the RX_DMA buffer because some UART
-// clients (i.e. RASP) are serviced on the alternate cycle (i.e. every 20ms)
-// and the RX_DMA buffer is transferred to the RX buffer every 10ms cycle.
-#define BUFFER_SIZE_RX_DMA  64
-#define BUFFER_SIZE_RX     128
+// Received data stays in the circular DMA buffer until the client releases
+// it, there is no second copy.  The buffer is sized for some clients
+// (i.e. RASP) being serviced on the alternate cycle (i.e. every 20ms) with
+// room to spare.  Must be a power of two.
+#define BUFFER_SIZE_RX_DMA 512
 
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
@@ -62,28 +61,40 @@ typedef struct
     U_INT32              nRxDMAChannel; // DMA receive channel
     U_INT32              nBaudRate;     // Transmission speed of this stream
     U_BYTE               nRxBufferDMA[BUFFER_SIZE_RX_DMA]; // DMA Receive Buffer
-    U_INT16              nRxHeadDMA;    // Leading index of DMA receive data
-    U_INT16              nRxTailDMA;    // Trailing index of DMA receive data
-    U_BYTE               nRxBuffer[BUFFER_SIZE_RX]; // Secondary Receive buffer
-    U_INT16              nRxHead;       // Leading index of secondary receive buffer
-    U_INT16              nRxTail;       // Trailing index of secondary receive buffer
+    volatile U_INT16     nRxHeadDMA;    // Leading index of DMA receive data
+    volatile U_INT32     nRxWritten;    // Bytes the DMA has received
+    U_INT16              nRxTailDMA;    // Oldest byte not released by the client
+    U_INT32              nRxRead;       // Bytes released by the client
+    U_INT16              nRxScanned;    // Bytes past the tail already searched
     U_BYTE               nTxBufferDMA[UART_BUFFER_SIZE_TX]; // Transmit buffer
     UART_CLIENT          eClient;       // Peripheral client
     UART_CALLBACK_TX     pfCallbackTx;  // Callback function invoked when transmit is complete
 } UART_SELECT;
 
+typedef struct
+{
+    U_INT32 nReceived;      // bytes released by the client
+    U_INT32 nOverruns;      // times the DMA caught up with the client
+    U_INT32 nOverrunBytes;  // bytes thrown away by those overruns
+    U_INT16 nMaxPending;    // most bytes waiting for the client at once
+} UART_RX_STATS;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
 static void uARTx_Configure(UART_SELECT *pUARTx);
 static void uARTx_IRQHandler(UART_SELECT *pUARTx);
+static UART_SELECT *uART_GetSelect(UART_CLIENT eClient);
+static void uARTx_RxUpdate(UART_SELECT *pUARTx);
+static U_INT16 uARTx_RxPending(UART_SELECT *pUARTx);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
 static UART_SELECT m_UART[NUM_UART_STREAMS];
+UART_RX_STATS m_UartRxStats[NUM_UART_STREAMS];
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -165,9 +176,10 @@ void Initialize_UARTs(void)
 	pUARTx->eClient = CLIENT_DATA_LINK;
 	pUARTx->pfCallbackTx = NULL;
 	pUARTx->nRxHeadDMA = 0;
+	pUARTx->nRxWritten = 0;
 	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
 	uARTx_Configure(pUARTx);
 //	NVIC_InitIrq(NVIC_UART1);
 	// Enable DMA2 Stream5 Channel 4 (USART1_RX)
@@ -213,9 +225,10 @@ void Initialize_UARTs(void)
 	pUARTx->eClient = CLIENT_COMPASS;
 	pUARTx->pfCallbackTx = NULL;
 	pUARTx->nRxHeadDMA = 0;
+	pUARTx->nRxWritten = 0;
 	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
 	uARTx_Configure(pUARTx);
 //	NVIC_InitIrq(NVIC_UART2);
 	// Enable DMA1 Stream1 Channel4 (USART1_RX)
@@ -240,96 +253,265 @@ void Initialize_UARTs(void)
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   UART_ServiceRxBufferDMA()
+;   UART_ServiceRxBuffer()
 ;
 ; Description:
-;   Services all clients that have received new data on their DMA RX channels
-;   since the last call to this function. The newly received data is
-;   transferred to the secondary receive buffer for the client.
+;   Services all clients that have received new data in their DMA receive
+;   buffer by handing it to the client's receive function a span at a time,
+;   then releasing it.  The client should handle any newly received data,
+;   but should not initiate a transmission.
 ;
 ; Reentrancy:
 ;   No
 ;
-; Assumptions:
-;   This function is called from cycleHandler() and the DMA interrupt. The
-;   DMA half transfer interrupt must be lower priority than cycleHandler().
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-void UART_ServiceRxBufferDMA(void)
+void UART_ServiceRxBuffer(void)
 {
-	U_BYTE i;
+	const U_BYTE *pData;
+	U_INT16 nLength;
 
-	for (i = 0; i < NUM_UART_STREAMS; i++)
+	while ((nLength = UART_RxPeek(CLIENT_DATA_LINK, &pData)) != 0)
 	{
-		m_UART[i].nRxHeadDMA = BUFFER_SIZE_RX_DMA - (U_INT16)m_UART[i].pRxDMA->NDTR;
-		while (m_UART[i].nRxHeadDMA != m_UART[i].nRxTailDMA)
+		if(GetModemIsPresent())
 		{
-			m_UART[i].nRxBuffer[m_UART[i].nRxHead++] = m_UART[i].nRxBufferDMA[m_UART[i].nRxTailDMA++];
-			if (m_UART[i].nRxTailDMA >= BUFFER_SIZE_RX_DMA)
-			{
-				m_UART[i].nRxTailDMA = 0;
-			}
-			if (m_UART[i].nRxHead >= BUFFER_SIZE_RX)
-			{
-				m_UART[i].nRxHead = 0;
-			}
+			// the new way handles the whole message
+			ModemData_ReceiveSpan(pData, nLength);
 		}
+//		else
+//		{
+//			ServiceRxRASP(nRxChar);
+//		}
+		UART_RxRelease(CLIENT_DATA_LINK, nLength);
+	}
+	while ((nLength = UART_RxPeek(CLIENT_COMPASS, &pData)) != 0)
+	{
+		Compass_ServiceRxSpan(pData, nLength);
+		UART_RxRelease(CLIENT_COMPASS, nLength);
 	}
-} // End UART_ServiceRxBufferDMA()
+} // End UART_ServiceRxBuffer()
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   UART_ServiceRxBuffer()
+;   UART_RxPeek()
 ;
 ; Description:
-;   Services all clients that have received new data on their seconday receive
-;   buffer and then calls the service receive function for the client in
-;   which the client should handle any newly received data, but should not
-;   initiate a transmission.
+;   Gives the client a view of the oldest bytes it has not released yet,
+;   straight out of the DMA buffer.  The view stops at the end of the
+;   buffer, so data that wraps needs a second peek after the first span
+;   has been released.  The bytes stay valid until they are released or
+;   the DMA catches up with them.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to read from
+;   U_BYTE **ppData => set to the first byte of the span
+;
+; Returns:
+;   U_INT16 => bytes in the span, 0 if nothing is waiting
 ;
 ; Reentrancy:
-;   No
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT16 UART_RxPeek(UART_CLIENT eClient, const U_BYTE **ppData)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nLength;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	nLength = uARTx_RxPending(pUARTx);
+	if (nLength > (BUFFER_SIZE_RX_DMA - pUARTx->nRxTailDMA))
+	{
+		nLength = BUFFER_SIZE_RX_DMA - pUARTx->nRxTailDMA;
+	}
+	*ppData = &pUARTx->nRxBufferDMA[pUARTx->nRxTailDMA];
+	return nLength;
+} // End UART_RxPeek()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_RxRelease()
 ;
+; Description:
+;   Gives the oldest received bytes back to the DMA once the client is done
+;   with them.
+;
+; Parameters:
+;   UART_CLIENT eClient => client that read the data
+;   U_INT16 nLength => bytes to release, more than are waiting releases all
+;
+; Reentrancy:
+;   No, one reader per client
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-void UART_ServiceRxBuffer(void)
+void UART_RxRelease(UART_CLIENT eClient, U_INT16 nLength)
 {
-	U_BYTE i, nRxChar;
+	UART_SELECT *pUARTx;
+	U_INT16 nPending;
 
-	for (i = 0; i < NUM_UART_STREAMS; i++)
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return;
+	}
+	nPending = uARTx_RxPending(pUARTx);
+	if (nLength > nPending)
+	{
+		nLength = nPending;
+	}
+	pUARTx->nRxTailDMA = (pUARTx->nRxTailDMA + nLength) % BUFFER_SIZE_RX_DMA;
+	pUARTx->nRxRead += nLength;
+	pUARTx->nRxScanned = (pUARTx->nRxScanned > nLength) ? (pUARTx->nRxScanned - nLength) : 0;
+	m_UartRxStats[pUARTx - m_UART].nReceived += nLength;
+} // End UART_RxRelease()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_RxFindDelimiter()
+;
+; Description:
+;   Looks for a delimiter in the bytes waiting for the client.  The search
+;   carries on from where the last call stopped, so each received byte is
+;   looked at once however often the client polls for a partial message.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to search
+;   U_BYTE nDelimiter => byte that ends a message
+;   U_INT16 *pLength => set to the message length including the delimiter
+;
+; Returns:
+;   BOOL => TRUE if a whole message is waiting
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL UART_RxFindDelimiter(UART_CLIENT eClient, U_BYTE nDelimiter, U_INT16 *pLength)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nPending;
+	U_INT16 nIndex;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return FALSE;
+	}
+	nPending = uARTx_RxPending(pUARTx);
+	nIndex = (pUARTx->nRxTailDMA + pUARTx->nRxScanned) % BUFFER_SIZE_RX_DMA;
+	while (pUARTx->nRxScanned < nPending)
 	{
-		while(m_UART[i].nRxHead != m_UART[i].nRxTail)
+		if (pUARTx->nRxBufferDMA[nIndex] == nDelimiter)
 		{
-			nRxChar = m_UART[i].nRxBuffer[m_UART[i].nRxTail++];
-			// Wrap the tail
-			if (m_UART[i].nRxTail >= BUFFER_SIZE_RX)
-			{
-				m_UART[i].nRxTail = 0;
-			}
-			switch (m_UART[i].eClient)
-			{
-				case CLIENT_DATA_LINK:
-					if(GetModemIsPresent())
-					{
-						// the new way handles the whole message
-						ModemData_ReceiveData(nRxChar);
-//						ModemData_ReceiveRxData(nRxChar);
-					}
-//					else
-//					{
-//						ServiceRxRASP(nRxChar);
-//					}
-					break;
-				case CLIENT_COMPASS:
-					Compass_ServiceRxData(nRxChar);
-					break;
-				default:
-					break;
-			}
+			*pLength = pUARTx->nRxScanned + 1;
+			return TRUE;
+		}
+		pUARTx->nRxScanned++;
+		if (++nIndex >= BUFFER_SIZE_RX_DMA)
+		{
+			nIndex = 0;
 		}
 	}
-} // End UART_ServiceRxBuffer()
+	return FALSE;
+} // End UART_RxFindDelimiter()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxUpdate()
+;
+; Description:
+;   Catches up with the receive DMA's write position.  Called from the DMA
+;   half and full transfer interrupts, the USART idle line interrupt and by
+;   the client before it looks at the buffer.  The interrupts come at least
+;   every half buffer, so the DMA can never lap the last known position
+;   unseen.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to update
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_RxUpdate(UART_SELECT *pUARTx)
+{
+	U_INT32 nOldState;
+	U_INT16 nHead;
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+	nHead = BUFFER_SIZE_RX_DMA - (U_INT16)pUARTx->pRxDMA->NDTR;
+	if (nHead >= BUFFER_SIZE_RX_DMA)
+	{
+		nHead = 0;
+	}
+	pUARTx->nRxWritten += (nHead + BUFFER_SIZE_RX_DMA - pUARTx->nRxHeadDMA) % BUFFER_SIZE_RX_DMA;
+	pUARTx->nRxHeadDMA = nHead;
+	__set_interrupt_state((__istate_t)nOldState);
+} // End uARTx_RxUpdate()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxPending()
+;
+; Description:
+;   Reports how many received bytes are waiting for the client.  If the DMA
+;   has come round to the client's unreleased data some of it has been
+;   overwritten, so everything waiting is thrown away and counted in
+;   m_UartRxStats rather than handed over half new and half old.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to check
+;
+; Returns:
+;   U_INT16 => bytes waiting, starting at nRxTailDMA
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static U_INT16 uARTx_RxPending(UART_SELECT *pUARTx)
+{
+	UART_RX_STATS *pStats = &m_UartRxStats[pUARTx - m_UART];
+	U_INT32 nOldState;
+	U_INT32 nPending;
+	U_INT16 nHead;
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+	uARTx_RxUpdate(pUARTx);
+	nPending = pUARTx->nRxWritten - pUARTx->nRxRead;
+	nHead = pUARTx->nRxHeadDMA;
+	__set_interrupt_state((__istate_t)nOldState);
+
+	if (nPending >= BUFFER_SIZE_RX_DMA)
+	{
+		pStats->nOverruns++;
+		pStats->nOverrunBytes += nPending;
+		pUARTx->nRxRead += nPending;
+		pUARTx->nRxTailDMA = nHead;
+		pUARTx->nRxScanned = 0;
+		nPending = 0;
+	}
+	if (nPending > pStats->nMaxPending)
+	{
+		pStats->nMaxPending = (U_INT16)nPending;
+	}
+	return (U_INT16)nPending;
+} // End uARTx_RxPending()
 
 /*******************************************************************************
 *       @details
@@ -447,6 +629,33 @@ void UART_SendMessage(
 	}
 } // End UART_SendMessage()
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static UART_SELECT *uART_GetSelect(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+
+	// Given a client, get the pointer to the client's UART_SELECT structure
+	switch (eClient)
+	{
+		case CLIENT_DATA_LINK:
+			pUARTx = &m_UART[INDEX_UART_DATA_LINK];
+			break;
+		case CLIENT_COMPASS:
+			pUARTx = &m_UART[INDEX_UART_COMPASS];
+			break;
+		default:
+			return NULL;
+	}
+	// Verify the client configured in the UART_SELECT structure matches
+	if (pUARTx->eClient != eClient)
+	{
+		return NULL;
+	}
+	return pUARTx;
+} // End uART_GetSelect()
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -490,10 +699,16 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
 	DMA_InitStructure.DMA_Channel = (U_INT32)(pUARTx->nRxDMAChannel);
 	DMA_Init(pUARTx->pRxDMA, &DMA_InitStructure);
-	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE), ENABLE);
+	// The half and full transfer interrupts keep the receive head up to date
+	// while data streams in without a break
+	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE | DMA_IT_TC), ENABLE);
 	// Reconfiguring the DMA will reset the leading receive buffer index
 	// and the trailing index must be reset manually to keep them synchronized
+	pUARTx->nRxHeadDMA = 0;
 	pUARTx->nRxTailDMA = 0;
+	pUARTx->nRxWritten = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
 	// DMA configuration for UARTx_TX (transmitting)
 	DMA_DeInit(pUARTx->pTxDMA);
 	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)(pUARTx->nTxBufferDMA);
@@ -528,6 +743,8 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	// transfer complete interrupt (bitwise OR of the two interrupts sets
 	// incorrect bits in control register)
 	USART_ITConfig(pUARTx->pUART, USART_IT_ERR, ENABLE);
+	// The idle line interrupt marks the end of each burst of received data
+	USART_ITConfig(pUARTx->pUART, USART_IT_IDLE, ENABLE);
 	// Enable the peripheral
 	USART_Cmd(pUARTx->pUART, ENABLE);
 	// Enable DMA for receiving data
@@ -565,6 +782,14 @@ static void uARTx_IRQHandler(UART_SELECT *pUARTx)
 		(void)pUARTx->pUART->SR;
 		(void)pUARTx->pUART->DR;
 	}
+	if (pUARTx->pUART->SR & USART_FLAG_IDLE)
+	{
+		// Idle line, cleared by the same status then data register read.
+		// The DMA has already taken the last byte, so the read loses nothing
+		(void)pUARTx->pUART->SR;
+		(void)pUARTx->pUART->DR;
+		uARTx_RxUpdate(pUARTx);
+	}
 	if (pUARTx->pUART->SR & USART_FLAG_TC)
 	{
 		// Transfer complete
@@ -664,10 +889,12 @@ void DMA2_Stream5_IRQHandler(void)
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_HTIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_HTIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_TCIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_TCIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 } // End DMA2_Channel5_IRQHandler()
 
@@ -758,9 +985,11 @@ void DMA1_Stream5_IRQHandler(void)
 	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_HTIF5))
 	{
 		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_HTIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_COMPASS]);
 	}
 	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TCIF5))
 	{
 		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TCIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_COMPASS]);
 	}
 } // End DMA1_Channel5_IRQHandler()
@@ -134,6 +134,32 @@ void Compass_ServiceRxData(U_BYTE nData)
 	tCompassGapTimer = ElapsedTimeLowRes((TIME_RT)0);
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void Compass_ServiceRxSpan(const U_BYTE *pData, U_INT16 nLength)
+{
+	U_INT16 nPiece;
+
+	while(nLength > 0)
+	{
+		nPiece = COMPASS_RECEIVE_BUFFER_SIZE - m_nCompassRxCount;
+		if(nPiece > nLength)
+		{
+			nPiece = nLength;
+		}
+		memcpy(&m_nCompassReceiveBuffer[m_nCompassRxCount], pData, nPiece);
+		m_nCompassRxCount += nPiece;
+		if(m_nCompassRxCount >= COMPASS_RECEIVE_BUFFER_SIZE)
+		{
+			m_nCompassRxCount = 0;
+		}
+		pData += nPiece;
+		nLength -= nPiece;
+	}
+	tCompassGapTimer = ElapsedTimeLowRes((TIME_RT)0);
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
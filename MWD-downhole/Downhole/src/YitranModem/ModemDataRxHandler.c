@@ -131,6 +131,34 @@ void ModemData_ReceiveData(U_BYTE nData)
 	tMessageGapTimer = ElapsedTimeLowRes((TIME_RT)0);
 }//end ModemData_ReceiveRxData
 
+/*******************************************************************************
+*       @details
+*       Same as ModemData_ReceiveData() for a span of the UART receive
+*       buffer, copied in at most two pieces.
+*******************************************************************************/
+void ModemData_ReceiveSpan(const U_BYTE *pData, U_INT16 nLength)
+{
+	U_INT16 nPiece;
+
+	while(nLength > 0)
+	{
+		nPiece = MODEM_RECEIVE_BUFFER_SIZE - m_nModemReceiveBufferHead;
+		if(nPiece > nLength)
+		{
+			nPiece = nLength;
+		}
+		memcpy(&m_nModemReceiveBuffer[m_nModemReceiveBufferHead], pData, nPiece);
+		m_nModemReceiveBufferHead += nPiece;
+		if(m_nModemReceiveBufferHead >= MODEM_RECEIVE_BUFFER_SIZE)
+		{
+			m_nModemReceiveBufferHead = 0;
+		}
+		pData += nPiece;
+		nLength -= nPiece;
+	}
+	tMessageGapTimer = ElapsedTimeLowRes((TIME_RT)0);
+}//end ModemData_ReceiveSpan
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
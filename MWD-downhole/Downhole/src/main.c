@@ -355,13 +355,8 @@ void main(void)
                         state_changed = 0;
 //                        tLiveTimer = ElapsedTimeLowRes(0);
                 }
-                // This function moves serial data from the DMA receiving buffer to the
-                // main receive buffer for the UART module.  It should be big enough to
-                // handle a full Cycle Handler's worth of data
-                UART_ServiceRxBufferDMA();
-                // This function moves serial data from the UART receiving buffer to the
-                // applications message buffer.  It should be big enough to handle a
-                // full Serial Message.
+                // This function hands serial data straight from the DMA receiving
+                // buffer to the applications message buffers, a span at a time.
                 UART_ServiceRxBuffer();
                 // handle the Ytran RX buffer
                 ProcessModemBuffer();
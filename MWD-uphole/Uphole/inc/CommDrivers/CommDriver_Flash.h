@@ -31,6 +31,11 @@ typedef enum
 
 #define FLASH_PAGE_SIZE             512
 
+// Page writes waiting for, or in, the write engine.  A full queue makes
+// FLASH_QueueWrite() return false and the caller falls back to a blocking
+// FLASH_WritePage().
+#define FLASH_WRITE_QUEUE_SIZE      4
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -40,6 +45,22 @@ typedef struct _FLASH_PAGE
 	U_BYTE  AsBytes[FLASH_PAGE_SIZE];
 } FLASH_PAGE;
 
+// Called from FLASH_WriteService() once a queued page is programmed, or has
+// failed.  It may queue another write.
+typedef void (*FLASH_WRITE_CALLBACK)(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus);
+
+typedef struct
+{
+	U_INT32 nQueued;        // writes accepted
+	U_INT32 nCoalesced;     // writes folded into a queued write of the same page
+	U_INT32 nCompleted;
+	U_INT32 nFailed;        // erase or program timed out
+	U_INT32 nQueueFull;     // writes refused, the caller wrote synchronously
+	U_BYTE  nMaxDepth;      // deepest the queue has been
+} FLASH_WRITE_STATS;
+
+extern FLASH_WRITE_STATS m_FlashWriteStats;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -53,6 +74,13 @@ extern "C" {
 	BOOL FLASH_WaitForReady(TIME_LR tDelay);
 	FLASH_PAGE_STATUS FLASH_ReadPage(FLASH_PAGE *page, U_INT32 nPageNumber);
 	FLASH_PAGE_STATUS FLASH_WritePage(FLASH_PAGE *page, U_INT32 nPageNumber);
+	BOOL FLASH_QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback);
+	BOOL FLASH_QueueWriteRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback);
+	BOOL FLASH_QueueAppendRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback);
+	BOOL FLASH_GetQueuedPage(FLASH_PAGE *page, U_INT32 nPageNumber);
+	U_BYTE FLASH_GetWriteQueueDepth(void);
+	void FLASH_WriteService(void);
+	BOOL FLASH_FlushWrites(void);
 
 #ifdef __cplusplus
 }
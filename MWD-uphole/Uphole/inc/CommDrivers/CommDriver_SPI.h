@@ -28,6 +28,10 @@ typedef enum
 	SPI_DEVICE_FRAM
 }SPI_DEVICE;
 
+// Called from the DMA interrupt when a block started by SPI_StartBlock()
+// ends.  The chip select has already been released if that was asked for.
+typedef void (*SPI_BLOCK_CALLBACK)(SPI_DEVICE nDevice, BOOL bSuccess);
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -41,6 +45,11 @@ extern "C" {
 	void SPI_ResetTransferTimeOut(void);
 	BOOL SPI_ChipSelect(SPI_DEVICE nDevice, BOOL bSelect);
 	U_BYTE SPI_TransferByte(U_BYTE nDataByte);
+	BOOL SPI_TransferBlock(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength);
+	BOOL SPI_StartBlock(SPI_DEVICE nDevice, const U_BYTE *pTxData, U_BYTE *pRxData,
+	                    U_INT16 nLength, BOOL bDeselect, SPI_BLOCK_CALLBACK pCallback);
+	BOOL SPI_IsBlockBusy(void);
+	BOOL SPI_WaitForBlock(void);
 
 #ifdef __cplusplus
 }
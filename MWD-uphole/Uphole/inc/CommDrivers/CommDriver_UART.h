@@ -29,15 +29,13 @@
 #define BAUD_RATE_38400         38400
 #define BAUD_RATE_57600         57600
 
-// UART buffers are serviced from cycleHandler() every 10ms. At 19200 baud,
-// we could receive approximately 20 bytes per 10ms cycle. (20 is the absolute
-// minimum size of the RX_DMA buffer)
-//
-// The RX buffer is twice the size of the RX_DMA buffer because some UART
-// clients are serviced on the alternate cycle (i.e. every 20ms)
-// and the RX_DMA buffer is transferred to the RX buffer every 10ms cycle.
-#define BUFFER_SIZE_RX_DMA  256
-#define BUFFER_SIZE_RX     256
+// Received data stays in the circular DMA buffer until the client releases
+// it, there is no second copy.  The DMA half and full transfer interrupts
+// and the USART idle line interrupt keep track of how much has arrived, so
+// the buffer only has to hold what arrives between two passes of the client.
+// The PC port has to hold a full upload window of CSV lines while a flash
+// page write holds up the main loop.  Must be a power of two.
+#define BUFFER_SIZE_RX_DMA 2048
 
 // UART transmit buffer of 128 bytes provides enough space to transmit most
 // messages in full. The Data Link is capable of sending a message larger
@@ -45,6 +43,14 @@
 // of a message to generate a complete message.
 #define UART_BUFFER_SIZE_TX 256
 
+// Each UART keeps a queue of pending transmits which the DMA transfer
+// complete interrupt works through one after the other.  Messages sent with
+// UART_SendMessage() are copied into a ring of UART_TX_COPY_SIZE bytes, so
+// a message may be up to UART_TX_COPY_SIZE - 1 bytes long.  The ring holds
+// two PC bulk transfer frames so one can be built while the other is sent.
+#define UART_TX_QUEUE_SIZE  8
+#define UART_TX_COPY_SIZE   2048
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -58,6 +64,27 @@ typedef enum
 
 typedef void (*UART_CALLBACK_TX)(void);
 
+typedef struct
+{
+	U_INT32 nQueued;        // messages accepted into the transmit queue
+	U_INT32 nRejected;      // messages refused because the queue was full
+	U_INT32 nErrors;        // DMA transfer errors
+	U_INT16 nMaxDepth;      // most messages waiting at once
+	U_INT16 nMaxCopyUsed;   // most copy ring bytes in use at once
+} UART_TX_STATS;
+
+extern UART_TX_STATS m_UartTxStats[NUM_UART_STREAMS];
+
+typedef struct
+{
+	U_INT32 nReceived;      // bytes released by the client
+	U_INT32 nOverruns;      // times the DMA caught up with the client
+	U_INT32 nOverrunBytes;  // bytes thrown away by those overruns
+	U_INT16 nMaxPending;    // most bytes waiting for the client at once
+} UART_RX_STATS;
+
+extern UART_RX_STATS m_UartRxStats[NUM_UART_STREAMS];
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -68,13 +95,21 @@ extern "C" {
 
 	void UART_InitPins(void);
 	void UART_Init(void);
-	void UART_ServiceRxBufferDMA(void);
 	void UART_ServiceRxBuffer(void);
 	void UART_ProcessRxData(void);
 	BOOL UART_SendMessage(UART_CLIENT eClient,
 	const U_BYTE *pData, U_INT16 nDataLen );
-        U_INT16 UART_ReceiveMessage(UART_CLIENT eClient, 
-        U_BYTE *pData, U_INT16 nDataLen);
+	BOOL UART_SendMessageNoCopy(UART_CLIENT eClient,
+	const U_BYTE *pData, U_INT16 nDataLen, UART_CALLBACK_TX pfDone);
+	BOOL UART_IsTxBusy(UART_CLIENT eClient);
+	U_INT16 UART_GetTxQueueDepth(UART_CLIENT eClient);
+	U_INT16 UART_GetTxQueueFree(UART_CLIENT eClient);
+	U_INT16 UART_RxPeek(UART_CLIENT eClient, const U_BYTE **ppData);
+	void UART_RxRelease(UART_CLIENT eClient, U_INT16 nLength);
+	BOOL UART_RxFindDelimiter(UART_CLIENT eClient, U_BYTE nDelimiter,
+	U_INT16 *pLength);
+	BOOL UART_ReceiveMessage(UART_CLIENT eClient,
+	U_BYTE *pData, U_INT16 nDataLen);
 
 #ifdef __cplusplus
 }
@@ -17,6 +17,7 @@
 
 #include "portable.h"
 #include "rtc.h"
+#include "CommDriver_Flash.h"
 #include "Calc_AveAngleMinCurve.h"
 
 //============================================================================//
@@ -24,6 +25,11 @@
 //============================================================================//
 
 #define MAX_BOREHOLE_NAME_BYTES 16
+// Serial flash pages kept for the survey journal, see RecordManager.c
+#define RECORD_JOURNAL_PAGES    8
+// Branches of the current hole the branch tree keeps, see RecordManager.c
+#define RECORD_MAX_BRANCHES     32
+#define RECORD_NO_BRANCH        0xFFFF
 
 typedef struct __STRUCT_RECORD_DATA__
 {
@@ -81,6 +87,95 @@ typedef struct _NEWHOLE_INFO
     INT16 DesiredAzimuth;
 }NEWHOLE_INFO;
 
+// Serial flash layout of the log, for code that moves whole pages.  Hole
+// info pages start at page 0 and record pages at RECORD_AREA_BASE_ADDRESS.
+#define RECORD_AREA_BASE_ADDRESS    128
+#define RECORDS_PER_PAGE            (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(STRUCT_RECORD_DATA))
+#define NEW_HOLE_RECORDS_PER_PAGE   (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(NEWHOLE_INFO))
+
+typedef struct _RECORD_PAGE_CACHE_STATS
+{
+    U_INT32 nHits;          // record page found in RAM
+    U_INT32 nMisses;        // record page read from flash
+    U_INT32 nInvalidations; // cache flushes caused by a flash rewrite
+} RECORD_PAGE_CACHE_STATS;
+
+typedef struct _RECORD_JOURNAL_STATS
+{
+    U_INT32 nEntries;       // surveys journaled instead of rewriting their page
+    U_INT32 nPageWrites;    // record pages erased and programmed
+    U_INT32 nCompactions;   // page writes that folded in journaled surveys
+    U_INT32 nCheckpoints;
+    U_INT32 nJournalErases; // journal pages erased to start a new one
+    U_INT32 nFallbacks;     // surveys written straight to their page
+    U_INT32 nFailed;        // journal programs the flash failed
+    U_INT32 nReplayed;      // entries folded into record pages at power up
+} RECORD_JOURNAL_STATS;
+
+extern RECORD_JOURNAL_STATS m_RecordJournalStats;
+
+typedef struct _BOREHOLE_STATS_RECOVERY
+{
+    U_INT32 nCommits;       // statistics slots written
+    U_INT32 nRollbacks;     // power ups that found a change half done
+    U_INT32 nRebuilds;      // power ups with neither slot valid
+    U_INT32 nBadSlots;      // slots that failed their CRC at power up
+    U_INT16 nLastRollback;  // operation that was rolled back
+} BOREHOLE_STATS_RECOVERY;
+
+extern BOREHOLE_STATS_RECOVERY m_BoreholeStatsRecovery;
+
+typedef struct _RECORD_RECOMPUTE_STATS
+{
+    U_INT32 nRequests;      // desired azimuth changes that started a recompute
+    U_INT32 nRestarts;      // started over after a power up, a removal or a branch
+    U_INT32 nPages;         // record pages redone into their shadow
+    U_INT32 nRecords;       // surveys redone
+    U_INT32 nCompleted;     // recomputes swapped in
+    U_INT32 nCopiedBack;    // swapped in pages copied back from their shadow
+    U_INT32 nNoRoom;        // dropped, no room for the shadow pages
+    U_INT32 nShadowFailures;// shadow pages that failed to program
+} RECORD_RECOMPUTE_STATS;
+
+extern RECORD_RECOMPUTE_STATS m_RecordRecomputeStats;
+
+// One branch of the current hole.  Branch 0 is the hole itself.  The surveys
+// drilled on a branch are stored one after the other, so a branch holds the
+// records from nFirstRecord up to nEndRecord and leaves its parent after
+// nTieInRecord.  The totals are those at the end of the branch.
+typedef struct _RECORD_BRANCH
+{
+    U_INT16 nFirstRecord;   // absolute index of the first survey
+    U_INT16 nEndRecord;     // one past the last survey
+    U_INT16 nTieInRecord;   // survey on the parent it leaves from, 0 for branch 0
+    U_INT16 nParent;        // RECORD_NO_BRANCH for branch 0
+    U_INT16 nLevel;         // branches between this one and the hole
+    U_INT16 nSurveys;       // surveys from the collar to the end of the branch
+    U_INT32 TotalLength;
+    INT32 TotalDepth;
+    REAL32 TotalNorthings;
+    REAL32 TotalEastings;
+} RECORD_BRANCH;
+
+// Walks the surveys of a branch from the collar down, see
+// RECORD_BranchWalkStart()
+typedef struct _RECORD_BRANCH_WALK
+{
+    U_BYTE nPath[RECORD_MAX_BRANCHES];  // branches from the hole down
+    U_BYTE nLevels;
+    U_BYTE nLevel;
+    U_INT32 nNext;          // next record to hand out
+    U_INT32 nSpanEnd;       // end of the records taken from nPath[nLevel]
+} RECORD_BRANCH_WALK;
+
+typedef struct _RECORD_BRANCH_TREE_STATS
+{
+    U_INT32 nRebuilds;      // trees worked out again from the record pages
+    U_INT32 nOverflows;     // holes with more than RECORD_MAX_BRANCHES branches
+} RECORD_BRANCH_TREE_STATS;
+
+extern RECORD_BRANCH_TREE_STATS m_RecordBranchTreeStats;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -128,6 +223,29 @@ extern "C" {
     void RECORD_MergeRecord(STRUCT_RECORD_DATA* record);
     //   Retrieves selected record from record table
     BOOL RECORD_GetRecord(STRUCT_RECORD_DATA* record, U_INT32 recordNumber);
+    //   Finds the deepest record of the hole at or above a measured depth
+    U_INT32 RECORD_FindRecordByDepth(U_INT32 nTotalLength);
+    //   Folds surveys left in the journal into their pages, at power up
+    void RECORD_JournalRecover(void);
+    //   Background compaction of the journal, from the 100 ms tick
+    void RECORD_JournalService(void);
+    //   Writes out everything the journal holds, before power down
+    void RECORD_JournalFlush(void);
+    //   Restores the borehole statistics from the newest committed slot
+    void RECORD_RecoverBoreholeStats(void);
+    //   Redoes the positions of the hole for a new desired azimuth
+    void RECORD_RequestRecompute(void);
+    //   One page of the recompute or its copy back, from the 10 ms tick
+    void RECORD_RecomputeService(void);
+    //   Retrieves a branch of the current hole
+    BOOL RECORD_GetBranch(RECORD_BRANCH* pBranch, U_INT16 nBranch);
+    //   Finds the branch a record was drilled on
+    U_INT16 RECORD_FindBranch(U_INT32 nRecord);
+    //   Finds the survey a record was measured from
+    U_INT32 RECORD_GetPreviousRecord(U_INT32 nRecord);
+    //   Walks the surveys of a branch from the collar down
+    BOOL RECORD_BranchWalkStart(RECORD_BRANCH_WALK* pWalk, U_INT16 nBranch);
+    BOOL RECORD_BranchWalkNext(RECORD_BRANCH_WALK* pWalk, U_INT32* pnRecord);
     //   Retrieves selected New Hole Info record from flash
     BOOL NewHole_Info_Read(NEWHOLE_INFO* NewHoleInfo, U_INT32 HoleNumber);
     //   Requests merge for next record
@@ -191,6 +309,12 @@ extern "C" {
     void StoreUploadedRecord(STRUCT_RECORD_DATA* record);
     void GetBoreholeStats(BOREHOLE_STATISTICS* stats);
     void SetBoreholeStats(BOREHOLE_STATISTICS* stats);
+    //   Gets the record page cache hit and miss counters
+    const RECORD_PAGE_CACHE_STATS* RECORD_GetPageCacheStats(void);
+    //   Copies a record page with every survey taken so far
+    FLASH_PAGE_STATUS RECORD_ReadRecordPage(FLASH_PAGE* pPage, U_INT32 pageNumber);
+    //   Copies a hole info page as it stands
+    FLASH_PAGE_STATUS RECORD_ReadHoleInfoPage(FLASH_PAGE* pPage, U_INT32 pageNumber);
 
 
 
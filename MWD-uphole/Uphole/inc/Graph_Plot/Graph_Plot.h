@@ -41,6 +41,15 @@ struct GraphPlotArea
 	INT16 Bottom_Right_Y;
 };
 
+typedef struct
+{
+	U_INT32 nSegments;      // segments handed to GRAPH_Line()
+	U_INT32 nMerged;        // segments folded into a row or column span
+	U_INT32 nLinesDrawn;    // GLCD_Line() calls made
+} GRAPH_LINE_STATS;
+
+extern GRAPH_LINE_STATS m_GraphLineStats;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -52,6 +61,8 @@ extern "C" {
 	INT16 Round_Down_10(INT16 num);
 	INT16 Round_Up_10(INT16 num);
 	void PlotGraph(void);
+	void GRAPH_Line(INT16 X1, INT16 Y1, INT16 X2, INT16 Y2);
+	void GRAPH_LineFlush(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,87 @@
+/*******************************************************************************
+*       @brief      Header File for the trajectory cache used by the plan,
+*                   side and gamma graphs.
+*       @file       Uphole/inc/Graph_Plot/Trajectory_Cache.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef TRAJECTORY_CACHE_H
+#define TRAJECTORY_CACHE_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Stations of the current hole kept in RAM.  A longer hole is thinned out to
+// fit and drawn from the stations kept; all of them are still folded into
+// the bounds.
+#define TRAJECTORY_CACHE_SIZE   512
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// The fields of a record the graphs plot, named as in STRUCT_RECORD_DATA
+typedef struct
+{
+	INT32 Z;                        // downtrack
+	INT16 X;                        // left/right
+	INT16 Y;                        // up/down
+	U_INT16 nTotalLength;
+	INT16 nGamma;
+	INT16 PreviousBranchRecordNum;
+} TRAJECTORY_STATION;
+
+typedef struct
+{
+	INT32 nMaxZ;
+	INT32 nMinZ;
+	INT16 nMaxX;
+	INT16 nMinX;
+	INT16 nMaxY;
+	INT16 nMinY;
+	U_INT16 nMaxTotalLength;
+	U_INT16 nMinTotalLength;
+	INT16 nMaxGamma;
+	INT16 nMinGamma;
+} TRAJECTORY_BOUNDS;
+
+typedef struct
+{
+	U_INT32 nAppended;      // stations read from flash once and kept
+	U_INT32 nRebuilds;      // cache restarted for a new hole
+	U_INT32 nTruncations;   // stations dropped by a delete or a branch
+	U_INT32 nThinned;       // times a long hole dropped every other station
+	U_INT32 nFlashReads;    // stations read from the record pages instead
+} TRAJECTORY_CACHE_STATS;
+
+extern TRAJECTORY_CACHE_STATS m_TrajectoryCacheStats;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void TRAJECTORY_Sync(void);
+	void TRAJECTORY_Truncate(U_INT32 nRecord);
+	void TRAJECTORY_GetStation(TRAJECTORY_STATION *pStation, U_INT32 nRecord);
+	BOOL TRAJECTORY_GetNextStation(TRAJECTORY_STATION *pStation, U_INT32 *pnRecord, U_INT32 nEndRecord);
+	void TRAJECTORY_GetBounds(TRAJECTORY_BOUNDS *pBounds, BOOL bFromOrigin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRAJECTORY_CACHE_H
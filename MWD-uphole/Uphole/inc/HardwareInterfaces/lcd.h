@@ -34,6 +34,19 @@
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
 
+// Display bus traffic of LCD_Update(), bytes include the command and cursor
+// address bytes.
+typedef struct
+{
+	U_INT32 nFrames;        // updates that sent at least one page
+	U_INT32 nSpans;         // cursor moves, one per run of dirty bytes
+	U_INT32 nLastBytes;     // bytes written by the latest update
+	U_INT32 nMaxBytes;
+	U_INT32 nTotalBytes;
+} LCD_UPDATE_STATS;
+
+extern LCD_UPDATE_STATS m_LcdUpdateStats;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -58,6 +71,8 @@ extern "C" {
 	void GLCD_Circle(U_INT16 cx, U_INT16 cy ,U_INT16 radius);
 	void GLCD_SemiCircle(U_INT16 cx, U_INT16 cy ,U_INT16 radius);
 	void clearLCD(void);
+	void LCD_MarkDirty(BOOL bPage, U_INT16 nRow, U_INT16 nLoByte, U_INT16 nHiByte);
+	void LCD_MarkRowsDirty(BOOL bPage, U_INT16 nFirstRow, U_INT16 nLastRow);
 
 #ifdef __cplusplus
 }
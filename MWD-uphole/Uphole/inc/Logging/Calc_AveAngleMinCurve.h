@@ -43,6 +43,14 @@ typedef struct __EASTING_NORTHING_DATA_STRUCT__
 	REAL32 fDepth;
 } EASTING_NORTHING_DATA_STRUCT;
 
+// A survey as it is stored, angles in tenths of a degree
+typedef struct __MIN_CURVE_STATION__
+{
+	INT16   nAzimuth;
+	INT16   nInclination;
+	INT32   nPipeLength;
+} MIN_CURVE_STATION;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -60,6 +68,17 @@ extern "C" {
                                POSITION_DATA_STRUCT         *nStarting,
                                POSITION_DATA_STRUCT         *nEnding);
 
+    //  Calculates the same from a sine table, in single precision
+    ///@param nResult         - pointer to Easting and Northing Data
+    ///@param nStarting       - pointer to starting survey
+    ///@param nEnding         - pointer to ending survey
+    ///@param nDesiredAzimuth - tenths of a degree
+    ///@return BOOL
+    BOOL Calc_MinCurveTenths(EASTING_NORTHING_DATA_STRUCT *nResult,
+                             const MIN_CURVE_STATION      *nStarting,
+                             const MIN_CURVE_STATION      *nEnding,
+                             INT16                        nDesiredAzimuth);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,83 @@
+/*******************************************************************************
+*       @brief      Header File for the execution time profiler.
+*       @file       Uphole/inc/Profile.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Set to 0 to compile every probe out of the firmware.
+#define PROFILE_ENABLED 1
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// One entry per instrumented code path.  Add new probes above PROFILE_MAX.
+typedef enum
+{
+	PROFILE_DRAW_PLAN_GRAPH,
+	PROFILE_DRAW_SIDE_GRAPH,
+	PROFILE_DRAW_SIDE_GAMMA_GRAPH,
+	PROFILE_DRAW_GAMMA_GRAPH,
+	PROFILE_PC_DOWNLOAD,      // one record of the CSV dump, SEND_LOG1 to SEND_LOG4
+	PROFILE_PC_UPLOAD_LINE,
+	PROFILE_RECORD_PAGE_READ,
+	PROFILE_RECORD_PAGE_WRITE,
+	PROFILE_MIN_CURVE,
+	PROFILE_LCD_UPDATE,
+	PROFILE_MAX
+} PROFILE_PROBE;
+
+typedef struct
+{
+	U_INT32 nCount;       // number of completed Start/Stop pairs
+	U_INT32 nLastCycles;  // core clock cycles of the last pass
+	U_INT32 nMinCycles;   // shortest pass seen
+	U_INT32 nMaxCycles;   // longest pass seen
+	U_INT64 nTotalCycles; // sum of all passes, for the average
+	U_INT32 nStartCycles; // DWT cycle count latched by PROFILE_Start()
+} PROFILE_STATS;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if PROFILE_ENABLED
+	void PROFILE_Init(void);
+	void PROFILE_Reset(void);
+	void PROFILE_Start(PROFILE_PROBE nProbe);
+	void PROFILE_Stop(PROFILE_PROBE nProbe);
+	const PROFILE_STATS* PROFILE_GetStats(PROFILE_PROBE nProbe);
+	U_INT32 PROFILE_CyclesToMicroseconds(U_INT32 nCycles);
+#else
+	#define PROFILE_Init()
+	#define PROFILE_Reset()
+	#define PROFILE_Start(nProbe)
+	#define PROFILE_Stop(nProbe)
+	#define PROFILE_GetStats(nProbe) ((const PROFILE_STATS*)NULL)
+	#define PROFILE_CyclesToMicroseconds(nCycles) (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
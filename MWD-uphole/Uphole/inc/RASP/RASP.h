@@ -24,8 +24,12 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
-// The present implementation of RASP only uses 4 bytes in the header
+// The present implementation of RASP only uses 3 bytes in the header, plus
+// an optional fourth carrying a sequence tag.  A request that carries a tag
+// gets it back in its reply, so the PC can keep several requests in flight
+// and match up the replies.
 #define RASP_HEADER_LEN 3
+#define RASP_TAGGED_HEADER_LEN 4
 #define MAX_RASP_LENGTH 255
 
 #define MSG_BUF_LEN (MAX_RASP_LENGTH - RASP_HEADER_LEN)
@@ -41,6 +45,7 @@
 
 // definition of the header bytes positions
 #define CMD_ID_POS 2            // the command ID position
+#define SEQUENCE_POS 3          // the sequence tag position, if present
 
 #define INTF_0000 (U_INT16)0x0000
 #define INTF_0000_CMD_00 (U_BYTE)0x00
@@ -98,6 +103,10 @@ typedef struct
                                         // pointer to a command validation function
                                         // set this to NULL to disable the command validation
                                         // function call
+    U_BYTE nMaxReplySize;               // the longest reply data the command sends, 0 if it
+                                        // does not reply.  A longer reply is still sent but
+                                        // is counted in the command's statistics.  Set this
+                                        // value to 0xFF when the reply length varies.
 }CMD_VALIDATION;
 
 //============================================================================//
@@ -142,6 +151,12 @@ extern "C" {
     ///@param  
     ///@return
     void ServiceRxRASP(U_BYTE nRxChar);
+
+    ///@brief  Feeds received characters to RASP, stopping at a complete message
+    ///@param  pData => the characters received
+    ///@param  nLength => number of characters
+    ///@return characters used; release these from the UART
+    U_INT16 ServiceRxRASPSpan(const U_BYTE *pData, U_INT16 nLength);
     
     ///@brief  
     ///@param  
@@ -121,6 +121,8 @@ typedef struct {
 	U_INT32 Newhole_start_page;
 	U_INT32	EVENTS_start_page;
 	U_INT32	EVENTS_pages_available;
+	U_INT32	NV_log_start_page;
+	U_INT32	Record_journal_start_page;
 } Flash_chip_type;
 
 typedef struct
@@ -150,6 +152,7 @@ extern U_BYTE Serflash_page_data[];
 extern NVRAM_image NVRAM_data;
 extern BOREHOLE_STATISTICS boreholeStatistics;
 extern NEWHOLE_INFO newHole_tracker;
+extern volatile Flash_chip_type Serial_Flash_Chip;
 
 void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
 void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber);
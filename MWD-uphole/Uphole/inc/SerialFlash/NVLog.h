@@ -0,0 +1,70 @@
+/*******************************************************************************
+*       @brief      Header File for the log-structured NV settings store.
+*       @file       Uphole/inc/SerialFlash/NVLog.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef NV_LOG_H
+#define NV_LOG_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Pages reserved at the top of the serial flash for the settings log.  Each
+// page starts with a full snapshot of the image and is then appended to with
+// records holding only the bytes that changed.  When a page fills, the next
+// page of the ring is erased and started with a new snapshot, so every page
+// is erased once per ring pass instead of once per save.
+#define NVLOG_PAGES             16
+#define NVLOG_MAX_IMAGE         256
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// The old scheme erased and programmed one page on every save, so nCommits
+// is what it would have cost in erases; compare it with nPageErases.
+typedef struct
+{
+	U_INT32 nCommits;           // saves that found something changed
+	U_INT32 nRecords;           // records appended, snapshots included
+	U_INT32 nSnapshots;
+	U_INT32 nBytesLogged;       // record bytes appended, headers included
+	U_INT32 nPagePrograms;      // page program cycles queued
+	U_INT32 nPageErases;        // page erase cycles queued
+	U_INT32 nFailed;            // queued writes the flash failed
+	U_INT32 nQueueFull;         // saves put off because the write queue was full
+	U_INT32 nRejected;          // saves the write queue refused with room to spare
+	U_INT32 nRecoveredSequence; // newest record found at power up
+	U_INT16 nRecoveredPage;     // ring page it was found in
+	U_INT16 nBadRecords;        // records that failed their CRC at power up
+} NVLOG_STATS;
+
+extern NVLOG_STATS m_NVLogStats;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	BOOL NVLOG_Recover(U_INT32 nFirstPage, U_BYTE *pImage, U_INT16 nLength);
+	BOOL NVLOG_Commit(const U_BYTE *pImage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NV_LOG_H
@@ -1,6 +1,6 @@
 /*******************************************************************************
-*       @brief      Implementation file for the PC data transfer
-*       @file       Uphole/inc/SerialProtocol/csvparser.h
+*       @brief      Header File for the streaming CSV line parser.
+*       @file       Uphole/inc/SerialProtocol/CSVParser.h
 *       @date       October 2023
 *       @copyright  COPYRIGHT (c) 2019 Target Drilling Inc. All rights are
 *                   reserved.  Reproduction in whole or in part is prohibited
@@ -9,34 +9,70 @@
 #ifndef INC_CSVPARSER_H_
 #define INC_CSVPARSER_H_
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-// Define a structure to represent CSVRowStructure
-typedef struct {
-    char** items;       // List of strings
-    int size;           // Size of the list
-    int isheader;       // Boolean flag for header
-    int current_column; // Current column index
-} CSVRowStructure;
-
-void init_CSVRowStructure(CSVRowStructure* row);
-void add_char_to_line_parser(CSVRowStructure* row, char character);
-void free_CSVRowStructure(CSVRowStructure* row);
-// Define a structure to represent CSVFileStructure
-typedef struct {
-    CSVRowStructure* csvrows; // List of CSVRowStructure objects
-    int size;                // Size of the list
-    int current_row;         // Current row index
-} CSVFileStructure;
-void init_CSVFileStructure(CSVFileStructure* fs);
-void add_row(CSVFileStructure* fs, const char* line, char delimiter);
-void print_CSVFileStructure(CSVFileStructure* fs);
-void free_CSVFileStructure(CSVFileStructure* fs);
-
-// setup csv
-void initCSVStructure(void);
-void add_data_row(const char *line, char delimiter);
-CSVFileStructure *getFileStructure(void);
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CSV_MAX_COLUMNS         40      // the survey CSV uses 35
+#define CSV_MAX_FIELD_LENGTH    64
+#define CSV_MAX_LINE_LENGTH     256     // all fields, each with its '\0'
+
+typedef enum
+{
+	CSV_OK,
+	CSV_TOO_MANY_COLUMNS,   // columns past CSV_MAX_COLUMNS were dropped
+	CSV_FIELD_TOO_LONG,     // a field was cut at CSV_MAX_FIELD_LENGTH
+	CSV_LINE_TOO_LONG,      // the line did not fit in CSV_MAX_LINE_LENGTH
+	CSV_BAD_QUOTE           // text after a closing quote, or quote not closed
+} CSV_STATUS;
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// Fields are stored one after another in sText, each null terminated, and
+// nColumnStart[] points at the start of each one, so every character is
+// handled once no matter how long the field is.
+typedef struct
+{
+	char sText[CSV_MAX_LINE_LENGTH];
+	U_INT16 nColumnStart[CSV_MAX_COLUMNS];
+	U_INT16 nLength;        // bytes of sText in use
+	U_INT16 nFieldLength;   // characters in the field being built
+	U_BYTE nColumns;        // fields started so far
+	BOOL bInQuotes;
+	BOOL bQuoteClosed;      // closing quote seen, waiting for the delimiter
+	BOOL bLineComplete;
+	BOOL bSkipLineFeed;     // line ended on '\r', drop the '\n' of a CRLF
+	BOOL bOverflow;         // out of room, ignore the rest of the line
+	CSV_STATUS eStatus;     // first problem seen on this line
+} CSV_LINE_PARSER;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void CSV_Init(CSV_LINE_PARSER *pParser);
+	BOOL CSV_AddChar(CSV_LINE_PARSER *pParser, char nChar);
+	CSV_STATUS CSV_ParseLine(CSV_LINE_PARSER *pParser, const char *pLine);
+	U_BYTE CSV_GetColumnCount(const CSV_LINE_PARSER *pParser);
+	const char* CSV_GetField(const CSV_LINE_PARSER *pParser, U_BYTE nColumn);
+	BOOL CSV_GetInt(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, INT32 *pValue);
+	BOOL CSV_GetFixed(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, U_BYTE nDecimals, INT32 *pValue);
+	BOOL CSV_GetReal(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, REAL32 *pValue);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* INC_CSVPARSER_H_ */
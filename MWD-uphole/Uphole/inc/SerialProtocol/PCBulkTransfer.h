@@ -0,0 +1,96 @@
+/*******************************************************************************
+*       @brief      Header File for the binary borehole download to the PC.
+*       @file       Uphole/inc/SerialProtocol/PCBulkTransfer.h
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+#ifndef PC_BULK_TRANSFER_H
+#define PC_BULK_TRANSFER_H
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include "portable.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// The PC starts a download by sending "BEGIN_BIN\r" on the PC port.  Every
+// block is then framed as
+//
+//   [0]    PCBULK_SOH
+//   [1]    block type, PCBULK_BLOCK_TYPE
+//   [2..3] block sequence number, little endian, starting at 0
+//   [4..5] payload length in bytes, always a multiple of 4
+//   [6]    flash page status for PAGE blocks (FLASH_PAGE_STATUS), else 0
+//   [7]    0
+//   [8..]  payload
+//   [..]   CRC32 of bytes 0 up to the end of the payload, little endian,
+//          as produced by the STM32 CRC unit (CalculateCRC())
+//
+// Sequence 0 is the SUMMARY block, the hole info pages follow, then the
+// record pages, then a single END block.  The PC answers with "ACK n\r"
+// once every block up to and including n has arrived, or "NAK n\r" to have
+// everything from n onward sent again.  Up to PCBULK_WINDOW blocks are sent
+// ahead of the last acknowledgement.
+#define PCBULK_SOH              0x01
+#define PCBULK_HEADER_SIZE      8
+#define PCBULK_WINDOW           4
+#define PCBULK_NAME_SIZE        16
+
+typedef enum
+{
+	PCBULK_BLOCK_SUMMARY = 1,   // payload is the PCBULK_SUMMARY fields
+	PCBULK_BLOCK_HOLE_INFO,     // payload is one raw 512 byte hole info page
+	PCBULK_BLOCK_RECORDS,       // payload is one raw 512 byte record page
+	PCBULK_BLOCK_END            // no payload
+} PCBULK_BLOCK_TYPE;
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// Everything the PC needs to lay the raw pages out again.  The SUMMARY block
+// carries these fields in this order, each little endian with no padding,
+// 52 bytes in all.
+typedef struct
+{
+	U_INT32 nRecordCount;       // records in use, record 0 is never used
+	U_INT16 nRecordSize;        // sizeof(STRUCT_RECORD_DATA)
+	U_INT16 nRecordsPerPage;
+	U_INT16 nRecordPages;       // number of RECORDS blocks that follow
+	U_INT16 nHoleInfoSize;      // sizeof(NEWHOLE_INFO)
+	U_INT16 nHoleInfoPerPage;
+	U_INT16 nHoleInfoPages;     // number of HOLE_INFO blocks that follow
+	U_INT16 nBoreholeNumber;    // current hole
+	U_INT16 nReserved;
+	U_INT32 nTotalLength;       // BOREHOLE_STATISTICS totals, CSV columns 32-35
+	INT32   nTotalDepth;
+	REAL32  fTotalNorthings;
+	REAL32  fTotalEastings;
+	char    BoreholeName[PCBULK_NAME_SIZE]; // CSV column 1 when the hole info has no name
+} PCBULK_SUMMARY;
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void PCBULK_Start(void);
+	BOOL PCBULK_IsActive(void);
+	BOOL PCBULK_ProcessLine(const char *pLine);
+	void PCBULK_Service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PC_BULK_TRANSFER_H
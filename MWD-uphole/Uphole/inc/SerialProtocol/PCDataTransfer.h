@@ -9,7 +9,7 @@
 
 #ifndef PCDATA_TRANSFER_H
 #define PCDATA_TRANSFER_H
-#include "csvparser.h"
+#include "CSVParser.h"
 #define PCDT_COMM_BUFF_SIZE	255
 
 //============================================================================//
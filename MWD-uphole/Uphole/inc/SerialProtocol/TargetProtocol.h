@@ -32,11 +32,26 @@ typedef enum
 	TP_DOWNHOLE_STATUS,
 } TP_COMMS_INTERFACE;
 
+// round trip statistics for the CMD_GET_FULL_DATA_SET poll, all times in ms
+typedef struct
+{
+	U_INT32 nRequestsSent;      // polls handed to the modem
+	U_INT32 nRepliesReceived;   // polls answered with a good checksum
+	U_INT32 nRepliesMissed;     // polls superseded before any answer came
+	U_INT32 nChecksumErrors;    // answers thrown away for a bad checksum
+	U_INT32 nLastRoundTrip;
+	U_INT32 nMinRoundTrip;
+	U_INT32 nMaxRoundTrip;
+	U_INT32 nTotalRoundTrip;    // divide by nRepliesReceived for the average
+	U_INT32 nPollsPerMinute;    // answered polls in the last full minute
+} TARGET_LINK_STATS;
+
 //============================================================================//
 //      VARIABLES EXPOSED                                                     //
 //============================================================================//
 
 extern U_INT16 RX_message_receptions;
+extern TARGET_LINK_STATS m_TargetLinkStats;
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
@@ -52,6 +67,8 @@ extern "C" {
 	void TargProtocol_RequestSendGammaEnable(BOOL bState);
 	void SetAwakeTimeTarget(INT16 aTime);
 	void TargProtocol_SetSensorPowerState(BOOL bState);
+	const TARGET_LINK_STATS* TargProtocol_GetLinkStats(void);
+	void TargProtocol_ResetLinkStats(void);
 
 #ifdef __cplusplus
 }
@@ -29,18 +29,13 @@
 
 #define MODEM_RECEIVE_BUFFER_SIZE   512
 
+// Responses and indications that can wait behind the one being handled.
+#define MODEM_REPLY_QUEUE_SIZE      4
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
 
-typedef enum {
-	MODEM_RX_WAITING_FOR_COMMAND,
-	MODEM_RX_WAITING_FOR_LENGTH,
-	MODEM_RX_WAITING_FOR_TYPE,
-	MODEM_RX_WAITING_FOR_OPCODE,
-	MODEM_RX_WAITING_FOR_DATA
-}MODEM_STATE_RX;
-
 typedef struct {
     U_INT16 nLength;
     MODEM_REPLY_TYPE eReply;
@@ -48,14 +43,26 @@ typedef struct {
     BOOL bReplyReady;
 }MODEM_REPLY_DATA_STRUCT;
 
+///@brief Receive decoder counters, put m_ModemRxStats in a Live Watch window.
+typedef struct {
+    U_INT32 nFrames;              // frames decoded and handed on
+    U_INT32 nChecksumErrors;      // frames with a bad checksum
+    U_INT32 nBadLengths;          // start bytes followed by an impossible length
+    U_INT32 nTimeouts;            // partial frames whose tail never arrived
+    U_INT32 nSkippedBytes;        // bytes outside any frame
+    U_INT32 nResponsesDropped;    // responses lost to a full queue
+    U_INT32 nIndicationsDropped;  // indications lost to a full queue
+    U_INT32 nOverruns;            // bytes lost to a full receive buffer
+    U_BYTE  nMaxResponseDepth;    // most responses queued at once
+    U_BYTE  nMaxIndicationDepth;  // most indications queued at once
+}MODEM_RX_STATS;
+
 //extern U_BYTE m_nModemReceiveBuffer[MODEM_RECEIVE_BUFFER_SIZE];
 //extern U_INT16 m_nModemReceiveBufferHead;
 //extern U_INT16 m_nModemReceiveBufferTail;
-extern MODEM_COMMAND_STRUCT m_nModemRxCommand;
-extern U_BYTE  m_nModemReceivedLengthByteCount;
-//extern U_INT16 m_nModemReceivedDataByteCount;
 extern MODEM_REPLY_DATA_STRUCT m_nResponse;
 extern MODEM_REPLY_DATA_STRUCT m_nIndication;
+extern MODEM_RX_STATS m_ModemRxStats;
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
@@ -65,15 +72,14 @@ extern MODEM_REPLY_DATA_STRUCT m_nIndication;
 extern "C" {
 #endif
 
-	void ModemData_ReceiveRxData(U_BYTE nData);
-	void ModemData_ProcessRxData(void);
 //	const MODEM_REPLY_DATA_STRUCT* GetRxResponse(void);
 //	const MODEM_REPLY_DATA_STRUCT* GetRxIndication(void);
 	void ModemData_ResetRxResponse(void);
 	void ModemData_ResetRxIndication(void);
+	void ModemData_FlushRxResponses(void);
 	MODEM_REPLY_TYPE getReplyOpCodeIndex(U_BYTE nOpCode);
 	void ModemData_ReceiveData(U_BYTE nData);
-	U_BYTE getBufferByte(void);
+	U_INT16 ModemData_ReceiveSpan(const U_BYTE *pData, U_INT16 nLength);
 	void ProcessModemBuffer(void);
 
 #ifdef __cplusplus
@@ -15,8 +15,61 @@
 //============================================================================//
 
 #include "portable.h"
+#include "timer.h"
 #include "ModemDataHandler.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// TX_PACKET data is an 11 byte packet header and the 4 byte transaction
+// number, followed by the message.
+#define MODEM_TX_PACKET_HEADER_SIZE  15
+#define MODEM_TX_MESSAGE_MAX         (MODEM_MESSAGE_BUFFER_SIZE - MODEM_TX_PACKET_HEADER_SIZE)
+
+// Number of downhole messages that can wait for the modem at once.
+#define MODEM_TX_QUEUE_SIZE          4
+
+// Retransmits of a control message before it is given up as stale.  Polls
+// are never resent, the next poll does the same job.
+#define MODEM_TX_CONTROL_RETRIES     3
+
+// Floor for the measured transmit confirmation timeout.  The ceiling is
+// MODEM_STALE_MESSAGE_TIMEOUT.
+#define MODEM_TX_MIN_ACK_TIMEOUT     THREE_HUNDRED_MILLI_SECONDS
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// Order matters, higher priorities are sent first.
+typedef enum {
+	MODEM_TX_PRIORITY_POLL,
+	MODEM_TX_PRIORITY_CONTROL,
+	MAX_MODEM_TX_PRIORITY,
+}MODEM_TX_PRIORITY;
+
+typedef enum {
+	MODEM_TX_QUEUED,
+	MODEM_TX_COALESCED,
+	MODEM_TX_REJECTED,
+}MODEM_TX_RESULT;
+
+///@brief Transmit queue counters, put m_ModemTxStats in a Live Watch window.
+typedef struct {
+	U_INT32 nQueued;        // messages accepted into a slot
+	U_INT32 nCoalesced;     // polls merged with one already queued
+	U_INT32 nEvicted;       // waiting polls thrown out to make room for a control
+	U_INT32 nRejected;      // messages refused, queue full or too long
+	U_INT32 nAcked;         // transmit confirmations received
+	U_INT32 nRetries;       // packets sent again after a timeout
+	U_INT32 nDropped;       // packets given up after their last timeout
+	U_INT16 nMaxDepth;      // most slots in use at once
+	TIME_LR tSmoothedRtt;   // ms, 0 until the first confirmation
+	TIME_LR tRttVariance;   // ms
+	TIME_LR tAckTimeout;    // ms, current confirmation timeout
+}MODEM_TX_STATS;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -26,7 +79,11 @@ extern "C" {
 #endif
 
 	BOOL Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength);
+	MODEM_TX_RESULT Modem_QueueMessage(const U_BYTE *pData, U_INT32 nLength, MODEM_TX_PRIORITY ePriority);
 	void ModemData_ResetTxMessage(void);
+	void ModemData_TxMessageAcknowledged(void);
+	BOOL ModemData_RetryTxMessage(void);
+	TIME_LR ModemData_GetTxAckTimeout(void);
 	void ModemData_ProcessTxPacketRequest(void);
 	BOOL TxMessageInBuffer(void);
 	BOOL TxMessageSent(void);
@@ -34,6 +91,8 @@ extern "C" {
 	void ModemData_ProcessGetConfigParameterRequest(MODEM_CONFIG_PARAMETER_TYPE nParameterIndex);
 	void ModemData_ProcessGetSerialNumberRequest(void);
 
+	extern MODEM_TX_STATS m_ModemTxStats;
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,6 +27,14 @@
 
 #define MODEM_SN_LENGTH     16
 
+// How long a host request may wait for the IT700 response before the modem
+// is reset, and the longest a downhole packet may wait for its transmit
+// confirmation.  The confirmation wait normally follows the measured round
+// trip, see m_ModemTxStats.  See m_nModemResponseTimeouts and
+// m_nModemStaleMessages when tuning these against a real link.
+#define MODEM_RESPONSE_TIMEOUT       FIVE_SECOND
+#define MODEM_STALE_MESSAGE_TIMEOUT  FIVE_SECOND
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -54,6 +62,7 @@ extern "C" {
     void InitModem(void);
     void ModemManager(void);
     extern volatile BOOL WakeUpModemReset;
+    extern U_INT32 m_nModemResponseTimeouts;
 
 #ifdef __cplusplus
 }
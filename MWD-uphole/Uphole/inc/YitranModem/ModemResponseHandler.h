@@ -31,6 +31,8 @@ extern "C" {
     BOOL ModemData_RxLookingForResponse(void);
     void ModemData_CheckForStaleMessage(void);
 
+    extern U_INT32 m_nModemStaleMessages;
+
 #ifdef __cplusplus
 }
 #endif
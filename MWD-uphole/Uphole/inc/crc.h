@@ -16,6 +16,16 @@
 
 #include "portable.h"
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// 1 works RASP checksums out from a table in software, 0 feeds them to the
+// CRC unit.  CalculateCRC() always uses the CRC unit.
+#ifndef CRC_USE_TABLE
+#define CRC_USE_TABLE 1
+#endif
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -27,6 +37,7 @@ extern "C" {
 	BOOL CalculateCRC(U_BYTE *pData, U_INT16 nLength, U_INT32 *nResultCRC);
 	void ResetCRC(U_INT32 *pCRC);
 	void CRC_CalculateOnByte(U_INT32 *pCRC, U_BYTE nData);
+	void CRC_CalculateOnSpan(U_INT32 *pCRC, const U_BYTE *pData, U_INT16 nLength);
 
 #ifdef __cplusplus
 }
@@ -68,11 +68,7 @@ BOOL SPI_ReadFRAM(U_BYTE *nData, U_INT32 nAddress, U_INT32 nCount)
 
         (void)SPI_TransferByte(nAddress & 0xFF);
 
-        while(nCount > 0)
-        {
-            *nData++ = SPI_TransferByte(0x00);
-            nCount--;
-        }
+        (void)SPI_TransferBlock(NULL, nData, (U_INT16)nCount);
 
         (void)SPI_ChipSelect(SPI_DEVICE_FRAM, false);
         return true;
@@ -137,11 +133,7 @@ BOOL SPI_WriteFRAM(U_BYTE *nData, U_INT32 nAddress, U_INT32 nCount)
 
             (void)SPI_TransferByte(nAddress & 0xFF);
 
-            while(nCount > 0)
-            {
-                (void)SPI_TransferByte(*nData++);
-                nCount--;
-            }
+            (void)SPI_TransferBlock(nData, NULL, (U_INT16)nCount);
 
             SPI_ChipSelect(SPI_DEVICE_FRAM, false);
 
@@ -41,6 +41,27 @@
 #define MBIT32_LAST_PAGE            8191
 #define MBIT16_LAST_PAGE            4095
 
+// each step of a queued write gets as long as the blocking write allowed
+#define FLASH_WRITE_STEP_TIMEOUT    TWENTY_FIVE_MILLI_SECONDS
+
+typedef enum
+{
+    FLASH_WRITE_IDLE,
+    FLASH_WRITE_ERASING,        // erase running (if any), buffer 1 loading
+    FLASH_WRITE_PROGRAMMING     // buffer 1 to page program running
+} FLASH_WRITE_STATE;
+
+// nCrc directly follows the page so both go to the chip as one DMA block
+typedef struct
+{
+    FLASH_PAGE page;
+    U_INT32 nCrc;
+    U_INT32 nPageNumber;
+    BOOL bWithCrc;              // false for the raw NV pages of FlashMemory.c
+    BOOL bErase;                // false to program over an already erased page
+    FLASH_WRITE_CALLBACK pCallback;
+} FLASH_WRITE_REQUEST;
+
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
@@ -48,6 +69,22 @@
 static U_BYTE m_nDeviceSize;
 static FLASH_PAGE pageData;
 
+// ring of pending writes, m_nWriteHead is the one the engine is working on
+static FLASH_WRITE_REQUEST m_WriteQueue[FLASH_WRITE_QUEUE_SIZE];
+static U_BYTE m_nWriteHead;
+static U_BYTE m_nWriteCount;
+static FLASH_WRITE_STATE m_eWriteState = FLASH_WRITE_IDLE;
+static TIME_LR m_tWriteStep;
+static BOOL m_bWriteFailed;
+
+// Put m_FlashWriteStats in a Live Watch window to see how the queue copes.
+FLASH_WRITE_STATS m_FlashWriteStats;
+
+static BOOL QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, BOOL bWithCrc, BOOL bErase, FLASH_WRITE_CALLBACK pCallback);
+static FLASH_WRITE_REQUEST* FindQueuedWrite(U_INT32 nPageNumber, BOOL bIncludeActive);
+static void StartQueuedWrite(void);
+static void FinishQueuedWrite(FLASH_PAGE_STATUS eStatus);
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -88,10 +125,7 @@ BOOL FLASH_IsBusy(void)
 
 static void SendBytes(U_BYTE* bytes, int len)
 {
-    for (int index = 0; index < len; index++)
-    {
-        SPI_TransferByte(bytes[index]);
-    }
+    (void)SPI_TransferBlock(bytes, NULL, (U_INT16)len);
 }
 
 /*!
@@ -130,10 +164,7 @@ static void SendCommand(U_BYTE command, U_INT16 pageNumber)
 
 static void ReceiveBytes(U_BYTE* bytes, U_INT16 length)
 {
-    for (int index = 0; index < length; index++)
-    {
-        bytes[index] = SPI_TransferByte(0x00);
-    }
+    (void)SPI_TransferBlock(NULL, bytes, length);
 }
 
 /*!
@@ -143,7 +174,7 @@ static void ReceiveBytes(U_BYTE* bytes, U_INT16 length)
 
 static BOOL IsValidPage(U_INT32 pageNumber)
 {
-    return (pageNumber < MBIT16_LAST_PAGE) || ((m_nDeviceSize == MBIT32_DEVICE) && (pageNumber < MBIT32_LAST_PAGE));
+    return (pageNumber <= MBIT16_LAST_PAGE) || ((m_nDeviceSize == MBIT32_DEVICE) && (pageNumber <= MBIT32_LAST_PAGE));
 }
 
 /*!
@@ -186,9 +217,19 @@ FLASH_PAGE_STATUS FLASH_ReadPage(FLASH_PAGE *page, U_INT32 pageNumber)
         memset(page, 0xFF, sizeof(FLASH_PAGE));
     }
 
+    // a page still in the write queue is newer than what is in the array
+    if (FLASH_GetQueuedPage(page, pageNumber))
+    {
+        return FLASH_PAGE_GOOD;
+    }
+
     if (IsValidPage(pageNumber))
     {
         SPI_ResetTransferTimeOut();
+        if (m_eWriteState != FLASH_WRITE_IDLE)
+        {
+            FLASH_WaitForReady(FLASH_WRITE_STEP_TIMEOUT);
+        }
 
         if (SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true))
         {
@@ -226,6 +267,8 @@ FLASH_PAGE_STATUS FLASH_ReadPage(FLASH_PAGE *page, U_INT32 pageNumber)
 
 FLASH_PAGE_STATUS FLASH_WritePage(FLASH_PAGE *page, U_INT32 nPageNumber)
 {
+    // anything queued was asked for first, and the chip has to be idle
+    FLASH_FlushWrites();
     if (IsValidPage(nPageNumber))
     {
         U_INT32 pageCrc;
@@ -273,3 +316,352 @@ BOOL FLASH_WaitForReady(TIME_LR milliseconds)
     }
     return true;
 }
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   FLASH_QueueWrite()
+;
+; Description:
+;   Queues a page write with the same CRC framing as FLASH_WritePage() and
+;   returns without waiting for the chip.  FLASH_WriteService() moves the
+;   write through erase and program from the 10 ms tick.  A second write to
+;   a page that is queued but not yet started replaces the queued data, so
+;   a page that keeps changing is only programmed once.  Until the write is
+;   done FLASH_ReadPage() returns the queued copy.
+;
+; Parameters:
+;   const FLASH_PAGE *page => data to write, copied before returning
+;   U_INT32 nPageNumber => page to write
+;   FLASH_WRITE_CALLBACK pCallback => called when done, may be NULL
+;
+; Returns:
+;   BOOL => false if the page number is bad or the queue is full
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+BOOL FLASH_QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, true, true, pCallback);
+}
+
+/*!
+********************************************************************************
+*       @details
+*       Same as FLASH_QueueWrite() for pages kept without the CRC word, as
+*       written by FLASH_WriteThePage() in FlashMemory.c.
+*******************************************************************************/
+
+BOOL FLASH_QueueWriteRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, false, true, pCallback);
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   FLASH_QueueAppendRaw()
+;
+; Description:
+;   Same as FLASH_QueueWriteRaw() but programs the page without erasing it
+;   first, for logs that add to a page in place.  Programming can only clear
+;   bits, so the page must have been erased by an earlier write, every byte
+;   already programmed must be passed again unchanged, and unused bytes must
+;   be 0xFF.
+;
+; Parameters:
+;   const FLASH_PAGE *page => whole page image, copied before returning
+;   U_INT32 nPageNumber => page to program
+;   FLASH_WRITE_CALLBACK pCallback => called when done, may be NULL
+;
+; Returns:
+;   BOOL => false if the page number is bad or the queue is full
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+BOOL FLASH_QueueAppendRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, false, false, pCallback);
+}
+
+/*!
+********************************************************************************
+*       @details
+*       Copies the newest queued data for a page that has not reached the
+*       array yet.  Returns false when no write to the page is pending.
+*******************************************************************************/
+
+BOOL FLASH_GetQueuedPage(FLASH_PAGE *page, U_INT32 nPageNumber)
+{
+    FLASH_WRITE_REQUEST *pRequest = FindQueuedWrite(nPageNumber, true);
+
+    if (pRequest == NULL)
+    {
+        return false;
+    }
+    if (page != NULL)
+    {
+        memcpy(page->AsBytes, pRequest->page.AsBytes, FLASH_PAGE_SIZE);
+    }
+    return true;
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+U_BYTE FLASH_GetWriteQueueDepth(void)
+{
+    return m_nWriteCount;
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   FLASH_WriteService()
+;
+; Description:
+;   Advances the write engine by at most one step.  Called from the 10 ms
+;   tick; it only reads the status register unless a step has finished, so
+;   it never waits on the chip.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+void FLASH_WriteService(void)
+{
+    switch (m_eWriteState)
+    {
+        case FLASH_WRITE_IDLE:
+            StartQueuedWrite();
+            break;
+
+        case FLASH_WRITE_ERASING:
+            if (!FLASH_IsBusy())
+            {
+                ProgramPage(m_WriteQueue[m_nWriteHead].nPageNumber);
+                m_tWriteStep = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+                m_eWriteState = FLASH_WRITE_PROGRAMMING;
+            }
+            else if (ElapsedTimeLowRes(m_tWriteStep) > FLASH_WRITE_STEP_TIMEOUT)
+            {
+                FinishQueuedWrite(FLASH_PAGE_CORRUPT);
+            }
+            break;
+
+        case FLASH_WRITE_PROGRAMMING:
+            if (!FLASH_IsBusy())
+            {
+                FinishQueuedWrite(FLASH_PAGE_GOOD);
+            }
+            else if (ElapsedTimeLowRes(m_tWriteStep) > FLASH_WRITE_STEP_TIMEOUT)
+            {
+                FinishQueuedWrite(FLASH_PAGE_CORRUPT);
+            }
+            break;
+    }
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   FLASH_FlushWrites()
+;
+; Description:
+;   Runs the write engine until the queue is empty.  Used before a blocking
+;   write, and before anything that powers the flash down or resets.
+;
+; Returns:
+;   BOOL => false if any write finished during the flush failed
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+BOOL FLASH_FlushWrites(void)
+{
+    TIME_LR tStalled = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+
+    m_bWriteFailed = false;
+    while ((m_nWriteCount > 0) || (m_eWriteState != FLASH_WRITE_IDLE))
+    {
+        FLASH_WriteService();
+        if (m_eWriteState != FLASH_WRITE_IDLE)
+        {
+            tStalled = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+        }
+        else if ((m_nWriteCount > 0) && (ElapsedTimeLowRes(tStalled) > FLASH_WRITE_STEP_TIMEOUT))
+        {
+            // the chip never went ready to start this one, give up on it
+            FinishQueuedWrite(FLASH_PAGE_CORRUPT);
+        }
+        // KickWatchdog();
+    }
+    return !m_bWriteFailed;
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+static BOOL QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, BOOL bWithCrc, BOOL bErase, FLASH_WRITE_CALLBACK pCallback)
+{
+    FLASH_WRITE_REQUEST *pRequest;
+
+    if ((page == NULL) || !IsValidPage(nPageNumber))
+    {
+        return false;
+    }
+
+    pRequest = FindQueuedWrite(nPageNumber, false);
+    if ((pRequest != NULL) && (pRequest->bWithCrc == bWithCrc) && (pRequest->pCallback == pCallback))
+    {
+        // an erase still pending for the page has to stay with the new data
+        bErase = bErase || pRequest->bErase;
+        m_FlashWriteStats.nCoalesced++;
+    }
+    else if (m_nWriteCount < FLASH_WRITE_QUEUE_SIZE)
+    {
+        pRequest = &m_WriteQueue[(m_nWriteHead + m_nWriteCount) % FLASH_WRITE_QUEUE_SIZE];
+        m_nWriteCount++;
+        if (m_nWriteCount > m_FlashWriteStats.nMaxDepth)
+        {
+            m_FlashWriteStats.nMaxDepth = m_nWriteCount;
+        }
+    }
+    else
+    {
+        m_FlashWriteStats.nQueueFull++;
+        return false;
+    }
+
+    memcpy(pRequest->page.AsBytes, page->AsBytes, FLASH_PAGE_SIZE);
+    pRequest->nPageNumber = nPageNumber;
+    pRequest->bWithCrc = bWithCrc;
+    pRequest->bErase = bErase;
+    pRequest->pCallback = pCallback;
+    if (bWithCrc)
+    {
+        CalculateCRC(pRequest->page.AsBytes, FLASH_PAGE_SIZE, &pRequest->nCrc);
+    }
+    m_FlashWriteStats.nQueued++;
+
+    // get the erase going now rather than on the next tick
+    if (m_eWriteState == FLASH_WRITE_IDLE)
+    {
+        StartQueuedWrite();
+    }
+    return true;
+}
+
+/*!
+********************************************************************************
+*       @details
+*       Finds the newest queued write to a page.  The write the engine is
+*       already working on can no longer be changed, so it is only included
+*       when bIncludeActive is set.
+*******************************************************************************/
+
+static FLASH_WRITE_REQUEST* FindQueuedWrite(U_INT32 nPageNumber, BOOL bIncludeActive)
+{
+    U_BYTE nIndex = m_nWriteCount;
+    U_BYTE nOldest = ((m_eWriteState != FLASH_WRITE_IDLE) && !bIncludeActive) ? 1 : 0;
+
+    while (nIndex-- > nOldest)
+    {
+        FLASH_WRITE_REQUEST *pRequest = &m_WriteQueue[(m_nWriteHead + nIndex) % FLASH_WRITE_QUEUE_SIZE];
+        if (pRequest->nPageNumber == nPageNumber)
+        {
+            return pRequest;
+        }
+    }
+    return NULL;
+}
+
+/*!
+********************************************************************************
+*       @details
+*       Erases the page at the head of the queue and loads buffer 1 while
+*       the erase runs, the same order FLASH_WritePage() uses.  Appends skip
+*       the erase and only load the buffer.
+*******************************************************************************/
+
+static void StartQueuedWrite(void)
+{
+    FLASH_WRITE_REQUEST *pRequest = &m_WriteQueue[m_nWriteHead];
+
+    if ((m_nWriteCount == 0) || FLASH_IsBusy())
+    {
+        return;
+    }
+
+    SPI_ResetTransferTimeOut();
+    if (pRequest->bErase)
+    {
+        ErasePage(pRequest->nPageNumber);
+    }
+    if (SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true))
+    {
+        U_INT16 nLength = FLASH_PAGE_SIZE + (pRequest->bWithCrc ? sizeof(pRequest->nCrc) : 0);
+
+        // DMA loads the buffer while the erase runs, the SPI driver lets go
+        // of the chip select when it is done
+        SendCommand(WRITE_BUFFER_OPCODE, pRequest->nPageNumber);
+        if (!SPI_StartBlock(SPI_DEVICE_DATAFLASH, pRequest->page.AsBytes, NULL, nLength, true, NULL))
+        {
+            SendBytes(pRequest->page.AsBytes, nLength);
+            SPI_ChipSelect(SPI_DEVICE_DATAFLASH, false);
+        }
+    }
+    m_tWriteStep = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+    m_eWriteState = FLASH_WRITE_ERASING;
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+static void FinishQueuedWrite(FLASH_PAGE_STATUS eStatus)
+{
+    FLASH_WRITE_CALLBACK pCallback = m_WriteQueue[m_nWriteHead].pCallback;
+    U_INT32 nPageNumber = m_WriteQueue[m_nWriteHead].nPageNumber;
+
+    m_nWriteHead = (m_nWriteHead + 1) % FLASH_WRITE_QUEUE_SIZE;
+    m_nWriteCount--;
+    m_eWriteState = FLASH_WRITE_IDLE;
+    if (eStatus == FLASH_PAGE_GOOD)
+    {
+        m_FlashWriteStats.nCompleted++;
+    }
+    else
+    {
+        m_FlashWriteStats.nFailed++;
+        m_bWriteFailed = true;
+    }
+
+    if (pCallback != NULL)
+    {
+        pCallback(nPageNumber, eStatus);
+    }
+    StartQueuedWrite();
+}
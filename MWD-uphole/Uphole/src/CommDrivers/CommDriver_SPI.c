@@ -20,12 +20,47 @@
 #include "CommDriver_SPI.h"
 #include "NVIC.h"
 #include "SysTick.h"
+#include "timer.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// SPI1 on DMA2 channel 3.  Stream 0 belongs to the ADC and streams 5 and 7
+// to USART1, so RX uses stream 2 and TX stream 3.
+#define SPI_DMA_CHANNEL         DMA_Channel_3
+#define SPI_RX_DMA_STREAM       DMA2_Stream2
+#define SPI_TX_DMA_STREAM       DMA2_Stream3
+#define SPI_RX_DMA_FLAGS        (DMA_FLAG_TCIF2 | DMA_FLAG_TEIF2 | DMA_FLAG_HTIF2 | DMA_FLAG_DMEIF2 | DMA_FLAG_FEIF2)
+#define SPI_TX_DMA_FLAGS        (DMA_FLAG_TCIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3)
+
+// below this the DMA set up costs more than clocking the bytes by hand
+#define SPI_DMA_MIN_LENGTH      16
+
+// a 528 byte page takes about 1 ms at the 5 MHz bus clock
+#define SPI_BLOCK_TIMEOUT       TEN_MILLI_SECONDS
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
 static U_INT16 m_nTimeout = 0;
+static SPI_DEVICE m_nDeviceHasBus = SPI_DEVICE_NONE;
+
+// the block started by SPI_StartBlock(), finished by the RX DMA interrupt
+static volatile BOOL m_bBlockBusy = false;
+static SPI_DEVICE m_nBlockDevice;
+static BOOL m_bBlockDeselect;
+static SPI_BLOCK_CALLBACK m_pBlockCallback;
+static TIME_LR m_tBlockStart;
+
+// source of the 0x00 clocked out on reads, sink for the bytes read on writes
+static const U_BYTE m_nDummyTx = 0x00;
+static U_BYTE m_nDummyRx;
+
+static void sPI_StartDMA(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength, BOOL bInterrupt);
+static void sPI_StopDMA(void);
+static void sPI_EndBlock(BOOL bSuccess);
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -105,6 +140,7 @@ void SPI_InitPins(void)
 void SPI_Initialize(void)
 {
     SPI_InitTypeDef SPI_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
 
     // Reset SPI1 with default values
     SPI_Cmd(SPI1, DISABLE);
@@ -125,6 +161,12 @@ void SPI_Initialize(void)
     // Enable SPI1
     SPI_CalculateCRC(SPI1, DISABLE);
     SPI_Cmd(SPI1, ENABLE);
+
+    // Enable DMA2 Stream2 Channel 3 (SPI1_RX), the end of every block
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 6;
+    NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream2_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
 }// End SPI_Initialize()
 
 /*!
@@ -178,8 +220,6 @@ BOOL SPI_ChipSelect(SPI_DEVICE nDevice, BOOL bSelect)
     GPIO_TypeDef*   nPort;
     uint16_t        nPin;
 
-    static SPI_DEVICE nDeviceHasBus = SPI_DEVICE_NONE;
-
     switch(nDevice)
     {
       case SPI_DEVICE_DATAFLASH:
@@ -194,18 +234,23 @@ BOOL SPI_ChipSelect(SPI_DEVICE nDevice, BOOL bSelect)
 
     if(bSelect == true)
     {
-        if(nDeviceHasBus !=  SPI_DEVICE_NONE)
+        // a DMA block still owns the bus until it ends
+        if(m_bBlockBusy)
+        {
+            (void)SPI_WaitForBlock();
+        }
+        if(m_nDeviceHasBus !=  SPI_DEVICE_NONE)
         {
             return false;
         }
         else
         {
-            nDeviceHasBus = nDevice;
+            m_nDeviceHasBus = nDevice;
         }
     }
     else
     {
-        nDeviceHasBus = SPI_DEVICE_NONE;
+        m_nDeviceHasBus = SPI_DEVICE_NONE;
     }
 
     GPIO_WriteBit(nPort, nPin, (bSelect ? Bit_RESET : Bit_SET));
@@ -256,3 +301,281 @@ U_BYTE SPI_TransferByte(U_BYTE nDataByte)
 
     return(SPI_ReceiveData(SPI1));
 }// End SPI_TransferByte()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   SPI_TransferBlock()
+;
+; Description:
+;   Clocks a block through SPI1 with DMA and waits for it to end.  The
+;   caller must already hold the chip select.  pTxData NULL sends 0x00 for
+;   a read, pRxData NULL throws the read bytes away for a write, both set
+;   is full duplex.  Short blocks are clocked by SPI_TransferByte().
+;
+; Parameters:
+;   const U_BYTE *pTxData => bytes to send, or NULL
+;   U_BYTE *pRxData => where to put the bytes read, or NULL
+;   U_INT16 nLength => bytes to transfer
+;
+; Returns:
+;   BOOL => false on a DMA error or timeout
+;
+; Reentrancy:
+;   No
+;
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+BOOL SPI_TransferBlock(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength)
+{
+    TIME_LR tStart;
+
+    if((m_nTimeout == 0) || m_bBlockBusy)
+    {
+        return false;
+    }
+
+    if(nLength < SPI_DMA_MIN_LENGTH)
+    {
+        while(nLength-- > 0)
+        {
+            U_BYTE nByte = SPI_TransferByte((pTxData != NULL) ? *pTxData++ : 0x00);
+            if(pRxData != NULL)
+            {
+                *pRxData++ = nByte;
+            }
+        }
+        return (m_nTimeout != 0);
+    }
+
+    sPI_StartDMA(pTxData, pRxData, nLength, false);
+    tStart = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+    while(DMA_GetFlagStatus(SPI_RX_DMA_STREAM, DMA_FLAG_TCIF2 | DMA_FLAG_TEIF2) == RESET)
+    {
+        if(ElapsedTimeLowRes(tStart) > SPI_BLOCK_TIMEOUT)
+        {
+            sPI_StopDMA();
+            m_nTimeout = 0;
+            return false;
+        }
+    }
+    if(DMA_GetFlagStatus(SPI_RX_DMA_STREAM, DMA_FLAG_TEIF2) != RESET)
+    {
+        sPI_StopDMA();
+        m_nTimeout = 0;
+        return false;
+    }
+    sPI_StopDMA();
+    return true;
+}// End SPI_TransferBlock()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   SPI_StartBlock()
+;
+; Description:
+;   Starts a DMA block and returns straight away.  The RX DMA interrupt
+;   ends it, releases the chip select when bDeselect is set and calls
+;   pCallback.  Until then SPI_ChipSelect() for any device waits for the
+;   block, so nothing else can get onto the bus part way through.  The
+;   buffers must stay put until the block ends.
+;
+; Parameters:
+;   SPI_DEVICE nDevice => device that holds the chip select
+;   const U_BYTE *pTxData => bytes to send, or NULL
+;   U_BYTE *pRxData => where to put the bytes read, or NULL
+;   U_INT16 nLength => bytes to transfer
+;   BOOL bDeselect => release the chip select when done
+;   SPI_BLOCK_CALLBACK pCallback => completion notice, may be NULL
+;
+; Returns:
+;   BOOL => false if nDevice does not hold the bus or a block is running
+;
+; Reentrancy:
+;   No
+;
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+BOOL SPI_StartBlock(SPI_DEVICE nDevice, const U_BYTE *pTxData, U_BYTE *pRxData,
+                    U_INT16 nLength, BOOL bDeselect, SPI_BLOCK_CALLBACK pCallback)
+{
+    if((m_nTimeout == 0) || m_bBlockBusy || (nLength == 0) || (m_nDeviceHasBus != nDevice))
+    {
+        return false;
+    }
+
+    m_nBlockDevice = nDevice;
+    m_bBlockDeselect = bDeselect;
+    m_pBlockCallback = pCallback;
+    m_tBlockStart = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+    m_bBlockBusy = true;
+    sPI_StartDMA(pTxData, pRxData, nLength, true);
+    return true;
+}// End SPI_StartBlock()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+BOOL SPI_IsBlockBusy(void)
+{
+    return m_bBlockBusy;
+}// End SPI_IsBlockBusy()
+
+/*!
+********************************************************************************
+*       @details
+*       Waits for the block started by SPI_StartBlock().  A block that has
+*       not ended by SPI_BLOCK_TIMEOUT is stopped and reported as failed.
+*******************************************************************************/
+BOOL SPI_WaitForBlock(void)
+{
+    while(m_bBlockBusy)
+    {
+        if(ElapsedTimeLowRes(m_tBlockStart) > SPI_BLOCK_TIMEOUT)
+        {
+            __disable_interrupt();
+            if(m_bBlockBusy)
+            {
+                sPI_EndBlock(false);
+            }
+            __enable_interrupt();
+            return false;
+        }
+    }
+    return true;
+}// End SPI_WaitForBlock()
+
+/*!
+********************************************************************************
+*       @details
+*       RX finishes last, so its transfer complete marks the end of a block.
+*******************************************************************************/
+/*
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   DMA2_Stream2_IRQHandler()
+;
+; Description:
+;   Handles DMA2_Stream2 interrupts. DMA2_Stream2 interrupts are mapped to
+;   SPI1_RX for the blocks started by SPI_StartBlock().
+;
+; Reentrancy:
+;   No
+;
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+void DMA2_Stream2_IRQHandler(void)
+{
+    if (DMA_GetITStatus(SPI_RX_DMA_STREAM, DMA_IT_TEIF2))
+    {
+        DMA_ClearITPendingBit(SPI_RX_DMA_STREAM, DMA_IT_TEIF2);
+        if (m_bBlockBusy)
+        {
+            sPI_EndBlock(false);
+        }
+    }
+    if (DMA_GetITStatus(SPI_RX_DMA_STREAM, DMA_IT_TCIF2))
+    {
+        DMA_ClearITPendingBit(SPI_RX_DMA_STREAM, DMA_IT_TCIF2);
+        if (m_bBlockBusy)
+        {
+            sPI_EndBlock(true);
+        }
+    }
+}// End DMA2_Stream2_IRQHandler()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+static void sPI_StartDMA(const U_BYTE *pTxData, U_BYTE *pRxData, U_INT16 nLength, BOOL bInterrupt)
+{
+    DMA_InitTypeDef DMA_InitStructure;
+
+    sPI_StopDMA();
+    // throw away anything left over from byte transfers
+    while (SPI_GetFlagStatus(SPI1, SPI_FLAG_RXNE) != RESET)
+    {
+        (void)SPI_ReceiveData(SPI1);
+    }
+
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = SPI_DMA_CHANNEL;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (U_INT32)&SPI1->DR;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_BufferSize = nLength;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+
+    // RX outranks TX so a received byte is always collected before the
+    // next one can overrun it
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)((pRxData != NULL) ? pRxData : &m_nDummyRx);
+    DMA_InitStructure.DMA_MemoryInc = (pRxData != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_Init(SPI_RX_DMA_STREAM, &DMA_InitStructure);
+
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)((pTxData != NULL) ? pTxData : &m_nDummyTx);
+    DMA_InitStructure.DMA_MemoryInc = (pTxData != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_Init(SPI_TX_DMA_STREAM, &DMA_InitStructure);
+
+    DMA_ITConfig(SPI_RX_DMA_STREAM, DMA_IT_TC | DMA_IT_TE, bInterrupt ? ENABLE : DISABLE);
+    DMA_Cmd(SPI_RX_DMA_STREAM, ENABLE);
+    DMA_Cmd(SPI_TX_DMA_STREAM, ENABLE);
+    SPI_I2S_DMACmd(SPI1, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+}// End sPI_StartDMA()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+static void sPI_StopDMA(void)
+{
+    SPI_I2S_DMACmd(SPI1, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+    DMA_ITConfig(SPI_RX_DMA_STREAM, DMA_IT_TC | DMA_IT_TE, DISABLE);
+    DMA_Cmd(SPI_TX_DMA_STREAM, DISABLE);
+    DMA_Cmd(SPI_RX_DMA_STREAM, DISABLE);
+    while ((DMA_GetCmdStatus(SPI_TX_DMA_STREAM) != DISABLE) ||
+           (DMA_GetCmdStatus(SPI_RX_DMA_STREAM) != DISABLE))
+    {
+    }
+    DMA_ClearFlag(SPI_TX_DMA_STREAM, SPI_TX_DMA_FLAGS);
+    DMA_ClearFlag(SPI_RX_DMA_STREAM, SPI_RX_DMA_FLAGS);
+}// End sPI_StopDMA()
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+static void sPI_EndBlock(BOOL bSuccess)
+{
+    SPI_BLOCK_CALLBACK pCallback = m_pBlockCallback;
+    SPI_DEVICE nDevice = m_nBlockDevice;
+
+    sPI_StopDMA();
+    m_bBlockBusy = false;
+    if (m_bBlockDeselect)
+    {
+        (void)SPI_ChipSelect(nDevice, false);
+    }
+    if (pCallback != NULL)
+    {
+        pCallback(nDevice, bSuccess);
+    }
+}// End sPI_EndBlock()
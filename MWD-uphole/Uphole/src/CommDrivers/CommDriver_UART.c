@@ -26,6 +26,16 @@
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
 
+// One pending transmit.  Copied messages point into the owning UART's copy
+// ring, and nCopyEnd is where the ring's tail moves to once this is sent.
+typedef struct
+{
+	const U_BYTE*        pData;         // first byte to send
+	U_INT16              nLength;       // bytes to send
+	U_INT16              nCopyEnd;      // copy ring tail after this message
+	UART_CALLBACK_TX     pfDone;        // called from the DMA interrupt when sent
+} UART_TX_DESCRIPTOR;
+
 typedef struct
 {
 	USART_TypeDef*       pUART;         // UART peripheral
@@ -35,12 +45,18 @@ typedef struct
 	U_INT32              nRxDMAChannel; // DMA receive channel
 	U_INT32              nBaudRate;     // Transmission speed of this stream
 	U_BYTE               nRxBufferDMA[BUFFER_SIZE_RX_DMA]; // DMA Receive Buffer
-	U_INT16              nRxHeadDMA;    // Leading index of DMA receive data
-	U_INT16              nRxTailDMA;    // Trailing index of DMA receive data
-	U_BYTE               nRxBuffer[BUFFER_SIZE_RX]; // Secondary Receive buffer
-	U_INT16              nRxHead;       // Leading index of secondary receive buffer
-	U_INT16              nRxTail;       // Trailing index of secondary receive buffer
-	U_BYTE               nTxBufferDMA[UART_BUFFER_SIZE_TX]; // Transmit buffer
+	volatile U_INT16     nRxHeadDMA;    // Leading index of DMA receive data
+	volatile U_INT32     nRxWritten;    // Bytes the DMA has received
+	U_INT16              nRxTailDMA;    // Oldest byte not released by the client
+	U_INT32              nRxRead;       // Bytes released by the client
+	U_INT16              nRxScanned;    // Bytes past the tail already searched
+	UART_TX_DESCRIPTOR   TxQueue[UART_TX_QUEUE_SIZE]; // Pending transmits
+	volatile U_INT16     nTxQueueHead;  // Next free descriptor
+	volatile U_INT16     nTxQueueTail;  // Descriptor being sent
+	volatile U_INT16     nTxQueueCount; // Descriptors waiting or being sent
+	U_BYTE               nTxCopy[UART_TX_COPY_SIZE]; // Transmit copy ring
+	volatile U_INT16     nTxCopyHead;   // Leading index of the copy ring
+	volatile U_INT16     nTxCopyTail;   // Trailing index of the copy ring
 	UART_CLIENT          eClient;       // Peripheral client
 } UART_SELECT;
 
@@ -50,16 +66,22 @@ typedef struct
 
 static void uARTx_Configure(UART_SELECT *pUARTx);
 static void uARTx_IRQHandler(UART_SELECT *pUARTx);
+static UART_SELECT *uART_GetSelect(UART_CLIENT eClient);
+static BOOL uARTx_Enqueue(UART_SELECT *pUARTx, const U_BYTE *pData,
+	U_INT16 nDataLen, BOOL bCopy, UART_CALLBACK_TX pfDone);
+static U_INT16 uARTx_CopyRoom(UART_SELECT *pUARTx, U_INT16 *pStart);
+static void uARTx_TxStart(UART_SELECT *pUARTx);
+static void uARTx_TxComplete(UART_SELECT *pUARTx);
+static void uARTx_RxUpdate(UART_SELECT *pUARTx);
+static U_INT16 uARTx_RxPending(UART_SELECT *pUARTx);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
 static UART_SELECT m_UART[NUM_UART_STREAMS];
-volatile uint8_t DMA_Rx_Buffer[64];
-uint8_t Process_Rx_Buffer[BUFFER_SIZE_RX_DMA];
-uint32_t Process_Rx_Buffer_Index = 0;
-volatile bool bufferOverrun = false;
+UART_TX_STATS m_UartTxStats[NUM_UART_STREAMS];
+UART_RX_STATS m_UartRxStats[NUM_UART_STREAMS];
 
 
 //============================================================================//
@@ -146,9 +168,15 @@ void UART_Init(void)
 	pUARTx->nRxDMAChannel = DMA_Channel_4;
 	pUARTx->eClient = CLIENT_PC_COMM;
 	pUARTx->nRxHeadDMA = 0;
+	pUARTx->nRxWritten = 0;
 	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
+	pUARTx->nTxQueueHead = 0;
+	pUARTx->nTxQueueTail = 0;
+	pUARTx->nTxQueueCount = 0;
+	pUARTx->nTxCopyHead = 0;
+	pUARTx->nTxCopyTail = 0;
 	uARTx_Configure(pUARTx);
 	// Enable DMA2 Stream5 Channel 4 (USART1_RX)
 	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 12;
@@ -176,9 +204,15 @@ void UART_Init(void)
 	pUARTx->nRxDMAChannel = DMA_Channel_4;
 	pUARTx->eClient = CLIENT_DATA_LINK;
 	pUARTx->nRxHeadDMA = 0;
+	pUARTx->nRxWritten = 0;
 	pUARTx->nRxTailDMA = 0;
-	pUARTx->nRxHead = 0;
-	pUARTx->nRxTail = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
+	pUARTx->nTxQueueHead = 0;
+	pUARTx->nTxQueueTail = 0;
+	pUARTx->nTxQueueCount = 0;
+	pUARTx->nTxCopyHead = 0;
+	pUARTx->nTxCopyTail = 0;
 	uARTx_Configure(pUARTx);
 	// Enable DMA1 Stream5 Channel4 (USART1_RX)
 	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 12;
@@ -197,51 +231,6 @@ void UART_Init(void)
 	NVIC_Init(&NVIC_InitStructure);
 } // End UART_Init()
 
-/*******************************************************************************
-*       @details
-*******************************************************************************/
-/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-; Function:
-;   UART_ServiceRxBufferDMA()
-;
-; Description:
-;   Services all clients that have received new data on their DMA RX channels
-;   since the last call to this function. The newly received data is
-;   transferred to the secondary receive buffer for the client.
-;
-; Reentrancy:
-;   No
-;
-; Assumptions:
-;   This function is called from main.
-;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-
-void UART_ServiceRxBufferDMA(void)
-{
-	U_BYTE loopy;
-
-	//for (loopy = 0; loopy < NUM_UART_STREAMS; loopy++)
-	loopy = 0;
-	{
-		m_UART[loopy].nRxHeadDMA = BUFFER_SIZE_RX_DMA - (U_INT16)m_UART[loopy].pRxDMA->NDTR;
-		while (m_UART[loopy].nRxHeadDMA != m_UART[loopy].nRxTailDMA)
-		{
-			m_UART[loopy].nRxBuffer[m_UART[loopy].nRxHead] =
-			m_UART[loopy].nRxBufferDMA[m_UART[loopy].nRxTailDMA];
-			m_UART[loopy].nRxTailDMA++;
-			if (m_UART[loopy].nRxTailDMA >= BUFFER_SIZE_RX_DMA)
-			{
-				m_UART[loopy].nRxTailDMA = 0;
-			}
-			m_UART[loopy].nRxHead++;
-			if (m_UART[loopy].nRxHead >= BUFFER_SIZE_RX)
-			{
-				m_UART[loopy].nRxHead = 0;
-			}
-		}
-	}
-} // End UART_ServiceRxBufferDMA()
-
 /*
 ******************************************************************************
 *       @details
@@ -251,10 +240,11 @@ void UART_ServiceRxBufferDMA(void)
 ;   UART_ServiceRxBuffer()
 ;
 ; Description:
-;   Services all clients that have received new data on their secondary receive
-;   buffer and then calls the service receive function for the client in
-;   which the client should handle any newly received data, but should not
-;   initiate a transmission.
+;   Hands everything the data link has received to the modem a span of the
+;   DMA buffer at a time and releases what the modem took.  When the modem
+;   receive buffer is full the rest stays in the DMA buffer until
+;   ProcessModemBuffer() has made room.  The PC port is not serviced here,
+;   PCDataTransfer pulls its lines with UART_ReceiveMessage().
 ;
 ; Reentrancy:
 ;   No
@@ -265,56 +255,25 @@ void UART_ServiceRxBufferDMA(void)
 
 void UART_ServiceRxBuffer(void)
 {
-    U_BYTE loopy, nRxChar;
+	const U_BYTE *pData;
+	U_INT16 nLength;
+	U_INT16 nTaken;
 
-    for (loopy = 0; loopy < NUM_UART_STREAMS; loopy++)
-    {
- 		if (m_UART[loopy].eClient == CLIENT_DATA_LINK)
+	while ((nLength = UART_RxPeek(CLIENT_DATA_LINK, &pData)) != 0)
+	{
+		nTaken = nLength;
+		if (GetModemIsPresent())
 		{
-			while (m_UART[loopy].nRxHead != m_UART[loopy].nRxTail)
-			{
-				nRxChar = m_UART[loopy].nRxBuffer[m_UART[loopy].nRxTail];
-				m_UART[loopy].nRxTail++;
-
-				if (m_UART[loopy].nRxTail >= BUFFER_SIZE_RX)
-				{
-					m_UART[loopy].nRxTail = 0;
-				}
-				if(GetModemIsPresent())
-				{
-					ModemData_ReceiveData(nRxChar);
-				}			
-			}
+			nTaken = ModemData_ReceiveSpan(pData, nLength);
 		}
-    }
-}
-
-
-void UART_HandleReceivedData(void)
-{
-    U_BYTE loopy, nRxChar;
-
-    for (loopy = 0; loopy < NUM_UART_STREAMS; loopy++)
-    {
- 		if (m_UART[loopy].eClient == CLIENT_DATA_LINK)
+		UART_RxRelease(CLIENT_DATA_LINK, nTaken);
+		if (nTaken < nLength)
 		{
-			while (m_UART[loopy].nRxHead != m_UART[loopy].nRxTail)
-			{
-				nRxChar = m_UART[loopy].nRxBuffer[m_UART[loopy].nRxTail];
-				m_UART[loopy].nRxTail++;
-
-				if (m_UART[loopy].nRxTail >= BUFFER_SIZE_RX)
-				{
-					m_UART[loopy].nRxTail = 0;
-				}
-				if(GetModemIsPresent())
-				{
-					ModemData_ReceiveData(nRxChar);
-				}			
-			}
+			break;
 		}
-    }
-}
+	}
+} // End UART_ServiceRxBuffer()
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -344,9 +303,7 @@ void UART_ProcessRxData(void)
 			case CLIENT_DATA_LINK:
 				if(GetModemIsPresent())
 				{
-					// old way byte by byte
-					// ModemData_ProcessRxData();
-					// new way handles whole message
+					// decodes every whole frame received so far
 					ProcessModemBuffer();
 				}
 				break;
@@ -366,16 +323,23 @@ void UART_ProcessRxData(void)
 ;   UART_SendMessage()
 ;
 ; Description:
-;   Places a copy of the data to be sent into the client's transfer buffer
-;   then intiates a DMA transfer of the data.
+;   Places a copy of the data to be sent into the client's transmit copy ring
+;   and queues it behind anything already waiting.  The DMA starts at once if
+;   the UART is idle, otherwise the transfer complete interrupt starts it when
+;   the messages ahead of it have gone.  Messages longer than the copy ring
+;   are cut short as the single transmit buffer used to do.
 ;
 ; Parameters:
 ;   UART_CLIENT eClient => client to transfer the data to
 ;   U_BYTE *pData => pointer to the data to be transferred
 ;   U_INT16 nDataLen => number of bytes to be transferred
 ;
+; Returns:
+;   BOOL => false if the queue or the copy ring is full, in which case
+;           nothing was queued and the caller should try again later
+;
 ; Reentrancy:
-;   No
+;   Yes
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 BOOL UART_SendMessage(
 	UART_CLIENT eClient,
@@ -383,10 +347,149 @@ BOOL UART_SendMessage(
 	U_INT16 nDataLen)
 {
 	UART_SELECT *pUARTx;
-	if (pData == NULL)
+
+	pUARTx = uART_GetSelect(eClient);
+	if ((pData == NULL) || (pUARTx == NULL))
+	{
+		return false;
+	}
+	if (nDataLen > (UART_TX_COPY_SIZE - 1))
+	{
+		nDataLen = UART_TX_COPY_SIZE - 1;
+	}
+	return uARTx_Enqueue(pUARTx, pData, nDataLen, true, NULL);
+} // End UART_SendMessage()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_SendMessageNoCopy()
+;
+; Description:
+;   Queues the caller's own buffer for transmission without copying it.
+;   The buffer must stay untouched until pfDone is called, which happens
+;   from the DMA interrupt once the last byte has been handed to the UART.
+;   Several calls in a row send the pieces back to back, so a message can
+;   be gathered from separate buffers.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to transfer the data to
+;   U_BYTE *pData => pointer to the data to be transferred
+;   U_INT16 nDataLen => number of bytes to be transferred
+;   UART_CALLBACK_TX pfDone => called when the buffer is free again, or NULL
+;
+; Returns:
+;   BOOL => false if the queue is full, in which case nothing was queued
+;           and pfDone will not be called
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL UART_SendMessageNoCopy(
+	UART_CLIENT eClient,
+	const U_BYTE *pData,
+	U_INT16 nDataLen,
+	UART_CALLBACK_TX pfDone)
+{
+	UART_SELECT *pUARTx;
+
+	pUARTx = uART_GetSelect(eClient);
+	if ((pData == NULL) || (pUARTx == NULL))
 	{
 		return false;
 	}
+	return uARTx_Enqueue(pUARTx, pData, nDataLen, false, pfDone);
+} // End UART_SendMessageNoCopy()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_IsTxBusy()
+;
+; Description:
+;   Reports whether the client still has messages queued or on the wire.
+;   Callers no longer need to wait for this before sending, the queue keeps
+;   them in order; use it to know when everything has gone out.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to check
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL UART_IsTxBusy(UART_CLIENT eClient)
+{
+	return UART_GetTxQueueDepth(eClient) != 0;
+} // End UART_IsTxBusy()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 UART_GetTxQueueDepth(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	return pUARTx->nTxQueueCount;
+} // End UART_GetTxQueueDepth()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_GetTxQueueFree()
+;
+; Description:
+;   Reports the longest message UART_SendMessage() would accept right now.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to check
+;
+; Returns:
+;   U_INT16 => bytes free in one piece of the copy ring, or 0 if there is
+;              no free descriptor
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT16 UART_GetTxQueueFree(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+	U_INT32 nOldState;
+	U_INT16 nStart;
+	U_INT16 nFree = 0;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+	if (pUARTx->nTxQueueCount < UART_TX_QUEUE_SIZE)
+	{
+		nFree = uARTx_CopyRoom(pUARTx, &nStart);
+	}
+	__set_interrupt_state((__istate_t)nOldState);
+	return nFree;
+} // End UART_GetTxQueueFree()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static UART_SELECT *uART_GetSelect(UART_CLIENT eClient)
+{
+	UART_SELECT *pUARTx;
+
 	// Given a client, get the pointer to the client's UART_SELECT structure
 	switch (eClient)
 	{
@@ -399,74 +502,521 @@ BOOL UART_SendMessage(
 			break;
 
 		default:
-			pUARTx = NULL;
-			break;
+			return NULL;
+	}
+	// Verify the client config in the UART_SELECT struct matches the client
+	if (pUARTx->eClient != eClient)
+	{
+		return NULL;
+	}
+	return pUARTx;
+} // End uART_GetSelect()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_Enqueue()
+;
+; Description:
+;   Adds a descriptor to the UART's transmit queue, copying the data into the
+;   copy ring first if asked to, and starts the DMA if the UART was idle.
+;   Interrupts are held off throughout because messages are queued from
+;   interrupt handlers as well as from main.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to send on
+;   U_BYTE *pData => data to send
+;   U_INT16 nDataLen => number of bytes to send
+;   BOOL bCopy => true to copy the data into the copy ring
+;   UART_CALLBACK_TX pfDone => called once the data has been sent, or NULL
+;
+; Returns:
+;   BOOL => false if there was no room
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static BOOL uARTx_Enqueue(UART_SELECT *pUARTx, const U_BYTE *pData,
+	U_INT16 nDataLen, BOOL bCopy, UART_CALLBACK_TX pfDone)
+{
+	UART_TX_STATS *pStats = &m_UartTxStats[pUARTx - m_UART];
+	UART_TX_DESCRIPTOR *pDescriptor;
+	U_INT32 nOldState;
+	U_INT16 nStart;
+	U_INT16 nUsed;
+
+	if (nDataLen == 0)
+	{
+		return true;
+	}
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+
+	if (pUARTx->nTxQueueCount >= UART_TX_QUEUE_SIZE)
+	{
+		pStats->nRejected++;
+		__set_interrupt_state((__istate_t)nOldState);
+		return false;
 	}
-	// Verify the pointer to the UART_SELECT structure is valid
-	if (pUARTx != NULL)
+	if (bCopy)
 	{
-// Verify the client config in the UART_SELECT struct matches the client requesting the transfer
-		if (eClient == pUARTx->eClient)
+		if (uARTx_CopyRoom(pUARTx, &nStart) < nDataLen)
+		{
+			pStats->nRejected++;
+			__set_interrupt_state((__istate_t)nOldState);
+			return false;
+		}
+		(void)memcpy(&pUARTx->nTxCopy[nStart], pData, nDataLen);
+		pData = &pUARTx->nTxCopy[nStart];
+		pUARTx->nTxCopyHead = nStart + nDataLen;
+		if (pUARTx->nTxCopyHead >= UART_TX_COPY_SIZE)
 		{
-			if (nDataLen > UART_BUFFER_SIZE_TX)
-			{
-				nDataLen = UART_BUFFER_SIZE_TX;
-			}
-			// Create a persistent copy of the data to be transferred
-			(void)memcpy(pUARTx->nTxBufferDMA, pData, nDataLen);
-// Set pointer data to be transmitted and length of data in the DMA regs before enabling DMA and starting the transfer
-			pUARTx->pTxDMA->M0AR = (U_INT32)(pUARTx->nTxBufferDMA);
-			pUARTx->pTxDMA->NDTR = nDataLen; //breakpoint here -look at pUARTx->nTxBufferDMA in Watch win
-			USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, ENABLE); //whs 31Jan2022 see full buffer
-			DMA_Cmd(pUARTx->pTxDMA, ENABLE); // each record appears every 4th button press
-		} // after every 3rd and 4th press the thumb drive flashes.
-		return true; //whs 28Jan2022 put breakpoint here to see data as it goes through serial port to Thumb drive
+			pUARTx->nTxCopyHead = 0;
+		}
+		nUsed = (pUARTx->nTxCopyHead + UART_TX_COPY_SIZE - pUARTx->nTxCopyTail) % UART_TX_COPY_SIZE;
+		if (nUsed > pStats->nMaxCopyUsed)
+		{
+			pStats->nMaxCopyUsed = nUsed;
+		}
 	}
-	return false;
-} // End UART_SendMessage()
-/**
- * Receives a message from the specified UART client, using DMA, and stores it in the specified buffer.
- *
- * @param eClient The UART client to receive data from.
- * @param pData Pointer to the buffer to store the received data.
- * @param nDataLen Maximum number of bytes to receive.
- *
- * @return The actual number of bytes received.
- */
-bool UART_ReceiveMessage(U_BYTE* pData)
+
+	pDescriptor = &pUARTx->TxQueue[pUARTx->nTxQueueHead];
+	pDescriptor->pData = pData;
+	pDescriptor->nLength = nDataLen;
+	pDescriptor->nCopyEnd = pUARTx->nTxCopyHead;
+	pDescriptor->pfDone = pfDone;
+	pUARTx->nTxQueueHead = (pUARTx->nTxQueueHead + 1) % UART_TX_QUEUE_SIZE;
+	pUARTx->nTxQueueCount++;
+
+	pStats->nQueued++;
+	if (pUARTx->nTxQueueCount > pStats->nMaxDepth)
+	{
+		pStats->nMaxDepth = pUARTx->nTxQueueCount;
+	}
+
+	// Nothing ahead of this one, so no interrupt is coming to start it
+	if (pUARTx->nTxQueueCount == 1)
+	{
+		uARTx_TxStart(pUARTx);
+	}
+
+	__set_interrupt_state((__istate_t)nOldState);
+	return true;
+} // End uARTx_Enqueue()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_CopyRoom()
+;
+; Description:
+;   Finds the largest contiguous free space in the copy ring.  The DMA needs
+;   each message in one piece, so when the space at the end of the ring is
+;   too small the message starts again at the beginning and the bytes left
+;   at the end are skipped.  One byte is always left free so a full ring
+;   can be told from an empty one.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to check
+;   U_INT16 *pStart => set to the index of the free space
+;
+; Returns:
+;   U_INT16 => bytes free at *pStart
+;
+; Reentrancy:
+;   No, call with interrupts disabled
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static U_INT16 uARTx_CopyRoom(UART_SELECT *pUARTx, U_INT16 *pStart)
 {
-	bool crFound = false;
-	U_INT16 tempTail;
-	UART_SELECT* pUARTx;
-	U_INT16 byteIndex = 0;
+	U_INT16 nHead = pUARTx->nTxCopyHead;
+	U_INT16 nTail = pUARTx->nTxCopyTail;
+	U_INT16 nAtEnd;
+	U_INT16 nAtStart;
 
-	pUARTx = &m_UART[INDEX_UART_PC_COMM];
-	tempTail = pUARTx->nRxTail;
+	if (nHead < nTail)
+	{
+		*pStart = nHead;
+		return nTail - nHead - 1;
+	}
 
-	// Check if there's a CR in the RX buffer
-	while (pUARTx->nRxHead != tempTail && !crFound)
+	nAtEnd = UART_TX_COPY_SIZE - nHead;
+	nAtStart = 0;
+	if (nTail == 0)
 	{
-		if (pUARTx->nRxBuffer[tempTail] == '\r')
+		nAtEnd--;
+	}
+	else
+	{
+		nAtStart = nTail - 1;
+	}
+	if (nAtEnd >= nAtStart)
+	{
+		*pStart = nHead;
+		return nAtEnd;
+	}
+	*pStart = 0;
+	return nAtStart;
+} // End uARTx_CopyRoom()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void uARTx_TxStart(UART_SELECT *pUARTx)
+{
+	UART_TX_DESCRIPTOR *pDescriptor = &pUARTx->TxQueue[pUARTx->nTxQueueTail];
+
+	// Set pointer data to be transmitted and length of data in the DMA regs before enabling DMA and starting the transfer
+	pUARTx->pTxDMA->M0AR = (U_INT32)(pDescriptor->pData);
+	pUARTx->pTxDMA->NDTR = pDescriptor->nLength;
+	USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, ENABLE);
+	DMA_Cmd(pUARTx->pTxDMA, ENABLE);
+} // End uARTx_TxStart()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_TxComplete()
+;
+; Description:
+;   Called from the transmit DMA interrupt when the message at the tail of
+;   the queue has gone.  Frees its copy ring space, starts the next message
+;   straight away so the line stays busy, then tells the sender.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART whose transfer finished
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_TxComplete(UART_SELECT *pUARTx)
+{
+	UART_TX_DESCRIPTOR *pDescriptor;
+	UART_CALLBACK_TX pfDone;
+	U_INT32 nOldState;
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+
+	if (pUARTx->nTxQueueCount == 0)
+	{
+		__set_interrupt_state((__istate_t)nOldState);
+		return;
+	}
+	pDescriptor = &pUARTx->TxQueue[pUARTx->nTxQueueTail];
+	pfDone = pDescriptor->pfDone;
+	pUARTx->nTxCopyTail = pDescriptor->nCopyEnd;
+	pUARTx->nTxQueueTail = (pUARTx->nTxQueueTail + 1) % UART_TX_QUEUE_SIZE;
+	pUARTx->nTxQueueCount--;
+
+	if (pUARTx->nTxQueueCount != 0)
+	{
+		uARTx_TxStart(pUARTx);
+	}
+	else
+	{
+		// Queue empty, disable DMA until next transmit request and give
+		// the next message the whole copy ring
+		DMA_Cmd(pUARTx->pTxDMA, DISABLE);
+		USART_DMACmd(pUARTx->pUART, USART_DMAReq_Tx, DISABLE);
+		pUARTx->nTxCopyHead = 0;
+		pUARTx->nTxCopyTail = 0;
+	}
+
+	__set_interrupt_state((__istate_t)nOldState);
+
+	if (pfDone != NULL)
+	{
+		pfDone();
+	}
+} // End uARTx_TxComplete()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_RxPeek()
+;
+; Description:
+;   Gives the client a view of the oldest bytes it has not released yet,
+;   straight out of the DMA buffer.  The view stops at the end of the
+;   buffer, so data that wraps needs a second peek after the first span
+;   has been released.  The bytes stay valid until they are released or
+;   the DMA catches up with them.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to read from
+;   U_BYTE **ppData => set to the first byte of the span
+;
+; Returns:
+;   U_INT16 => bytes in the span, 0 if nothing is waiting
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT16 UART_RxPeek(UART_CLIENT eClient, const U_BYTE **ppData)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nLength;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return 0;
+	}
+	nLength = uARTx_RxPending(pUARTx);
+	if (nLength > (BUFFER_SIZE_RX_DMA - pUARTx->nRxTailDMA))
+	{
+		nLength = BUFFER_SIZE_RX_DMA - pUARTx->nRxTailDMA;
+	}
+	*ppData = &pUARTx->nRxBufferDMA[pUARTx->nRxTailDMA];
+	return nLength;
+} // End UART_RxPeek()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_RxRelease()
+;
+; Description:
+;   Gives the oldest received bytes back to the DMA once the client is done
+;   with them.
+;
+; Parameters:
+;   UART_CLIENT eClient => client that read the data
+;   U_INT16 nLength => bytes to release, more than are waiting releases all
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void UART_RxRelease(UART_CLIENT eClient, U_INT16 nLength)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nPending;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return;
+	}
+	nPending = uARTx_RxPending(pUARTx);
+	if (nLength > nPending)
+	{
+		nLength = nPending;
+	}
+	pUARTx->nRxTailDMA = (pUARTx->nRxTailDMA + nLength) % BUFFER_SIZE_RX_DMA;
+	pUARTx->nRxRead += nLength;
+	pUARTx->nRxScanned = (pUARTx->nRxScanned > nLength) ? (pUARTx->nRxScanned - nLength) : 0;
+	m_UartRxStats[pUARTx - m_UART].nReceived += nLength;
+} // End UART_RxRelease()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_RxFindDelimiter()
+;
+; Description:
+;   Looks for a delimiter in the bytes waiting for the client.  The search
+;   carries on from where the last call stopped, so each received byte is
+;   looked at once however often the client polls for a partial message.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to search
+;   U_BYTE nDelimiter => byte that ends a message
+;   U_INT16 *pLength => set to the message length including the delimiter
+;
+; Returns:
+;   BOOL => true if a whole message is waiting
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL UART_RxFindDelimiter(UART_CLIENT eClient, U_BYTE nDelimiter, U_INT16 *pLength)
+{
+	UART_SELECT *pUARTx;
+	U_INT16 nPending;
+	U_INT16 nIndex;
+
+	pUARTx = uART_GetSelect(eClient);
+	if (pUARTx == NULL)
+	{
+		return false;
+	}
+	nPending = uARTx_RxPending(pUARTx);
+	nIndex = (pUARTx->nRxTailDMA + pUARTx->nRxScanned) % BUFFER_SIZE_RX_DMA;
+	while (pUARTx->nRxScanned < nPending)
+	{
+		if (pUARTx->nRxBufferDMA[nIndex] == nDelimiter)
 		{
-			crFound = true;
-			pData[byteIndex] = '\0';
-			pUARTx->nRxTail = tempTail + 1;
+			*pLength = pUARTx->nRxScanned + 1;
+			return true;
 		}
-		else
+		pUARTx->nRxScanned++;
+		if (++nIndex >= BUFFER_SIZE_RX_DMA)
 		{
-			pData[byteIndex++] = pUARTx->nRxBuffer[tempTail];
+			nIndex = 0;
 		}
+	}
+	return false;
+} // End UART_RxFindDelimiter()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   UART_ReceiveMessage()
+;
+; Description:
+;   Copies the next carriage return terminated line out of the DMA buffer
+;   as a null terminated string, without the '\r', and releases it.  A line
+;   too long for the caller's buffer is cut short.
+;
+; Parameters:
+;   UART_CLIENT eClient => client to read from
+;   U_BYTE *pData => buffer for the line
+;   U_INT16 nDataLen => size of the buffer, including the terminator
+;
+; Returns:
+;   BOOL => true if a line was copied
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL UART_ReceiveMessage(UART_CLIENT eClient, U_BYTE *pData, U_INT16 nDataLen)
+{
+	const U_BYTE *pSpan;
+	U_INT16 nLength;
+	U_INT16 nSpan;
+	U_INT16 nCopy;
+	U_INT16 nCopied = 0;
 
-		// Update and wrap the tail
-		tempTail++;
-		if (tempTail >= BUFFER_SIZE_RX)
+	if ((nDataLen == 0) || !UART_RxFindDelimiter(eClient, '\r', &nLength))
+	{
+		return false;
+	}
+	while (nLength > 0)
+	{
+		nSpan = UART_RxPeek(eClient, &pSpan);
+		if (nSpan > nLength)
+		{
+			nSpan = nLength;
+		}
+		// the '\r' is released with the line but not copied
+		nCopy = (nSpan == nLength) ? (nSpan - 1) : nSpan;
+		if (nCopy > (nDataLen - 1 - nCopied))
 		{
-			tempTail = 0;
+			nCopy = nDataLen - 1 - nCopied;
 		}
+		(void)memcpy(&pData[nCopied], pSpan, nCopy);
+		nCopied += nCopy;
+		UART_RxRelease(eClient, nSpan);
+		nLength -= nSpan;
+	}
+	pData[nCopied] = '\0';
+	return true;
+} // End UART_ReceiveMessage()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxUpdate()
+;
+; Description:
+;   Catches up with the receive DMA's write position.  Called from the DMA
+;   half and full transfer interrupts, the USART idle line interrupt and by
+;   the client before it looks at the buffer.  The interrupts come at least
+;   every half buffer, so the DMA can never lap the last known position
+;   unseen.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to update
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uARTx_RxUpdate(UART_SELECT *pUARTx)
+{
+	U_INT32 nOldState;
+	U_INT16 nHead;
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+	nHead = BUFFER_SIZE_RX_DMA - (U_INT16)pUARTx->pRxDMA->NDTR;
+	if (nHead >= BUFFER_SIZE_RX_DMA)
+	{
+		nHead = 0;
+	}
+	pUARTx->nRxWritten += (nHead + BUFFER_SIZE_RX_DMA - pUARTx->nRxHeadDMA) % BUFFER_SIZE_RX_DMA;
+	pUARTx->nRxHeadDMA = nHead;
+	__set_interrupt_state((__istate_t)nOldState);
+} // End uARTx_RxUpdate()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uARTx_RxPending()
+;
+; Description:
+;   Reports how many received bytes are waiting for the client.  If the DMA
+;   has come round to the client's unreleased data some of it has been
+;   overwritten, so everything waiting is thrown away and counted in
+;   m_UartRxStats rather than handed over half new and half old.
+;
+; Parameters:
+;   UART_SELECT *pUARTx => UART to check
+;
+; Returns:
+;   U_INT16 => bytes waiting, starting at nRxTailDMA
+;
+; Reentrancy:
+;   No, one reader per client
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static U_INT16 uARTx_RxPending(UART_SELECT *pUARTx)
+{
+	UART_RX_STATS *pStats = &m_UartRxStats[pUARTx - m_UART];
+	U_INT32 nOldState;
+	U_INT32 nPending;
+	U_INT16 nHead;
+
+	nOldState = (U_INT32)__get_interrupt_state();
+	__disable_interrupt();
+	uARTx_RxUpdate(pUARTx);
+	nPending = pUARTx->nRxWritten - pUARTx->nRxRead;
+	nHead = pUARTx->nRxHeadDMA;
+	__set_interrupt_state((__istate_t)nOldState);
+
+	if (nPending >= BUFFER_SIZE_RX_DMA)
+	{
+		pStats->nOverruns++;
+		pStats->nOverrunBytes += nPending;
+		pUARTx->nRxRead += nPending;
+		pUARTx->nRxTailDMA = nHead;
+		pUARTx->nRxScanned = 0;
+		nPending = 0;
+	}
+	if (nPending > pStats->nMaxPending)
+	{
+		pStats->nMaxPending = (U_INT16)nPending;
 	}
+	return (U_INT16)nPending;
+} // End uARTx_RxPending()
 
-	return crFound;
-}
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -513,18 +1063,23 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
 	DMA_InitStructure.DMA_Channel = (U_INT32)(pUARTx->nRxDMAChannel);
 	DMA_Init(pUARTx->pRxDMA, &DMA_InitStructure);
-	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE), ENABLE);
-        DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE | DMA_IT_TC), ENABLE);
+	// The half and full transfer interrupts keep the receive head up to date
+	// while data streams in without a break
+	DMA_ITConfig(pUARTx->pRxDMA, (DMA_IT_HT | DMA_IT_TE | DMA_IT_TC), ENABLE);
 
 	// Reconfiguring the DMA will reset the leading receive buffer index
 	// and the trailing index must be reset manually to keep them synchronized
+	pUARTx->nRxHeadDMA = 0;
 	pUARTx->nRxTailDMA = 0;
+	pUARTx->nRxWritten = 0;
+	pUARTx->nRxRead = 0;
+	pUARTx->nRxScanned = 0;
 
 	// DMA configuration for UARTx_TX (transmitting)
 	DMA_DeInit(pUARTx->pTxDMA);
-	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)(pUARTx->nTxBufferDMA);
+	DMA_InitStructure.DMA_Memory0BaseAddr = (U_INT32)(pUARTx->nTxCopy);
 	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
-	DMA_InitStructure.DMA_BufferSize = UART_BUFFER_SIZE_TX;
+	DMA_InitStructure.DMA_BufferSize = UART_TX_COPY_SIZE;
 	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
 	DMA_InitStructure.DMA_Channel = (U_INT32)(pUARTx->nTxDMAChannel);
 	DMA_Init(pUARTx->pTxDMA, &DMA_InitStructure);
@@ -561,6 +1116,9 @@ static void uARTx_Configure(UART_SELECT *pUARTx)
 	// incorrect bits in control register)
 	USART_ITConfig(pUARTx->pUART, USART_IT_ERR, ENABLE);
 
+	// The idle line interrupt marks the end of each burst of received data
+	USART_ITConfig(pUARTx->pUART, USART_IT_IDLE, ENABLE);
+
 	// Enable the peripheral
 	USART_Cmd(pUARTx->pUART, ENABLE);
 
@@ -601,6 +1159,15 @@ static void uARTx_IRQHandler(UART_SELECT *pUARTx)
 		(void)pUARTx->pUART->DR;
 	}
 
+	if (pUARTx->pUART->SR & USART_FLAG_IDLE)
+	{
+		// Idle line, cleared by the same status then data register read.
+		// The DMA has already taken the last byte, so the read loses nothing
+		(void)pUARTx->pUART->SR;
+		(void)pUARTx->pUART->DR;
+		uARTx_RxUpdate(pUARTx);
+	}
+
 	if (pUARTx->pUART->SR & USART_FLAG_TC)
 	{
 		// Transfer complete
@@ -653,9 +1220,14 @@ void USART1_IRQHandler(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void DMA2_Stream7_IRQHandler(void)
 {
+	BOOL bDone = false;
+
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_TEIF7))
 	{
+		// The stream stops on an error, move on to the next message
 		DMA_ClearITPendingBit(DMA2_Stream7, DMA_IT_TEIF7);
+		m_UartTxStats[INDEX_UART_PC_COMM].nErrors++;
+		bDone = true;
 	}
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_FEIF7))
 	{
@@ -667,10 +1239,13 @@ void DMA2_Stream7_IRQHandler(void)
 	}
 	if (DMA_GetITStatus(DMA2_Stream7, DMA_IT_TCIF7))
 	{
-		// Transmit complete, disable DMA until next transmit request
 		DMA_ClearITPendingBit(DMA2_Stream7, DMA_IT_TCIF7);
-		DMA_Cmd(DMA2_Stream7, DISABLE);
-		USART_DMACmd(USART1, USART_DMAReq_Tx, DISABLE);
+		bDone = true;
+	}
+	if (bDone)
+	{
+		// Transmit complete, start the next queued message if there is one
+		uARTx_TxComplete(&m_UART[INDEX_UART_PC_COMM]);
 	}
 } // End DMA2_Channel7_IRQHandler()
 
@@ -700,27 +1275,13 @@ void DMA2_Stream5_IRQHandler(void)
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_HTIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_HTIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_PC_COMM]);
 	}
 	if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_TCIF5))
 	{
 		DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_TCIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_PC_COMM]);
 	}
-        if (DMA_GetITStatus(DMA2_Stream5, DMA_IT_TCIF5))
-        {
-        DMA_ClearITPendingBit(DMA2_Stream5, DMA_IT_TCIF5);
-        // Check for overflow and handle wrap-around if the buffer is circular
-        if ((Process_Rx_Buffer_Index + BUFFER_SIZE_RX_DMA) >= BUFFER_SIZE_RX)
-          {
-            bufferOverrun = true;
-			// reset buffer option
-          }
-        // Copy data from DMA buffer to processing buffer
-        for (uint32_t i = 0; i < BUFFER_SIZE_RX_DMA; i++)
-          {
-            Process_Rx_Buffer[Process_Rx_Buffer_Index] = DMA_Rx_Buffer[i];
-            Process_Rx_Buffer_Index++;
-          }
-		}
 } // End DMA2_Channel5_IRQHandler()
 
 /*******************************************************************************
@@ -763,9 +1324,14 @@ void USART2_IRQHandler(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void DMA1_Stream6_IRQHandler(void)
 {
+	BOOL bDone = false;
+
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_TEIF6))
 	{
+		// The stream stops on an error, move on to the next message
 		DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TEIF6);
+		m_UartTxStats[INDEX_UART_DATA_LINK].nErrors++;
+		bDone = true;
 	}
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_FEIF6))
 	{
@@ -777,10 +1343,13 @@ void DMA1_Stream6_IRQHandler(void)
 	}
 	if (DMA_GetITStatus(DMA1_Stream6, DMA_IT_TCIF6))
 	{
-		// Transmit complete, disable DMA until next transmit request
 		DMA_ClearITPendingBit(DMA1_Stream6, DMA_IT_TCIF6);
-		DMA_Cmd(DMA1_Stream6, DISABLE);
-		USART_DMACmd(USART2, USART_DMAReq_Tx, DISABLE);
+		bDone = true;
+	}
+	if (bDone)
+	{
+		// Transmit complete, start the next queued message if there is one
+		uARTx_TxComplete(&m_UART[INDEX_UART_DATA_LINK]);
 	}
 } // End DMA1_Stream6_IRQHandler()
 
@@ -803,50 +1372,18 @@ void DMA1_Stream6_IRQHandler(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void DMA1_Stream5_IRQHandler(void)
 {
-    // Transfer Error Interrupt
-    if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TEIF5))
-    {
-        DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TEIF5);
-        // TODO: Handle transfer error (logging, resetting, etc.)
-    }
-
-    // Half Transfer Interrupt
-    if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_HTIF5))
-    {
-        DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_HTIF5);
-        // TODO: Begin processing the first half of the data, if applicable
-    }
-
-    // Transfer Complete Interrupt
-    if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TCIF5))
-    {
-        DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TCIF5);
-
-        // Copy data from DMA_Rx_Buffer to Process_Rx_Buffer
-        for (int i = 0; i < BUFFER_SIZE_RX_DMA; i++)
-        {
-            Process_Rx_Buffer[Process_Rx_Buffer_Index] = DMA_Rx_Buffer[i];
-            Process_Rx_Buffer_Index++;
-
-            // Check for overflow in Process_Rx_Buffer and reset the index if needed
-            if (Process_Rx_Buffer_Index >= BUFFER_SIZE_RX)
-            {
-                Process_Rx_Buffer_Index = 0;
-            }
-            if ((Process_Rx_Buffer_Index + BUFFER_SIZE_RX_DMA) >= BUFFER_SIZE_RX)
-            {
-              bufferOverrun = true;  // Set the flag if an overrun is about to happen.
-            }
-			if (strstr((char *)Process_Rx_Buffer, "BEGIN_CSV") != NULL)
-			{
-				// Respond back for testing
-				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE *)"Received BEGIN_CSV", strlen("Received BEGIN_CSV"));
-			}
-			else
-			{
-				// respond negative
-				UART_SendMessage(CLIENT_PC_COMM, (U_BYTE*)"BEGIN_CSV not received", strlen("BEGIN_CSV not received"));
-			}
-		}
-    }
-}
+	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TEIF5))
+	{
+		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TEIF5);
+	}
+	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_HTIF5))
+	{
+		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_HTIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_DATA_LINK]);
+	}
+	if (DMA_GetITStatus(DMA1_Stream5, DMA_IT_TCIF5))
+	{
+		DMA_ClearITPendingBit(DMA1_Stream5, DMA_IT_TCIF5);
+		uARTx_RxUpdate(&m_UART[INDEX_UART_DATA_LINK]);
+	}
+} // End DMA1_Stream5_IRQHandler()
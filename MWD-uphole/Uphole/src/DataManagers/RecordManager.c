@@ -13,15 +13,17 @@
 //============================================================================//
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include "portable.h"
 #include "CommDriver_UART.h"
-#include "LED.h"
+#include "led.h"
 #include "RecordManager.h"
 #include "rtc.h"
 #include "FlashMemory.h"
+#include "crc.h"
 #include "CommDriver_Flash.h"
 #include "Manager_DataLink.h"
 #include "UI_RecordDataPanel.h"
@@ -29,6 +31,8 @@
 #include "UI_EnterNewPipeLength.h"
 #include "UI_JobTab.h"
 #include "SysTick.h"
+#include "Profile.h"
+#include "Trajectory_Cache.h"
 #include "math.h"
 #include "stdlib.h"
 
@@ -36,15 +40,34 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
-#define RECORD_AREA_BASE_ADDRESS    128
-#define RECORDS_PER_PAGE            (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(STRUCT_RECORD_DATA))
 #define FLASH_PAGE_FILLER           ((FLASH_PAGE_SIZE - 4) - (sizeof(STRUCT_RECORD_DATA) * RECORDS_PER_PAGE))
-#define NEW_HOLE_RECORDS_PER_PAGE   (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(NEWHOLE_INFO))
 #define NEW_HOLE_FLASH_PAGE_FILLER  ((FLASH_PAGE_SIZE - 4) - (sizeof(NEWHOLE_INFO) * NEW_HOLE_RECORDS_PER_PAGE))
 
 #define NULL_PAGE 0xFFFFFFFF
+#define RECORD_PAGE_CACHE_SIZE      4
+#define RECORD_DEPTH_INDEX_SIZE     512
 #define BranchStatusCode 100
 
+// Survey journal entries.  A survey entry carries one record, a checkpoint
+// says every survey before it is in its record page.
+#define RECORD_JOURNAL_SURVEY_MARKER        0x4A53
+#define RECORD_JOURNAL_CHECKPOINT_MARKER    0x4A43
+#define RECORD_JOURNAL_DATA_SIZE            ((sizeof(STRUCT_RECORD_DATA) + 3) & ~3)
+#define RECORD_JOURNAL_ENTRY_SIZE(marker)   (sizeof(RECORD_JOURNAL_HEADER) + sizeof(U_INT32) + \
+                                             (((marker) == RECORD_JOURNAL_SURVEY_MARKER) ? RECORD_JOURNAL_DATA_SIZE : 0))
+// no journal writes for this long means an upload or merge burst is over
+#define RECORD_JOURNAL_IDLE_TIME            ONE_SECOND
+// the last word of a record page, past its records, holds its sequence
+#define RECORD_PAGE_SEQUENCE_OFFSET         (FLASH_PAGE_SIZE - sizeof(U_INT32))
+// more entries than the write queue can hold between them and the flash
+#define RECORD_JOURNAL_SEQUENCE_GAP         (FLASH_WRITE_QUEUE_SIZE * FLASH_PAGE_SIZE / sizeof(RECORD_JOURNAL_HEADER))
+
+#define STATS_INTENT_OPEN                   0x5354
+#define RECOMPUTE_JOB_OPEN                  0x5243
+#define RECOMPUTE_SWAP_ACTIVE               0x5357
+// record pages the hole can grow into before it reaches the shadow pages
+#define RECOMPUTE_SHADOW_GAP                4
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -64,6 +87,104 @@ typedef struct _NEWHOLE_INFO_PAGE
     U_BYTE New_hole_filler[NEW_HOLE_FLASH_PAGE_FILLER];
 } NEWHOLE_INFO_PAGE;
 
+// One valid record of the current hole, kept in measured depth order.
+typedef struct _RECORD_DEPTH_ENTRY
+{
+    U_INT32 nRecord;        // absolute record index
+    U_INT16 nTotalLength;   // measured depth of the record
+} RECORD_DEPTH_ENTRY;
+
+// Start of every journal entry, followed by the record for a survey entry
+// and then a CRC of the whole entry.
+typedef struct _RECORD_JOURNAL_HEADER
+{
+    U_INT16 nMarker;
+    U_INT16 nReserved;
+    U_INT32 nSequence;
+    U_INT32 nRecord;        // absolute record index of a survey entry
+} RECORD_JOURNAL_HEADER;
+
+// Running totals of a recompute, after the last survey redone.
+typedef struct _RECOMPUTE_TOTALS
+{
+    INT32 nTotalDepth;
+    REAL32 fTotalNorthings;
+    REAL32 fTotalEastings;
+    MIN_CURVE_STATION previous; // survey the next one is measured from
+} RECOMPUTE_TOTALS;
+
+// Background recompute of the current hole after the desired azimuth has
+// changed.  The pages are redone into shadow pages above the hole, page
+// nFirstPage into nShadowBase and on up; the pages in use are not touched
+// until the swap.  The running totals are those after nNextRecord - 1.
+typedef struct _RECOMPUTE_JOB
+{
+    U_INT16 nOpen;              // RECOMPUTE_JOB_OPEN while there is work left
+    INT16 nDesiredAzimuth;      // the azimuth the job is working to
+    U_INT32 nNextRecord;        // absolute index of the next record to redo
+    U_INT32 nFirstPage;         // record page of the first survey of the hole
+    U_INT32 nShadowBase;        // record page nFirstPage is redone into
+    RECOMPUTE_TOTALS totals;
+} RECOMPUTE_JOB;
+
+// Redone pages that have been swapped in.  Pages from nCopyPage up to
+// nTailPage are still read from their shadow until they are copied back,
+// the tail page is copied into m_WritePage.  Kept in the statistics slots,
+// so it is swapped in with the totals by one commit.
+typedef struct _RECOMPUTE_SWAP
+{
+    U_INT16 nActive;            // RECOMPUTE_SWAP_ACTIVE until copied back
+    U_INT16 bTailCopied;        // m_WritePage holds the redone tail page
+    U_INT32 nFirstPage;
+    U_INT32 nTailPage;          // the page m_WritePage is filling
+    U_INT32 nShadowBase;
+    U_INT32 nCopyPage;          // next page to copy back
+} RECOMPUTE_SWAP;
+
+// A committed copy of boreholeStats.  Two are kept and written in turn, so
+// a brown-out while one is written leaves the other one good.
+typedef struct _BOREHOLE_STATS_SLOT
+{
+    U_INT32 nSequence;
+    BOREHOLE_STATISTICS stats;
+    RECOMPUTE_SWAP swap;
+    U_INT32 nCrc;
+} BOREHOLE_STATS_SLOT;
+
+// Write-ahead intent, opened before boreholeStats is changed and closed
+// when the change is committed to a slot.
+typedef struct _BOREHOLE_STATS_INTENT
+{
+    U_INT32 nSequence;      // slot sequence the change will commit as
+    U_INT32 nRecordCount;   // RecordCount when the change started
+    U_INT16 nOperation;     // STATS_OPERATION
+    U_INT16 nOpen;          // STATS_INTENT_OPEN, written last
+} BOREHOLE_STATS_INTENT;
+
+typedef enum
+{
+    STATS_OP_NONE,
+    STATS_OP_OPEN_FILE,
+    STATS_OP_SURVEY,
+    STATS_OP_MERGE,
+    STATS_OP_REMOVE,
+    STATS_OP_NEW_HOLE,
+    STATS_OP_BRANCH,
+    STATS_OP_UPLOAD,
+    STATS_OP_RECOMPUTE
+} STATS_OPERATION;
+
+// Branch tree of the current hole.  The CRC covers the header and the
+// branches in use, and is taken whenever the statistics are committed.
+typedef struct _RECORD_BRANCH_TREE
+{
+    U_INT32 nCrc;
+    U_INT32 nHoleFirstRecord;   // first record of the hole the tree is for
+    U_INT16 nCount;             // 0 until it has been worked out
+    U_INT16 bOverflow;          // the hole has more branches than fit
+    RECORD_BRANCH branch[RECORD_MAX_BRANCHES];
+} RECORD_BRANCH_TREE;
+
 /*typedef struct _BOREHOLE_STATISTICS
 {
     char BoreholeName[16];
@@ -97,10 +218,81 @@ __no_init static NEWHOLE_INFO_PAGE m_New_hole_info_WritePage
 @ "RECORD_STORAGE_BBRAM";
 __no_init static BOOL BranchSet
 @ "RECORD_STORAGE_BBRAM";
+__no_init static BOREHOLE_STATS_SLOT m_StatsSlot[2]
+@ "RECORD_STORAGE_BBRAM";
+__no_init static BOREHOLE_STATS_INTENT m_StatsIntent
+@ "RECORD_STORAGE_BBRAM";
+__no_init static RECOMPUTE_JOB m_Recompute
+@ "RECORD_STORAGE_BBRAM";
 
-static RECORD_PAGE m_ReadPage = { NULL_PAGE };
+// The branch tree does not fit in what is left of the battery backed RAM,
+// it is worked out again from the record pages at power up.
+static RECORD_BRANCH_TREE m_BranchTree;
+
+// Sequence of the newest slot, the next commit goes in the other one.
+static U_INT32 m_nStatsSequence = 0;
+BOREHOLE_STATS_RECOVERY m_BoreholeStatsRecovery;
+
+// Recently read record pages, m_pReadPage points at the most recent one.
+// A slot whose last use is 0 is empty.
+static RECORD_PAGE m_PageCache[RECORD_PAGE_CACHE_SIZE];
+static U_INT32 m_nPageCacheLastUse[RECORD_PAGE_CACHE_SIZE];
+static U_INT32 m_nPageCacheClock = 0;
+static RECORD_PAGE* m_pReadPage = &m_PageCache[0];
+// Put m_PageCacheStats in a Live Watch window to see how well the cache works.
+RECORD_PAGE_CACHE_STATS m_PageCacheStats = { 0, 0, 0 };
 static NEWHOLE_INFO_PAGE m_New_hole_info_ReadPage = { NULL_PAGE };
 
+// Depth index of the current hole.  It lives in plain RAM, so it starts out
+// invalid after a reset and is rebuilt from flash on first use.  When a hole
+// has more valid records than fit, lookups fall back to scanning the hole.
+static RECORD_DEPTH_ENTRY m_DepthIndex[RECORD_DEPTH_INDEX_SIZE];
+static U_INT32 m_nDepthIndexCount = 0;
+static BOOL m_bDepthIndexValid = false;
+static BOOL m_bDepthIndexOverflow = false;
+
+// Survey journal.  Rewriting a record page costs an erase for every survey,
+// so a new survey is appended to a pre-erased page of the journal instead
+// and only m_WritePage, in battery backed RAM, holds the whole page.  The
+// record page itself is written once it is full, or when the journal has to
+// be folded in.  Entries after the newest checkpoint are folded into their
+// pages at power up.  The page number that is only up to date in
+// m_WritePage is kept in m_nJournalPendingPage.  A record page is written
+// with the sequence of the newest entry at the time, so an entry from
+// before it, for a survey removed since, is not folded back in.
+static U_INT32 m_nJournalPage[FLASH_PAGE_SIZE / sizeof(U_INT32)];
+static U_INT32 m_nJournalFirstPage;
+static U_INT16 m_nJournalPageIndex = RECORD_JOURNAL_PAGES - 1;
+static U_INT16 m_nJournalOffset = FLASH_PAGE_SIZE;
+static U_INT32 m_nJournalSequence = 0;
+static U_INT16 m_nJournalPagesOpen = 0;     // journal pages started since the last checkpoint
+static U_INT32 m_nJournalPendingPage = NULL_PAGE;
+static TIME_LR m_tJournalLastWrite;
+static BOOL m_bJournalReady = false;
+static BOOL m_bJournalDirty = false;        // survey entries since the last checkpoint
+static BOOL m_bJournalCheckpointDue = false; // every survey journaled is programmed in its page
+// Put m_RecordJournalStats in a Live Watch window, nEntries against
+// nPageWrites shows the erases saved.
+RECORD_JOURNAL_STATS m_RecordJournalStats;
+
+// Put m_RecordBranchTreeStats in a Live Watch window, there is one rebuild
+// at power up and any more mean the tree fell behind the records.
+RECORD_BRANCH_TREE_STATS m_RecordBranchTreeStats;
+
+// Copy of a record page being recomputed or copied back from its shadow
+static STRUCT_RECORD_DATA m_RecomputePage[RECORDS_PER_PAGE];
+// Swapped in pages still being copied back, committed with the statistics
+static RECOMPUTE_SWAP m_Swap;
+// The tail page is redone last and again whenever a commit changes it
+// before the swap.  m_RecomputeTail holds the totals after it.
+static RECOMPUTE_TOTALS m_RecomputeTail;
+static U_INT32 m_nRecomputeTailSequence;
+static BOOL m_bRecomputeTailQueued = false;
+static BOOL m_bRecomputeShadowFailed = false;
+// Put m_RecordRecomputeStats in a Live Watch window, nCopiedBack catches up
+// with nPages once a recompute has been swapped in.
+RECORD_RECOMPUTE_STATS m_RecordRecomputeStats;
+
 // To be used to read the new hole info into
 //static NEWHOLE_INFO selectedNewHoleInfo;
 
@@ -117,6 +309,14 @@ INT16 GammaTemp = 0;
 
 STRUCT_RECORD_DATA record;
 
+static BOOL JournalAppend(U_INT16 nMarker, U_INT32 nRecord, const STRUCT_RECORD_DATA* record);
+static void JournalCheckpoint(void);
+static void JournalWriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus);
+static void JournalPageWritten(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus);
+static void RecomputeStart(void);
+static void RecomputeBeforeChange(STATS_OPERATION eOperation);
+static void RecomputeCopyTail(void);
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -151,7 +351,7 @@ static U_BYTE PageOffset(U_INT32 recordCount)
 /*******************************************************************************
 *       @details
 *******************************************************************************/
-static U_BYTE PageNumber(U_INT32 recordCount)
+static U_INT32 PageNumber(U_INT32 recordCount)
 {
     return recordCount / RECORDS_PER_PAGE;
 }
@@ -164,14 +364,99 @@ static BOOL IsPageFull(U_INT32 recordCount)
     return (PageOffset(recordCount) == 0) && (PageNumber(recordCount) != 0);
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void PageCacheInvalidate(U_INT32 pageNumber)
+{
+    U_BYTE nSlot;
+
+    for (nSlot = 0; nSlot < RECORD_PAGE_CACHE_SIZE; nSlot++)
+    {
+        if ((pageNumber == NULL_PAGE) || (m_PageCache[nSlot].number == pageNumber))
+        {
+            m_PageCache[nSlot].number = NULL_PAGE;
+            m_nPageCacheLastUse[nSlot] = 0;
+        }
+    }
+    m_PageCacheStats.nInvalidations++;
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 static FLASH_PAGE page;
+static void PageWriteFrom(const STRUCT_RECORD_DATA* records, U_INT32 pageNumber)
+{
+    PROFILE_Start(PROFILE_RECORD_PAGE_WRITE);
+    memcpy(&page, records, sizeof(m_WritePage.records));
+    memcpy(&page.AsBytes[RECORD_PAGE_SEQUENCE_OFFSET], &m_nJournalSequence, sizeof(U_INT32));
+    if (pageNumber == m_nJournalPendingPage)
+    {
+        // the page now has every survey journaled for it
+        m_nJournalPendingPage = NULL_PAGE;
+        m_RecordJournalStats.nCompactions++;
+    }
+    m_RecordJournalStats.nPageWrites++;
+    // programmed from the 10 ms tick, blocking only when the queue is full
+    if (!FLASH_QueueWrite(&page, pageNumber + RECORD_AREA_BASE_ADDRESS, JournalPageWritten))
+    {
+        JournalPageWritten(pageNumber + RECORD_AREA_BASE_ADDRESS,
+                           FLASH_WritePage(&page, pageNumber + RECORD_AREA_BASE_ADDRESS));
+    }
+    PageCacheInvalidate(pageNumber);
+    PROFILE_Stop(PROFILE_RECORD_PAGE_WRITE);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
 static void PageWrite(U_INT32 pageNumber)
 {
-    memcpy(&page, m_WritePage.records, sizeof(m_WritePage.records));
-    FLASH_WritePage(&page, pageNumber + RECORD_AREA_BASE_ADDRESS);
+    PageWriteFrom(m_WritePage.records, pageNumber);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PageCommit()
+;
+; Description:
+;   Makes a survey just put in m_WritePage durable.  It is appended to the
+;   journal, which only programs a few bytes, unless it fills its page or
+;   the journal cannot take it; then the whole page is written as before.
+;
+; Parameters:
+;   U_INT32 nRecord => absolute record index of the survey
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void PageCommit(U_INT32 nRecord)
+{
+    U_INT32 nPage = PageNumber(nRecord);
+    BOOL bLastInPage = (PageOffset(nRecord) == (RECORDS_PER_PAGE - 1));
+
+    if (m_nJournalPendingPage != nPage)
+    {
+        // only left behind when records were removed back into an earlier
+        // page, the surveys it was waiting on are gone
+        m_nJournalPendingPage = NULL_PAGE;
+    }
+    if (!bLastInPage && JournalAppend(RECORD_JOURNAL_SURVEY_MARKER, nRecord, &m_WritePage.records[PageOffset(nRecord)]))
+    {
+        m_nJournalPendingPage = nPage;
+        m_RecordJournalStats.nEntries++;
+        PageCacheInvalidate(nPage);
+        return;
+    }
+    if (!bLastInPage)
+    {
+        m_RecordJournalStats.nFallbacks++;
+    }
+    PageWrite(nPage);
 }
 
 /*******************************************************************************
@@ -185,43 +470,1300 @@ static void PageWritePartial(U_INT32 recordNumber)
     }
 }
 
+/*******************************************************************************
+*       @details
+*       Record page to read a page from.  A page of a swapped in recompute
+*       is read from its shadow until it has been copied back.
+*******************************************************************************/
+static U_INT32 RecomputeSourcePage(U_INT32 pageNumber)
+{
+    if ((m_Swap.nActive == RECOMPUTE_SWAP_ACTIVE) && (pageNumber >= m_Swap.nCopyPage)
+        && (pageNumber < m_Swap.nTailPage))
+    {
+        return m_Swap.nShadowBase + (pageNumber - m_Swap.nFirstPage);
+    }
+    return pageNumber;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PageRead()
+;
+; Description:
+;   Points m_pReadPage at the requested record page.  The page comes from
+;   the cache when it is there, otherwise it is read from flash into the
+;   least recently used slot.  A page that fails its CRC is still handed
+;   back, as before, but is not kept so the next access reads it again.
+;   PageWrite() drops a page from the cache whenever it is rewritten.  The
+;   page waiting on the journal is taken from m_WritePage, and a page of a
+;   recompute that is not copied back yet from its shadow.
+;
+; Parameters:
+;   U_INT32 pageNumber => record page, relative to RECORD_AREA_BASE_ADDRESS
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void PageRead(U_INT32 pageNumber)
+{
+    U_BYTE nSlot, nVictim = 0;
+
+    m_nPageCacheClock++;
+    for (nSlot = 0; nSlot < RECORD_PAGE_CACHE_SIZE; nSlot++)
+    {
+        if ((m_nPageCacheLastUse[nSlot] != 0) && (m_PageCache[nSlot].number == pageNumber))
+        {
+            m_nPageCacheLastUse[nSlot] = m_nPageCacheClock;
+            m_pReadPage = &m_PageCache[nSlot];
+            m_PageCacheStats.nHits++;
+            return;
+        }
+        if (m_nPageCacheLastUse[nSlot] < m_nPageCacheLastUse[nVictim])
+        {
+            nVictim = nSlot;
+        }
+    }
+
+    m_pReadPage = &m_PageCache[nVictim];
+    if (pageNumber == m_nJournalPendingPage)
+    {
+        // the flash copy is missing the journaled surveys
+        memcpy(m_pReadPage->records, m_WritePage.records, sizeof(m_WritePage.records));
+        m_pReadPage->number = pageNumber;
+        m_nPageCacheLastUse[nVictim] = m_nPageCacheClock;
+        m_PageCacheStats.nHits++;
+        return;
+    }
+
+    PROFILE_Start(PROFILE_RECORD_PAGE_READ);
+    m_PageCacheStats.nMisses++;
+    if (FLASH_ReadPage(&page, RecomputeSourcePage(pageNumber) + RECORD_AREA_BASE_ADDRESS) != FLASH_PAGE_CORRUPT)
+    {
+        m_pReadPage->number = pageNumber;
+        m_nPageCacheLastUse[nVictim] = m_nPageCacheClock;
+    }
+    else
+    {
+        m_pReadPage->number = NULL_PAGE;
+        m_nPageCacheLastUse[nVictim] = 0;
+    }
+    memcpy(m_pReadPage->records, &page, sizeof(m_WritePage.records));
+    PROFILE_Stop(PROFILE_RECORD_PAGE_READ);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_ReadRecordPage()
+;
+; Description:
+;   Copies a whole record page for code that sends the log page by page.
+;   The flash copy of the page waiting on the journal is missing the
+;   journaled surveys, so that page comes from m_WritePage.  Every other
+;   page comes from FLASH_ReadPage(), which sees writes still queued, or
+;   from its shadow while a recompute is copied back.
+;
+; Parameters:
+;   FLASH_PAGE* pPage => receives the page
+;   U_INT32 pageNumber => record page, relative to RECORD_AREA_BASE_ADDRESS
+;
+; Returns:
+;   FLASH_PAGE_STATUS => as FLASH_ReadPage()
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+FLASH_PAGE_STATUS RECORD_ReadRecordPage(FLASH_PAGE* pPage, U_INT32 pageNumber)
+{
+    if (pageNumber == m_nJournalPendingPage)
+    {
+        memset(pPage, 0xFF, sizeof(FLASH_PAGE));
+        memcpy(pPage, m_WritePage.records, sizeof(m_WritePage.records));
+        return FLASH_PAGE_GOOD;
+    }
+    return FLASH_ReadPage(pPage, RecomputeSourcePage(pageNumber) + RECORD_AREA_BASE_ADDRESS);
+}
+
+/*******************************************************************************
+*       @details
+*       Hole info pages are queued for writing as soon as they change, so
+*       FLASH_ReadPage() always has the current copy.
+*******************************************************************************/
+FLASH_PAGE_STATUS RECORD_ReadHoleInfoPage(FLASH_PAGE* pPage, U_INT32 pageNumber)
+{
+    return FLASH_ReadPage(pPage, pageNumber);
+}
+
+/*******************************************************************************
+*       @details
+*       Returns the size of the valid journal entry at nOffset of
+*       m_nJournalPage, or 0 if there is none.
+*******************************************************************************/
+static U_INT16 JournalCheckEntry(U_INT16 nOffset)
+{
+    U_BYTE* pPage = (U_BYTE*)m_nJournalPage;
+    RECORD_JOURNAL_HEADER* pHeader = (RECORD_JOURNAL_HEADER*)&pPage[nOffset];
+    U_INT32 nCalcCRC, nStoredCRC;
+    U_INT16 nSize;
+
+    if ((nOffset + sizeof(RECORD_JOURNAL_HEADER)) > FLASH_PAGE_SIZE)
+    {
+        return 0;
+    }
+    if ((pHeader->nMarker != RECORD_JOURNAL_SURVEY_MARKER) && (pHeader->nMarker != RECORD_JOURNAL_CHECKPOINT_MARKER))
+    {
+        return 0;
+    }
+    nSize = RECORD_JOURNAL_ENTRY_SIZE(pHeader->nMarker);
+    if ((nOffset + nSize) > FLASH_PAGE_SIZE)
+    {
+        return 0;
+    }
+    (void)CalculateCRC(&pPage[nOffset], nSize - sizeof(U_INT32), &nCalcCRC);
+    memcpy(&nStoredCRC, &pPage[nOffset + nSize - sizeof(U_INT32)], sizeof(nStoredCRC));
+    return (nCalcCRC == nStoredCRC) ? nSize : 0;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   JournalAppend()
+;
+; Description:
+;   Adds an entry to the journal page in RAM and queues it to be programmed
+;   without an erase.  When the page is full the next page of the ring is
+;   erased and started instead, unless that page may still hold surveys
+;   that are not in their record pages yet.
+;
+; Parameters:
+;   U_INT16 nMarker => RECORD_JOURNAL_SURVEY_MARKER or ..._CHECKPOINT_MARKER
+;   U_INT32 nRecord => absolute record index of a survey
+;   const STRUCT_RECORD_DATA* record => the survey, NULL for a checkpoint
+;
+; Returns:
+;   BOOL => false if nothing was queued, the caller writes the page instead
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static BOOL JournalAppend(U_INT16 nMarker, U_INT32 nRecord, const STRUCT_RECORD_DATA* record)
+{
+    U_BYTE* pPage = (U_BYTE*)m_nJournalPage;
+    RECORD_JOURNAL_HEADER* pHeader;
+    U_INT16 nSize = RECORD_JOURNAL_ENTRY_SIZE(nMarker);
+    BOOL bNewPage = ((m_nJournalOffset + nSize) > FLASH_PAGE_SIZE);
+    BOOL bQueued;
+    U_INT32 nCRC;
+
+    if (!m_bJournalReady || (FLASH_GetWriteQueueDepth() >= FLASH_WRITE_QUEUE_SIZE))
+    {
+        return false;
+    }
+    if (bNewPage)
+    {
+        // a checkpoint may reuse the oldest page, its surveys are all saved
+        if (m_bJournalDirty && !m_bJournalCheckpointDue && (m_nJournalPagesOpen >= (RECORD_JOURNAL_PAGES - 1)))
+        {
+            return false;
+        }
+        if (m_bJournalDirty)
+        {
+            m_nJournalPagesOpen++;
+        }
+        m_nJournalPageIndex = (m_nJournalPageIndex + 1) % RECORD_JOURNAL_PAGES;
+        memset(m_nJournalPage, 0xFF, sizeof(m_nJournalPage));
+        m_nJournalOffset = 0;
+    }
+
+    pHeader = (RECORD_JOURNAL_HEADER*)&pPage[m_nJournalOffset];
+    pHeader->nMarker = nMarker;
+    pHeader->nReserved = 0;
+    pHeader->nSequence = ++m_nJournalSequence;
+    pHeader->nRecord = nRecord;
+    if (record != NULL)
+    {
+        memset(&pPage[m_nJournalOffset + sizeof(RECORD_JOURNAL_HEADER)], 0, RECORD_JOURNAL_DATA_SIZE);
+        memcpy(&pPage[m_nJournalOffset + sizeof(RECORD_JOURNAL_HEADER)], record, sizeof(STRUCT_RECORD_DATA));
+    }
+    (void)CalculateCRC(&pPage[m_nJournalOffset], nSize - sizeof(U_INT32), &nCRC);
+    memcpy(&pPage[m_nJournalOffset + nSize - sizeof(U_INT32)], &nCRC, sizeof(nCRC));
+    m_nJournalOffset += nSize;
+
+    if (bNewPage)
+    {
+        m_RecordJournalStats.nJournalErases++;
+        bQueued = FLASH_QueueWriteRaw((FLASH_PAGE*)m_nJournalPage, m_nJournalFirstPage + m_nJournalPageIndex, JournalWriteDone);
+    }
+    else
+    {
+        bQueued = FLASH_QueueAppendRaw((FLASH_PAGE*)m_nJournalPage, m_nJournalFirstPage + m_nJournalPageIndex, JournalWriteDone);
+    }
+    if (!bQueued)
+    {
+        // the page in RAM no longer matches the flash, stop journaling
+        m_bJournalReady = false;
+        return false;
+    }
+    if (nMarker == RECORD_JOURNAL_SURVEY_MARKER)
+    {
+        m_bJournalDirty = true;
+        m_bJournalCheckpointDue = false;
+    }
+    m_tJournalLastWrite = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       A journal page that failed to program may hold anything, so surveys
+*       go straight to their pages from then on.  RECORD_JournalService()
+*       writes out the page that was waiting on the journal.
+*******************************************************************************/
+static void JournalWriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus)
+{
+    if (eStatus != FLASH_PAGE_GOOD)
+    {
+        m_RecordJournalStats.nFailed++;
+        m_bJournalReady = false;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Called once a record page is programmed.  When no survey is waiting
+*       on the journal any more, a checkpoint is added so they are not
+*       folded in again at power up.  Not while other writes are queued, a
+*       page write among them may hold surveys the checkpoint would cover.
+*******************************************************************************/
+static void JournalPageWritten(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus)
+{
+    if ((eStatus == FLASH_PAGE_GOOD) && m_bJournalDirty && (m_nJournalPendingPage == NULL_PAGE)
+        && (FLASH_GetWriteQueueDepth() == 0))
+    {
+        m_bJournalCheckpointDue = true;
+        JournalCheckpoint();
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void JournalCheckpoint(void)
+{
+    if (JournalAppend(RECORD_JOURNAL_CHECKPOINT_MARKER, 0, NULL))
+    {
+        m_bJournalCheckpointDue = false;
+        m_bJournalDirty = false;
+        m_nJournalPagesOpen = 0;
+        m_RecordJournalStats.nCheckpoints++;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Writes out the record page that is waiting on the journal, if any.
+*******************************************************************************/
+static void JournalCompact(void)
+{
+    if (m_nJournalPendingPage != NULL_PAGE)
+    {
+        PageWrite(m_nJournalPendingPage);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Journal sequence a record page was written at, 0 if it does not read
+*       back.
+*******************************************************************************/
+static U_INT32 PageJournalSequence(U_INT32 pageNumber)
+{
+    U_INT32 nSequence = 0;
+
+    if (FLASH_ReadPage(&page, RecomputeSourcePage(pageNumber) + RECORD_AREA_BASE_ADDRESS) == FLASH_PAGE_GOOD)
+    {
+        memcpy(&nSequence, &page.AsBytes[RECORD_PAGE_SEQUENCE_OFFSET], sizeof(nSequence));
+    }
+    return nSequence;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_JournalRecover()
+;
+; Description:
+;   Finds the newest journal page, then walks the ring from the oldest page
+;   twice: once for the newest checkpoint and once to fold every survey
+;   after it into its record page, unless the page was written after the
+;   entry.  Writing carries on after the last good entry, or in a fresh
+;   page if the tail of the newest one is not erased.  The sequence moves
+;   on past entries that never reached the flash but may have been written
+;   into a record page.
+;   Called once at power up, after the serial flash has been detected.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_JournalRecover(void)
+{
+    U_BYTE* pPage = (U_BYTE*)m_nJournalPage;
+    RECORD_JOURNAL_HEADER* pHeader;
+    U_INT32 nNewest = 0, nCheckpoint = 0, nReplayPage = NULL_PAGE, nCovered = 0;
+    U_INT16 nPage, nIndex, nOffset = FLASH_PAGE_SIZE, nSize;
+    U_BYTE nPass;
+    BOOL bFound = false;
+
+    m_bJournalReady = false;
+    m_nJournalPendingPage = NULL_PAGE;
+    if (!Serial_Flash_Chip.ext_flash_working)
+    {
+        return;
+    }
+    m_nJournalFirstPage = Serial_Flash_Chip.Record_journal_start_page;
+
+    // the page started last has the highest sequence in its first entry
+    for (nPage = 0; nPage < RECORD_JOURNAL_PAGES; nPage++)
+    {
+        FLASH_ReadThePage(pPage, m_nJournalFirstPage + nPage);
+        pHeader = (RECORD_JOURNAL_HEADER*)pPage;
+        if ((JournalCheckEntry(0) != 0) && (!bFound || (pHeader->nSequence > nNewest)))
+        {
+            bFound = true;
+            nNewest = pHeader->nSequence;
+            m_nJournalPageIndex = nPage;
+        }
+    }
+
+    for (nPass = 0; bFound && (nPass < 2); nPass++)
+    {
+        for (nPage = 1; nPage <= RECORD_JOURNAL_PAGES; nPage++)
+        {
+            nIndex = (m_nJournalPageIndex + nPage) % RECORD_JOURNAL_PAGES;
+            FLASH_ReadThePage(pPage, m_nJournalFirstPage + nIndex);
+            for (nOffset = 0; (nSize = JournalCheckEntry(nOffset)) != 0; nOffset += nSize)
+            {
+                pHeader = (RECORD_JOURNAL_HEADER*)&pPage[nOffset];
+                if ((nPass == 1) && (pHeader->nSequence > m_nJournalSequence))
+                {
+                    // a page written from here on has every entry so far
+                    m_nJournalSequence = pHeader->nSequence;
+                }
+                if (pHeader->nMarker == RECORD_JOURNAL_CHECKPOINT_MARKER)
+                {
+                    if ((nPass == 0) && (pHeader->nSequence > nCheckpoint))
+                    {
+                        nCheckpoint = pHeader->nSequence;
+                    }
+                }
+                else if ((nPass == 1) && (pHeader->nSequence > nCheckpoint))
+                {
+                    if (PageNumber(pHeader->nRecord) != nReplayPage)
+                    {
+                        if (nReplayPage != NULL_PAGE)
+                        {
+                            PageWriteFrom(m_pReadPage->records, nReplayPage);
+                        }
+                        nReplayPage = PageNumber(pHeader->nRecord);
+                        PageRead(nReplayPage);
+                        nCovered = PageJournalSequence(nReplayPage);
+                    }
+                    if (pHeader->nSequence > nCovered)
+                    {
+                        memcpy(&m_pReadPage->records[PageOffset(pHeader->nRecord)], &pPage[nOffset + sizeof(RECORD_JOURNAL_HEADER)], sizeof(STRUCT_RECORD_DATA));
+                        m_RecordJournalStats.nReplayed++;
+                    }
+                }
+            }
+        }
+    }
+
+    // the last page walked was the newest, carry on after its last entry
+    // unless something past it was half written
+    for (nSize = nOffset; nSize < FLASH_PAGE_SIZE; nSize++)
+    {
+        if (pPage[nSize] != 0xFF)
+        {
+            nOffset = FLASH_PAGE_SIZE;
+            break;
+        }
+    }
+    m_nJournalOffset = bFound ? nOffset : FLASH_PAGE_SIZE;
+    m_nJournalSequence += RECORD_JOURNAL_SEQUENCE_GAP;
+    m_nJournalPagesOpen = 0;
+    m_bJournalReady = true;
+
+    if (nReplayPage != NULL_PAGE)
+    {
+        PageWriteFrom(m_pReadPage->records, nReplayPage);
+        FLASH_FlushWrites();
+        m_bJournalDirty = true;
+        JournalCheckpoint();
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_JournalService()
+;
+; Description:
+;   Background side of the journal, called from the 100 ms tick.  Once the
+;   flash and the journal have been quiet for RECORD_JOURNAL_IDLE_TIME it
+;   adds a checkpoint a page write could not queue, and folds the waiting
+;   page into flash when the journal has stopped working or is half used.
+;   A page that fills up is written as soon as it does, so most surveys
+;   never need folding here.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_JournalService(void)
+{
+    if ((FLASH_GetWriteQueueDepth() != 0) ||
+        (ElapsedTimeLowRes(m_tJournalLastWrite) < RECORD_JOURNAL_IDLE_TIME))
+    {
+        return;
+    }
+    if (m_bJournalCheckpointDue)
+    {
+        JournalCheckpoint();
+    }
+    else if (!m_bJournalReady || (m_nJournalPagesOpen >= (RECORD_JOURNAL_PAGES / 2)))
+    {
+        JournalCompact();
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_JournalFlush()
+;
+; Description:
+;   Synchronous form of RECORD_JournalService() for shutdown.  Folds the
+;   page waiting on the journal into flash, adds the checkpoint after it
+;   and runs the flash write queue until everything is programmed.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_JournalFlush(void)
+{
+    JournalCompact();
+    // the page write queues the checkpoint itself unless other writes were
+    // queued behind it or the journal was full
+    if (FLASH_FlushWrites() && m_bJournalDirty && (m_nJournalPendingPage == NULL_PAGE))
+    {
+        m_bJournalCheckpointDue = true;
+    }
+    if (m_bJournalCheckpointDue)
+    {
+        JournalCheckpoint();
+        (void)FLASH_FlushWrites();
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void RecordInit(STRUCT_RECORD_DATA* record)
+{
+    memset(record, 0, sizeof(STRUCT_RECORD_DATA));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void RecordWrite(STRUCT_RECORD_DATA* record, U_INT32 nRecord)
+{
+    memcpy(&m_WritePage.records[PageOffset(nRecord)], record, sizeof(STRUCT_RECORD_DATA));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL RecordRead(STRUCT_RECORD_DATA* record, U_INT32 nRecord)
+{
+    if (nRecord < boreholeStats.RecordCount)
+    {
+        memcpy(record, &m_pReadPage->records[PageOffset(nRecord)], sizeof(STRUCT_RECORD_DATA));
+        return true;
+    }
+    return false;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void DepthIndexReset(void)
+{
+    m_nDepthIndexCount = 0;
+    m_bDepthIndexOverflow = false;
+    m_bDepthIndexValid = true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   DepthIndexPut()
+;
+; Description:
+;   Adds a record to the depth index, or moves it if the record is already
+;   there (a record slot can be merged more than once before it is closed).
+;   Surveys nearly always come in deepest last, so the insertion point is
+;   searched for from the end and the shift is usually empty.
+;
+; Parameters:
+;   U_INT32 nRecord      => absolute record index
+;   U_INT16 nTotalLength => measured depth of the record
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void DepthIndexPut(U_INT32 nRecord, U_INT16 nTotalLength)
+{
+    U_INT32 nIndex;
+
+    if (!m_bDepthIndexValid || m_bDepthIndexOverflow)
+    {
+        return;
+    }
+    for (nIndex = m_nDepthIndexCount; nIndex > 0; nIndex--)
+    {
+        if (m_DepthIndex[nIndex - 1].nRecord == nRecord)
+        {
+            memmove(&m_DepthIndex[nIndex - 1], &m_DepthIndex[nIndex], (m_nDepthIndexCount - nIndex) * sizeof(RECORD_DEPTH_ENTRY));
+            m_nDepthIndexCount--;
+            break;
+        }
+    }
+    if (m_nDepthIndexCount >= RECORD_DEPTH_INDEX_SIZE)
+    {
+        m_bDepthIndexOverflow = true;
+        return;
+    }
+    nIndex = m_nDepthIndexCount;
+    while ((nIndex > 0) && (m_DepthIndex[nIndex - 1].nTotalLength > nTotalLength))
+    {
+        m_DepthIndex[nIndex] = m_DepthIndex[nIndex - 1];
+        nIndex--;
+    }
+    m_DepthIndex[nIndex].nRecord = nRecord;
+    m_DepthIndex[nIndex].nTotalLength = nTotalLength;
+    m_nDepthIndexCount++;
+}
+
+/*******************************************************************************
+*       @details
+*       Drops every record from nFirstRecord onward out of the depth index.
+*******************************************************************************/
+static void DepthIndexTruncate(U_INT32 nFirstRecord)
+{
+    U_INT32 nIn, nOut = 0;
+
+    if (!m_bDepthIndexValid)
+    {
+        return;
+    }
+    if (m_bDepthIndexOverflow)
+    {
+        // entries were lost, let the next lookup rebuild it
+        m_bDepthIndexValid = false;
+        return;
+    }
+    for (nIn = 0; nIn < m_nDepthIndexCount; nIn++)
+    {
+        if (m_DepthIndex[nIn].nRecord < nFirstRecord)
+        {
+            m_DepthIndex[nOut++] = m_DepthIndex[nIn];
+        }
+    }
+    m_nDepthIndexCount = nOut;
+}
+
+/*******************************************************************************
+*       @details
+*       Seals the branch tree with a CRC of the header and the branches in use.
+*******************************************************************************/
+static void BranchTreeSeal(void)
+{
+    (void)CalculateCRC((U_BYTE*)&m_BranchTree.nHoleFirstRecord,
+                       offsetof(RECORD_BRANCH_TREE, branch) - offsetof(RECORD_BRANCH_TREE, nHoleFirstRecord)
+                       + (m_BranchTree.nCount * sizeof(RECORD_BRANCH)), &m_BranchTree.nCrc);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static BOOL BranchTreeIsValid(void)
+{
+    U_INT32 nCrc;
+
+    if ((m_BranchTree.nCount == 0) || (m_BranchTree.nCount > RECORD_MAX_BRANCHES))
+    {
+        return false;
+    }
+    return CalculateCRC((U_BYTE*)&m_BranchTree.nHoleFirstRecord,
+                        offsetof(RECORD_BRANCH_TREE, branch) - offsetof(RECORD_BRANCH_TREE, nHoleFirstRecord)
+                        + (m_BranchTree.nCount * sizeof(RECORD_BRANCH)), &nCrc) && (nCrc == m_BranchTree.nCrc);
+}
+
+/*******************************************************************************
+*       @details
+*       Starts the tree over with an empty hole from nFirstRecord.
+*******************************************************************************/
+static void BranchTreeReset(U_INT32 nFirstRecord)
+{
+    memset((void*)&m_BranchTree, 0, sizeof(m_BranchTree));
+    m_BranchTree.nHoleFirstRecord = nFirstRecord;
+    m_BranchTree.nCount = 1;
+    m_BranchTree.branch[0].nFirstRecord = nFirstRecord;
+    m_BranchTree.branch[0].nEndRecord = nFirstRecord;
+    m_BranchTree.branch[0].nParent = RECORD_NO_BRANCH;
+    BranchTreeSeal();
+}
+
+/*******************************************************************************
+*       @details
+*       Branch whose own surveys include nRecord, RECORD_NO_BRANCH if none.
+*******************************************************************************/
+static U_INT16 BranchTreeFind(U_INT32 nRecord)
+{
+    U_INT16 nBranch;
+
+    for (nBranch = m_BranchTree.nCount; nBranch > 0; nBranch--)
+    {
+        if ((nRecord >= m_BranchTree.branch[nBranch - 1].nFirstRecord)
+            && (nRecord < m_BranchTree.branch[nBranch - 1].nEndRecord))
+        {
+            return nBranch - 1;
+        }
+    }
+    return RECORD_NO_BRANCH;
+}
+
+/*******************************************************************************
+*       @details
+*       Moves the end of a branch and counts its surveys again.  Surveys of
+*       the parent past the tie-in are not on the way down to it.
+*******************************************************************************/
+static void BranchTreeSetEnd(RECORD_BRANCH* pBranch, U_INT32 nEndRecord)
+{
+    const RECORD_BRANCH* pParent;
+
+    pBranch->nEndRecord = (nEndRecord > pBranch->nFirstRecord) ? nEndRecord : pBranch->nFirstRecord;
+    pBranch->nSurveys = pBranch->nEndRecord - pBranch->nFirstRecord;
+    if (pBranch->nParent != RECORD_NO_BRANCH)
+    {
+        pParent = &m_BranchTree.branch[pBranch->nParent];
+        pBranch->nSurveys += pParent->nSurveys - (pParent->nEndRecord - 1 - pBranch->nTieInRecord);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Adds the survey stored at nRecord, the record after the last one in
+*       the tree.  The first survey past a branch point starts a branch off
+*       the one that holds its branch point.  The totals are taken from the
+*       survey, the way StatsRebuild() takes them.
+*******************************************************************************/
+static void BranchTreeAppend(U_INT32 nRecord, const STRUCT_RECORD_DATA* survey)
+{
+    RECORD_BRANCH* pTip = &m_BranchTree.branch[m_BranchTree.nCount - 1];
+    U_INT32 nTieIn = (U_INT16)survey->PreviousBranchRecordNum;
+    U_INT16 nParent = RECORD_NO_BRANCH;
+
+    if (survey->branchWasSet && (nRecord != pTip->nFirstRecord)
+        && (nTieIn >= m_BranchTree.nHoleFirstRecord) && (nTieIn < nRecord))
+    {
+        nParent = BranchTreeFind(nTieIn);
+    }
+    if (nParent != RECORD_NO_BRANCH)
+    {
+        if (m_BranchTree.nCount >= RECORD_MAX_BRANCHES)
+        {
+            m_BranchTree.bOverflow = true;
+            m_RecordBranchTreeStats.nOverflows++;
+            return;
+        }
+        pTip = &m_BranchTree.branch[m_BranchTree.nCount++];
+        pTip->nFirstRecord = nRecord;
+        pTip->nTieInRecord = nTieIn;
+        pTip->nParent = nParent;
+        pTip->nLevel = m_BranchTree.branch[nParent].nLevel + 1;
+    }
+    BranchTreeSetEnd(pTip, nRecord + 1);
+    pTip->TotalLength = survey->nTotalLength;
+    pTip->TotalDepth = survey->Z * 10;
+    pTip->TotalNorthings = survey->Y;
+    pTip->TotalEastings = survey->X;
+}
+
+/*******************************************************************************
+*       @details
+*       The first record of the hole, from the newest survey, whose number
+*       counts the records of the hole.
+*******************************************************************************/
+static U_INT32 BranchTreeHoleFirst(void)
+{
+    STRUCT_RECORD_DATA survey;
+
+    if ((boreholeStats.MostRecentSurvey.nRecordNumber == 0) || (boreholeStats.RecordCount <= 1))
+    {
+        return boreholeStats.RecordCount;
+    }
+    if (RECORD_GetRecord(&survey, boreholeStats.RecordCount - 1)
+        && (survey.nRecordNumber != 0) && (survey.nRecordNumber < boreholeStats.RecordCount))
+    {
+        return boreholeStats.RecordCount - survey.nRecordNumber;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Works the tree out from the record pages, one pass over the hole.
+*******************************************************************************/
+static void BranchTreeRebuild(void)
+{
+    STRUCT_RECORD_DATA survey;
+    U_INT32 nRecord;
+
+    m_RecordBranchTreeStats.nRebuilds++;
+    BranchTreeReset(BranchTreeHoleFirst());
+    for (nRecord = m_BranchTree.nHoleFirstRecord;
+         (nRecord < boreholeStats.RecordCount) && !m_BranchTree.bOverflow; nRecord++)
+    {
+        if (RECORD_GetRecord(&survey, nRecord))
+        {
+            BranchTreeAppend(nRecord, &survey);
+        }
+    }
+    BranchTreeSeal();
+}
+
+/*******************************************************************************
+*       @details
+*       Makes sure the tree is for the records there are.  Returns false for
+*       a hole with more branches than fit, callers then read the records.
+*******************************************************************************/
+static BOOL BranchTreeEnsure(void)
+{
+    if (!BranchTreeIsValid()
+        || (!m_BranchTree.bOverflow
+            && (m_BranchTree.branch[m_BranchTree.nCount - 1].nEndRecord != boreholeStats.RecordCount)))
+    {
+        BranchTreeRebuild();
+    }
+    return !m_BranchTree.bOverflow;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   BranchTreeCommit()
+;
+; Description:
+;   Called from StatsCommit() so the tree follows the statistics.  A survey
+;   added since the last commit is appended, a removed one is dropped along
+;   with any branch it was the only survey of.  The branch being drilled
+;   then takes the totals of boreholeStats, or those of its branch point
+;   while it waits for its first survey.  A commit that moves the record
+;   count by more than one leaves the tree to be rebuilt on next use.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void BranchTreeCommit(void)
+{
+    RECORD_BRANCH* pTip;
+    U_INT16 nCount = m_BranchTree.nCount;
+
+    if (!BranchTreeIsValid() || m_BranchTree.bOverflow)
+    {
+        return;
+    }
+    pTip = &m_BranchTree.branch[nCount - 1];
+    if (boreholeStats.RecordCount == pTip->nEndRecord + 1)
+    {
+        BranchTreeAppend(pTip->nEndRecord, &boreholeStats.MostRecentSurvey);
+    }
+    else if (boreholeStats.RecordCount < pTip->nEndRecord)
+    {
+        while ((m_BranchTree.nCount > 1)
+               && (m_BranchTree.branch[m_BranchTree.nCount - 1].nFirstRecord >= boreholeStats.RecordCount))
+        {
+            m_BranchTree.nCount--;
+        }
+        BranchTreeSetEnd(&m_BranchTree.branch[m_BranchTree.nCount - 1], boreholeStats.RecordCount);
+    }
+    else
+    {
+        if (boreholeStats.RecordCount != pTip->nEndRecord)
+        {
+            m_BranchTree.nCount = 0;
+        }
+        return;
+    }
+
+    pTip = &m_BranchTree.branch[m_BranchTree.nCount - 1];
+    if (!BranchSet && !m_BranchTree.bOverflow && (m_BranchTree.nCount >= nCount)
+        && (pTip->nEndRecord > pTip->nFirstRecord))
+    {
+        pTip->TotalLength = boreholeStats.TotalLength;
+        pTip->TotalDepth = boreholeStats.TotalDepth;
+        pTip->TotalNorthings = boreholeStats.TotalNorthings;
+        pTip->TotalEastings = boreholeStats.TotalEastings;
+    }
+    BranchTreeSeal();
+}
+
+/*******************************************************************************
+*       @details
+*       The branch being drilled, the last one added.
+*******************************************************************************/
+static U_INT16 BranchTreeActive(void)
+{
+    return BranchTreeEnsure() ? (m_BranchTree.nCount - 1) : RECORD_NO_BRANCH;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL RECORD_GetBranch(RECORD_BRANCH* pBranch, U_INT16 nBranch)
+{
+    if (!BranchTreeEnsure() || (nBranch >= m_BranchTree.nCount))
+    {
+        return false;
+    }
+    memcpy(pBranch, &m_BranchTree.branch[nBranch], sizeof(RECORD_BRANCH));
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT16 RECORD_FindBranch(U_INT32 nRecord)
+{
+    return BranchTreeEnsure() ? BranchTreeFind(nRecord) : RECORD_NO_BRANCH;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_GetPreviousRecord()
+;
+; Description:
+;   Finds the survey nRecord was measured from, the record before it or,
+;   for the first survey of a branch, the branch point.  Only the tree is
+;   looked at, no record is read.
+;
+; Parameters:
+;   U_INT32 nRecord => absolute record index
+;
+; Returns:
+;   U_INT32 => absolute record index, 0 for the first survey of the hole or
+;              a record that is not in the tree
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT32 RECORD_GetPreviousRecord(U_INT32 nRecord)
+{
+    U_INT16 nBranch = RECORD_FindBranch(nRecord);
+
+    if (nBranch == RECORD_NO_BRANCH)
+    {
+        return 0;
+    }
+    if (nRecord == m_BranchTree.branch[nBranch].nFirstRecord)
+    {
+        return m_BranchTree.branch[nBranch].nTieInRecord;
+    }
+    return nRecord - 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Sets the walk up for the records it takes from the branch at its
+*       level, down to the branch point of the next branch of the path.
+*******************************************************************************/
+static void BranchWalkSpan(RECORD_BRANCH_WALK* pWalk)
+{
+    const RECORD_BRANCH* pBranch = &m_BranchTree.branch[pWalk->nPath[pWalk->nLevel]];
+
+    pWalk->nNext = pBranch->nFirstRecord;
+    pWalk->nSpanEnd = pBranch->nEndRecord;
+    if (pWalk->nLevel + 1 < pWalk->nLevels)
+    {
+        pWalk->nSpanEnd = m_BranchTree.branch[pWalk->nPath[pWalk->nLevel + 1]].nTieInRecord + 1;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_BranchWalkStart()
+;
+; Description:
+;   Gets ready to walk the surveys of a branch, from the first survey of
+;   the hole down through each branch point to the end of the branch.
+;   Surveys of other branches are skipped without being read, so a walk
+;   takes as long as the branch is, not the hole.  The walk is only good
+;   until the next survey is added or removed.
+;
+; Parameters:
+;   RECORD_BRANCH_WALK* pWalk => walk to set up
+;   U_INT16 nBranch           => branch to walk
+;
+; Returns:
+;   BOOL => false if there is no such branch
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL RECORD_BranchWalkStart(RECORD_BRANCH_WALK* pWalk, U_INT16 nBranch)
+{
+    U_INT16 nLevel;
+
+    if (!BranchTreeEnsure() || (nBranch >= m_BranchTree.nCount))
+    {
+        return false;
+    }
+    nLevel = m_BranchTree.branch[nBranch].nLevel;
+    pWalk->nLevels = nLevel + 1;
+    while (true)
+    {
+        pWalk->nPath[nLevel] = nBranch;
+        if (nLevel == 0)
+        {
+            break;
+        }
+        nBranch = m_BranchTree.branch[nBranch].nParent;
+        nLevel--;
+    }
+    pWalk->nLevel = 0;
+    BranchWalkSpan(pWalk);
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       Hands out the next survey of the walk, false when it is over.
+*******************************************************************************/
+BOOL RECORD_BranchWalkNext(RECORD_BRANCH_WALK* pWalk, U_INT32* pnRecord)
+{
+    while (pWalk->nNext >= pWalk->nSpanEnd)
+    {
+        if (pWalk->nLevel + 1 >= pWalk->nLevels)
+        {
+            return false;
+        }
+        pWalk->nLevel++;
+        BranchWalkSpan(pWalk);
+    }
+    *pnRecord = pWalk->nNext++;
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void DepthIndexRebuild(void)
+{
+    STRUCT_RECORD_DATA survey;
+    RECORD_BRANCH_WALK walk;
+    U_INT32 nRecord;
+
+    DepthIndexReset();
+    if (RECORD_BranchWalkStart(&walk, BranchTreeActive()))
+    {
+        // surveys off the branch being drilled were all made invalid
+        while (RECORD_BranchWalkNext(&walk, &nRecord))
+        {
+            if (RECORD_GetRecord(&survey, nRecord) && !survey.InvalidDataFlag)
+            {
+                DepthIndexPut(nRecord, survey.nTotalLength);
+            }
+        }
+        return;
+    }
+    for (nRecord = BranchTreeHoleFirst(); nRecord < boreholeStats.RecordCount; nRecord++)
+    {
+        if (RECORD_GetRecord(&survey, nRecord) && !survey.InvalidDataFlag)
+        {
+            DepthIndexPut(nRecord, survey.nTotalLength);
+        }
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_FindRecordByDepth()
+;
+; Description:
+;   Finds the deepest valid record of the current hole whose measured depth
+;   (nTotalLength) is at or above nTotalLength, by binary search of the
+;   depth index.  Records past a branch point are not in the index.
+;
+; Parameters:
+;   U_INT32 nTotalLength => measured depth to look for
+;
+; Returns:
+;   U_INT32 => absolute record index for RECORD_GetRecord(), 0 if every
+;              record of the hole is deeper (record 0 is never used)
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT32 RECORD_FindRecordByDepth(U_INT32 nTotalLength)
+{
+    STRUCT_RECORD_DATA survey;
+    RECORD_BRANCH_WALK walk;
+    U_INT32 nRecord, nFound = 0, nFoundLength = 0;
+    U_INT32 nLow, nHigh, nMid;
+    BOOL bWalk;
+
+    if (!m_bDepthIndexValid)
+    {
+        DepthIndexRebuild();
+    }
+    if (m_bDepthIndexOverflow)
+    {
+        // along the branch being drilled, or the whole hole if the tree is full
+        bWalk = RECORD_BranchWalkStart(&walk, BranchTreeActive());
+        nRecord = BranchTreeHoleFirst() - 1;
+        while (bWalk ? RECORD_BranchWalkNext(&walk, &nRecord) : (++nRecord < boreholeStats.RecordCount))
+        {
+            if (RECORD_GetRecord(&survey, nRecord) && !survey.InvalidDataFlag
+                && (survey.nTotalLength <= nTotalLength) && (survey.nTotalLength >= nFoundLength))
+            {
+                nFound = nRecord;
+                nFoundLength = survey.nTotalLength;
+            }
+        }
+        return nFound;
+    }
+    // first entry deeper than nTotalLength, the one before it is the answer
+    nLow = 0;
+    nHigh = m_nDepthIndexCount;
+    while (nLow < nHigh)
+    {
+        nMid = (nLow + nHigh) / 2;
+        if (m_DepthIndex[nMid].nTotalLength <= nTotalLength)
+        {
+            nLow = nMid + 1;
+        }
+        else
+        {
+            nHigh = nMid;
+        }
+    }
+    return (nLow == 0) ? 0 : m_DepthIndex[nLow - 1].nRecord;
+}
+
+/*******************************************************************************
+*       @details
+*       Opens the intent before boreholeStats is changed.  An intent that is
+*       already open covers this change as well, a survey is taken and then
+*       merged as one change.  A recompute is first kept out of the way of
+*       the pages the change may write.
+*******************************************************************************/
+static void StatsBegin(STATS_OPERATION eOperation)
+{
+    RecomputeBeforeChange(eOperation);
+    if (m_StatsIntent.nOpen == STATS_INTENT_OPEN)
+    {
+        return;
+    }
+    m_StatsIntent.nSequence = m_nStatsSequence + 1;
+    m_StatsIntent.nRecordCount = boreholeStats.RecordCount;
+    m_StatsIntent.nOperation = eOperation;
+    m_StatsIntent.nOpen = STATS_INTENT_OPEN;
+}
+
+/*******************************************************************************
+*       @details
+*       Copies boreholeStats into the older slot, then closes the intent.
+*       The branch tree is brought up to date first.  The swap state of a
+*       recompute goes in the same slot.
+*******************************************************************************/
+static void StatsCommit(void)
+{
+    BOREHOLE_STATS_SLOT* pSlot = &m_StatsSlot[(m_nStatsSequence + 1) & 1];
+
+    BranchTreeCommit();
+    pSlot->nSequence = m_nStatsSequence + 1;
+    memcpy(&pSlot->stats, &boreholeStats, sizeof(BOREHOLE_STATISTICS));
+    memcpy(&pSlot->swap, &m_Swap, sizeof(RECOMPUTE_SWAP));
+    (void)CalculateCRC((U_BYTE*)pSlot, offsetof(BOREHOLE_STATS_SLOT, nCrc), &pSlot->nCrc);
+    m_nStatsSequence++;
+    m_StatsIntent.nOpen = 0;
+    m_BoreholeStatsRecovery.nCommits++;
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
-static void PageRead(U_INT32 pageNumber)
+static BOOL StatsSlotIsValid(const BOREHOLE_STATS_SLOT* pSlot)
 {
-    FLASH_ReadPage(&page, pageNumber + RECORD_AREA_BASE_ADDRESS);
-    memcpy(m_ReadPage.records, &page, sizeof(m_WritePage.records));
-    m_ReadPage.number = pageNumber;
+    U_INT32 nCrc;
+
+    return CalculateCRC((U_BYTE*)pSlot, offsetof(BOREHOLE_STATS_SLOT, nCrc), &nCrc) && (nCrc == pSlot->nCrc);
 }
 
 /*******************************************************************************
 *       @details
+*       Number of record pages before the survey journal.
 *******************************************************************************/
-static void RecordInit(STRUCT_RECORD_DATA* record)
+static U_INT32 RecordPageCapacity(void)
 {
-    memset(record, 0, sizeof(STRUCT_RECORD_DATA));
+    if (!Serial_Flash_Chip.ext_flash_working)
+    {
+        return 0;
+    }
+    return Serial_Flash_Chip.Record_journal_start_page - RECORD_AREA_BASE_ADDRESS;
 }
 
 /*******************************************************************************
 *       @details
+*       Neither slot is any good, so the statistics are taken from the
+*       newest survey of the hole that is still in use, the way a branch
+*       point restores them.  The record count is only trusted when it
+*       fits the record area, otherwise the file starts out empty.
 *******************************************************************************/
-static void RecordWrite(STRUCT_RECORD_DATA* record, U_INT32 nRecord)
+static void StatsRebuild(void)
 {
-    memcpy(&m_WritePage.records[PageOffset(nRecord)], record, sizeof(STRUCT_RECORD_DATA));
+    U_INT32 nRecordCount = boreholeStats.RecordCount;
+    U_INT32 nCapacity = RecordPageCapacity() * RECORDS_PER_PAGE;
+    U_INT32 nRecord;
+    STRUCT_RECORD_DATA survey;
+
+    memset((void*)&boreholeStats, 0, sizeof(boreholeStats));
+    if ((nRecordCount == 0) || (nRecordCount > nCapacity))
+    {
+        boreholeStats.RecordCount = 1;
+        return;
+    }
+    boreholeStats.RecordCount = nRecordCount;
+
+    for (nRecord = nRecordCount - 1; nRecord > newHole_tracker1.EndingRecordNumber; nRecord--)
+    {
+        RECORD_GetRecord(&survey, nRecord);
+        if (!survey.InvalidDataFlag)
+        {
+            memcpy(&boreholeStats.MostRecentSurvey, &survey, sizeof(STRUCT_RECORD_DATA));
+            RECORD_GetRecord(&boreholeStats.PreviousSurvey, survey.PreviousRecordIndex);
+            boreholeStats.TotalEastings = survey.X;
+            boreholeStats.TotalNorthings = survey.Y;
+            boreholeStats.TotalDepth = survey.Z * 10;
+            boreholeStats.TotalLength = survey.nTotalLength;
+            return;
+        }
+    }
 }
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
-static BOOL RecordRead(STRUCT_RECORD_DATA* record, U_INT32 nRecord)
-{
-    if (nRecord < boreholeStats.RecordCount)
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_RecoverBoreholeStats()
+;
+; Description:
+;   Called once at power up, after RECORD_JournalRecover().  boreholeStats
+;   may have been caught half way through a change, so it is replaced by
+;   the newest slot that passes its CRC.  An open intent newer than that
+;   slot means the change it started was lost and is counted as a roll
+;   back.  Only when neither slot is good are the statistics rebuilt from
+;   the record pages.  A recompute swapped in by the slot is copied back
+;   again from its shadow pages, which are left alone until it is done, and
+;   its tail page is put in m_WritePage if that was not done yet.  An
+;   unfinished recompute is started over, and the branch tree, which is not
+;   kept over a power down, is worked out again.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_RecoverBoreholeStats(void)
+{
+    BOREHOLE_STATS_SLOT* pNewest = NULL;
+    U_BYTE nSlot;
+
+    for (nSlot = 0; nSlot < 2; nSlot++)
     {
-        memcpy(record, &m_ReadPage.records[PageOffset(nRecord)], sizeof(STRUCT_RECORD_DATA));
-        return true;
+        if (!StatsSlotIsValid(&m_StatsSlot[nSlot]))
+        {
+            m_BoreholeStatsRecovery.nBadSlots++;
+        }
+        else if ((pNewest == NULL) || (m_StatsSlot[nSlot].nSequence > pNewest->nSequence))
+        {
+            pNewest = &m_StatsSlot[nSlot];
+        }
     }
-    return false;
+
+    if ((m_StatsIntent.nOpen == STATS_INTENT_OPEN) &&
+        ((pNewest == NULL) || (pNewest->nSequence < m_StatsIntent.nSequence)))
+    {
+        m_BoreholeStatsRecovery.nRollbacks++;
+        m_BoreholeStatsRecovery.nLastRollback = m_StatsIntent.nOperation;
+    }
+    m_StatsIntent.nOpen = 0;
+
+    if (pNewest != NULL)
+    {
+        memcpy((void*)&boreholeStats, &pNewest->stats, sizeof(BOREHOLE_STATISTICS));
+        memcpy(&m_Swap, &pNewest->swap, sizeof(RECOMPUTE_SWAP));
+        m_nStatsSequence = pNewest->nSequence;
+    }
+    else
+    {
+        m_BoreholeStatsRecovery.nRebuilds++;
+        StatsRebuild();
+        StatsCommit();
+    }
+
+    if (m_Swap.nActive == RECOMPUTE_SWAP_ACTIVE)
+    {
+        // pages copied back may still have been queued
+        m_Swap.nCopyPage = m_Swap.nFirstPage;
+        if (!m_Swap.bTailCopied)
+        {
+            RecomputeCopyTail();
+        }
+    }
+    // shadow pages the recompute had queued may not have reached the flash
+    if (m_Recompute.nOpen == RECOMPUTE_JOB_OPEN)
+    {
+        RecomputeStart();
+        m_RecordRecomputeStats.nRestarts++;
+    }
+    BranchTreeRebuild();
 }
 
 /*******************************************************************************
@@ -334,8 +1876,9 @@ U_INT32 getLastRecordNumber(void)
 *******************************************************************************/
 void RECORD_OpenLoggingFile(void)
 {
+    StatsBegin(STATS_OP_OPEN_FILE);
     PageInit(&m_WritePage);
-    PageInit(&m_ReadPage);
+    PageCacheInvalidate(NULL_PAGE);
     NewHole_Info_PageInit(&m_New_hole_info_WritePage);
     NewHole_Info_PageInit(&m_New_hole_info_ReadPage);
 
@@ -346,15 +1889,28 @@ void RECORD_OpenLoggingFile(void)
     memset((void*)&selectedSurveyRecord, 0, sizeof(selectedSurveyRecord));
     RecordData_StoreSelectSurveyIndex(0);
 
+    DepthIndexReset();
+    BranchTreeReset(boreholeStats.RecordCount);
+    TRAJECTORY_Truncate(0);
+    m_Recompute.nOpen = 0;
+    m_Swap.nActive = 0;
+    // surveys of the old file still in the journal must not come back
+    m_nJournalPendingPage = NULL_PAGE;
+    if (m_bJournalDirty)
+    {
+        m_bJournalCheckpointDue = true;
+        JournalCheckpoint();
+    }
     bRefreshSurveys = true; //ZD 9/14/2023 Fix for Refreshing the Page After a Branch Point is Created as it Didn't Display Any Data unless taking another shot
     BranchSet = false;
+    StatsCommit();
 }
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 void RECORD_CloseMergeFile(void)
 {
-    m_ReadPage.number = NULL_PAGE;
+    PageCacheInvalidate(NULL_PAGE);
 }
 
 /*******************************************************************************
@@ -363,7 +1919,8 @@ void RECORD_CloseMergeFile(void)
 void RECORD_CloseLoggingFile(void)
 {
     PageWritePartial(boreholeStats.RecordCount);
-    PageInit(&m_ReadPage);
+    JournalCompact();
+    PageCacheInvalidate(NULL_PAGE);
 }
 
 /*******************************************************************************
@@ -373,6 +1930,8 @@ void RECORD_TakeSurveyMWD(void)
 {
     U_INT32 nRecordNumberTemp;
 
+    // committed by RECORD_MergeRecordMWD() once the survey is stored
+    StatsBegin(STATS_OP_SURVEY);
     nRecordNumberTemp = GetRecordCount() - newHole_tracker1.EndingRecordNumber - 1;
     memcpy(&boreholeStats.PreviousSurvey, &boreholeStats.MostRecentSurvey, sizeof(STRUCT_RECORD_DATA));
 
@@ -480,8 +2039,10 @@ BOOL RECORD_RequestNextMergeRecord(void)
 *******************************************************************************/
 BOOL RECORD_BeginMergeRecords(void)
 {
+    StatsBegin(STATS_OP_MERGE);
     boreholeStats.recordRetrieved = false;
     boreholeStats.MergeIndex = 0;
+    StatsCommit();
     PageRead(0);
     return RECORD_RequestNextMergeRecord();
 }
@@ -491,22 +2052,78 @@ BOOL RECORD_BeginMergeRecords(void)
 *******************************************************************************/
 static void DetermineUpDownLeftRight(STRUCT_RECORD_DATA* record, STRUCT_RECORD_DATA* before, EASTING_NORTHING_DATA_STRUCT* result)
 {
-    POSITION_DATA_STRUCT start, end;
+    MIN_CURVE_STATION start, end;
     start.nPipeLength = before->nTotalLength;
-    start.nAzimuth.fDeg = before->nAzimuth / 10.0;
-    start.nInclination.fDeg = (before->nPitch / 10.0);
+    start.nAzimuth = before->nAzimuth;
+    start.nInclination = before->nPitch;
     end.nPipeLength = record->nTotalLength;
-    end.nAzimuth.fDeg = record->nAzimuth / 10.0;
-    end.nInclination.fDeg = (record->nPitch / 10.0);
-    Calc_AveAngleMinCurve(result, &start, &end);
+    end.nAzimuth = record->nAzimuth;
+    end.nInclination = record->nPitch;
+    PROFILE_Start(PROFILE_MIN_CURVE);
+    Calc_MinCurveTenths(result, &start, &end, GetDesiredAzimuth());
+    PROFILE_Stop(PROFILE_MIN_CURVE);
 }
 
 /*******************************************************************************
 *       @details
+*       Sets the X, Y and Z of a survey from the running totals, rounded the
+*       way they have always been stored.
 *******************************************************************************/
-static void MergeRecordCommon(STRUCT_RECORD_DATA* record)
+static void PositionFromTotals(STRUCT_RECORD_DATA* survey, INT32 nTotalDepth, REAL32 fTotalNorthings, REAL32 fTotalEastings)
 {
     INT32 b, n, c, e, l;
+
+    b = (nTotalDepth + 5) / 10;
+    b = b * 10;
+    //n = fTotalNorthings*10;
+    n = (int)roundf(fTotalNorthings * 10.0f);
+    //c = llabs(n%10);
+    c = llabs(n % 10);
+    //n = n/10;
+    if (c >= 5)
+    {
+        if (n >= 0)
+        {
+            l = 10 - c;
+            n = n + l;
+        }
+        else
+        {
+            l = 10 - c;
+            n = n - l;
+        }
+    }
+    //n = (float)n/10;
+    n = (INT32)roundf((float)n / 10.0f);
+    //e = fTotalEastings*10;
+    e = (INT32)roundf(fTotalEastings * 10.0f);
+    //c = llabs(e%10);
+    c = llabs(e % 10);
+    if (c >= 5)
+    {
+        if (e >= 0)
+        {
+            l = 10 - c;
+            e = e + l;
+        }
+        else
+        {
+            l = 10 - c;
+            e = e - l;
+        }
+    }
+    //e = (float)e/10;
+    e = (INT32)roundf((float)e / 10.0f);
+    survey->X = e; //fTotalEastings;
+    survey->Y = n; //fTotalNorthings;
+    survey->Z = b / 10; //nTotalDepth/10;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void MergeRecordCommon(STRUCT_RECORD_DATA* record)
+{
     float m;
 
     boreholeStats.recordRetrieved = true;
@@ -527,50 +2144,8 @@ static void MergeRecordCommon(STRUCT_RECORD_DATA* record)
             boreholeStats.TotalDepth += m; //result.fDepth;
             boreholeStats.TotalNorthings += result.fNorthing;
             boreholeStats.TotalEastings += result.fEasting;
-            b = (boreholeStats.TotalDepth + 5) / 10;
-            b = b * 10;
-            //n = boreholeStats.TotalNorthings*10;
-            n = (int)roundf(boreholeStats.TotalNorthings * 10.0f);
-            //c = llabs(n%10);
-            c = llabs(n % 10);
-            //n = n/10;
-            if (c >= 5)
-            {
-                if (n >= 0)
-                {
-                    l = 10 - c;
-                    n = n + l;
-                }
-                else
-                {
-                    l = 10 - c;
-                    n = n - l;
-                }
-            }
-            //n = (float)n/10;
-            n = (INT32)roundf((float)n / 10.0f);
-            //e = boreholeStats.TotalEastings*10;
-            e = (INT32)roundf(boreholeStats.TotalEastings * 10.0f);
-            //c = llabs(e%10);
-            c = llabs(e % 10);
-            if (c >= 5)
-            {
-                if (e >= 0)
-                {
-                    l = 10 - c;
-                    e = e + l;
-                }
-                else
-                {
-                    l = 10 - c;
-                    e = e - l;
-                }
-            }
-            //e = (float)e/10;
-            e = (INT32)roundf((float)e / 10.0f);
-            boreholeStats.MostRecentSurvey.X = e; //boreholeStats.TotalEastings;
-            boreholeStats.MostRecentSurvey.Y = n; //boreholeStats.TotalNorthings;
-            boreholeStats.MostRecentSurvey.Z = b / 10; //boreholeStats.TotalDepth/10;
+            PositionFromTotals(&boreholeStats.MostRecentSurvey, boreholeStats.TotalDepth,
+                               boreholeStats.TotalNorthings, boreholeStats.TotalEastings);
             lastResult.fDepth = result.fDepth;
             if (lastResult.fDepth < 0)
             {
@@ -587,6 +2162,7 @@ static void MergeRecordCommon(STRUCT_RECORD_DATA* record)
         boreholeStats.MostRecentSurvey.Z = 0;
     }
     RecordWrite(&boreholeStats.MostRecentSurvey, boreholeStats.RecordCount);
+    DepthIndexPut(boreholeStats.RecordCount, boreholeStats.MostRecentSurvey.nTotalLength);
 }
 
 /*******************************************************************************
@@ -594,8 +2170,10 @@ static void MergeRecordCommon(STRUCT_RECORD_DATA* record)
 *******************************************************************************/
 void RECORD_MergeRecord(STRUCT_RECORD_DATA* record)
 {
+    StatsBegin(STATS_OP_MERGE);
     MergeRecordCommon(record);
     boreholeStats.MergeIndex++;
+    StatsCommit();
 }
 
 /*******************************************************************************
@@ -603,11 +2181,13 @@ void RECORD_MergeRecord(STRUCT_RECORD_DATA* record)
 *******************************************************************************/
 void RECORD_MergeRecordMWD(STRUCT_RECORD_DATA* record)
 {
+    StatsBegin(STATS_OP_SURVEY);
     MergeRecordCommon(record);
 //	The next statement is rearragned since the write pointer was different from read pointer
-    PageWrite(PageNumber(boreholeStats.RecordCount));
+    PageCommit(boreholeStats.RecordCount);
     boreholeStats.RecordCount++;
     ++nNewHoleRecordCount;
+    StatsCommit();
 }
 
 /*******************************************************************************
@@ -615,6 +2195,7 @@ void RECORD_MergeRecordMWD(STRUCT_RECORD_DATA* record)
 *******************************************************************************/
 void RECORD_NextMergeRecord(EASTING_NORTHING_DATA_STRUCT* result)
 {
+    StatsBegin(STATS_OP_MERGE);
     boreholeStats.recordRetrieved = false;
     RECORD_MergeRecord(&boreholeStats.MostRecentSurvey);
 }
@@ -624,11 +2205,7 @@ void RECORD_NextMergeRecord(EASTING_NORTHING_DATA_STRUCT* result)
 *******************************************************************************/
 BOOL RECORD_GetRecord(STRUCT_RECORD_DATA* record, U_INT32 recordNumber)
 {
-    U_INT32 pageNumber = PageNumber(recordNumber);
-//	if (m_ReadPage.number != pageNumber) // This work only if the whole page has valid data
-//	{
-    PageRead(pageNumber);
-//	}
+    PageRead(PageNumber(recordNumber));
     return RecordRead(record, recordNumber);
 }
 
@@ -720,7 +2297,17 @@ void RECORD_removeLastRecord(void)
 {
     STRUCT_RECORD_DATA survey;
     EASTING_NORTHING_DATA_STRUCT result;
+    U_INT32 nMostRecent = 0, nPrevious = 0;
+    BOOL bTree = false;
 
+    StatsBegin(STATS_OP_REMOVE);
+    // the surveys the last one was measured from, found along its branch
+    if (!BranchSet && (RECORD_FindBranch(boreholeStats.RecordCount - 1) != RECORD_NO_BRANCH))
+    {
+        nMostRecent = RECORD_GetPreviousRecord(boreholeStats.RecordCount - 1);
+        nPrevious = RECORD_GetPreviousRecord(nMostRecent);
+        bTree = true;
+    }
     if (boreholeStats.MostRecentSurvey.branchWasSet)
     {
         BranchSet = true;
@@ -734,10 +2321,10 @@ void RECORD_removeLastRecord(void)
     GammaTemp = boreholeStats.PreviousSurvey.GammaShotNumCorrected;//
 
     RecordInit(&survey);
-    memcpy(&m_WritePage.records[PageOffset(boreholeStats.RecordCount--)], &survey, sizeof(STRUCT_RECORD_DATA));
-    RECORD_GetRecord(&survey, boreholeStats.MostRecentSurvey.PreviousRecordIndex);
+    memcpy(&m_WritePage.records[PageOffset(--boreholeStats.RecordCount)], &survey, sizeof(STRUCT_RECORD_DATA));
+    RECORD_GetRecord(&survey, bTree ? nMostRecent : boreholeStats.MostRecentSurvey.PreviousRecordIndex);
     memcpy(&boreholeStats.MostRecentSurvey, &survey, sizeof(STRUCT_RECORD_DATA));
-    RECORD_GetRecord(&survey, boreholeStats.MostRecentSurvey.PreviousRecordIndex);
+    RECORD_GetRecord(&survey, bTree ? nPrevious : boreholeStats.MostRecentSurvey.PreviousRecordIndex);
     memcpy(&boreholeStats.PreviousSurvey, &survey, sizeof(STRUCT_RECORD_DATA));
 
 
@@ -761,7 +2348,11 @@ void RECORD_removeLastRecord(void)
     memset((void*)&selectedSurveyRecord, 0, sizeof(selectedSurveyRecord));
     RecordData_StoreSelectSurveyIndex(0);
 
+    DepthIndexTruncate(boreholeStats.RecordCount);
+    TRAJECTORY_Truncate(boreholeStats.RecordCount);
+    PageCacheInvalidate(NULL_PAGE);
     RECORD_SetRefreshSurveys(true);
+    StatsCommit();
 }
 
 
@@ -773,6 +2364,7 @@ void RECORD_InitNewHole(void)
     if (!InitNewHole_KeyPress())
     {
         U_INT32 nRecordCountTemp = boreholeStats.RecordCount;
+        StatsBegin(STATS_OP_NEW_HOLE);
         Get_Save_NewHole_Info();
         memset((void*)&boreholeStats, 0, sizeof(boreholeStats));
         boreholeStats.RecordCount = nRecordCountTemp;
@@ -780,6 +2372,11 @@ void RECORD_InitNewHole(void)
         memset((void*)&selectedSurveyRecord, 0, sizeof(selectedSurveyRecord));
         RecordData_StoreSelectSurveyIndex(0);
         BranchSet = false;
+        DepthIndexReset();
+        BranchTreeReset(boreholeStats.RecordCount);
+        TRAJECTORY_Truncate(0);
+        m_Recompute.nOpen = 0;
+        StatsCommit();
     }
 }
 
@@ -821,7 +2418,10 @@ void Get_Save_NewHole_Info(void)
             NewHole_Info_PageInit(&m_New_hole_info_WritePage);
         memcpy(&m_New_hole_info_WritePage.NewHole_record[newHole_tracker.BoreholeNumber % NEW_HOLE_RECORDS_PER_PAGE], &newHole_tracker, sizeof(NEWHOLE_INFO));
         memcpy(&New_Hole_page, m_New_hole_info_WritePage.NewHole_record, sizeof(m_New_hole_info_WritePage.NewHole_record));
-        FLASH_WritePage(&New_Hole_page, (newHole_tracker.BoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE));
+        if (!FLASH_QueueWrite(&New_Hole_page, (newHole_tracker.BoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE), NULL))
+        {
+            FLASH_WritePage(&New_Hole_page, (newHole_tracker.BoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE));
+        }
         //NewHole_Info_Read(&selectedNewHoleInfo, newHole_tracker.BoreholeNumber);
     }
 }
@@ -849,7 +2449,10 @@ void Get_Hole_Info_To_PC(void)
             NewHole_Info_PageInit(&m_New_hole_info_WritePage);
         memcpy(&m_New_hole_info_WritePage.NewHole_record[TempBoreholeNumber % NEW_HOLE_RECORDS_PER_PAGE], &TempBoreholeInfo, sizeof(NEWHOLE_INFO));
         memcpy(&New_Hole_page, m_New_hole_info_WritePage.NewHole_record, sizeof(m_New_hole_info_WritePage.NewHole_record));
-        FLASH_WritePage(&New_Hole_page, (TempBoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE));
+        if (!FLASH_QueueWrite(&New_Hole_page, (TempBoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE), NULL))
+        {
+            FLASH_WritePage(&New_Hole_page, (TempBoreholeNumber / NEW_HOLE_RECORDS_PER_PAGE));
+        }
     }
 }
 
@@ -919,12 +2522,16 @@ void RECORD_InitBranchParam(void)
 {
     U_INT32 branchIndex;
 
+    // m_WritePage is used for the read-modify-writes below, so the page
+    // waiting on the journal has to reach flash first
+    JournalCompact();
+    StatsBegin(STATS_OP_BRANCH);
+
     // Calculate the index for the branch point
     branchIndex = RECORD_GetBranchPointIndex();
 
     // Save the current survey record
     STRUCT_RECORD_DATA branchSurvey;
-    STRUCT_RECORD_DATA tempSurvey;
     RECORD_GetRecord(&branchSurvey, branchIndex);
 
 
@@ -943,7 +2550,7 @@ void RECORD_InitBranchParam(void)
     branchSurvey.NextBranchRecordNum = boreholeStats.RecordCount;
 
     // Perform a read-modify-write of the flash page where the branch is set
-    memcpy(m_WritePage.records, m_ReadPage.records, sizeof(m_WritePage.records));
+    memcpy(m_WritePage.records, m_pReadPage->records, sizeof(m_WritePage.records));
     RecordWrite(&branchSurvey, branchIndex);
     PageWrite(PageNumber(branchIndex));
 
@@ -951,18 +2558,28 @@ void RECORD_InitBranchParam(void)
     branchSurvey.StatusCode += BranchStatusCode;
     BranchSet = true;
 
-    // set the invalid flags for all records after the branch point
-    for (int i = branchIndex + 1; i < boreholeStats.RecordCount; i++)
+    // set the invalid flags for all records after the branch point, one
+    // read-modify-write per flash page rather than per record
+    for (U_INT32 i = branchIndex + 1; i < boreholeStats.RecordCount; )
     {
-        RECORD_GetRecord(&tempSurvey, i);
-        tempSurvey.InvalidDataFlag = true;
-        RecordWrite(&tempSurvey, i);
-        PageWrite(PageNumber(i));
+        U_INT32 nPage = PageNumber(i);
+
+        PageRead(nPage);
+        memcpy(m_WritePage.records, m_pReadPage->records, sizeof(m_WritePage.records));
+        while ((i < boreholeStats.RecordCount) && (PageNumber(i) == nPage))
+        {
+            m_WritePage.records[PageOffset(i)].InvalidDataFlag = true;
+            i++;
+        }
+        PageWrite(nPage);
     }
+    DepthIndexTruncate(branchIndex + 1);
+    TRAJECTORY_Truncate(branchIndex + 1);
 
     // Restore the original content of the Write_Page because of partial filled pages
     PageRead(PageNumber(boreholeStats.RecordCount));
-    memcpy(m_WritePage.records, m_ReadPage.records, sizeof(m_WritePage.records));
+    memcpy(m_WritePage.records, m_pReadPage->records, sizeof(m_WritePage.records));
+    StatsCommit();
 }
 
 
@@ -1032,18 +2649,450 @@ void GetBoreholeStats(BOREHOLE_STATISTICS* stats)
 
 void SetBoreholeStats(BOREHOLE_STATISTICS* stats)
 {
+    // committed with the record by StoreUploadedRecord()
+    StatsBegin(STATS_OP_UPLOAD);
     boreholeStats.TotalDepth = stats->TotalDepth;
     boreholeStats.TotalLength = stats->TotalLength;
     boreholeStats.TotalEastings = stats->TotalEastings;
     boreholeStats.TotalNorthings = stats->TotalNorthings;
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const RECORD_PAGE_CACHE_STATS* RECORD_GetPageCacheStats(void)
+{
+    return &m_PageCacheStats;
+}
+
 void StoreUploadedRecord(STRUCT_RECORD_DATA* record)
 {
+    StatsBegin(STATS_OP_UPLOAD);
     memcpy(&boreholeStats.PreviousSurvey, &boreholeStats.MostRecentSurvey, sizeof(STRUCT_RECORD_DATA));
     memcpy(&boreholeStats.MostRecentSurvey, record, sizeof(STRUCT_RECORD_DATA));
     RecordWrite(record, boreholeStats.RecordCount);
-    PageWrite(PageNumber(boreholeStats.RecordCount));
+    PageCommit(boreholeStats.RecordCount);
+    if (!record->InvalidDataFlag)
+    {
+        DepthIndexPut(boreholeStats.RecordCount, record->nTotalLength);
+    }
     boreholeStats.RecordCount++;
     ++nNewHoleRecordCount;
+    StatsCommit();
+}
+
+/*******************************************************************************
+*       @details
+*       Starts the recompute over from the first survey of the hole.  The
+*       shadow pages start a few pages above the page being filled, so the
+*       hole can grow a little while the job runs.
+*******************************************************************************/
+static void RecomputeStart(void)
+{
+    m_Recompute.nOpen = 0;
+    m_Recompute.nDesiredAzimuth = GetDesiredAzimuth();
+    m_Recompute.nNextRecord = newHole_tracker1.EndingRecordNumber + 1;
+    m_Recompute.nFirstPage = PageNumber(m_Recompute.nNextRecord);
+    m_Recompute.nShadowBase = PageNumber(boreholeStats.RecordCount) + 1 + RECOMPUTE_SHADOW_GAP;
+    memset((void*)&m_Recompute.totals, 0, sizeof(m_Recompute.totals));
+    m_bRecomputeTailQueued = false;
+    m_bRecomputeShadowFailed = false;
+    m_Recompute.nOpen = RECOMPUTE_JOB_OPEN;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT32 RecomputeShadowPage(U_INT32 nPage)
+{
+    return m_Recompute.nShadowBase + (nPage - m_Recompute.nFirstPage);
+}
+
+/*******************************************************************************
+*       @details
+*       A shadow page that did not program leaves the recompute with nothing
+*       it can swap in.
+*******************************************************************************/
+static void RecomputeShadowWritten(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus)
+{
+    if (eStatus != FLASH_PAGE_GOOD)
+    {
+        m_bRecomputeShadowFailed = true;
+        m_RecordRecomputeStats.nShadowFailures++;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Queues m_RecomputePage to be written to the shadow of a record page.
+*******************************************************************************/
+static void RecomputeQueueShadow(U_INT32 nPage)
+{
+    U_INT32 nShadow = RecomputeShadowPage(nPage) + RECORD_AREA_BASE_ADDRESS;
+
+    memcpy(&page, m_RecomputePage, sizeof(m_RecomputePage));
+    if (!FLASH_QueueWrite(&page, nShadow, RecomputeShadowWritten))
+    {
+        RecomputeShadowWritten(nShadow, FLASH_WritePage(&page, nShadow));
+    }
+    m_RecordRecomputeStats.nPages++;
+}
+
+/*******************************************************************************
+*       @details
+*       Reads a survey as the recompute has redone it.  Surveys of the hole
+*       come from their shadow page, FLASH_ReadPage() sees pages still
+*       queued.
+*******************************************************************************/
+static BOOL RecomputeReadRecord(STRUCT_RECORD_DATA* record, U_INT32 nRecord)
+{
+    U_INT32 nPage = PageNumber(nRecord);
+
+    if (nPage < m_Recompute.nFirstPage)
+    {
+        return RECORD_GetRecord(record, nRecord);
+    }
+    if (FLASH_ReadPage(&page, RecomputeShadowPage(nPage) + RECORD_AREA_BASE_ADDRESS) == FLASH_PAGE_CORRUPT)
+    {
+        return false;
+    }
+    memcpy(record, &((STRUCT_RECORD_DATA*)&page)[PageOffset(nRecord)], sizeof(STRUCT_RECORD_DATA));
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       Works out the position of one survey again, from the survey it was
+*       taken after.  That is the one before it, or for the first survey
+*       past a branch point the branch point, whose position the totals
+*       restart from as RECORD_InitBranchParam() does.  The first survey of
+*       a hole is measured from nothing, as after RECORD_InitNewHole().
+*******************************************************************************/
+static void RecomputeRecord(STRUCT_RECORD_DATA* records, U_INT32 nPage, U_INT32 nRecord, RECOMPUTE_TOTALS* pTotals)
+{
+    STRUCT_RECORD_DATA* survey = &records[PageOffset(nRecord)];
+    STRUCT_RECORD_DATA branch;
+    EASTING_NORTHING_DATA_STRUCT result;
+    MIN_CURVE_STATION end;
+    float m;
+
+    if (nRecord == newHole_tracker1.EndingRecordNumber + 1)
+    {
+        memset((void*)pTotals, 0, sizeof(RECOMPUTE_TOTALS));
+    }
+    else if (survey->PreviousBranchRecordNum)
+    {
+        // the branch point has been redone already, maybe in this page
+        if (PageNumber(survey->PreviousBranchRecordNum) == nPage)
+        {
+            memcpy(&branch, &records[PageOffset(survey->PreviousBranchRecordNum)], sizeof(branch));
+        }
+        else
+        {
+            RecomputeReadRecord(&branch, survey->PreviousBranchRecordNum);
+        }
+        pTotals->nTotalDepth = branch.Z * 10;
+        pTotals->fTotalNorthings = branch.Y;
+        pTotals->fTotalEastings = branch.X;
+        pTotals->previous.nAzimuth = branch.nAzimuth;
+        pTotals->previous.nInclination = branch.nPitch;
+        pTotals->previous.nPipeLength = branch.nTotalLength;
+    }
+
+    end.nAzimuth = survey->nAzimuth;
+    end.nInclination = survey->nPitch;
+    end.nPipeLength = survey->nTotalLength;
+    Calc_MinCurveTenths(&result, &pTotals->previous, &end, m_Recompute.nDesiredAzimuth);
+    m = (result.fDepth + 0.5) * 1;
+    pTotals->nTotalDepth += m;
+    pTotals->fTotalNorthings += result.fNorthing;
+    pTotals->fTotalEastings += result.fEasting;
+    PositionFromTotals(survey, pTotals->nTotalDepth, pTotals->fTotalNorthings, pTotals->fTotalEastings);
+    memcpy(&pTotals->previous, &end, sizeof(end));
+    m_RecordRecomputeStats.nRecords++;
+}
+
+/*******************************************************************************
+*       @details
+*       Redoes one record page before the page being filled into its shadow.
+*******************************************************************************/
+static void RecomputeBuildPage(U_INT32 nPage)
+{
+    U_INT32 nRecord;
+
+    PageRead(nPage);
+    memcpy(m_RecomputePage, m_pReadPage->records, sizeof(m_RecomputePage));
+    for (nRecord = m_Recompute.nNextRecord; PageNumber(nRecord) == nPage; nRecord++)
+    {
+        RecomputeRecord(m_RecomputePage, nPage, nRecord, &m_Recompute.totals);
+    }
+    RecomputeQueueShadow(nPage);
+    m_Recompute.nNextRecord = nRecord;
+}
+
+/*******************************************************************************
+*       @details
+*       Redoes the page being filled into its shadow, from a copy of the
+*       totals so it can be done again if a survey is added before the swap.
+*       The page waiting on the journal is written out, since the swap has
+*       to wait for a checkpoint after it.
+*******************************************************************************/
+static void RecomputeBuildTail(void)
+{
+    U_INT32 nTailPage = PageNumber(boreholeStats.RecordCount);
+    U_INT32 nRecord;
+
+    JournalCompact();
+    memcpy(m_RecomputePage, m_WritePage.records, sizeof(m_RecomputePage));
+    memcpy(&m_RecomputeTail, &m_Recompute.totals, sizeof(RECOMPUTE_TOTALS));
+    for (nRecord = m_Recompute.nNextRecord; nRecord < boreholeStats.RecordCount; nRecord++)
+    {
+        RecomputeRecord(m_RecomputePage, nTailPage, nRecord, &m_RecomputeTail);
+    }
+    RecomputeQueueShadow(nTailPage);
+    m_nRecomputeTailSequence = m_nStatsSequence;
+    m_bRecomputeTailQueued = true;
+}
+
+/*******************************************************************************
+*       @details
+*       Puts the redone tail page in m_WritePage and writes it out, then
+*       commits that it is done.  Also run at power up when the swap was
+*       committed but this was not.
+*******************************************************************************/
+static void RecomputeCopyTail(void)
+{
+    U_INT32 nShadow = m_Swap.nShadowBase + (m_Swap.nTailPage - m_Swap.nFirstPage);
+
+    if (FLASH_ReadPage(&page, nShadow + RECORD_AREA_BASE_ADDRESS) != FLASH_PAGE_CORRUPT)
+    {
+        memcpy(m_WritePage.records, &page, sizeof(m_WritePage.records));
+        PageWrite(m_Swap.nTailPage);
+    }
+    else
+    {
+        m_RecordRecomputeStats.nShadowFailures++;
+    }
+    StatsBegin(STATS_OP_RECOMPUTE);
+    m_Swap.bTailCopied = true;
+    StatsCommit();
+}
+
+/*******************************************************************************
+*       @details
+*       Copies the next swapped in page back from its shadow.
+*******************************************************************************/
+static void RecomputeCopyBack(void)
+{
+    U_INT32 nShadow = m_Swap.nShadowBase + (m_Swap.nCopyPage - m_Swap.nFirstPage);
+
+    (void)FLASH_ReadPage(&page, nShadow + RECORD_AREA_BASE_ADDRESS);
+    memcpy(m_RecomputePage, &page, sizeof(m_RecomputePage));
+    PageWriteFrom(m_RecomputePage, m_Swap.nCopyPage);
+    m_Swap.nCopyPage++;
+    m_RecordRecomputeStats.nCopiedBack++;
+}
+
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RecomputeSwitch()
+;
+; Description:
+;   Every page of the hole has been redone into its shadow and programmed,
+;   so the redone pages and the totals the next survey is added to are
+;   swapped in with one statistics commit.  Until then readers only see the
+;   pages as they were, after it PageRead() takes the pages not copied back
+;   yet from their shadow.  After a branch point has been set the totals
+;   come from the branch point, the way RECORD_InitBranchParam() set them.
+;   The tail page is put in m_WritePage after the commit and committed on
+;   its own, RECORD_RecoverBoreholeStats() does it if power is lost first.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void RecomputeSwitch(void)
+{
+    STRUCT_RECORD_DATA survey;
+    U_INT32 nRecord = boreholeStats.MostRecentSurvey.nRecordNumber + newHole_tracker1.EndingRecordNumber;
+
+    StatsBegin(STATS_OP_RECOMPUTE);
+    if ((boreholeStats.MostRecentSurvey.nRecordNumber != 0) && (nRecord < boreholeStats.RecordCount)
+        && RecomputeReadRecord(&survey, nRecord))
+    {
+        if (!BranchSet && (nRecord == boreholeStats.RecordCount - 1))
+        {
+            boreholeStats.TotalDepth = m_RecomputeTail.nTotalDepth;
+            boreholeStats.TotalNorthings = m_RecomputeTail.fTotalNorthings;
+            boreholeStats.TotalEastings = m_RecomputeTail.fTotalEastings;
+        }
+        else
+        {
+            boreholeStats.TotalDepth = survey.Z * 10;
+            boreholeStats.TotalNorthings = survey.Y;
+            boreholeStats.TotalEastings = survey.X;
+        }
+        boreholeStats.MostRecentSurvey.X = survey.X;
+        boreholeStats.MostRecentSurvey.Y = survey.Y;
+        boreholeStats.MostRecentSurvey.Z = survey.Z;
+    }
+    m_Swap.nActive = RECOMPUTE_SWAP_ACTIVE;
+    m_Swap.bTailCopied = false;
+    m_Swap.nFirstPage = m_Recompute.nFirstPage;
+    m_Swap.nTailPage = PageNumber(boreholeStats.RecordCount);
+    m_Swap.nShadowBase = m_Recompute.nShadowBase;
+    m_Swap.nCopyPage = m_Swap.nFirstPage;
+    PageCacheInvalidate(NULL_PAGE);
+    StatsCommit();
+    m_Recompute.nOpen = 0;
+    RecomputeCopyTail();
+    m_RecordRecomputeStats.nCompleted++;
+
+    memset((void*)&selectedSurveyRecord, 0, sizeof(selectedSurveyRecord));
+    // the totals kept for each branch are worked out again on next use
+    m_BranchTree.nCount = 0;
+    TRAJECTORY_Truncate(0);
+    RECORD_SetRefreshSurveys(true);
+}
+
+/*******************************************************************************
+*       @details
+*       Called before any change other than the recompute's own.  A change
+*       that rewrites earlier pages, or a hole grown up to the shadow pages,
+*       needs the swapped in pages copied back first; the change commits the
+*       swap as over, and a power down before that copies them back again.
+*       A recompute still being redone is started over instead.  Opening a
+*       file drops both.
+*******************************************************************************/
+static void RecomputeBeforeChange(STATS_OPERATION eOperation)
+{
+    BOOL bRewrites = (eOperation == STATS_OP_REMOVE) || (eOperation == STATS_OP_BRANCH);
+    U_INT32 nNextPage = PageNumber(boreholeStats.RecordCount) + 1;
+
+    if ((eOperation == STATS_OP_RECOMPUTE) || (eOperation == STATS_OP_OPEN_FILE))
+    {
+        return;
+    }
+    if ((m_Swap.nActive == RECOMPUTE_SWAP_ACTIVE) && (bRewrites || (nNextPage >= m_Swap.nShadowBase)))
+    {
+        while (m_Swap.nCopyPage < m_Swap.nTailPage)
+        {
+            RecomputeCopyBack();
+        }
+        (void)FLASH_FlushWrites();
+        m_Swap.nActive = 0;
+    }
+    if ((m_Recompute.nOpen == RECOMPUTE_JOB_OPEN) && (bRewrites || (nNextPage >= m_Recompute.nShadowBase)))
+    {
+        RecomputeStart();
+        m_RecordRecomputeStats.nRestarts++;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_RequestRecompute()
+;
+; Description:
+;   The X, Y and Z of every survey were worked out against the desired
+;   azimuth in force when it was taken.  Called when that changes, this
+;   starts RECORD_RecomputeService() on the current hole from the top.  A
+;   change while a recompute is running starts it over.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_RequestRecompute(void)
+{
+    RecomputeStart();
+    m_RecordRecomputeStats.nRequests++;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   RECORD_RecomputeService()
+;
+; Description:
+;   Called from the 10 ms tick.  Each call redoes the surveys of one record
+;   page into its shadow page, so logging and the modem carry on in
+;   between.  The page being filled is done last, from m_WritePage, and
+;   again if a commit changes it before the swap.  Once every shadow page
+;   is programmed and the journal has a checkpoint after the page being
+;   filled, RecomputeSwitch() swaps them in with one commit; the calls
+;   after that copy one page a call back from its shadow, and the swap is
+;   committed as over once the last one is programmed.  Nothing is done
+;   while a statistics change is open, such as a survey that has been taken
+;   but not merged, or while the flash queue has fewer than two free
+;   entries.  A job with no room for its shadow pages below the journal is
+;   dropped.  The job is kept in battery backed RAM; at power up
+;   RECORD_RecoverBoreholeStats() starts an unfinished one over.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void RECORD_RecomputeService(void)
+{
+    U_INT32 nPage, nTailPage;
+
+    if ((m_StatsIntent.nOpen == STATS_INTENT_OPEN)
+        || (FLASH_GetWriteQueueDepth() >= FLASH_WRITE_QUEUE_SIZE - 1))
+    {
+        return;
+    }
+    if (m_Swap.nActive == RECOMPUTE_SWAP_ACTIVE)
+    {
+        if (m_Swap.nCopyPage < m_Swap.nTailPage)
+        {
+            RecomputeCopyBack();
+        }
+        else if (FLASH_GetWriteQueueDepth() == 0)
+        {
+            StatsBegin(STATS_OP_RECOMPUTE);
+            m_Swap.nActive = 0;
+            StatsCommit();
+        }
+        return;
+    }
+    if (m_Recompute.nOpen != RECOMPUTE_JOB_OPEN)
+    {
+        return;
+    }
+    if (m_bRecomputeShadowFailed)
+    {
+        // the pages in use are still as they were
+        m_Recompute.nOpen = 0;
+        return;
+    }
+    if (m_Recompute.nNextRecord > boreholeStats.RecordCount)
+    {
+        // surveys were removed from under it
+        RecomputeStart();
+        m_RecordRecomputeStats.nRestarts++;
+    }
+
+    nTailPage = PageNumber(boreholeStats.RecordCount);
+    if (RecomputeShadowPage(nTailPage) >= RecordPageCapacity())
+    {
+        m_Recompute.nOpen = 0;
+        m_RecordRecomputeStats.nNoRoom++;
+        return;
+    }
+    nPage = PageNumber(m_Recompute.nNextRecord);
+    if (nPage < nTailPage)
+    {
+        RecomputeBuildPage(nPage);
+    }
+    else if (!m_bRecomputeTailQueued || (m_nRecomputeTailSequence != m_nStatsSequence))
+    {
+        RecomputeBuildTail();
+    }
+    else if ((FLASH_GetWriteQueueDepth() == 0) && (m_nJournalPendingPage == NULL_PAGE) && !m_bJournalDirty)
+    {
+        RecomputeSwitch();
+    }
 }
@@ -26,6 +26,8 @@
 #include "UI_Frame.h"
 #include "buzzer.h"
 #include "Gamma_Graph_Plot.h"
+#include "Profile.h"
+#include "Trajectory_Cache.h"
 #include <math.h>
 
 //============================================================================//
@@ -47,6 +49,7 @@ static INT16 X_min_PL_Scanned = 0; // To check for -ve PL
 *******************************************************************************/
 void DrawGammaGraph(void)
 {
+	PROFILE_Start(PROFILE_DRAW_GAMMA_GRAPH);
 	Find_Gamma_Graph_Scale_Max_Min();
 
 	BuzzerHandler(); // To make the beep shorter while plotting graph.
@@ -63,6 +66,8 @@ void DrawGammaGraph(void)
 	{
 		DrawNegativeQuadGammaGraph(X_max_PL, X_min_PL, Y_max_GAMMA, Y_min_GAMMA);
 	}
+
+	PROFILE_Stop(PROFILE_DRAW_GAMMA_GRAPH);
 }
 
 /*******************************************************************************
@@ -129,19 +134,19 @@ void DrawPositiveQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_m
 	GLCD_Line(40, 185, 310, 185);
 	GLCD_Line(40, 30, 310, 30);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 PipeLengthCurrent;
 	INT16 PipeLengthNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeLengthCurrent = current_record.nTotalLength;
 		PipeLengthNext = next_record.nTotalLength;
@@ -156,9 +161,10 @@ void DrawPositiveQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_m
 		X2 = (INT16) (GammaPlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y1 = (INT16) (GammaPlot.Bottom_Left_Y - (((current_record.nGamma-(Y_min*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (GammaPlot.Bottom_Left_Y - (((next_record.nGamma-(Y_min*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1+7, Y1, X2+7, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1+7, Y1, X2+7, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -229,20 +235,20 @@ void DrawPositiveNegativeQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, I
 	GLCD_Line(40, 190, 310, 190);
 	GLCD_Line(40, 30, 310, 30);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 Y_CenterPoint = (INT16) (Y_min + (5 * Y_Scale_Resolution));
 	INT16 PipeLengthCurrent;
 	INT16 PipeLengthNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeLengthCurrent = current_record.nTotalLength;
 		PipeLengthNext = next_record.nTotalLength;
@@ -257,9 +263,10 @@ void DrawPositiveNegativeQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, I
 		X2 = (INT16) (GammaPlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15); // 15 pixels between subdivisions
 		Y1 = (INT16) (110 - (((current_record.nGamma-(Y_CenterPoint*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (110 - (((next_record.nGamma-(Y_CenterPoint*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1, Y1, X2, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1, Y1, X2, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -326,19 +333,19 @@ void DrawNegativeQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_m
 	GLCD_Line(40, 35, 310, 35);
 	GLCD_Line(40, 190, 310, 190);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 PipeLengthCurrent;
 	INT16 PipeLengthNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeLengthCurrent = current_record.nTotalLength;
 		PipeLengthNext = next_record.nTotalLength;
@@ -353,9 +360,10 @@ void DrawNegativeQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_m
 		X2 = (INT16) (GammaPlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y1 = (INT16) (35 - (((current_record.nGamma-(Y_max*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (35 - (((next_record.nGamma-(Y_max*10))/1.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1, Y1, X2, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1, Y1, X2, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -363,46 +371,14 @@ void DrawNegativeQuadGammaGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_m
 *******************************************************************************/
 void Find_Gamma_Graph_Scale_Max_Min(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
+	TRAJECTORY_BOUNDS bounds;
 
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	if(!(InitNewHole_KeyPress() || IsClearHoleSelected()))
-	{
-		RECORD_GetRecord(&record, StartRecord);
-		X_max_PL = record.nTotalLength; // PipeLength;
-		X_min_PL = record.nTotalLength; // PipeLength;
-		Y_max_GAMMA = record.nGamma; // GAMMA ->  Y =
-		Y_min_GAMMA = record.nGamma; // GAMMA ->  Y =
-	}
-	else
-	{
-		X_max_PL = 0; // PipeLength;
-		X_min_PL = 0; // PipeLength;
-		Y_max_GAMMA = 0; // GAMMA ->  Y =
-		Y_min_GAMMA = 0; // GAMMA ->  Y =
-	}
-	for (int i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if(record.nTotalLength > X_max_PL)
-		{
-			X_max_PL = record.nTotalLength;
-		}
-		if(record.nTotalLength < X_min_PL)
-		{
-			X_min_PL = record.nTotalLength;
-		}
-		if(record.nGamma > Y_max_GAMMA)
-		{
-			Y_max_GAMMA = record.nGamma;
-		}
-		if(record.nGamma < Y_min_GAMMA)
-		{
-			Y_min_GAMMA = record.nGamma;
-		}
-	}
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, InitNewHole_KeyPress() || IsClearHoleSelected());
+	X_max_PL = bounds.nMaxTotalLength; // PipeLength;
+	X_min_PL = bounds.nMinTotalLength; // PipeLength;
+	Y_max_GAMMA = bounds.nMaxGamma; // GAMMA ->  Y =
+	Y_min_GAMMA = bounds.nMinGamma; // GAMMA ->  Y =
 	X_min_PL_Scanned = X_min_PL;
 	X_max_PL = Round_Up_10((X_max_PL/10));
 	X_min_PL = Round_Down_10((X_min_PL/10));
@@ -11,6 +11,7 @@
 //      INCLUDES                                                              //
 //============================================================================//
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include "lcd.h"
 #include "Graph_Plot.h"
@@ -29,6 +30,19 @@
 //      DATA DEFINITIONS                                                      //
 //============================================================================//
 
+GRAPH_LINE_STATS m_GraphLineStats;
+
+// Segment held back by GRAPH_Line() in case the next ones carry it on along
+// the same row or column.  X1 <= X2 and Y1 <= Y2 always hold here.
+static struct
+{
+    BOOL bPending;
+    INT16 X1;
+    INT16 Y1;
+    INT16 X2;
+    INT16 Y2;
+} m_Run = { false };
+
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -94,3 +108,95 @@ INT16 Round_Down_10(INT16 num)
     return sign * num;
 }
 
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   GRAPH_Line()
+;
+; Description:
+;   Draws one segment of a survey polyline.  On a long hole many surveys
+;   land in the same pixel column (gamma against pipe length) or the same
+;   row (a straight run in plan), and each of them used to be a GLCD_Line()
+;   setting pixels that were already set.  A run of vertical or horizontal
+;   segments that overlap or touch is kept as one span, its min and max,
+;   and drawn once when something else comes along.  Pixels are only ever
+;   OR'd in, so the union of a run is exactly the span from its min to its
+;   max and the screen comes out the same as drawing every segment.  Sloped
+;   segments are drawn as they are, since any other simplification would
+;   move pixels.  GRAPH_LineFlush() must follow the last segment.
+;
+; Parameters:
+;   INT16 X1, Y1 => start of the segment, in pixels
+;   INT16 X2, Y2 => end of the segment, in pixels
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void GRAPH_Line(INT16 X1, INT16 Y1, INT16 X2, INT16 Y2)
+{
+    INT16 nTemp;
+
+    m_GraphLineStats.nSegments++;
+    if((X1 != X2) && (Y1 != Y2))
+    {
+        GRAPH_LineFlush();
+        GLCD_Line(X1, Y1, X2, Y2);
+        m_GraphLineStats.nLinesDrawn++;
+        return;
+    }
+
+    if(X1 > X2)
+    {
+        nTemp = X1; X1 = X2; X2 = nTemp;
+    }
+    if(Y1 > Y2)
+    {
+        nTemp = Y1; Y1 = Y2; Y2 = nTemp;
+    }
+
+    if(m_Run.bPending)
+    {
+        // same column, spans overlapping or next to each other
+        if((X1 == X2) && (m_Run.X1 == m_Run.X2) && (X1 == m_Run.X1)
+           && (Y1 <= m_Run.Y2 + 1) && (Y2 >= m_Run.Y1 - 1))
+        {
+            if(Y1 < m_Run.Y1) m_Run.Y1 = Y1;
+            if(Y2 > m_Run.Y2) m_Run.Y2 = Y2;
+            m_GraphLineStats.nMerged++;
+            return;
+        }
+        // same row
+        if((Y1 == Y2) && (m_Run.Y1 == m_Run.Y2) && (Y1 == m_Run.Y1)
+           && (X1 <= m_Run.X2 + 1) && (X2 >= m_Run.X1 - 1))
+        {
+            if(X1 < m_Run.X1) m_Run.X1 = X1;
+            if(X2 > m_Run.X2) m_Run.X2 = X2;
+            m_GraphLineStats.nMerged++;
+            return;
+        }
+        GRAPH_LineFlush();
+    }
+
+    m_Run.bPending = true;
+    m_Run.X1 = X1;
+    m_Run.Y1 = Y1;
+    m_Run.X2 = X2;
+    m_Run.Y2 = Y2;
+}
+
+/*!
+********************************************************************************
+*       @details Draws the span GRAPH_Line() is holding back, if any.
+*******************************************************************************/
+void GRAPH_LineFlush(void)
+{
+    if(m_Run.bPending)
+    {
+        m_Run.bPending = false;
+        GLCD_Line(m_Run.X1, m_Run.Y1, m_Run.X2, m_Run.Y2);
+        m_GraphLineStats.nLinesDrawn++;
+    }
+}
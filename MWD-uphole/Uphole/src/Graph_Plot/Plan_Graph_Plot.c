@@ -11,6 +11,7 @@
 //      INCLUDES                                                              //
 //============================================================================//
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include "lcd.h"
 #include "Graph_Plot.h"
@@ -26,6 +27,8 @@
 #include "UI_Frame.h"
 #include "Plan_Graph_Plot.h"
 #include "buzzer.h"
+#include "Profile.h"
+#include "Trajectory_Cache.h"
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -46,6 +49,7 @@ static INT16 X_min_DT_Scanned = 0; // To check for -ve DT
 
 void DrawPlanGraph(void)
 {
+    PROFILE_Start(PROFILE_DRAW_PLAN_GRAPH);
     Find_Plan_Graph_Scale_Max_Min();
 
     BuzzerHandler(); // To make the beep shorter while plotting graph.
@@ -57,6 +61,7 @@ void DrawPlanGraph(void)
     else if(Y_max_LR <= 0 && Y_min_LR < 0)
       DrawNegativeQuadPlanGraph(X_max_DT, X_min_DT, Y_max_LR, Y_min_LR);
 
+    PROFILE_Stop(PROFILE_DRAW_PLAN_GRAPH);
 }
 
 /*******************************************************************************
@@ -127,19 +132,19 @@ void DrawPositiveQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 	GLCD_Line(40, 185, 310, 185);
 	GLCD_Line(40, 30, 310, 30);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 PipeDTCurrent;
 	INT16 PipeDTNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeDTCurrent = current_record.Z;
 		PipeDTNext = next_record.Z;
@@ -154,9 +159,10 @@ void DrawPositiveQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 		X2 = (INT16) (PlanPlot.Bottom_Left_X + (((next_record.Z-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y1 = (INT16) (PlanPlot.Bottom_Left_Y - (((current_record.X-(Y_min*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (PlanPlot.Bottom_Left_Y - (((next_record.X-(Y_min*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1, Y1, X2, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1, Y1, X2, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -229,20 +235,20 @@ void DrawPositiveNegativeQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, IN
 	GLCD_Line(40, 190, 310, 190);
 	GLCD_Line(40, 30, 310, 30);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 Y_CenterPoint = (INT16) (Y_min + (5 * Y_Scale_Resolution));
 	INT16 PipeDTCurrent;
 	INT16 PipeDTNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeDTCurrent = current_record.Z;
 		PipeDTNext = next_record.Z;
@@ -257,9 +263,10 @@ void DrawPositiveNegativeQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, IN
 		X2 = (INT16) (PlanPlot.Bottom_Left_X + (((next_record.Z-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y1 = (INT16) (110 - (((current_record.X-(Y_CenterPoint*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (110 - (((next_record.X-(Y_CenterPoint*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1, Y1, X2, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1, Y1, X2, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -329,19 +336,19 @@ void DrawNegativeQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 	GLCD_Line(40, 35, 310, 35);
 	GLCD_Line(40, 190, 310, 190);
 	INT16 X1, X2, Y1, Y2;
-	STRUCT_RECORD_DATA current_record;
-	STRUCT_RECORD_DATA next_record;
+	TRAJECTORY_STATION current_record;
+	TRAJECTORY_STATION next_record;
 	INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
 	INT16 lastRecord = GetRecordCount();
 	INT16 PipeDTCurrent;
 	INT16 PipeDTNext;
-	RECORD_GetRecord(&current_record, StartRecord);
-	for (int i = StartRecord; i < (lastRecord-1); i++)
+	U_INT32 nStation = StartRecord;
+	TRAJECTORY_GetStation(&current_record, StartRecord);
+	while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
 	{
-		RECORD_GetRecord(&next_record, i+1);
 		if(next_record.PreviousBranchRecordNum)
 		{
-			RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+			TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
 		}
 		PipeDTCurrent = current_record.Z;
 		PipeDTNext = next_record.Z;
@@ -356,9 +363,10 @@ void DrawNegativeQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 		X2 = (INT16) (PlanPlot.Bottom_Left_X + (((next_record.Z-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y1 = (INT16) (35 - (((current_record.X-(Y_max*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
 		Y2 = (INT16) (35 - (((next_record.X-(Y_max*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-		GLCD_Line(X1, Y1, X2, Y2);
-		memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+		GRAPH_Line(X1, Y1, X2, Y2);
+		memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
 	}
+	GRAPH_LineFlush();
 }
 
 /*******************************************************************************
@@ -366,46 +374,14 @@ void DrawNegativeQuadPlanGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 *******************************************************************************/
 void Find_Plan_Graph_Scale_Max_Min(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
+	TRAJECTORY_BOUNDS bounds;
 
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	if(!(InitNewHole_KeyPress() || IsClearHoleSelected()))
-	{
-		RECORD_GetRecord(&record, StartRecord);
-		X_max_DT = record.Z; // Downtarck ->  Z = TotalDepth;
-		X_min_DT = record.Z; // Downtarck ->  Z = TotalDepth;
-		Y_max_LR= record.X; // Downtarck ->  Z = TotalDepth;
-		Y_min_LR= record.X; // Downtarck ->  Z = TotalDepth;
-	}
-	else
-	{
-		X_max_DT = 0; // Downtarck ->  Z = TotalDepth;
-		X_min_DT = 0; // Downtarck ->  Z = TotalDepth;
-		Y_max_LR = 0; // UP/DOWN ->  Y =
-		Y_min_LR = 0; // UP/DOWN ->  Y =
-	}
-	for (int i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if(record.Z > X_max_DT)
-		{
-			X_max_DT = record.Z;
-		}
-		if(record.Z < X_min_DT)
-		{
-			X_min_DT = record.Z;
-		}
-		if(record.X > Y_max_LR)
-		{
-			Y_max_LR = record.X;
-		}
-		if(record.X < Y_min_LR)
-		{
-			Y_min_LR = record.X;
-		}
-	}
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, InitNewHole_KeyPress() || IsClearHoleSelected());
+	X_max_DT = bounds.nMaxZ; // Downtarck ->  Z = TotalDepth;
+	X_min_DT = bounds.nMinZ; // Downtarck ->  Z = TotalDepth;
+	Y_max_LR = bounds.nMaxX; // Left/Right ->  X =
+	Y_min_LR = bounds.nMinX; // Left/Right ->  X =
 	X_min_DT_Scanned = X_min_DT;
 	X_max_DT = Round_Up_10((X_max_DT/10));
 	X_min_DT = Round_Down_10((X_min_DT/10));
@@ -443,24 +419,11 @@ void Find_Plan_Graph_Scale_Max_Min(void)
 *******************************************************************************/
 INT16 Find_X_Scale_Max_Depth(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
-	INT16 Max;
+	TRAJECTORY_BOUNDS bounds;
 
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	RECORD_GetRecord(&record, StartRecord);
-	Max = record.Z; // Downtarck ->  Z = TotalDepth;
-	for (int i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if(record.Z > Max)
-		{
-			Max = record.Z;
-		}
-	}
-	Max = Round_Up_10(Max/10);
-	return Max;
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, false);
+	return Round_Up_10((INT16)bounds.nMaxZ/10);
 }
 
 /*******************************************************************************
@@ -468,23 +431,11 @@ INT16 Find_X_Scale_Max_Depth(void)
 *******************************************************************************/
 INT16 Find_Y_Scale_Max_East(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
-	INT16 Max;
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	RECORD_GetRecord(&record, StartRecord);
-	Max = record.X; // Downtarck ->  Z = TotalDepth;
-	for (int i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if(record.X > Max)
-		{
-			Max = record.X;
-		}
-	}
-	Max = Round_Up_10(Max/10);
-	return Max;
+	TRAJECTORY_BOUNDS bounds;
+
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, false);
+	return Round_Up_10((INT16)bounds.nMaxX/10);
 }
 
 /*******************************************************************************
@@ -492,23 +443,11 @@ INT16 Find_Y_Scale_Max_East(void)
 *******************************************************************************/
 INT16 Find_X_Scale_Min_Depth(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
-	INT16 Min = 0;
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	RECORD_GetRecord(&record, StartRecord);
-	Min = record.Z; // Downtarck ->  Z = TotalDepth;
-	for (INT16 i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if(record.Z < Min)
-		{
-			Min = record.Z;
-		}
-	}
-	Min = Round_Down_10(Min/10);
-	return Min;
+	TRAJECTORY_BOUNDS bounds;
+
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, false);
+	return Round_Down_10((INT16)bounds.nMinZ/10);
 }
 
 /*******************************************************************************
@@ -516,21 +455,9 @@ INT16 Find_X_Scale_Min_Depth(void)
 *******************************************************************************/
 INT16 Find_Y_Scale_Min_East(void)
 {
-	INT16 StartRecord;
-	STRUCT_RECORD_DATA record;
-	INT16 Min = 0;
-	StartRecord = GetRecordCount() - GetStartRecordNumber();
-	INT16 lastRecord = GetRecordCount();
-	RECORD_GetRecord(&record, StartRecord);
-	Min = record.X; // Downtarck ->  Z = TotalDepth;
-	for (int i = StartRecord+1; i < lastRecord; i++)
-	{
-		RECORD_GetRecord(&record, i);
-		if((record.X) < Min)
-		{
-			Min = record.X;
-		}
-	}
-	Min = Round_Down_10(Min/10);
-	return Min;
+	TRAJECTORY_BOUNDS bounds;
+
+	TRAJECTORY_Sync();
+	TRAJECTORY_GetBounds(&bounds, false);
+	return Round_Down_10((INT16)bounds.nMinX/10);
 }
@@ -26,6 +26,8 @@
 #include "UI_Frame.h"
 #include "buzzer.h"
 #include "Side_Graph_Plot.h"
+#include "Profile.h"
+#include "Trajectory_Cache.h"
 #include <math.h>
 
 //============================================================================//
@@ -46,6 +48,7 @@ static INT16 X_min_PL_Scanned = 0; // To check for -ve PL
 
 void DrawSideGraph(void)
 {
+    PROFILE_Start(PROFILE_DRAW_SIDE_GRAPH);
     Find_Side_Graph_Scale_Max_Min();
 
     BuzzerHandler(); // To make the beep shorter while plotting graph.
@@ -57,6 +60,7 @@ void DrawSideGraph(void)
     else if(Y_max_UD <= 0 && Y_min_UD < 0)
       DrawNegativeQuadSideGraph(X_max_PL, X_min_PL, Y_max_UD, Y_min_UD);
 
+    PROFILE_Stop(PROFILE_DRAW_SIDE_GRAPH);
 }
 
 /*!
@@ -127,19 +131,19 @@ void DrawPositiveQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
     GLCD_Line(40, 185, 310, 185);
     GLCD_Line(40, 30, 310, 30);
     INT16 X1, X2, Y1, Y2;
-    STRUCT_RECORD_DATA current_record;
-    STRUCT_RECORD_DATA next_record;
+    TRAJECTORY_STATION current_record;
+    TRAJECTORY_STATION next_record;
     INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
     INT16 lastRecord = GetRecordCount();
     INT16 PipeLengthCurrent;
     INT16 PipeLengthNext;
-    RECORD_GetRecord(&current_record, StartRecord);
-    for (int i = StartRecord; i < (lastRecord-1); i++)
+    U_INT32 nStation = StartRecord;
+    TRAJECTORY_GetStation(&current_record, StartRecord);
+    while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
     {
-      RECORD_GetRecord(&next_record, i+1);
       if(next_record.PreviousBranchRecordNum)
       {
-        RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+        TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
       }
       PipeLengthCurrent = current_record.nTotalLength;
       PipeLengthNext = next_record.nTotalLength;
@@ -154,9 +158,10 @@ void DrawPositiveQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
       X2 = (INT16) (SidePlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
       Y1 = (INT16) (SidePlot.Bottom_Left_Y - (((current_record.Y-(Y_min*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
       Y2 = (INT16) (SidePlot.Bottom_Left_Y - (((next_record.Y-(Y_min*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-      GLCD_Line(X1, Y1, X2, Y2);
-      memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+      GRAPH_Line(X1, Y1, X2, Y2);
+      memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
     }
+    GRAPH_LineFlush();
 }
 
 /*!
@@ -231,20 +236,20 @@ void DrawPositiveNegativeQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, IN
     GLCD_Line(40, 190, 310, 190);
     GLCD_Line(40, 30, 310, 30);
     INT16 X1, X2, Y1, Y2;
-    STRUCT_RECORD_DATA current_record;
-    STRUCT_RECORD_DATA next_record;
+    TRAJECTORY_STATION current_record;
+    TRAJECTORY_STATION next_record;
     INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
     INT16 lastRecord = GetRecordCount();
     INT16 Y_CenterPoint = (INT16) (Y_min + (5 * Y_Scale_Resolution));
     INT16 PipeLengthCurrent;
     INT16 PipeLengthNext;
-    RECORD_GetRecord(&current_record, StartRecord);
-    for (int i = StartRecord; i < (lastRecord-1); i++)
+    U_INT32 nStation = StartRecord;
+    TRAJECTORY_GetStation(&current_record, StartRecord);
+    while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
     {
-      RECORD_GetRecord(&next_record, i+1);
       if(next_record.PreviousBranchRecordNum)
       {
-        RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+        TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
       }
       PipeLengthCurrent = current_record.nTotalLength;
       PipeLengthNext = next_record.nTotalLength;
@@ -259,9 +264,10 @@ void DrawPositiveNegativeQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, IN
       X2 = (INT16) (SidePlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15); // 15 pixels between subdivisions
       Y1 = (INT16) (110 - (((current_record.Y-(Y_CenterPoint*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
       Y2 = (INT16) (110 - (((next_record.Y-(Y_CenterPoint*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-      GLCD_Line(X1, Y1, X2, Y2);
-      memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+      GRAPH_Line(X1, Y1, X2, Y2);
+      memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
     }
+    GRAPH_LineFlush();
 }
 
 /*!
@@ -334,19 +340,19 @@ void DrawNegativeQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
     GLCD_Line(40, 35, 310, 35);
     GLCD_Line(40, 190, 310, 190);
     INT16 X1, X2, Y1, Y2;
-    STRUCT_RECORD_DATA current_record;
-    STRUCT_RECORD_DATA next_record;
+    TRAJECTORY_STATION current_record;
+    TRAJECTORY_STATION next_record;
     INT16 StartRecord = GetRecordCount() - GetStartRecordNumber();
     INT16 lastRecord = GetRecordCount();
     INT16 PipeLengthCurrent;
     INT16 PipeLengthNext;
-    RECORD_GetRecord(&current_record, StartRecord);
-    for (int i = StartRecord; i < (lastRecord-1); i++)
+    U_INT32 nStation = StartRecord;
+    TRAJECTORY_GetStation(&current_record, StartRecord);
+    while (TRAJECTORY_GetNextStation(&next_record, &nStation, lastRecord))
     {
-      RECORD_GetRecord(&next_record, i+1);
       if(next_record.PreviousBranchRecordNum)
       {
-        RECORD_GetRecord(&current_record, next_record.PreviousBranchRecordNum);
+        TRAJECTORY_GetStation(&current_record, next_record.PreviousBranchRecordNum);
       }
       PipeLengthCurrent = current_record.nTotalLength;
       PipeLengthNext = next_record.nTotalLength;
@@ -361,9 +367,10 @@ void DrawNegativeQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
       X2 = (INT16) (SidePlot.Bottom_Left_X + (((next_record.nTotalLength-(X_min*10))/10.0)/X_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
       Y1 = (INT16) (35 - (((current_record.Y-(Y_max*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
       Y2 = (INT16) (35 - (((next_record.Y-(Y_max*10))/10.0)/Y_Scale_Resolution) * 15.0); // 15 pixels between subdivisions
-      GLCD_Line(X1, Y1, X2, Y2);
-      memcpy(&current_record, &next_record, sizeof(STRUCT_RECORD_DATA));
+      GRAPH_Line(X1, Y1, X2, Y2);
+      memcpy(&current_record, &next_record, sizeof(TRAJECTORY_STATION));
     }
+    GRAPH_LineFlush();
 }
 
 /*!
@@ -372,53 +379,14 @@ void DrawNegativeQuadSideGraph(INT16 X_max, INT16 X_min, INT16 Y_max, INT16 Y_mi
 *******************************************************************************/
 void Find_Side_Graph_Scale_Max_Min(void)
 {
-  INT16 StartRecord;
-  STRUCT_RECORD_DATA record;
-
-  StartRecord = GetRecordCount() - GetStartRecordNumber();
-  INT16 lastRecord = GetRecordCount();
-
-  if(!(InitNewHole_KeyPress() || IsClearHoleSelected()))
-  {
-    RECORD_GetRecord(&record, StartRecord);
-    X_max_PL = record.nTotalLength; // PipeLength;
-    X_min_PL = record.nTotalLength; // PipeLength;
-    Y_max_UD = record.Y; // UP/DOWN ->  Y =
-    Y_min_UD = record.Y; // UP/DOWN ->  Y =
-  }
-  else
-  {
-    X_max_PL = 0; // PipeLength;
-    X_min_PL = 0; // PipeLength;
-    Y_max_UD = 0; // UP/DOWN ->  Y =
-    Y_min_UD = 0; // UP/DOWN ->  Y =
-  }
-
-  for (int i = StartRecord+1; i < lastRecord; i++)
-    {
-      RECORD_GetRecord(&record, i);
-
-      if(record.nTotalLength > X_max_PL)
-      {
-        X_max_PL = record.nTotalLength;
-      }
-
-      if(record.nTotalLength < X_min_PL)
-      {
-        X_min_PL = record.nTotalLength;
-      }
-
-      if(record.Y > Y_max_UD)
-      {
-        Y_max_UD = record.Y;
-      }
-
-      if(record.Y < Y_min_UD)
-      {
-        Y_min_UD = record.Y;
-      }
-    }
-
+  TRAJECTORY_BOUNDS bounds;
+
+  TRAJECTORY_Sync();
+  TRAJECTORY_GetBounds(&bounds, InitNewHole_KeyPress() || IsClearHoleSelected());
+  X_max_PL = bounds.nMaxTotalLength; // PipeLength;
+  X_min_PL = bounds.nMinTotalLength; // PipeLength;
+  Y_max_UD = bounds.nMaxY; // UP/DOWN ->  Y =
+  Y_min_UD = bounds.nMinY; // UP/DOWN ->  Y =
   X_min_PL_Scanned = X_min_PL;
 
   X_max_PL = Round_Up_10((X_max_PL/10));
@@ -0,0 +1,530 @@
+/*******************************************************************************
+*       @brief      Keeps the plotted fields of the current hole in RAM so the
+*                   plan, side and gamma graphs repaint without reading the
+*                   record pages back from the serial flash.  A hole longer
+*                   than the cache is thinned out, see CacheThin().
+*       @file       Uphole/src/Graph_Plot/Trajectory_Cache.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdbool.h>
+#include <string.h>
+#include "portable.h"
+#include "RecordManager.h"
+#include "UI_RecordDataPanel.h"
+#include "Trajectory_Cache.h"
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+TRAJECTORY_CACHE_STATS m_TrajectoryCacheStats;
+
+// One array per field rather than an array of TRAJECTORY_STATION, so the
+// 16 bit fields pack without padding next to the 32 bit downtrack.  Slots
+// are in record order, m_nRecord[] says which record each one holds.
+static INT32 m_nZ[TRAJECTORY_CACHE_SIZE];
+static INT16 m_nX[TRAJECTORY_CACHE_SIZE];
+static INT16 m_nY[TRAJECTORY_CACHE_SIZE];
+static U_INT16 m_nTotalLength[TRAJECTORY_CACHE_SIZE];
+static INT16 m_nGamma[TRAJECTORY_CACHE_SIZE];
+static INT16 m_nPreviousBranch[TRAJECTORY_CACHE_SIZE];
+static U_INT16 m_nRecord[TRAJECTORY_CACHE_SIZE];
+static BOOL m_bKeep[TRAJECTORY_CACHE_SIZE];     // never thinned out
+
+static BOOL m_bValid = false;
+static U_INT32 m_nFirstRecord = 0;      // first record of the hole
+static U_INT32 m_nEndRecord = 0;        // one past the last record folded in
+static U_INT32 m_nCount = 0;            // slots in use
+static U_INT32 m_nCursor = 0;           // slot TRAJECTORY_GetNextStation() last gave
+
+// Bounds of every station after the first, thinned out or not.  The graphs
+// either start their scan from the first station or from zero, so the
+// first station is kept out of these and added by TRAJECTORY_GetBounds()
+// when it is wanted.
+static TRAJECTORY_BOUNDS m_Tail;
+static BOOL m_bTailEmpty = true;
+static BOOL m_bTailStale = false;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void StationFromRecord(TRAJECTORY_STATION *pStation, const STRUCT_RECORD_DATA *pRecord)
+{
+	pStation->Z = pRecord->Z;
+	pStation->X = pRecord->X;
+	pStation->Y = pRecord->Y;
+	pStation->nTotalLength = pRecord->nTotalLength;
+	pStation->nGamma = pRecord->nGamma;
+	pStation->PreviousBranchRecordNum = pRecord->PreviousBranchRecordNum;
+}
+
+/*******************************************************************************
+*       @details
+*       Finds the slot holding a record, or the slot it would go in.
+*******************************************************************************/
+static BOOL FindSlot(U_INT32 nRecord, U_INT32 *pnSlot)
+{
+	U_INT32 nLow = 0;
+	U_INT32 nHigh = m_nCount;
+
+	if(!m_bValid)
+	{
+		*pnSlot = 0;
+		return false;
+	}
+	if((m_nCursor < m_nCount) && (m_nRecord[m_nCursor] == nRecord))
+	{
+		*pnSlot = m_nCursor;
+		return true;
+	}
+	while(nLow < nHigh)
+	{
+		U_INT32 nMiddle = (nLow + nHigh) / 2;
+
+		if(m_nRecord[nMiddle] < nRecord)
+		{
+			nLow = nMiddle + 1;
+		}
+		else
+		{
+			nHigh = nMiddle;
+		}
+	}
+	*pnSlot = nLow;
+	return (nLow < m_nCount) && (m_nRecord[nLow] == nRecord);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void SlotCopy(U_INT32 nTo, U_INT32 nFrom)
+{
+	m_nZ[nTo] = m_nZ[nFrom];
+	m_nX[nTo] = m_nX[nFrom];
+	m_nY[nTo] = m_nY[nFrom];
+	m_nTotalLength[nTo] = m_nTotalLength[nFrom];
+	m_nGamma[nTo] = m_nGamma[nFrom];
+	m_nPreviousBranch[nTo] = m_nPreviousBranch[nFrom];
+	m_nRecord[nTo] = m_nRecord[nFrom];
+	m_bKeep[nTo] = m_bKeep[nFrom];
+}
+
+/*******************************************************************************
+*       @details
+*       Puts a station in a free slot, moving the later ones up.
+*******************************************************************************/
+static void SlotInsert(U_INT32 nSlot, U_INT32 nRecord, const TRAJECTORY_STATION *pStation, BOOL bKeep)
+{
+	for(U_INT32 nMove = m_nCount; nMove > nSlot; nMove--)
+	{
+		SlotCopy(nMove, nMove - 1);
+	}
+	m_nZ[nSlot] = pStation->Z;
+	m_nX[nSlot] = pStation->X;
+	m_nY[nSlot] = pStation->Y;
+	m_nTotalLength[nSlot] = pStation->nTotalLength;
+	m_nGamma[nSlot] = pStation->nGamma;
+	m_nPreviousBranch[nSlot] = pStation->PreviousBranchRecordNum;
+	m_nRecord[nSlot] = (U_INT16)nRecord;
+	m_bKeep[nSlot] = bKeep;
+	m_nCount++;
+	m_TrajectoryCacheStats.nAppended++;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   CacheThin()
+;
+; Description:
+;   Makes room in a full cache by dropping every other station, so a hole
+;   of any length is drawn from RAM at half the detail each time it outgrows
+;   the cache again.  The first and last stations, the first station of a
+;   branch, the one before it and its tie-in are kept, so every leg still
+;   starts and ends where it did.
+;
+; Returns:
+;   BOOL => false if every station had to be kept
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static BOOL CacheThin(void)
+{
+	U_INT32 nKept = 0;
+	BOOL bDrop = false;
+
+	for(U_INT32 nSlot = 0; nSlot < m_nCount; nSlot++)
+	{
+		if(m_bKeep[nSlot] || (nSlot == m_nCount - 1))
+		{
+			SlotCopy(nKept++, nSlot);
+		}
+		else
+		{
+			if(!bDrop)
+			{
+				SlotCopy(nKept++, nSlot);
+			}
+			bDrop = !bDrop;
+		}
+	}
+	if(nKept == m_nCount)
+	{
+		return false;
+	}
+	m_nCount = nKept;
+	m_nCursor = 0;
+	m_TrajectoryCacheStats.nThinned++;
+	return true;
+}
+
+/*******************************************************************************
+*       @details
+*       Marks a station to survive CacheThin(), reading it in if it has
+*       already been thinned out.
+*******************************************************************************/
+static void CacheKeep(U_INT32 nRecord)
+{
+	STRUCT_RECORD_DATA record;
+	TRAJECTORY_STATION station;
+	U_INT32 nSlot;
+
+	if(FindSlot(nRecord, &nSlot))
+	{
+		m_bKeep[nSlot] = true;
+		return;
+	}
+	if(((m_nCount < TRAJECTORY_CACHE_SIZE) || CacheThin()) && RECORD_GetRecord(&record, nRecord))
+	{
+		StationFromRecord(&station, &record);
+		(void)FindSlot(nRecord, &nSlot);
+		SlotInsert(nSlot, nRecord, &station, true);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void BoundsSet(TRAJECTORY_BOUNDS *pBounds, const TRAJECTORY_STATION *pStation)
+{
+	pBounds->nMaxZ = pBounds->nMinZ = pStation->Z;
+	pBounds->nMaxX = pBounds->nMinX = pStation->X;
+	pBounds->nMaxY = pBounds->nMinY = pStation->Y;
+	pBounds->nMaxTotalLength = pBounds->nMinTotalLength = pStation->nTotalLength;
+	pBounds->nMaxGamma = pBounds->nMinGamma = pStation->nGamma;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void BoundsFold(TRAJECTORY_BOUNDS *pBounds, const TRAJECTORY_BOUNDS *pOther)
+{
+	if(pOther->nMaxZ > pBounds->nMaxZ) pBounds->nMaxZ = pOther->nMaxZ;
+	if(pOther->nMinZ < pBounds->nMinZ) pBounds->nMinZ = pOther->nMinZ;
+	if(pOther->nMaxX > pBounds->nMaxX) pBounds->nMaxX = pOther->nMaxX;
+	if(pOther->nMinX < pBounds->nMinX) pBounds->nMinX = pOther->nMinX;
+	if(pOther->nMaxY > pBounds->nMaxY) pBounds->nMaxY = pOther->nMaxY;
+	if(pOther->nMinY < pBounds->nMinY) pBounds->nMinY = pOther->nMinY;
+	if(pOther->nMaxTotalLength > pBounds->nMaxTotalLength) pBounds->nMaxTotalLength = pOther->nMaxTotalLength;
+	if(pOther->nMinTotalLength < pBounds->nMinTotalLength) pBounds->nMinTotalLength = pOther->nMinTotalLength;
+	if(pOther->nMaxGamma > pBounds->nMaxGamma) pBounds->nMaxGamma = pOther->nMaxGamma;
+	if(pOther->nMinGamma < pBounds->nMinGamma) pBounds->nMinGamma = pOther->nMinGamma;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void TailAdd(const TRAJECTORY_STATION *pStation)
+{
+	TRAJECTORY_BOUNDS station;
+
+	BoundsSet(&station, pStation);
+	if(m_bTailEmpty)
+	{
+		m_Tail = station;
+		m_bTailEmpty = false;
+	}
+	else
+	{
+		BoundsFold(&m_Tail, &station);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TailRebuild()
+;
+; Description:
+;   Running bounds only grow, so once stations have been dropped they are
+;   worked out again.  This is a scan of the RAM arrays; only a hole that
+;   has been thinned out goes back to flash for the stations it dropped.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void TailRebuild(void)
+{
+	TRAJECTORY_STATION station;
+
+	m_bTailEmpty = true;
+	m_bTailStale = false;
+	for(U_INT32 nRecord = m_nFirstRecord + 1; nRecord < m_nEndRecord; nRecord++)
+	{
+		TRAJECTORY_GetStation(&station, nRecord);
+		TailAdd(&station);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TRAJECTORY_Sync()
+;
+; Description:
+;   Brings the cache up to the records of the hole being plotted.  Only the
+;   surveys added since the last call are read from flash, and each one is
+;   folded into the bounds as it is read, so a repaint after a new survey
+;   costs one record read instead of a pass over the whole hole.  A new
+;   first record means a new hole and starts the cache again.  Deletes and
+;   branches are reported through TRAJECTORY_Truncate() by the Record
+;   Manager, since they can rewrite records without changing the count.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void TRAJECTORY_Sync(void)
+{
+	STRUCT_RECORD_DATA record;
+	TRAJECTORY_STATION station;
+	U_INT32 nEnd = GetRecordCount();
+	U_INT32 nStart = GetStartRecordNumber();
+	U_INT32 nFirst = (nStart < nEnd) ? (nEnd - nStart) : 0;
+
+	if(!m_bValid || (nFirst != m_nFirstRecord))
+	{
+		m_bValid = true;
+		m_nFirstRecord = nFirst;
+		m_nEndRecord = nFirst;
+		m_nCount = 0;
+		m_nCursor = 0;
+		m_bTailEmpty = true;
+		m_bTailStale = false;
+		m_TrajectoryCacheStats.nRebuilds++;
+	}
+	else if(nEnd < m_nEndRecord)
+	{
+		TRAJECTORY_Truncate(nEnd);
+	}
+
+	if(m_bTailStale)
+	{
+		TailRebuild();
+	}
+
+	while(m_nEndRecord < nEnd)
+	{
+		if(!RECORD_GetRecord(&record, m_nEndRecord))
+		{
+			break;
+		}
+		StationFromRecord(&station, &record);
+		if(station.PreviousBranchRecordNum != 0)
+		{
+			// a new branch, its leg is drawn from the tie-in
+			if(m_nCount > 0)
+			{
+				m_bKeep[m_nCount - 1] = true;
+			}
+			CacheKeep((U_INT16)station.PreviousBranchRecordNum);
+		}
+		if((m_nCount < TRAJECTORY_CACHE_SIZE) || CacheThin())
+		{
+			SlotInsert(m_nCount, m_nEndRecord, &station,
+				(m_nEndRecord == m_nFirstRecord) || (station.PreviousBranchRecordNum != 0));
+		}
+		if(m_nEndRecord != m_nFirstRecord)
+		{
+			TailAdd(&station);
+		}
+		m_nEndRecord++;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TRAJECTORY_Truncate()
+;
+; Description:
+;   Drops the stations from nRecord on; they are read again on the next
+;   TRAJECTORY_Sync().  The bounds of what is left are rebuilt from RAM then.
+;
+; Parameters:
+;   U_INT32 nRecord => first record that may have changed, 0 for all
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void TRAJECTORY_Truncate(U_INT32 nRecord)
+{
+	U_INT32 nSlot;
+
+	if(!m_bValid || (nRecord >= m_nEndRecord))
+	{
+		return;
+	}
+	m_TrajectoryCacheStats.nTruncations++;
+	if(nRecord <= m_nFirstRecord)
+	{
+		m_bValid = false;
+		return;
+	}
+	(void)FindSlot(nRecord, &nSlot);
+	m_nCount = nSlot;
+	m_nCursor = 0;
+	m_nEndRecord = nRecord;
+	m_bTailStale = true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TRAJECTORY_GetStation()
+;
+; Description:
+;   Takes the plotted fields of a record from RAM.  Records the cache does
+;   not hold, such as a station a long hole has thinned out, are read from
+;   the record pages as before.  The graphs only ask for the ones it holds,
+;   see TRAJECTORY_GetNextStation().
+;
+; Parameters:
+;   TRAJECTORY_STATION *pStation => filled in
+;   U_INT32 nRecord => record number, as for RECORD_GetRecord()
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void TRAJECTORY_GetStation(TRAJECTORY_STATION *pStation, U_INT32 nRecord)
+{
+	STRUCT_RECORD_DATA record;
+	U_INT32 nSlot;
+
+	if(FindSlot(nRecord, &nSlot))
+	{
+		pStation->Z = m_nZ[nSlot];
+		pStation->X = m_nX[nSlot];
+		pStation->Y = m_nY[nSlot];
+		pStation->nTotalLength = m_nTotalLength[nSlot];
+		pStation->nGamma = m_nGamma[nSlot];
+		pStation->PreviousBranchRecordNum = m_nPreviousBranch[nSlot];
+		m_nCursor = nSlot;
+		return;
+	}
+
+	m_TrajectoryCacheStats.nFlashReads++;
+	memset(&record, 0, sizeof(record));
+	RECORD_GetRecord(&record, nRecord);
+	StationFromRecord(pStation, &record);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TRAJECTORY_GetNextStation()
+;
+; Description:
+;   Steps a graph along the stations the cache holds.  Until the hole
+;   outgrows the cache that is every station; after that it is the ones
+;   CacheThin() kept, so a repaint never reads the record pages.
+;
+; Parameters:
+;   TRAJECTORY_STATION *pStation => filled in
+;   U_INT32 *pnRecord => the station drawn last, moved on to the next one
+;   U_INT32 nEndRecord => one past the last record to draw
+;
+; Returns:
+;   BOOL => false when there are no more stations before nEndRecord
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL TRAJECTORY_GetNextStation(TRAJECTORY_STATION *pStation, U_INT32 *pnRecord, U_INT32 nEndRecord)
+{
+	U_INT32 nSlot;
+
+	if(FindSlot(*pnRecord, &nSlot))
+	{
+		nSlot++;
+	}
+	if((nSlot >= m_nCount) || (m_nRecord[nSlot] >= nEndRecord))
+	{
+		return false;
+	}
+	*pnRecord = m_nRecord[nSlot];
+	TRAJECTORY_GetStation(pStation, *pnRecord);
+	return true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   TRAJECTORY_GetBounds()
+;
+; Description:
+;   Gives the extent of the hole synced by TRAJECTORY_Sync().  The scale
+;   scans start either from the first station or, while a new hole or a
+;   clear hole is pending, from zero; both are kept in step here.
+;
+; Parameters:
+;   TRAJECTORY_BOUNDS *pBounds => filled in
+;   BOOL bFromOrigin => true to start from zero instead of the first station
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void TRAJECTORY_GetBounds(TRAJECTORY_BOUNDS *pBounds, BOOL bFromOrigin)
+{
+	TRAJECTORY_STATION station;
+
+	if(bFromOrigin)
+	{
+		memset(&station, 0, sizeof(station));
+	}
+	else
+	{
+		TRAJECTORY_GetStation(&station, m_nFirstRecord);
+	}
+	BoundsSet(pBounds, &station);
+	if(!m_bTailEmpty)
+	{
+		BoundsFold(pBounds, &m_Tail);
+	}
+}
@@ -20,13 +20,14 @@
 #include "portable.h"
 #include "lcd.h"
 #include "Manager_DataLink.h"
-#include "systick.h"
+#include "SysTick.h"
 #include "timer.h"
 #include "FlashMemory.h"
 #include "UI_Frame.h"
 #include "UI_LCDScreenInversion.h"
 #include "Compass_Plot.h"
 #include "Compass_Panel.h"
+#include "Profile.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -48,6 +49,14 @@
 #define SED1335_MWRITE       0x42
 #define SED1335_MREAD        0x43
 #define SED1335_FX           7
+#define SED1335_CSRW         0x46
+
+#define LCD_FOREGROUND_ADDRESS  0x0000
+#define LCD_BACKGROUND_ADDRESS  0x2580
+
+// Two dirty spans closer than this are sent as one, re-sending the clean
+// bytes between them costs less than another cursor command.
+#define LCD_SPAN_MERGE_GAP   3
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
@@ -56,6 +65,9 @@
 static void lcd_WritePixelDataBuffer(void);
 static void lcd_WritePixelBackgroundBuffer(void);
 static void lcd_Write(U_BYTE nCmd, U_BYTE *pData, U_INT32 nLength);
+static void lcd_WriteDirtySpans(BOOL bPage);
+static void lcd_WriteSpan(BOOL bPage, U_INT16 nStart, U_INT16 nEnd);
+static void lcd_ClearDirty(BOOL bPage);
 
 void GLCD_SetPixel(unsigned int x,unsigned int y);
 void GLCD_SetCursorAddress(int addr);
@@ -82,6 +94,14 @@ static BOOL m_bPaintLcdBackground;
 static BOOL m_bPaintLcdForeground;
 static BOOL LcdOnOffFlag = true;
 static BOOL LCDRefreshSwitch = true;
+
+// Changed bytes of each pixel row since it was last sent, per page.  A row
+// is clean when its low byte is past its high byte.
+static U_BYTE m_nDirtyLo[2][MAX_PIXEL_ROW];
+static U_BYTE m_nDirtyHi[2][MAX_PIXEL_ROW];
+
+// Put m_LcdUpdateStats in a Live Watch window to see the bus traffic.
+LCD_UPDATE_STATS m_LcdUpdateStats;
 //static BOOL Horizontal_Line = false;
 
 //============================================================================//
@@ -249,23 +269,53 @@ void LCD_Init(void)
 
 	lcd_WritePixelDataBuffer();
 	lcd_WritePixelBackgroundBuffer();
+	lcd_ClearDirty(LCD_FOREGROUND_PAGE);
+	lcd_ClearDirty(LCD_BACKGROUND_PAGE);
 }
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   LCD_Update()
+;
+; Description:
+;   Sends the pages flagged by LCD_Refresh() to the SED1335.  Only the bytes
+;   marked dirty since the last send go out, so a frame that changes one
+;   value costs a few dozen bus writes instead of the whole 9600 byte page.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void LCD_Update(void)
 {
+	BOOL bSent = false;
+
+	PROFILE_Start(PROFILE_LCD_UPDATE);
+	m_LcdUpdateStats.nLastBytes = 0;
 	if(m_bPaintLcdBackground)
 	{
-		lcd_WritePixelBackgroundBuffer();
+		lcd_WriteDirtySpans(LCD_BACKGROUND_PAGE);
 		m_bPaintLcdBackground = false;
+		bSent = true;
 	}
 	if(m_bPaintLcdForeground)
 	{
-		lcd_WritePixelDataBuffer();
+		lcd_WriteDirtySpans(LCD_FOREGROUND_PAGE);
 		m_bPaintLcdForeground = false;
+		bSent = true;
+	}
+	if(bSent)
+	{
+		m_LcdUpdateStats.nFrames++;
+		m_LcdUpdateStats.nTotalBytes += m_LcdUpdateStats.nLastBytes;
+		if(m_LcdUpdateStats.nLastBytes > m_LcdUpdateStats.nMaxBytes)
+		{
+			m_LcdUpdateStats.nMaxBytes = m_LcdUpdateStats.nLastBytes;
+		}
 	}
+	PROFILE_Stop(PROFILE_LCD_UPDATE);
 //	if (ElapsedTimeLowRes(m_tLcdBacklightTimer) >= (FOURTYFIVE_SECOND))
 //	{
 //		LCD_SetBacklight(OFF);
@@ -327,6 +377,7 @@ void LCD_ClearRow(U_INT16 nRowPosn, U_INT16 nColLoLimit, U_INT16 nColHiLimit, BO
 			break;
 	}
 
+	LCD_MarkDirty(bPage, nRowPosn, nLoBytePosn, nHiBytePosn);
 	nIndex = nLoBytePosn;
 	while(nIndex <= nHiBytePosn)
 	{
@@ -398,6 +449,7 @@ void LCD_InvertRow(U_INT16 nRowPosn, U_INT16 nColLoLimit, U_INT16 nColHiLimit, B
 			break;
 	}
 
+	LCD_MarkDirty(bPage, nRowPosn, nLoBytePosn, nHiBytePosn);
 	for(nIndex = nLoBytePosn; nIndex <= nHiBytePosn; nIndex++)
 	{
 		if(nIndex == nLoBytePosn)
@@ -461,6 +513,7 @@ void LCD_ClearPixel(U_INT16 nColPosn, U_BYTE nRowPosn, BOOL bPage)
 	{
 		m_nPixelData[nRowPosn][nBytePosn] = nTestByte;
 	}
+	LCD_MarkDirty(bPage, nRowPosn, nBytePosn, nBytePosn);
 }
 
 /*******************************************************************************
@@ -553,6 +606,8 @@ void LCD_OFF(void)
 	memset((void *) m_nPixelBackground, 0x00, sizeof(m_nPixelBackground));
 	lcd_WritePixelDataBuffer();
 	lcd_WritePixelBackgroundBuffer();
+	lcd_ClearDirty(LCD_FOREGROUND_PAGE);
+	lcd_ClearDirty(LCD_BACKGROUND_PAGE);
 
 	LcdOnOffFlag = false;
 
@@ -722,6 +777,7 @@ void GLCD_SetPixel(unsigned int x,unsigned int y)
 //	tmp = GLCD_ReadData();
 //	tmp &= (1 << (SED1335_FX - (x % 8)));
 	DataAddress[address] |= (1 << (7 - (x % 8)));
+	LCD_MarkDirty(LCD_FOREGROUND_PAGE, y, x/8, x/8);
 
 //	GLCD_SetCursorAddress(address);
 //	m_nLcdCommandPort = SED1335_MWRITE;
@@ -852,5 +908,152 @@ void clearLCD(void)
 
 	memset(DataAddress, 0, sizeof(U_BYTE)*MAX_PIXEL_ROW*MAX_PIXEL_COL_STORAGE);
 	memset(BackgdAddress, 0, sizeof(U_BYTE)*MAX_PIXEL_ROW*MAX_PIXEL_COL_STORAGE);
+	LCD_MarkRowsDirty(LCD_FOREGROUND_PAGE, 0, MAX_PIXEL_ROW - 1);
+	LCD_MarkRowsDirty(LCD_BACKGROUND_PAGE, 0, MAX_PIXEL_ROW - 1);
 }
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   LCD_MarkDirty()
+;
+; Description:
+;   Records that bytes nLoByte..nHiByte of a pixel row have changed and must
+;   go to the display on the next LCD_Update() of that page.  Anything that
+;   writes m_nPixelData or m_nPixelBackground directly has to call this (or
+;   LCD_MarkRowsDirty()), otherwise the change never reaches the screen.
+;   Rows and bytes outside the display are ignored/clipped.
+;
+; Parameters:
+;   BOOL bPage       => LCD_FOREGROUND_PAGE or LCD_BACKGROUND_PAGE
+;   U_INT16 nRow     => pixel row
+;   U_INT16 nLoByte  => first changed byte column
+;   U_INT16 nHiByte  => last changed byte column
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void LCD_MarkDirty(BOOL bPage, U_INT16 nRow, U_INT16 nLoByte, U_INT16 nHiByte)
+{
+	U_BYTE nPage = bPage ? LCD_BACKGROUND_PAGE : LCD_FOREGROUND_PAGE;
+
+	if((nRow >= MAX_PIXEL_ROW) || (nLoByte >= MAX_PIXEL_COL_STORAGE) || (nLoByte > nHiByte))
+	{
+		return;
+	}
+	if(nHiByte >= MAX_PIXEL_COL_STORAGE)
+	{
+		nHiByte = MAX_PIXEL_COL_STORAGE - 1;
+	}
+	if(nLoByte < m_nDirtyLo[nPage][nRow])
+	{
+		m_nDirtyLo[nPage][nRow] = (U_BYTE)nLoByte;
+	}
+	if(nHiByte > m_nDirtyHi[nPage][nRow])
+	{
+		m_nDirtyHi[nPage][nRow] = (U_BYTE)nHiByte;
+	}
+}// End LCD_MarkDirty()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void LCD_MarkRowsDirty(BOOL bPage, U_INT16 nFirstRow, U_INT16 nLastRow)
+{
+	while(nFirstRow <= nLastRow && nFirstRow < MAX_PIXEL_ROW)
+	{
+		LCD_MarkDirty(bPage, nFirstRow++, 0, MAX_PIXEL_COL_STORAGE - 1);
+	}
+}// End LCD_MarkRowsDirty()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   lcd_WriteDirtySpans()
+;
+; Description:
+;   Walks the dirty spans of a page in display memory order and sends each
+;   run with its own cursor address.  The page is one contiguous block with
+;   a 40 byte line pitch, so a span ending a row and one starting the next
+;   join into a single write, as do spans separated by a small clean gap.
+;
+; Parameters:
+;   BOOL bPage => LCD_FOREGROUND_PAGE or LCD_BACKGROUND_PAGE
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void lcd_WriteDirtySpans(BOOL bPage)
+{
+	U_BYTE nPage = bPage ? LCD_BACKGROUND_PAGE : LCD_FOREGROUND_PAGE;
+	U_INT16 nRow;
+	U_INT16 nSpanStart;
+	U_INT16 nSpanEnd;
+	U_INT16 nRunStart = 0;
+	U_INT16 nRunEnd = 0;
+	BOOL bRunOpen = false;
+
+	for(nRow = 0; nRow < MAX_PIXEL_ROW; nRow++)
+	{
+		if(m_nDirtyLo[nPage][nRow] > m_nDirtyHi[nPage][nRow])
+		{
+			continue;
+		}
+		nSpanStart = (nRow * MAX_PIXEL_COL_STORAGE) + m_nDirtyLo[nPage][nRow];
+		nSpanEnd = (nRow * MAX_PIXEL_COL_STORAGE) + m_nDirtyHi[nPage][nRow];
+		if(bRunOpen && (nSpanStart <= (nRunEnd + 1 + LCD_SPAN_MERGE_GAP)))
+		{
+			nRunEnd = nSpanEnd;
+		}
+		else
+		{
+			if(bRunOpen)
+			{
+				lcd_WriteSpan(bPage, nRunStart, nRunEnd);
+			}
+			nRunStart = nSpanStart;
+			nRunEnd = nSpanEnd;
+			bRunOpen = true;
+		}
+	}
+	if(bRunOpen)
+	{
+		lcd_WriteSpan(bPage, nRunStart, nRunEnd);
+	}
+	lcd_ClearDirty(bPage);
+}// End lcd_WriteDirtySpans()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void lcd_WriteSpan(BOOL bPage, U_INT16 nStart, U_INT16 nEnd)
+{
+	U_BYTE nCmdData[2];
+	U_INT16 nAddress;
+	U_BYTE *pPage;
+
+	nAddress = (bPage ? LCD_BACKGROUND_ADDRESS : LCD_FOREGROUND_ADDRESS) + nStart;
+	pPage = bPage ? &m_nPixelBackground[0][0] : &m_nPixelData[0][0];
+	nCmdData[0] = (U_BYTE)(nAddress & 0xFF);
+	nCmdData[1] = (U_BYTE)(nAddress >> 8);
+	lcd_Write(SED1335_CSRW, nCmdData, sizeof(nCmdData));
+	lcd_Write(SED1335_MWRITE, &pPage[nStart], (U_INT32)(nEnd - nStart) + 1);
+	m_LcdUpdateStats.nSpans++;
+	m_LcdUpdateStats.nLastBytes += (U_INT32)(nEnd - nStart) + 1 + sizeof(nCmdData) + 2;
+}// End lcd_WriteSpan()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void lcd_ClearDirty(BOOL bPage)
+{
+	U_BYTE nPage = bPage ? LCD_BACKGROUND_PAGE : LCD_FOREGROUND_PAGE;
+
+	memset(m_nDirtyLo[nPage], 0xFF, sizeof(m_nDirtyLo[nPage]));
+	memset(m_nDirtyHi[nPage], 0x00, sizeof(m_nDirtyHi[nPage]));
+}// End lcd_ClearDirty()
+
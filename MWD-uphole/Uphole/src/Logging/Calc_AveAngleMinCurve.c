@@ -20,6 +20,175 @@
 #include "Calc_AveAngleMinCurve.h"
 
 
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+// Below this 1 - cos(dogleg), about 10 degrees, the ratio factor comes from
+// its series instead of acosf(), which loses the small angles to rounding
+#define MIN_CURVE_SERIES_LIMIT  0.015f
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// sin() of 0.0 to 90.0 degrees in steps of 0.1 degree, the resolution the
+// surveys are stored at.  The other quadrants and cos() fold onto it.
+static const REAL32 m_fSinTenths[901] =
+{
+    0.00000000f, 0.00174533f, 0.00349065f, 0.00523596f, 0.00698126f, 0.00872654f,
+    0.01047178f, 0.01221700f, 0.01396218f, 0.01570732f, 0.01745241f, 0.01919744f,
+    0.02094242f, 0.02268733f, 0.02443218f, 0.02617695f, 0.02792164f, 0.02966624f,
+    0.03141076f, 0.03315518f, 0.03489950f, 0.03664371f, 0.03838781f, 0.04013179f,
+    0.04187565f, 0.04361939f, 0.04536299f, 0.04710645f, 0.04884977f, 0.05059294f,
+    0.05233596f, 0.05407881f, 0.05582150f, 0.05756403f, 0.05930637f, 0.06104854f,
+    0.06279052f, 0.06453231f, 0.06627390f, 0.06801529f, 0.06975647f, 0.07149744f,
+    0.07323820f, 0.07497873f, 0.07671903f, 0.07845910f, 0.08019892f, 0.08193851f,
+    0.08367784f, 0.08541692f, 0.08715574f, 0.08889430f, 0.09063258f, 0.09237059f,
+    0.09410831f, 0.09584575f, 0.09758290f, 0.09931975f, 0.10105630f, 0.10279254f,
+    0.10452846f, 0.10626407f, 0.10799936f, 0.10973431f, 0.11146893f, 0.11320321f,
+    0.11493715f, 0.11667074f, 0.11840397f, 0.12013684f, 0.12186934f, 0.12360148f,
+    0.12533323f, 0.12706461f, 0.12879560f, 0.13052619f, 0.13225639f, 0.13398619f,
+    0.13571557f, 0.13744455f, 0.13917310f, 0.14090123f, 0.14262893f, 0.14435620f,
+    0.14608303f, 0.14780941f, 0.14953534f, 0.15126082f, 0.15298584f, 0.15471039f,
+    0.15643447f, 0.15815807f, 0.15988119f, 0.16160382f, 0.16332596f, 0.16504761f,
+    0.16676875f, 0.16848938f, 0.17020950f, 0.17192910f, 0.17364818f, 0.17536673f,
+    0.17708474f, 0.17880222f, 0.18051915f, 0.18223553f, 0.18395135f, 0.18566662f,
+    0.18738131f, 0.18909544f, 0.19080900f, 0.19252197f, 0.19423435f, 0.19594614f,
+    0.19765734f, 0.19936793f, 0.20107792f, 0.20278730f, 0.20449605f, 0.20620419f,
+    0.20791169f, 0.20961856f, 0.21132480f, 0.21303039f, 0.21473533f, 0.21643961f,
+    0.21814324f, 0.21984620f, 0.22154850f, 0.22325012f, 0.22495105f, 0.22665131f,
+    0.22835087f, 0.23004974f, 0.23174790f, 0.23344536f, 0.23514211f, 0.23683815f,
+    0.23853346f, 0.24022804f, 0.24192190f, 0.24361501f, 0.24530739f, 0.24699901f,
+    0.24868989f, 0.25038000f, 0.25206936f, 0.25375794f, 0.25544576f, 0.25713279f,
+    0.25881905f, 0.26050451f, 0.26218918f, 0.26387305f, 0.26555612f, 0.26723838f,
+    0.26891982f, 0.27060045f, 0.27228025f, 0.27395922f, 0.27563736f, 0.27731465f,
+    0.27899111f, 0.28066671f, 0.28234146f, 0.28401534f, 0.28568837f, 0.28736052f,
+    0.28903180f, 0.29070219f, 0.29237170f, 0.29404033f, 0.29570805f, 0.29737487f,
+    0.29904079f, 0.30070580f, 0.30236989f, 0.30403306f, 0.30569530f, 0.30735662f,
+    0.30901699f, 0.31067643f, 0.31233492f, 0.31399246f, 0.31564904f, 0.31730466f,
+    0.31895931f, 0.32061299f, 0.32226570f, 0.32391742f, 0.32556815f, 0.32721790f,
+    0.32886665f, 0.33051439f, 0.33216113f, 0.33380686f, 0.33545157f, 0.33709526f,
+    0.33873792f, 0.34037955f, 0.34202014f, 0.34365969f, 0.34529820f, 0.34693565f,
+    0.34857205f, 0.35020738f, 0.35184165f, 0.35347484f, 0.35510696f, 0.35673800f,
+    0.35836795f, 0.35999681f, 0.36162457f, 0.36325123f, 0.36487678f, 0.36650123f,
+    0.36812455f, 0.36974676f, 0.37136784f, 0.37298778f, 0.37460659f, 0.37622426f,
+    0.37784079f, 0.37945616f, 0.38107038f, 0.38268343f, 0.38429532f, 0.38590604f,
+    0.38751559f, 0.38912395f, 0.39073113f, 0.39233712f, 0.39394191f, 0.39554550f,
+    0.39714789f, 0.39874907f, 0.40034903f, 0.40194778f, 0.40354530f, 0.40514159f,
+    0.40673664f, 0.40833046f, 0.40992303f, 0.41151436f, 0.41310443f, 0.41469324f,
+    0.41628079f, 0.41786707f, 0.41945208f, 0.42103581f, 0.42261826f, 0.42419942f,
+    0.42577929f, 0.42735786f, 0.42893513f, 0.43051110f, 0.43208575f, 0.43365908f,
+    0.43523110f, 0.43680179f, 0.43837115f, 0.43993917f, 0.44150585f, 0.44307119f,
+    0.44463518f, 0.44619781f, 0.44775909f, 0.44931900f, 0.45087754f, 0.45243471f,
+    0.45399050f, 0.45554491f, 0.45709793f, 0.45864955f, 0.46019978f, 0.46174861f,
+    0.46329604f, 0.46484205f, 0.46638664f, 0.46792981f, 0.46947156f, 0.47101188f,
+    0.47255076f, 0.47408821f, 0.47562421f, 0.47715876f, 0.47869186f, 0.48022350f,
+    0.48175367f, 0.48328238f, 0.48480962f, 0.48633538f, 0.48785966f, 0.48938245f,
+    0.49090375f, 0.49242356f, 0.49394187f, 0.49545867f, 0.49697396f, 0.49848774f,
+    0.50000000f, 0.50151074f, 0.50301995f, 0.50452762f, 0.50603376f, 0.50753836f,
+    0.50904142f, 0.51054292f, 0.51204286f, 0.51354125f, 0.51503807f, 0.51653333f,
+    0.51802701f, 0.51951911f, 0.52100963f, 0.52249856f, 0.52398591f, 0.52547165f,
+    0.52695580f, 0.52843833f, 0.52991926f, 0.53139858f, 0.53287628f, 0.53435235f,
+    0.53582679f, 0.53729961f, 0.53877079f, 0.54024032f, 0.54170821f, 0.54317445f,
+    0.54463904f, 0.54610196f, 0.54756322f, 0.54902282f, 0.55048074f, 0.55193699f,
+    0.55339155f, 0.55484443f, 0.55629562f, 0.55774511f, 0.55919290f, 0.56063899f,
+    0.56208338f, 0.56352605f, 0.56496700f, 0.56640624f, 0.56784375f, 0.56927952f,
+    0.57071357f, 0.57214587f, 0.57357644f, 0.57500525f, 0.57643232f, 0.57785762f,
+    0.57928117f, 0.58070296f, 0.58212297f, 0.58354121f, 0.58495767f, 0.58637236f,
+    0.58778525f, 0.58919636f, 0.59060567f, 0.59201318f, 0.59341889f, 0.59482279f,
+    0.59622487f, 0.59762515f, 0.59902360f, 0.60042023f, 0.60181502f, 0.60320799f,
+    0.60459911f, 0.60598840f, 0.60737584f, 0.60876143f, 0.61014516f, 0.61152704f,
+    0.61290705f, 0.61428520f, 0.61566148f, 0.61703588f, 0.61840840f, 0.61977903f,
+    0.62114778f, 0.62251464f, 0.62387960f, 0.62524266f, 0.62660381f, 0.62796306f,
+    0.62932039f, 0.63067581f, 0.63202930f, 0.63338087f, 0.63473051f, 0.63607822f,
+    0.63742399f, 0.63876782f, 0.64010970f, 0.64144963f, 0.64278761f, 0.64412363f,
+    0.64545769f, 0.64678978f, 0.64811990f, 0.64944805f, 0.65077422f, 0.65209840f,
+    0.65342060f, 0.65474081f, 0.65605903f, 0.65737525f, 0.65868946f, 0.66000167f,
+    0.66131187f, 0.66262005f, 0.66392621f, 0.66523035f, 0.66653247f, 0.66783256f,
+    0.66913061f, 0.67042662f, 0.67172059f, 0.67301251f, 0.67430239f, 0.67559021f,
+    0.67687597f, 0.67815967f, 0.67944130f, 0.68072087f, 0.68199836f, 0.68327377f,
+    0.68454711f, 0.68581835f, 0.68708751f, 0.68835458f, 0.68961954f, 0.69088241f,
+    0.69214317f, 0.69340183f, 0.69465837f, 0.69591280f, 0.69716510f, 0.69841529f,
+    0.69966334f, 0.70090926f, 0.70215305f, 0.70339470f, 0.70463421f, 0.70587157f,
+    0.70710678f, 0.70833984f, 0.70957074f, 0.71079947f, 0.71202605f, 0.71325045f,
+    0.71447268f, 0.71569273f, 0.71691061f, 0.71812630f, 0.71933980f, 0.72055111f,
+    0.72176023f, 0.72296715f, 0.72417186f, 0.72537437f, 0.72657467f, 0.72777276f,
+    0.72896863f, 0.73016228f, 0.73135370f, 0.73254290f, 0.73372986f, 0.73491460f,
+    0.73609709f, 0.73727734f, 0.73845534f, 0.73963109f, 0.74080460f, 0.74197584f,
+    0.74314483f, 0.74431155f, 0.74547600f, 0.74663818f, 0.74779809f, 0.74895572f,
+    0.75011107f, 0.75126413f, 0.75241491f, 0.75356339f, 0.75470958f, 0.75585347f,
+    0.75699506f, 0.75813434f, 0.75927131f, 0.76040597f, 0.76153831f, 0.76266833f,
+    0.76379603f, 0.76492140f, 0.76604444f, 0.76716515f, 0.76828352f, 0.76939956f,
+    0.77051324f, 0.77162458f, 0.77273357f, 0.77384021f, 0.77494449f, 0.77604641f,
+    0.77714596f, 0.77824315f, 0.77933796f, 0.78043041f, 0.78152047f, 0.78260816f,
+    0.78369346f, 0.78477637f, 0.78585689f, 0.78693502f, 0.78801075f, 0.78908408f,
+    0.79015501f, 0.79122353f, 0.79228964f, 0.79335334f, 0.79441462f, 0.79547348f,
+    0.79652992f, 0.79758393f, 0.79863551f, 0.79968466f, 0.80073137f, 0.80177564f,
+    0.80281748f, 0.80385686f, 0.80489380f, 0.80592828f, 0.80696031f, 0.80798988f,
+    0.80901699f, 0.81004164f, 0.81106382f, 0.81208353f, 0.81310076f, 0.81411552f,
+    0.81512780f, 0.81613759f, 0.81714490f, 0.81814972f, 0.81915204f, 0.82015188f,
+    0.82114921f, 0.82214404f, 0.82313637f, 0.82412619f, 0.82511350f, 0.82609829f,
+    0.82708057f, 0.82806033f, 0.82903757f, 0.83001229f, 0.83098447f, 0.83195412f,
+    0.83292124f, 0.83388582f, 0.83484786f, 0.83580736f, 0.83676431f, 0.83771872f,
+    0.83867057f, 0.83961986f, 0.84056660f, 0.84151078f, 0.84245240f, 0.84339145f,
+    0.84432793f, 0.84526183f, 0.84619317f, 0.84712192f, 0.84804810f, 0.84897169f,
+    0.84989269f, 0.85081111f, 0.85172693f, 0.85264016f, 0.85355080f, 0.85445883f,
+    0.85536426f, 0.85626708f, 0.85716730f, 0.85806491f, 0.85895990f, 0.85985227f,
+    0.86074203f, 0.86162916f, 0.86251367f, 0.86339555f, 0.86427480f, 0.86515142f,
+    0.86602540f, 0.86689675f, 0.86776545f, 0.86863151f, 0.86949493f, 0.87035570f,
+    0.87121381f, 0.87206927f, 0.87292208f, 0.87377222f, 0.87461971f, 0.87546453f,
+    0.87630668f, 0.87714616f, 0.87798298f, 0.87881711f, 0.87964857f, 0.88047735f,
+    0.88130345f, 0.88212687f, 0.88294759f, 0.88376563f, 0.88458098f, 0.88539363f,
+    0.88620358f, 0.88701083f, 0.88781539f, 0.88861723f, 0.88941637f, 0.89021280f,
+    0.89100652f, 0.89179753f, 0.89258582f, 0.89337139f, 0.89415424f, 0.89493436f,
+    0.89571176f, 0.89648643f, 0.89725837f, 0.89802758f, 0.89879405f, 0.89955778f,
+    0.90031877f, 0.90107702f, 0.90183253f, 0.90258528f, 0.90333529f, 0.90408255f,
+    0.90482705f, 0.90556880f, 0.90630779f, 0.90704401f, 0.90777748f, 0.90850818f,
+    0.90923611f, 0.90996127f, 0.91068366f, 0.91140328f, 0.91212012f, 0.91283418f,
+    0.91354546f, 0.91425396f, 0.91495967f, 0.91566259f, 0.91636273f, 0.91706007f,
+    0.91775463f, 0.91844638f, 0.91913534f, 0.91982150f, 0.92050485f, 0.92118541f,
+    0.92186315f, 0.92253809f, 0.92321022f, 0.92387953f, 0.92454603f, 0.92520972f,
+    0.92587058f, 0.92652863f, 0.92718385f, 0.92783625f, 0.92848583f, 0.92913257f,
+    0.92977649f, 0.93041757f, 0.93105582f, 0.93169123f, 0.93232380f, 0.93295353f,
+    0.93358043f, 0.93420447f, 0.93482568f, 0.93544403f, 0.93605954f, 0.93667219f,
+    0.93728199f, 0.93788893f, 0.93849302f, 0.93909425f, 0.93969262f, 0.94028813f,
+    0.94088077f, 0.94147054f, 0.94205745f, 0.94264149f, 0.94322266f, 0.94380095f,
+    0.94437637f, 0.94494891f, 0.94551858f, 0.94608536f, 0.94664926f, 0.94721028f,
+    0.94776841f, 0.94832366f, 0.94887601f, 0.94942548f, 0.94997205f, 0.95051573f,
+    0.95105652f, 0.95159440f, 0.95212939f, 0.95266148f, 0.95319067f, 0.95371695f,
+    0.95424033f, 0.95476080f, 0.95527836f, 0.95579301f, 0.95630476f, 0.95681358f,
+    0.95731950f, 0.95782249f, 0.95832257f, 0.95881973f, 0.95931397f, 0.95980529f,
+    0.96029369f, 0.96077915f, 0.96126170f, 0.96174131f, 0.96221799f, 0.96269175f,
+    0.96316257f, 0.96363045f, 0.96409540f, 0.96455742f, 0.96501649f, 0.96547263f,
+    0.96592583f, 0.96637608f, 0.96682339f, 0.96726775f, 0.96770917f, 0.96814764f,
+    0.96858316f, 0.96901573f, 0.96944535f, 0.96987202f, 0.97029573f, 0.97071648f,
+    0.97113428f, 0.97154912f, 0.97196100f, 0.97236992f, 0.97277588f, 0.97317887f,
+    0.97357890f, 0.97397597f, 0.97437006f, 0.97476119f, 0.97514935f, 0.97553454f,
+    0.97591676f, 0.97629601f, 0.97667228f, 0.97704557f, 0.97741589f, 0.97778324f,
+    0.97814760f, 0.97850899f, 0.97886739f, 0.97922281f, 0.97957525f, 0.97992470f,
+    0.98027117f, 0.98061466f, 0.98095516f, 0.98129266f, 0.98162718f, 0.98195871f,
+    0.98228725f, 0.98261280f, 0.98293535f, 0.98325491f, 0.98357147f, 0.98388504f,
+    0.98419561f, 0.98450318f, 0.98480775f, 0.98510933f, 0.98540790f, 0.98570347f,
+    0.98599604f, 0.98628560f, 0.98657216f, 0.98685572f, 0.98713627f, 0.98741381f,
+    0.98768834f, 0.98795987f, 0.98822838f, 0.98849389f, 0.98875638f, 0.98901586f,
+    0.98927233f, 0.98952579f, 0.98977623f, 0.99002366f, 0.99026807f, 0.99050946f,
+    0.99074784f, 0.99098320f, 0.99121554f, 0.99144486f, 0.99167116f, 0.99189444f,
+    0.99211470f, 0.99233194f, 0.99254615f, 0.99275734f, 0.99296551f, 0.99317065f,
+    0.99337277f, 0.99357186f, 0.99376792f, 0.99396096f, 0.99415096f, 0.99433794f,
+    0.99452190f, 0.99470282f, 0.99488071f, 0.99505557f, 0.99522740f, 0.99539620f,
+    0.99556196f, 0.99572470f, 0.99588440f, 0.99604107f, 0.99619470f, 0.99634530f,
+    0.99649286f, 0.99663739f, 0.99677888f, 0.99691733f, 0.99705275f, 0.99718513f,
+    0.99731448f, 0.99744078f, 0.99756405f, 0.99768428f, 0.99780147f, 0.99791562f,
+    0.99802673f, 0.99813480f, 0.99823983f, 0.99834182f, 0.99844076f, 0.99853667f,
+    0.99862953f, 0.99871936f, 0.99880614f, 0.99888987f, 0.99897057f, 0.99904822f,
+    0.99912283f, 0.99919440f, 0.99926292f, 0.99932839f, 0.99939083f, 0.99945022f,
+    0.99950656f, 0.99955986f, 0.99961012f, 0.99965732f, 0.99970149f, 0.99974261f,
+    0.99978068f, 0.99981571f, 0.99984770f, 0.99987663f, 0.99990252f, 0.99992537f,
+    0.99994517f, 0.99996192f, 0.99997563f, 0.99998629f, 0.99999391f, 0.99999848f,
+    1.00000000f
+};
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
@@ -158,3 +327,130 @@ static void initDataSet(ANGLE_DATA_STRUCT *nAngle)
     nAngle->fSin = sin(nAngle->fRad); // sin(x)
     nAngle->fCos = cos(nAngle->fRad); // cos(x)
 }
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+static REAL32 SinTenths(INT32 nAngle)
+{
+    nAngle %= THREE_SIXTY_TIMES_TEN;
+    if(nAngle < 0)
+    {
+        nAngle += THREE_SIXTY_TIMES_TEN;
+    }
+    if(nAngle <= 900)
+    {
+        return m_fSinTenths[nAngle];
+    }
+    if(nAngle <= 1800)
+    {
+        return m_fSinTenths[1800 - nAngle];
+    }
+    if(nAngle <= 2700)
+    {
+        return -m_fSinTenths[nAngle - 1800];
+    }
+    return -m_fSinTenths[THREE_SIXTY_TIMES_TEN - nAngle];
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+
+static REAL32 CosTenths(INT32 nAngle)
+{
+    return SinTenths(nAngle + 900);
+}
+
+/*!
+********************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   Calc_MinCurveTenths()
+;
+; Description:
+;   Same result as Calc_AveAngleMinCurve(), for angles in tenths of a degree
+;   as they are stored in the records.  Every angle is a whole number of
+;   tenths, so sin and cos come out of m_fSinTenths[] and the rest is single
+;   precision, which the FPU does in hardware; the double version goes
+;   through the software library for every term.  The dogleg is carried as
+;   1 - cos(beta), worked out from the table, and for small doglegs the
+;   ratio factor is taken from its series in that, which also covers the
+;   straight hole the double version has to nudge the angles for.  Against
+;   the double version the deltas agree to within 1e-5 of the course length
+;   for doglegs up to 150 degrees; past that the ratio factor runs away in
+;   both.
+;
+; Parameters:
+;   EASTING_NORTHING_DATA_STRUCT *nResult => deltas, scaled as by
+;                                            Calc_AveAngleMinCurve()
+;   const MIN_CURVE_STATION *nStarting => previous survey
+;   const MIN_CURVE_STATION *nEnding => this survey
+;   INT16 nDesiredAzimuth => tenths of a degree, as GetDesiredAzimuth()
+;
+; Returns:
+;   BOOL => false if a pointer is missing
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+BOOL Calc_MinCurveTenths(EASTING_NORTHING_DATA_STRUCT *nResult,
+                         const MIN_CURVE_STATION      *nStarting,
+                         const MIN_CURVE_STATION      *nEnding,
+                         INT16                        nDesiredAzimuth)
+{
+    INT32 nStartAzimuth, nStartInclination, nEndAzimuth, nEndInclination;
+    REAL32 fSinStart, fSinEnd, fCosStart, fCosEnd;
+    REAL32 fVersine, fBeta, fRatio, fScale;
+
+    if((nResult == NULL) || (nStarting == NULL) || (nEnding == NULL))
+    {
+        return false;
+    }
+
+    // Angles just short of 360 are taken as small positive ones, the same
+    // as initDataSet() does for the double version
+    nStartAzimuth = (nStarting->nAzimuth >= 3595) ? THREE_SIXTY_TIMES_TEN - nStarting->nAzimuth : nStarting->nAzimuth;
+    nStartInclination = (nStarting->nInclination >= 3595) ? THREE_SIXTY_TIMES_TEN - nStarting->nInclination : nStarting->nInclination;
+    nEndAzimuth = (nEnding->nAzimuth >= 3595) ? THREE_SIXTY_TIMES_TEN - nEnding->nAzimuth : nEnding->nAzimuth;
+    nEndInclination = (nEnding->nInclination >= 3595) ? THREE_SIXTY_TIMES_TEN - nEnding->nInclination : nEnding->nInclination;
+
+    fSinStart = SinTenths(nStartInclination);
+    fSinEnd = SinTenths(nEndInclination);
+    fCosStart = CosTenths(nStartInclination);
+    fCosEnd = CosTenths(nEndInclination);
+
+    // 1 - cos(beta) = (1 - cos(dI)) + sin(I1) * sin(I2) * (1 - cos(dA))
+    fVersine = (1.0f - CosTenths(nEndInclination - nStartInclination))
+             + fSinStart * fSinEnd * (1.0f - CosTenths(nEndAzimuth - nStartAzimuth));
+    if(fVersine < MIN_CURVE_SERIES_LIMIT)
+    {
+        // Rf = 1 + beta^2/12 + beta^4/120, with beta^2 = 2v + v^2/3
+        fRatio = 1.0f + fVersine * (1.0f / 6.0f + fVersine * (11.0f / 180.0f));
+    }
+    else
+    {
+        // Rf = (2 / beta) * tan(beta / 2), tan(beta / 2) = sin(beta) / (1 + cos(beta))
+        fBeta = acosf(1.0f - fVersine);
+        fRatio = (2.0f * sqrtf(fVersine * (2.0f - fVersine))) / ((2.0f - fVersine) * fBeta);
+    }
+
+    fScale = fRatio * ((nEnding->nPipeLength - nStarting->nPipeLength) * 0.5f);
+
+    nResult->fNorthing = fScale * (fSinStart + fSinEnd) * 100.0f;
+    nResult->fEasting = fScale * (SinTenths(nStartAzimuth - nDesiredAzimuth) * fCosStart
+                                + SinTenths(nEndAzimuth - nDesiredAzimuth) * fCosEnd) * 10.0f;
+    nResult->fDepth = fScale * (CosTenths(nStartAzimuth - nDesiredAzimuth) * fCosStart
+                              + CosTenths(nEndAzimuth - nDesiredAzimuth) * fCosEnd) * 100.0f;
+    if(nResult->fDepth < 0.0f)
+    {
+        nResult->fDepth = 0.0f;
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+/*******************************************************************************
+*       @brief      This module measures the execution time of selected code
+*                   paths using the Cortex-M4 DWT cycle counter, so timing
+*                   questions can be answered from a debugger watch window
+*                   instead of a scope.
+*       @file       Uphole/src/Profile.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stm32f4xx.h>
+#include <string.h>
+#include "portable.h"
+#include "Profile.h"
+
+#if PROFILE_ENABLED
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// Put m_ProfileStats in a Live Watch window to read the results.
+PROFILE_STATS m_ProfileStats[PROFILE_MAX];
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PROFILE_Init()
+;
+; Description:
+;   Enables the DWT cycle counter and clears all probe statistics.
+;
+; Reentrancy:
+;   No
+;
+; Assumptions:
+;   This function is called only on reboot or power-up.
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void PROFILE_Init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	PROFILE_Reset();
+}// End PROFILE_Init()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void PROFILE_Reset(void)
+{
+	U_BYTE nProbe;
+
+	memset(m_ProfileStats, 0, sizeof(m_ProfileStats));
+	for (nProbe = 0; nProbe < PROFILE_MAX; nProbe++)
+	{
+		m_ProfileStats[nProbe].nMinCycles = 0xFFFFFFFF;
+	}
+}// End PROFILE_Reset()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void PROFILE_Start(PROFILE_PROBE nProbe)
+{
+	if (nProbe < PROFILE_MAX)
+	{
+		m_ProfileStats[nProbe].nStartCycles = DWT->CYCCNT;
+	}
+}// End PROFILE_Start()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PROFILE_Stop()
+;
+; Description:
+;   Closes the pass opened by PROFILE_Start() and folds its length into the
+;   probe statistics.  The 32 bit counter wraps every ~25 s at 168 MHz, the
+;   unsigned subtraction handles a single wrap correctly.
+;
+; Parameters:
+;   PROFILE_PROBE nProbe => the probe being closed
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void PROFILE_Stop(PROFILE_PROBE nProbe)
+{
+	PROFILE_STATS *pStats;
+	U_INT32 nCycles;
+
+	if (nProbe >= PROFILE_MAX)
+	{
+		return;
+	}
+	pStats = &m_ProfileStats[nProbe];
+	nCycles = DWT->CYCCNT - pStats->nStartCycles;
+	pStats->nLastCycles = nCycles;
+	pStats->nTotalCycles += nCycles;
+	pStats->nCount++;
+	if (nCycles < pStats->nMinCycles)
+	{
+		pStats->nMinCycles = nCycles;
+	}
+	if (nCycles > pStats->nMaxCycles)
+	{
+		pStats->nMaxCycles = nCycles;
+	}
+}// End PROFILE_Stop()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const PROFILE_STATS* PROFILE_GetStats(PROFILE_PROBE nProbe)
+{
+	if (nProbe < PROFILE_MAX)
+	{
+		return &m_ProfileStats[nProbe];
+	}
+	return NULL;
+}// End PROFILE_GetStats()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_INT32 PROFILE_CyclesToMicroseconds(U_INT32 nCycles)
+{
+	return nCycles / (SystemCoreClock / 1000000);
+}// End PROFILE_CyclesToMicroseconds()
+
+#endif // PROFILE_ENABLED
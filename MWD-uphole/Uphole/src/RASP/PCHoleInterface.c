@@ -41,10 +41,10 @@
 ///@brief
 const CMD_VALIDATION g_pcCmdValidation[] =
 {
-    { 0xFF, NULL },                       // ??
-    { 0xFF, NULL },                       // QUERY_HOLE
-    { 0xFF, NULL },                       // QUERY_RAW_RECORD
-    { 0xFF, NULL },                       // QUERY_PROCESSED_RECORD
+    { 0xFF, NULL, 0 },                    // ??
+    { 0xFF, NULL, 8 },                    // QUERY_HOLE
+    { 0xFF, NULL, 10 },                   // QUERY_RAW_RECORD
+    { 0xFF, NULL, 56 },                   // QUERY_PROCESSED_RECORD
 };
 
 //============================================================================//
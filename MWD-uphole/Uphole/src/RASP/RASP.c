@@ -13,6 +13,7 @@
 //      INCLUDES                                                              //
 //============================================================================//
 
+#include <stm32f4xx.h>
 #include <string.h>
 #include "portable.h"
 #include "CommDriver_UART.h"
@@ -21,7 +22,7 @@
 #include "crc.h"
 #include "RASP.h"
 #include "SysTick.h"
-#include "Timer.h"
+#include "timer.h"
 #include "intf0001.h"
 #include "intf0002.h"
 #include "intf0003.h"
@@ -29,6 +30,7 @@
 #include "PCHoleInterface.h"
 #include "intf0007.h"
 #include "intf0008.h"
+#include "Profile.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -42,6 +44,13 @@
 
 #define TX_MARKER_LEN 2
 
+// Replies waiting for room in the UART or modem.  Each slot holds one whole
+// escaped frame: three markers, every header and data byte doubled in the
+// worst case, and the checksum.
+#define RASP_TX_QUEUE_SIZE 4
+#define RASP_TX_FRAME_SIZE ((3 * TX_MARKER_LEN) + \
+	(2 * (RASP_TAGGED_HEADER_LEN + MSG_BUF_LEN)) + sizeof(U_INT32))
+
 // define the interface 0 command IDs
 #define QUERY_INTERFACES 0
 #define GET_DEV_TYPE 1
@@ -50,6 +59,9 @@
 #define IID_HIGH_BYTE_POS 0     // the high byte position of the interface ID
 #define IID_LOW_BYTE_POS  1     // the low byte position of the interface ID
 
+// Statistics are kept for command IDs below this on every interface
+#define RASP_CMDS_PER_INTERFACE 8
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
@@ -72,15 +84,29 @@ typedef enum
     IN_CRC
 }RECEIVE_STATE;
 
-typedef enum
+typedef struct
+{
+	UART_CLIENT eClient;                    // where the frame goes
+	U_INT16     nLength;                    // bytes in nFrame
+	U_BYTE      nFrame[RASP_TX_FRAME_SIZE]; // escaped frame, ready to send
+}RASP_TX_FRAME;
+
+typedef struct
+{
+	U_INT32 nQueued;                        // frames built
+	U_INT32 nDropped;                       // frames lost to a full queue
+	U_INT32 nDeferred;                      // times the UART or modem was busy
+	U_BYTE  nMaxDepth;                      // most frames waiting at once
+}RASP_TX_STATS;
+
+typedef struct
 {
-    TX_START_HEADER,
-    TX_HEADER,
-    TX_START_DATA,
-    TX_DATA,
-    TX_END_DATA,
-    TX_CRC,
-}TRANSMIT_STATE;
+	U_INT32 nCalls;                         // times the handler was called
+	U_INT32 nRejected;                      // requests refused before the handler
+	U_INT32 nOversizeReplies;               // replies longer than nMaxReplySize
+	U_INT32 nMaxCycles;                     // longest handler call
+	U_INT64 nTotalCycles;                   // time spent in the handler
+}RASP_CMD_STATS;
 
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
@@ -88,11 +114,11 @@ typedef enum
 
 static void   parseRASPSession(void);
 static void   interface0000Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
-static U_BYTE serviceTxRASP(void);
 static void resetReceiveSM(void);
 static void resetTransmitSM(void);
-static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, const U_BYTE *pData, U_INT16 nDataLen);
-static void callbackTxRASP(UART_CLIENT client);
+static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, U_BYTE nHeaderLen, const U_BYTE *pData, U_INT16 nDataLen);
+static U_INT16 escapeSpan(U_BYTE *pOut, const U_BYTE *pIn, U_INT16 nLength);
+static void serviceTxQueue(void);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -102,8 +128,8 @@ static void callbackTxRASP(UART_CLIENT client);
 // generic RASP code
 static const CMD_VALIDATION g_aCmdVal0000[] =
 {
-    {0, NULL},                             // Query Interfaces
-    {0, NULL}                              // Get Device Type
+    {0, NULL, 0},                          // Query Interfaces
+    {0, NULL, 0}                           // Get Device Type
 };
 
 //****************************************************************************
@@ -116,6 +142,8 @@ static const CMD_VALIDATION g_aCmdVal0000[] =
 //    1. Each interface should have its command IDs starting at 0 and incrementing
 //       sequentially by one.  If this is violated, the checking of the command
 //       ID done here will not work properly.
+//    2. The table is indexed by interface ID, so row N must be interface N.
+//       Fill gaps with a row that has no handler.
 //
 //****************************************************************************
 ///@brief
@@ -134,6 +162,7 @@ static const INTERFACE Interfaces[] =  /*lint -e(605) */
 	{0x04, Interface0004Handler, NULL,              g_aCmdVal0004,  0x4},
 // Sensor Calibration Interface
 	//{0x05, CalibrationInterface, NULL,                   NULL,  0xFF},
+	{0x05, NULL,                 NULL,              NULL,           0x0},
 // PC Hole Interface
 	{0x06, PCHoleInterface,      NULL,           g_pcCmdValidation,  0x3},
 // Send diagnostic info to downhole
@@ -143,6 +172,17 @@ static const INTERFACE Interfaces[] =  /*lint -e(605) */
 };
 #define MAX_NUM_INTERFACES (sizeof(Interfaces)/sizeof(INTERFACE))
 
+///@brief  Live watch counters for each command, indexed by interface ID and
+///        command ID.  Cycle counts need PROFILE_ENABLED.
+RASP_CMD_STATS m_RaspCmdStats[MAX_NUM_INTERFACES][RASP_CMDS_PER_INTERFACE];
+
+///@brief  Requests for an interface or command that does not exist.
+U_INT32 m_nRaspUnknownCmds;
+
+// The command whose handler is running, for checking the reply length
+static const CMD_VALIDATION *m_pReplyCmd;
+static RASP_CMD_STATS *m_pReplyStats;
+
 //
 // The RASP manager function pointer detemines which function will be executed
 // by the main loop cycle handler to perform RASP processing.  Normally this
@@ -157,8 +197,9 @@ static struct {
 	BOOL          bRxDLE;
 	BOOL          bDisableDLEDetect;
 	BOOL          bResetReceiveSMArmed;
-	U_BYTE        nHeader[RASP_HEADER_LEN];
+	U_BYTE        nHeader[RASP_TAGGED_HEADER_LEN];
 	U_BYTE        nHeaderLen;
+	U_BYTE        nReplyHeaderLen;
 	U_BYTE        nData[MSG_BUF_LEN];
 	U_BYTE        nDataLen;
 	U_BYTE        nCrcIndex;
@@ -170,23 +211,16 @@ static struct {
 	RECEIVE_STATE eRxState;
 }m_CommSessionRx;
 static struct {
-	BOOL           bTxInProgress;
-	BOOL           bTxMsgComplete;
-	U_BYTE         nStartHeader[TX_MARKER_LEN];
-	U_BYTE         nHeader[RASP_HEADER_LEN];
-	U_BYTE         nHeaderLen;
-	U_BYTE         nStartData[TX_MARKER_LEN];
-	U_BYTE         nData[MSG_BUF_LEN];
-	U_BYTE         nDataLen;
-	U_BYTE         nEndData[TX_MARKER_LEN];
-	U_BYTE         nBuffer[UART_BUFFER_SIZE_TX];
-	union
-	{
-		U_INT32 asWord;
-		U_BYTE  asBytes[4];
-	}              checksum;
-	TRANSMIT_STATE eTxState;
+	RASP_TX_FRAME  Frames[RASP_TX_QUEUE_SIZE];
+	U_BYTE         nHead;
+	U_BYTE         nCount;
 }m_CommSessionTx;
+static const U_BYTE m_nStartHeader[TX_MARKER_LEN] = {DLE, SOH};
+static const U_BYTE m_nStartData[TX_MARKER_LEN] = {DLE, STX};
+static const U_BYTE m_nEndData[TX_MARKER_LEN] = {DLE, ETX};
+
+///@brief  Live watch counters for the RASP reply queue.
+RASP_TX_STATS m_RaspTxStats;
 //static RASP_CALLBACK_TX m_pfCallbackTx;
 
 //============================================================================//
@@ -213,12 +247,7 @@ void InitRASP(void)
 //	m_pfCallbackTx = NULL;
 	resetReceiveSM();
 	resetTransmitSM();
-	m_CommSessionTx.nStartHeader[0] = DLE;
-	m_CommSessionTx.nStartHeader[1] = SOH;
-	m_CommSessionTx.nStartData[0] = DLE;
-	m_CommSessionTx.nStartData[1] = STX;
-	m_CommSessionTx.nEndData[0] = DLE;
-	m_CommSessionTx.nEndData[1] = ETX;
+	m_CommSessionRx.nReplyHeaderLen = RASP_HEADER_LEN;
 }// End InitRASP()
 
 /*******************************************************************************
@@ -250,16 +279,16 @@ static void resetReceiveSM(void)
 ;   resetTransmitSM()
 ;
 ; Description:
-;   Resets the parameters used for transmitting a RASP reply or message.
+;   Throws away any RASP replies or messages still waiting to be sent.
+;   Frames already handed to the UART or modem are not affected.
 ;
 ; Reentrancy:
 ;   No
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 static void resetTransmitSM(void)
 {
-	m_CommSessionTx.bTxInProgress = FALSE;
-	m_CommSessionTx.bTxMsgComplete = FALSE;
-	m_CommSessionTx.eTxState = TX_START_HEADER;
+	m_CommSessionTx.nHead = 0;
+	m_CommSessionTx.nCount = 0;
 }// End resetTransmitSM()
 
 /*******************************************************************************
@@ -271,7 +300,7 @@ static void resetTransmitSM(void)
 ;
 ; Description:
 ;   The receive state machine is reset only after the entire reply has been
-;   sent. The state machine must be reset only if a reply is being sent and
+;   queued. The state machine must be reset only if a reply is being sent and
 ;   not if a real-time data point is being sent.
 ;
 ;   These two conditions are differentiated using this call.
@@ -344,9 +373,11 @@ void RASPManager(void)
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void ProcessRASP(void)
 {
-	// Do not attempt to process a message if a previous transmission is still
-	// in progress.  Just return and try again next cycle.
-	if (m_CommSessionTx.bTxInProgress)
+	serviceTxQueue();
+	// Do not attempt to process a message unless there is room to queue its
+	// reply.  Just return and try again next cycle; the request stays in the
+	// receive buffer and further requests stay in the UART.
+	if (m_CommSessionTx.nCount >= RASP_TX_QUEUE_SIZE)
 	{
 		return;
 	}
@@ -355,19 +386,17 @@ void ProcessRASP(void)
 	{
 		m_CommSessionRx.bMsgComplete = FALSE;
 		parseRASPSession();
-		if (m_CommSessionTx.bTxInProgress)
+		if (m_pfRASPProcess == ProcessRASP)
 		{
-			// The transmit interrupt handler will re-arm the Rx interrupt
-			// handler so that it can receive the next message only AFTER the
-			// current message has been completely transmitted.
-			ArmResetReceiveSMAfterTx();
+			// Any reply has already been queued whole, so the next request
+			// can be received straight away while the reply goes out.
+			resetReceiveSM();
 		}
-		else if (m_pfRASPProcess == ProcessRASP)
+		else
 		{
-			// Something went wrong, no reply was generated.
-			// Re-arm the Rx interrupt handler now so that we can continue to
-			// receive messages.
-			resetReceiveSM();
+			// The reply has been deferred.  Re-arm the receiver once it has
+			// been queued.
+			ArmResetReceiveSMAfterTx();
 		}
 	}
 }// End ProcessRASP()
@@ -384,20 +413,27 @@ void ProcessRASP(void)
 ;   calls a validation function, and finally calls the handler for the interface.
 ;   The handler for the interface is responsible for parsing the command ID
 ;   and dealing with the command.
-;   This function should return TRUE if the command was handled, FALSE
-;   otherwise.
+;
+;   The interface is found by indexing Interfaces[] with its ID and the
+;   command by indexing the interface's validation table with the command
+;   ID, so every request costs the same however many interfaces there are.
+;   Requests that fail any check never reach the handler and are counted in
+;   m_RaspCmdStats, or m_nRaspUnknownCmds when there is no such command.
 ;
 ; Reentrancy:
 ;   No
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 static void parseRASPSession(void)
 {
+	const INTERFACE *pInterface = NULL;
+	const CMD_VALIDATION *pCmd = NULL;
+	RASP_CMD_STATS *pStats = NULL;
 	U_INT16 nInterfaceID;
-	U_INT16 nIdx;
-	U_BYTE nExpectedSize;
 	U_BYTE nCmdID;
-	void (*pInf)(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen) = NULL;
-	BOOL (*pCmdValFunc)(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+	BOOL bValid = FALSE;
+#if PROFILE_ENABLED
+	U_INT32 nCycles;
+#endif
 
 	// process headers of 3 bytes OR MORE
 	// NOTE: this technique allows this machine to process messages that
@@ -417,84 +453,97 @@ static void parseRASPSession(void)
 		// get the command ID
 		nCmdID = m_CommSessionRx.nHeader[CMD_ID_POS];
 
-		// find the interface
-		for (nIdx = 0; nIdx < MAX_NUM_INTERFACES; nIdx++)
+		// replies echo the sequence tag, if the request carried one
+		m_CommSessionRx.nReplyHeaderLen =
+			(m_CommSessionRx.nHeaderLen >= RASP_TAGGED_HEADER_LEN) ?
+			RASP_TAGGED_HEADER_LEN : RASP_HEADER_LEN;
+
+		// find the interface and command
+		if (nInterfaceID < MAX_NUM_INTERFACES)
 		{
-			if (Interfaces[nIdx].nIID == nInterfaceID)
+			pInterface = &Interfaces[nInterfaceID];
+			if ((pInterface->pfInterfaceHandler == NULL) ||
+				(nCmdID > pInterface->nMaxCmdID))
 			{
-				// The interface has been found.
-				// If an interface validation function is provided, and all
-				// RASP interfaces are not available, then check that this
-				// interface is valid for current conditions.
-				if ((Interfaces[nIdx].pfInterfaceValid != NULL))//TODO && (!AllRASPAvailable()))
-				{
-					if (!Interfaces[nIdx].pfInterfaceValid())
-					{
-						break; // This interface is currently invalid.
-					}
-				}
-				// The interface is valid.
-				// Check that the cmd id is within the validation table range.
-				if (nCmdID > Interfaces[nIdx].nMaxCmdID)
-				{
-					break; // This command is invalid.
-				}
-				pInf = Interfaces[nIdx].pfInterfaceHandler;
-				break; // A valid interface has been found.
+				pInterface = NULL;
 			}
 		}
-
-		// if a valid interface was found, do a couple of checks and call the handler
-		if (pInf != NULL)
+		if (pInterface != NULL)
 		{
-			// check the data length; an 0xFF in the table means not to check the length
-			// because it's variable
-			// A valid interface was found before nIdx reached MAX_NUM_INTERFACES,
-			// so it is safe to suppress lint warning 661.
-			nExpectedSize = 0xFF;
-			if (Interfaces[nIdx].pCmdValidation)
+			if (nCmdID < RASP_CMDS_PER_INTERFACE)
 			{
-				nExpectedSize =
-				Interfaces[nIdx].pCmdValidation[nCmdID].nExpectedDataSize;//lint !e661
+				pStats = &m_RaspCmdStats[nInterfaceID][nCmdID];
 			}
-			if ((nExpectedSize != 0xFF) &&
-				(m_CommSessionRx.nDataLen != nExpectedSize))
+			if (pInterface->pCmdValidation != NULL)
 			{
-				//TODO Tell the Application;
+				pCmd = &pInterface->pCmdValidation[nCmdID];
 			}
-			else
+			bValid = TRUE;
+			// If an interface validation function is provided, and all
+			// RASP interfaces are not available, then check that this
+			// interface is valid for current conditions.
+			if ((pInterface->pfInterfaceValid != NULL))//TODO && (!AllRASPAvailable()))
 			{
-				pCmdValFunc = NULL;
-				if (Interfaces[nIdx].pCmdValidation)
+				if (!pInterface->pfInterfaceValid())
 				{
-					// now call the command validation function if it exists
-					// A valid interface was found before nIdx reached MAX_NUM_INTERFACES,
-					// so it is safe to suppress lint warning 661.
-					pCmdValFunc = Interfaces[nIdx].pCmdValidation[nCmdID].pCmdValidationFunction; //lint !e661
+					bValid = FALSE; // This interface is currently invalid.
 				}
-				if (pCmdValFunc != NULL)
+			}
+			if (bValid && (pCmd != NULL))
+			{
+				// check the data length; an 0xFF in the table means not to
+				// check the length because it's variable
+				if ((pCmd->nExpectedDataSize != 0xFF) &&
+					(m_CommSessionRx.nDataLen != pCmd->nExpectedDataSize))
 				{
-					if (pCmdValFunc(m_CommSessionRx.nHeader,
+					bValid = FALSE;
+				}
+				// now call the command validation function if it exists
+				else if ((pCmd->pCmdValidationFunction != NULL) &&
+					!pCmd->pCmdValidationFunction(m_CommSessionRx.nHeader,
 						m_CommSessionRx.nData,
 						m_CommSessionRx.nDataLen))
-					{
-						pInf(m_CommSessionRx.nHeader,
-						m_CommSessionRx.nData,
-						m_CommSessionRx.nDataLen);
-					}
-				}
-				else
 				{
-					// just call the handler since there is no command validation function
-					pInf(m_CommSessionRx.nHeader,
-					m_CommSessionRx.nData,
-					m_CommSessionRx.nDataLen);
+					bValid = FALSE;
 				}
 			}
 		}
 		else
+		{
+			m_nRaspUnknownCmds++;
+		}
+
+		if (bValid)
+		{
+			m_pReplyCmd = pCmd;
+			m_pReplyStats = pStats;
+#if PROFILE_ENABLED
+			nCycles = DWT->CYCCNT;
+#endif
+			pInterface->pfInterfaceHandler(m_CommSessionRx.nHeader,
+				m_CommSessionRx.nData,
+				m_CommSessionRx.nDataLen);
+#if PROFILE_ENABLED
+			nCycles = DWT->CYCCNT - nCycles;
+#endif
+			m_pReplyCmd = NULL;
+			m_pReplyStats = NULL;
+			if (pStats != NULL)
+			{
+				pStats->nCalls++;
+#if PROFILE_ENABLED
+				pStats->nTotalCycles += nCycles;
+				if (nCycles > pStats->nMaxCycles)
+				{
+					pStats->nMaxCycles = nCycles;
+				}
+#endif
+			}
+		}
+		else if (pStats != NULL)
 		{
 			//TODO Tell the Application;
+			pStats->nRejected++;
 		}
 		m_CommSessionRx.nHeaderLen = 0;
 		m_CommSessionRx.nDataLen = 0;
@@ -579,6 +628,11 @@ void ServiceRxRASP(U_BYTE nRxChar)
 				{
 					if (m_CommSessionRx.nHeaderLen > 0)
 					{
+						if (m_CommSessionRx.nHeaderLen <= RASP_TAGGED_HEADER_LEN)
+						{
+							CRC_CalculateOnSpan(&m_CommSessionRx.checksum.asWord,
+								m_CommSessionRx.nHeader, m_CommSessionRx.nHeaderLen);
+						}
 						m_CommSessionRx.nDataLen = 0;
 						m_CommSessionRx.eRxState = IN_BODY;
 					}
@@ -591,19 +645,31 @@ void ServiceRxRASP(U_BYTE nRxChar)
 				{
 					// Only save the portion of the header we support, but
 					// checksum all header characters since the sender will have
-					// included them in its calculation.
-					if (m_CommSessionRx.nHeaderLen < RASP_HEADER_LEN)
+					// included them in its calculation.  The saved portion is
+					// checksummed in one go, when the header ends or the first
+					// extra character arrives.
+					if (m_CommSessionRx.nHeaderLen < RASP_TAGGED_HEADER_LEN)
 					{
 						m_CommSessionRx.nHeader[m_CommSessionRx.nHeaderLen] = nRxChar;
 					}
+					else
+					{
+						if (m_CommSessionRx.nHeaderLen == RASP_TAGGED_HEADER_LEN)
+						{
+							CRC_CalculateOnSpan(&m_CommSessionRx.checksum.asWord,
+								m_CommSessionRx.nHeader, RASP_TAGGED_HEADER_LEN);
+						}
+						CRC_CalculateOnByte(&m_CommSessionRx.checksum.asWord, nRxChar);
+					}
 					m_CommSessionRx.nHeaderLen++;
-					CRC_CalculateOnByte(&m_CommSessionRx.checksum.asWord, nRxChar);
 				}
 				break;
 			case IN_BODY:
 				if (bGotDLE_ETX)
 				{
-					// At the end of the frame
+					// At the end of the frame, checksum the whole body at once
+					CRC_CalculateOnSpan(&m_CommSessionRx.checksum.asWord,
+						m_CommSessionRx.nData, m_CommSessionRx.nDataLen);
 					m_CommSessionRx.eRxState = IN_CRC;
 					m_CommSessionRx.nCrcIndex = 0;
 					m_CommSessionRx.bDisableDLEDetect = TRUE;
@@ -617,7 +683,6 @@ void ServiceRxRASP(U_BYTE nRxChar)
 						((m_CommSessionRx.nDataLen + m_CommSessionRx.nHeaderLen) < MAX_RASP_LENGTH))
 					{
 						m_CommSessionRx.nData[m_CommSessionRx.nDataLen++] = nRxChar;
-						CRC_CalculateOnByte(&m_CommSessionRx.checksum.asWord, nRxChar);
 					}
 					else
 					{
@@ -630,7 +695,7 @@ void ServiceRxRASP(U_BYTE nRxChar)
 			case IN_CRC:
 				if (m_CommSessionRx.checksum.asBytes[m_CommSessionRx.nCrcIndex++] == nRxChar)
 				{
-					if(m_CommSessionRx.nCrcIndex >= sizeof(m_CommSessionRx.checksum.asWord))
+					if(m_CommSessionRx.nCrcIndex >= sizeof(m_CommSessionRx.checksum.asBytes))
 					{
 						m_CommSessionRx.bMsgComplete = TRUE;
 						m_CommSessionRx.eRxState = LOOKING_FOR_START;
@@ -653,6 +718,49 @@ void ServiceRxRASP(U_BYTE nRxChar)
 	}
 }// End ServiceRxRASP()
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ServiceRxRASPSpan()
+;
+; Description:
+;   Runs a span of received characters through the receive state machine,
+;   stopping once a complete message is waiting to be processed.  Whatever
+;   is left over is the start of the next request; leave it in the UART
+;   buffer and offer it again once ProcessRASP() has dealt with the current
+;   one.  This lets the PC send several requests without waiting for each
+;   reply.
+;
+; Parameters:
+;   const U_BYTE *pData => the characters received
+;   U_INT16 nLength => number of characters
+;
+; Returns:
+;   U_INT16 => characters used, release these from the UART
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+U_INT16 ServiceRxRASPSpan(const U_BYTE *pData, U_INT16 nLength)
+{
+	U_INT16 nUsed = 0;
+
+	while (nUsed < nLength)
+	{
+		// A complete message leaves the receiver looking for a start with
+		// DLE detection off until resetReceiveSM() re-arms it.
+		if ((m_CommSessionRx.eRxState == LOOKING_FOR_START) &&
+			m_CommSessionRx.bDisableDLEDetect)
+		{
+			break;
+		}
+		ServiceRxRASP(pData[nUsed++]);
+	}
+	return nUsed;
+}// End ServiceRxRASPSpan()
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -690,7 +798,7 @@ void RASPRequest(RASP_INTERFACE nInterfaceID, const U_BYTE nCommandID, const U_B
 
 	if (nDataLen < MSG_BUF_LEN)
 	{
-		sendMessage(CLIENT_DATA_LINK, nHeader, pData, nDataLen);
+		sendMessage(CLIENT_DATA_LINK, nHeader, RASP_HEADER_LEN, pData, nDataLen);
 	}
 }// End RASPRequest()
 
@@ -699,9 +807,24 @@ void RASPRequest(RASP_INTERFACE nInterfaceID, const U_BYTE nCommandID, const U_B
 *******************************************************************************/
 void RASPReply(const U_BYTE *pHeader, U_BYTE nRespCode, const U_BYTE *pData, U_INT16 nDataLen)
 {
+	U_BYTE nHeaderLen = RASP_HEADER_LEN;
+
+	// A reply to the received header carries back its sequence tag
+	if (pHeader == m_CommSessionRx.nHeader)
+	{
+		nHeaderLen = m_CommSessionRx.nReplyHeaderLen;
+	}
+	// A reply longer than the command table says means the table or the
+	// handler is wrong; send it anyway, but count it
+	if ((m_pReplyCmd != NULL) && (m_pReplyStats != NULL) &&
+		(m_pReplyCmd->nMaxReplySize != 0xFF) &&
+		(nDataLen > m_pReplyCmd->nMaxReplySize))
+	{
+		m_pReplyStats->nOversizeReplies++;
+	}
 	if (nDataLen < MSG_BUF_LEN)
 	{
-		sendMessage(CLIENT_PC_COMM, pHeader, pData, nDataLen);
+		sendMessage(CLIENT_PC_COMM, pHeader, nHeaderLen, pData, nDataLen);
 	}
 }
 
@@ -721,28 +844,28 @@ void RASPReplyNoError(const U_BYTE *pHeader, const U_BYTE *pData, U_INT16 nDataL
 ;   sendMessage()
 ;
 ; Description:
-;   Builds a complete RASP message and configures the message to be sent
-;   through the UART.
+;   Builds a complete RASP message, escaped and checksummed, in the next free
+;   slot of the reply queue and starts sending it if the UART or modem has
+;   room.  The message is dropped if the queue is full.
 ;
 ; Parameters:
+;   UART_CLIENT client => where the message goes
 ;   const U_BYTE *pHeader => pointer to the RASP message header
 ;   U_BYTE nHeaderLen => number of non-framing characters in header
-;   U_BYTE nResponseCode => RASP reply code to be sent
 ;   const U_BYTE *pData => pointer to the RASP message data
 ;   U_INT16 nDataLen => number of non-framing characters in data
 ;
 ; Reentrancy:
 ;   No
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, const U_BYTE *pData, U_INT16 nDataLen)
+static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, U_BYTE nHeaderLen, const U_BYTE *pData, U_INT16 nDataLen)
 {
-	// Do not start a transmission when one is already in progress
-	if (m_CommSessionTx.bTxInProgress)
-	{
-		return;
-	}
+	RASP_TX_FRAME *pFrame;
+	U_INT32 nCRC;
+	U_INT16 nLength;
+
 	// Header must be valid, but data can be NULL
-	if (pHeader == NULL)
+	if ((pHeader == NULL) || (nHeaderLen > RASP_TAGGED_HEADER_LEN))
 	{
 		return;
 	}
@@ -751,18 +874,51 @@ static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, const U_BYTE
 	{
 		return;
 	}
-	// Create a persistent copy of the header and the header length
-	(void)memcpy(&m_CommSessionTx.nHeader[0], pHeader, RASP_HEADER_LEN);
-	m_CommSessionTx.nHeaderLen = RASP_HEADER_LEN;
-	// Create a persistent copy of the data and its length (plus response code)
-	if(pData != NULL)
+	if (pData == NULL)
 	{
-		(void)memcpy(&m_CommSessionTx.nData[0], pData, nDataLen);
+		nDataLen = 0;
+	}
+	if (m_CommSessionTx.nCount >= RASP_TX_QUEUE_SIZE)
+	{
+		m_RaspTxStats.nDropped++;
+		return;
 	}
-	m_CommSessionTx.nDataLen = nDataLen;
-	// Start transmitting by invoking the transmit RASP callback
-	m_CommSessionTx.bTxInProgress = TRUE;
-	callbackTxRASP(client);
+	pFrame = &m_CommSessionTx.Frames[(m_CommSessionTx.nHead + m_CommSessionTx.nCount) % RASP_TX_QUEUE_SIZE];
+	pFrame->eClient = client;
+
+	// The checksum covers the unescaped header and data
+	ResetCRC(&nCRC);
+	CRC_CalculateOnSpan(&nCRC, pHeader, nHeaderLen);
+	CRC_CalculateOnSpan(&nCRC, pData, nDataLen);
+
+	(void)memcpy(&pFrame->nFrame[0], m_nStartHeader, TX_MARKER_LEN);
+	nLength = TX_MARKER_LEN;
+	nLength += escapeSpan(&pFrame->nFrame[nLength], pHeader, nHeaderLen);
+	(void)memcpy(&pFrame->nFrame[nLength], m_nStartData, TX_MARKER_LEN);
+	nLength += TX_MARKER_LEN;
+	nLength += escapeSpan(&pFrame->nFrame[nLength], pData, nDataLen);
+	(void)memcpy(&pFrame->nFrame[nLength], m_nEndData, TX_MARKER_LEN);
+	nLength += TX_MARKER_LEN;
+	// The receiver stops looking for DLEs after the end marker, so the
+	// checksum goes out as is.
+	(void)memcpy(&pFrame->nFrame[nLength], &nCRC, sizeof(nCRC));
+	nLength += sizeof(nCRC);
+	pFrame->nLength = nLength;
+
+	m_CommSessionTx.nCount++;
+	m_RaspTxStats.nQueued++;
+	if (m_CommSessionTx.nCount > m_RaspTxStats.nMaxDepth)
+	{
+		m_RaspTxStats.nMaxDepth = m_CommSessionTx.nCount;
+	}
+	if (m_CommSessionRx.bResetReceiveSMArmed)
+	{
+		// Only reset the receive state machine if the queued message is the
+		// deferred reply to a received message
+		resetReceiveSM();
+		m_CommSessionRx.bResetReceiveSMArmed = FALSE;
+	}
+	serviceTxQueue();
 }// End sendMessage()
 
 /*******************************************************************************
@@ -770,176 +926,88 @@ static void sendMessage(UART_CLIENT client, const U_BYTE *pHeader, const U_BYTE
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   callbackTxRASP()
+;   escapeSpan()
 ;
 ; Description:
-;   Callback function executed when the current transmission is complete. A
-;   transmission may or may not be a complete RASP reply depending on the
-;   size of the reply. This callback function will handle sending of the
-;   next set of data if the current reply requires multiple transfers to
-;   fully complete.
+;   Copies header or data characters into a frame, doubling every DLE.
+;
+; Parameters:
+;   U_BYTE *pOut => where the escaped characters go, room for 2 * nLength
+;   const U_BYTE *pIn => the characters to send
+;   U_INT16 nLength => number of characters
+;
+; Returns:
+;   U_INT16 => number of characters written
 ;
 ; Reentrancy:
-;   No
+;   Yes
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-static void callbackTxRASP(UART_CLIENT client)
+static U_INT16 escapeSpan(U_BYTE *pOut, const U_BYTE *pIn, U_INT16 nLength)
 {
-	U_INT32 nIndex = 0;
-//	BOOL bSuccess = FALSE;
+	U_BYTE *pStart = pOut;
 
-	// Fill the buffer to be sent to the UART until the entire message has
-	// been processed or until the buffer is full.
-	while (!m_CommSessionTx.bTxMsgComplete && (nIndex < UART_BUFFER_SIZE_TX))
-	{
-		m_CommSessionTx.nBuffer[nIndex++] = serviceTxRASP();
-	}
-	if((GetModemIsPresent()) && (client == CLIENT_DATA_LINK))
+	while (nLength-- > 0)
 	{
-		Modem_MessageToSend(&m_CommSessionTx.nBuffer[0], nIndex);
-	}
-	else
-	{
-		UART_SendMessage(client, (const U_BYTE *)&m_CommSessionTx.nBuffer[0], nIndex, NULL, FALSE);
-	}
-	if(m_CommSessionTx.bTxMsgComplete)
-	//    if(bSuccess && (m_CommSessionTx.bTxMsgComplete))
-	{
-		m_CommSessionTx.bTxMsgComplete = FALSE;
-		if (m_CommSessionRx.bResetReceiveSMArmed)
+		if (*pIn == DLE)
 		{
-			// Only reset the receive state machine if the completed transmission
-			// was in response to a received message and wasn't a real-time
-			// transmission
-			resetReceiveSM();
-			m_CommSessionRx.bResetReceiveSMArmed = FALSE;
+			*pOut++ = DLE;
 		}
-		m_CommSessionTx.bTxInProgress = FALSE;
-		// If any additional post-processing has been requested after the reply
-		// has been sent, start it here.
-//		if (m_pfCallbackTx != NULL)
-//		{
-//			m_pfCallbackTx();
-//			m_pfCallbackTx = NULL;
-//		}
+		*pOut++ = *pIn++;
 	}
-}// End callbackTxRASP()
+	return (U_INT16)(pOut - pStart);
+}// End escapeSpan()
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 ; Function:
-;   serviceTxRASP()
+;   serviceTxQueue()
 ;
 ; Description:
-;   Executes the RASP transmit state machine and returns the next character
-;   to be transmitted.
+;   Hands queued frames, oldest first, to the UART or the modem until one
+;   of them has no room.  The UART copies the frame into its own transmit
+;   ring, so the slot is free again as soon as it is accepted.  Called
+;   whenever a frame is queued and from ProcessRASP() to retry frames that
+;   had to wait.
 ;
 ; Reentrancy:
 ;   No
 ;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
-U_BYTE serviceTxRASP(void)
+static void serviceTxQueue(void)
 {
-	static BOOL bFirstDLE = TRUE;
-	static U_INT16 nTxCounter = 0;
-	U_BYTE nTxChar = 0;
+	RASP_TX_FRAME *pFrame;
+	BOOL bSent;
 
-	m_CommSessionTx.bTxMsgComplete = FALSE;
-	switch (m_CommSessionTx.eTxState)
+	while (m_CommSessionTx.nCount > 0)
 	{
-		case TX_START_HEADER:
-			if (nTxCounter < TX_MARKER_LEN)
-			{
-				nTxChar = m_CommSessionTx.nStartHeader[nTxCounter++];
-				break;
-			}
-			else
-			{
-				nTxCounter = 0;
-				bFirstDLE = TRUE;
-				ResetCRC(&m_CommSessionTx.checksum.asWord);
-				m_CommSessionTx.eTxState = TX_HEADER;
-			}//lint -fallthrough
-		case TX_HEADER:
-			if (nTxCounter < m_CommSessionTx.nHeaderLen)
-			{
-				nTxChar = m_CommSessionTx.nHeader[nTxCounter];
-				if ((nTxChar == DLE) && bFirstDLE)
-				{
-					bFirstDLE = FALSE;
-				}
-				else
-				{
-					CRC_CalculateOnByte(&m_CommSessionTx.checksum.asWord, nTxChar);
-					bFirstDLE = TRUE;
-					nTxCounter++;
-				}
-				break;
-			}
-			else
-			{
-				nTxCounter = 0;
-				m_CommSessionTx.eTxState = TX_START_DATA;
-			}//lint -fallthrough
-		case TX_START_DATA:
-			if (nTxCounter < TX_MARKER_LEN)
-			{
-				nTxChar = m_CommSessionTx.nStartData[nTxCounter++];
-				break;
-			}
-			else
-			{
-				nTxCounter = 0;
-				bFirstDLE = TRUE;
-				m_CommSessionTx.eTxState = TX_DATA;
-			}//lint -fallthrough
-		case TX_DATA:
-			if (nTxCounter < m_CommSessionTx.nDataLen)
-			{
-				nTxChar = m_CommSessionTx.nData[nTxCounter];
-				if ((nTxChar == DLE) && bFirstDLE)
-				{
-					bFirstDLE = FALSE;
-				}
-				else
-				{
-					CRC_CalculateOnByte(&m_CommSessionTx.checksum.asWord, nTxChar);
-					bFirstDLE = TRUE;
-					nTxCounter++;
-				}
-				break;
-			}
-			else
-			{
-				nTxCounter = 0;
-				m_CommSessionTx.eTxState = TX_END_DATA;
-			}//lint -fallthrough
-		case TX_END_DATA:
-			if (nTxCounter < TX_MARKER_LEN)
+		pFrame = &m_CommSessionTx.Frames[m_CommSessionTx.nHead];
+		if ((GetModemIsPresent()) && (pFrame->eClient == CLIENT_DATA_LINK))
+		{
+			if (pFrame->nLength > MODEM_TX_MESSAGE_MAX)
 			{
-				nTxChar = m_CommSessionTx.nEndData[nTxCounter++];
-				break;
+				// Too big for a modem message, it would never go
+				m_RaspTxStats.nDropped++;
+				bSent = TRUE;
 			}
 			else
 			{
-				nTxCounter = 0;
-				bFirstDLE = TRUE;
-				m_CommSessionTx.eTxState = TX_CRC;
-			}//lint -fallthrough
-		case TX_CRC:
-			nTxChar = m_CommSessionTx.checksum.asBytes[nTxCounter++];
-			if(nTxCounter >= sizeof(m_CommSessionTx.checksum.asWord))
-			{
-				nTxCounter = 0;
-				m_CommSessionTx.bTxMsgComplete = TRUE;
-				m_CommSessionTx.eTxState = TX_START_HEADER;
+				bSent = Modem_MessageToSend(pFrame->nFrame, pFrame->nLength);
 			}
+		}
+		else
+		{
+			bSent = UART_SendMessage(pFrame->eClient, pFrame->nFrame, pFrame->nLength);
+		}
+		if (!bSent)
+		{
+			m_RaspTxStats.nDeferred++;
 			break;
-		default:
-			break;
+		}
+		m_CommSessionTx.nHead = (m_CommSessionTx.nHead + 1) % RASP_TX_QUEUE_SIZE;
+		m_CommSessionTx.nCount--;
 	}
-	return nTxChar;
-}// End serviceTxRASP()
+}// End serviceTxQueue()
 
 /*******************************************************************************
 *       @details
@@ -38,10 +38,10 @@
 ///@brief
 const CMD_VALIDATION g_aCmdVal0001[] =
 {
-    {0xFF, NULL},                          // GET_DEVICE_IDENTIFICATION
-    {0xFF, NULL},                          // SET_DEVICE_IDENTIFICATION
-    {1, NULL},                          // SET_PRODUCT_ID
-    {0, NULL},                          // GET_PRODUCT_ID
+    {0xFF, NULL, 0xFF},                    // GET_DEVICE_IDENTIFICATION
+    {0xFF, NULL, 1},                       // SET_DEVICE_IDENTIFICATION
+    {1, NULL, 0},                       // SET_PRODUCT_ID
+    {0, NULL, 0},                       // GET_PRODUCT_ID
 };
 
 //============================================================================//
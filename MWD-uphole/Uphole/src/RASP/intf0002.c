@@ -31,8 +31,8 @@
 ///@brief  
 const CMD_VALIDATION g_aCmdVal0002[] =
 {
-    {0, NULL},                          // Set RTC
-    {0, NULL},                          // Get RTC
+    {0, NULL, 0},                       // Set RTC
+    {0, NULL, 0},                       // Get RTC
 };
 
 //============================================================================//
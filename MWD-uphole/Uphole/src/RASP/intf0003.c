@@ -37,13 +37,13 @@
 ///@brief
 const CMD_VALIDATION g_aCmdVal0003[] =
 {
-	{ 0xFF, NULL },                       // GET_FULL_DATA_SET
-	{ 2, NULL },                          // GET_AZIMUTH_DATA
-	{ 2, NULL },                          // GET_PITCH_DATA
-	{ 2, NULL },                          // GET_ROLL_DATA
-	{ 2, NULL },                          // GET_TEMPERATURE_DATA
-	{ 2, NULL },                          // GET_GAMMA_DATA
-	{ 0xFF, NULL },                       // GET_SURVEY_DATA
+	{ 0xFF, NULL, 0 },                    // GET_FULL_DATA_SET
+	{ 2, NULL, 0 },                       // GET_AZIMUTH_DATA
+	{ 2, NULL, 0 },                       // GET_PITCH_DATA
+	{ 2, NULL, 0 },                       // GET_ROLL_DATA
+	{ 2, NULL, 0 },                       // GET_TEMPERATURE_DATA
+	{ 2, NULL, 0 },                       // GET_GAMMA_DATA
+	{ 0xFF, NULL, 0 },                    // GET_SURVEY_DATA
 };
 
 ///@brief
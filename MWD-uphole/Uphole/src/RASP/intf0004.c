@@ -45,11 +45,11 @@
 ///@brief
 const CMD_VALIDATION g_aCmdVal0004[] =
 {
-        { 0xFF, NULL },                       // INTF04_QUERY
-        { 0xFF, NULL },                          // START_HOLE
-        { 0xFF, NULL },                         // STOP_HOLE
-        { 10, NULL },                         // QUERY_HOLE
-        { 0xFF, NULL },                         // QUERY_RECORD
+        { 0xFF, NULL, 0 },                    // INTF04_QUERY
+        { 0xFF, NULL, 0 },                       // START_HOLE
+        { 0xFF, NULL, 0 },                      // STOP_HOLE
+        { 10, NULL, 0 },                      // QUERY_HOLE
+        { 0xFF, NULL, 0 },                      // QUERY_RECORD
 };
 
 //============================================================================//
@@ -44,7 +44,7 @@ TIME_LR tUpdateDownHoleSuccess = 0;
 ///@brief
 const CMD_VALIDATION g_diagCmdVal0007[] =
 {
-        { 0xFF, NULL },                       // UPDATE_DIAG_DATA_SET
+        { 0xFF, NULL, 0 },                    // UPDATE_DIAG_DATA_SET
 };
 
 //============================================================================//
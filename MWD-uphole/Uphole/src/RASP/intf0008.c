@@ -32,8 +32,8 @@
 ///@brief
 const CMD_VALIDATION g_statusCmdVal0008[] =
 {
-        { 0xFF, NULL },                       // DownHole ON
-        { 0xFF, NULL },                       // DownHole OFF
+        { 0xFF, NULL, 0 },                    // DownHole ON
+        { 0xFF, NULL, 0 },                    // DownHole OFF
 };
 
 //static U_INT16 ON_TIME = 0;
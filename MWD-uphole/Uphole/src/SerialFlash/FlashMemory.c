@@ -13,11 +13,14 @@
 //============================================================================//
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include "timer.h"
 #include "portable.h"
 #include "FlashMemory.h"
+#include "CommDriver_Flash.h"
 #include "CommDriver_SPI.h"
+#include "NVLog.h"
 #include "SysTick.h"
 
 //============================================================================//
@@ -138,6 +141,9 @@ volatile Flash_chip_type Serial_Flash_Chip;
 //volatile U_INT32 Total_heat_time_to_date;
 extern volatile U_INT16 NV_save_timer;
 
+// bytes of NVRAM_data kept in the settings log, the checksum is rebuilt
+#define NV_LOGGED_BYTES     offsetof(NVRAM_image, calculatedCrc)
+
 // slight delay padded between SPI edges for flash access
 #define slight_delay()	asm("nop");	asm("nop");	asm("nop");	asm("nop")
 
@@ -147,6 +153,8 @@ extern volatile U_INT16 NV_save_timer;
 
 static BOOL FLASH_WaitForReadyNow(TIME_LR milliseconds);
 static BOOL CalcCRC(U_BYTE *pData, U_INT16 nLength, U_INT32 *nResultCRC);
+static void QueueTheBlock(U_INT32 nPageNumber);
+static void BlockWriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus);
 
 /*******************************************************************************
 *       @details
@@ -202,10 +210,7 @@ BOOL FLASH_IsBusyNow(void)
 *******************************************************************************/
 static void SendBytes(U_BYTE* bytes, int len)
 {
-	for (int index = 0; index < len; index++)
-	{
-		SPI_TransferByte(bytes[index]);
-	}
+	(void)SPI_TransferBlock(bytes, NULL, (U_INT16)len);
 }
 
 /*******************************************************************************
@@ -238,11 +243,7 @@ static void SendCommand(U_BYTE command, U_INT16 pageNumber)
 *******************************************************************************/
 static void ReceiveBytes(U_BYTE* bytes, U_INT16 length)
 {
-	U_INT16 index;
-	for(index = 0; index < length; index++)
-	{
-		bytes[index] = SPI_TransferByte(0x00);
-	}
+	(void)SPI_TransferBlock(NULL, bytes, length);
 }
 
 /*******************************************************************************
@@ -273,6 +274,9 @@ void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber)
 {
 	if(page == NULL) return;
 	if(!IsValidPage(pageNumber)) return;
+	// a block still waiting in the write queue is newer than the array
+	if(FLASH_GetQueuedPage((FLASH_PAGE *)page, pageNumber)) return;
+	FLASH_WaitForReadyNow(TWENTY_FIVE_MILLI_SECONDS);
 	SPI_ResetTransferTimeOut();
 	SPI_ChipSelect(SPI_DEVICE_DATAFLASH, true);
 	SendCommand(SERFLASH45_READ_PAGE_OPCODE, pageNumber);
@@ -293,6 +297,8 @@ void FLASH_WriteThePage(U_BYTE *page, U_INT32 nPageNumber)
 	{
 		return;
 	}
+	// let queued writes go first, they were asked for first
+	FLASH_FlushWrites();
 	if (IsValidPage(nPageNumber))
 	{
 		memcpy(pageData, page, CHIP_PAGE_SIZE);
@@ -343,6 +349,32 @@ BOOL FLASH_WaitForReadyNow(TIME_LR milliseconds)
 	return true;
 }
 
+/*******************************************************************************
+*       @details
+*       Hands the block in Serflash_page_data to the flash write queue so
+*       the main loop keeps running while it is programmed.  Writes the old
+*       blocking way if the queue is full.
+*******************************************************************************/
+static void QueueTheBlock(U_INT32 nPageNumber)
+{
+	if(!FLASH_QueueWriteRaw((FLASH_PAGE *)Serflash_page_data, nPageNumber, BlockWriteDone))
+	{
+		FLASH_WriteThePage(Serflash_page_data, nPageNumber);
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void BlockWriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus)
+{
+	if(eStatus != FLASH_PAGE_GOOD)
+	{
+		// same as a timeout in FLASH_WriteThePage()
+		Serial_Flash_Chip.ext_flash_working = false;
+	}
+}
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -556,7 +588,14 @@ U_BYTE Serflash_read_NV_Block(void)
 	howmuch_data = sizeof(NVRAM_data);
 	// yikes, if NVRAM_data grows beyond a page we are not prepared for it.
 	if(sizeof(NVRAM_data) > Serial_Flash_Chip.page_size) return 0;
-	// go get all of our data from flash
+	// the newest copy in the settings log wins
+	if(NVLOG_Recover(Serial_Flash_Chip.NV_log_start_page, (U_BYTE *)&NVRAM_data, NV_LOGGED_BYTES))
+	{
+		FLASH_FixTheNVChecksum();
+		return 1;
+	}
+	// nothing logged yet, take the old fixed page; the first save copies
+	// it into the log
 	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
 	NV_data_pointer = (U_BYTE *)&NVRAM_data;
 	NV_storage_pointer = (U_BYTE *)&Serflash_page_data[0];
@@ -571,70 +610,28 @@ U_BYTE Serflash_read_NV_Block(void)
 
 /****************************************************************************
  * Function Name:   Serflash_check_NV_Block
- * Abstract:        Selectively checks for changed bytes and writes them to serial flash
+ * Abstract:        Selectively checks for changed bytes and appends them to
+ *                  the settings log on the serial flash
  ****************************************************************************/
 U_BYTE Serflash_check_NV_Block(void)
 {
-	U_BYTE     finished;
-	U_INT16    howmuch_data;
-	U_INT16    loopy;
-	U_BYTE     *NV_data_pointer;
-	U_BYTE     *NV_storage_pointer;
-
 	if(Serial_Flash_Chip.ext_flash_working == false)
 	{
 		return 0;
 	}
-	howmuch_data = sizeof(NVRAM_data);
-	// yikes, if NVRAM_data grows beyond a buffer page we are not prepared for it.
-	if(howmuch_data > Serial_Flash_Chip.page_size) return 0;
-	// we cannot do this too often, we will wear out the flash
+	// yikes, if NVRAM_data grows beyond what the log holds we are not prepared for it.
+	if(NV_LOGGED_BYTES > NVLOG_MAX_IMAGE) return 0;
+	// no need to look more often than this, a change usually comes in a burst
 	if (ElapsedTimeLowRes(g_tFlashIdleTimer) < (TEN_SECOND)) return 0;
 	// since we are doing it, clear the timer for next time
 	g_tFlashIdleTimer = ElapsedTimeLowRes((TIME_LR)0);
-	finished=true;
-	// run through NVRAM_data data, compare to what is in flash
-	// if a change, store the whole block to the flash.
-	// then leave and let the unit come around again.
-	// if we make it all the way through without writing a bit, we will flag a complete bit.
-	// pull the data into our buffer
-	FLASH_ReadThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
-	NV_data_pointer = (U_BYTE *)&NVRAM_data;
-	NV_storage_pointer = (U_BYTE *)&Serflash_page_data[0];
-	for(loopy=0; loopy < howmuch_data; loopy++)
-	{
-		if( *NV_data_pointer != *NV_storage_pointer )
-		{
-			finished=false;
-			// force exit of the loop
-			break;
-		}
-		NV_data_pointer++;
-		NV_storage_pointer++;
-	}
-	if(finished==false)
+	// only the bytes that differ from the logged copy are written, and the
+	// page is programmed from the 10 ms tick.  If the write queue is busy
+	// the unit comes around again next time; m_NVLogStats counts why.
+	FLASH_FixTheNVChecksum();
+	if(!NVLOG_Commit((const U_BYTE *)&NVRAM_data))
 	{
-		// new save, fix the checksum
-		FLASH_FixTheNVChecksum();
-		// erase the NV data page.. will erase one solid page.
-		ErasePage(Serial_Flash_Chip.NV_param_start_page);
-		// move the NV data into the page buffer
-		NV_data_pointer = (U_BYTE *)&NVRAM_data;
-		for(loopy=0; loopy<CHIP_PAGE_SIZE; loopy++)
-		{
-			if(loopy < howmuch_data)
-			{
-				Serflash_page_data[loopy] = *NV_data_pointer;
-			}
-			else
-			{
-				// anything past our data is zeroed
-				Serflash_page_data[loopy] = 0;
-			}
-			NV_data_pointer++;
-		}
-		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.NV_param_start_page);
+		return 0;
 	}
 	return 1;
 }
@@ -715,8 +712,6 @@ U_BYTE Serflash_check_Newhole_Block(void)
 	}
 	if(finished==false)
 	{
-		// erase the data page.. will erase one solid page.
-		ErasePage(Serial_Flash_Chip.Newhole_start_page);
 		// move the data into the page buffer
 		Data_pointer = (U_BYTE *)&newHole_tracker;
 		for(loopy=0; loopy<CHIP_PAGE_SIZE; loopy++)
@@ -731,8 +726,8 @@ U_BYTE Serflash_check_Newhole_Block(void)
 			}
 			Data_pointer++;
 		}
-		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Newhole_start_page);
+		// queue the page buffer for the flash, it erases the page first
+		QueueTheBlock(Serial_Flash_Chip.Newhole_start_page);
 	}
 	return 1;
 }
@@ -813,8 +808,6 @@ U_BYTE Serflash_check_Borehole_Block(void)
 	}
 	if(finished==false)
 	{
-		// erase the data page.. will erase one solid page.
-		ErasePage(Serial_Flash_Chip.Borehole_start_page);
 		// move the data into the page buffer
 		Data_pointer = (U_BYTE *)&boreholeStatistics;
 		for(loopy=0; loopy<CHIP_PAGE_SIZE; loopy++)
@@ -829,8 +822,8 @@ U_BYTE Serflash_check_Borehole_Block(void)
 			}
 			Data_pointer++;
 		}
-		// put the page buffer into flash
-		FLASH_WriteThePage(Serflash_page_data, Serial_Flash_Chip.Borehole_start_page);
+		// queue the page buffer for the flash, it erases the page first
+		QueueTheBlock(Serial_Flash_Chip.Borehole_start_page);
 	}
 	return 1;
 }
@@ -884,6 +877,14 @@ void Serflash_read_DID_data(void)
 		FLASH_DATA[Serial_Flash_Chip.part_index].num_pages;
 	U_INT32 partone = Serial_Flash_Chip.EVENTS_start_page;
 	Serial_Flash_Chip.EVENTS_pages_available -= partone;
+	// the settings log ring takes the top of the device
+	Serial_Flash_Chip.NV_log_start_page =
+		Serial_Flash_Chip.Max_pages_available - NVLOG_PAGES;
+	Serial_Flash_Chip.EVENTS_pages_available -= NVLOG_PAGES;
+	// and the survey journal sits just below it
+	Serial_Flash_Chip.Record_journal_start_page =
+		Serial_Flash_Chip.NV_log_start_page - RECORD_JOURNAL_PAGES;
+	Serial_Flash_Chip.EVENTS_pages_available -= RECORD_JOURNAL_PAGES;
 	g_tFlashIdleTimer = ElapsedTimeLowRes((TIME_LR)0);
 }
 
@@ -0,0 +1,418 @@
+/*******************************************************************************
+*       @brief      This module keeps the NV settings image as a log of CRC
+*                   checked records spread over a ring of serial flash pages,
+*                   so a settings change programs a few bytes instead of
+*                   erasing and rewriting the same page every time.
+*       @file       Uphole/src/SerialFlash/NVLog.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdbool.h>
+#include <string.h>
+#include "portable.h"
+#include "crc.h"
+#include "FlashMemory.h"
+#include "CommDriver_Flash.h"
+#include "NVLog.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define NVLOG_SNAPSHOT_MARKER   0x5AA5  // data is the whole image
+#define NVLOG_DELTA_MARKER      0x5AC3  // data is part of the image
+#define NVLOG_ERASED_MARKER     0xFFFF
+
+// Set in nFlags of every record of a save but the last, so a save torn
+// between its records is not half applied.
+#define NVLOG_MORE_RECORDS      0x0001
+
+// Changed bytes closer together than this go in one record, logging the
+// unchanged bytes between them is cheaper than another header and CRC.
+#define NVLOG_MERGE_GAP         16
+
+// The STM32 CRC unit works on whole words, so records are word aligned.
+#define NVLOG_ALIGN(n)          (((n) + 3) & ~3)
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// On the flash each record is the header, nLength data bytes padded with
+// 0xFF to a word, then the CRC of both.
+typedef struct
+{
+	U_INT16 nMarker;
+	U_INT16 nOffset;        // where the data goes in the image
+	U_INT16 nLength;        // data bytes
+	U_INT16 nFlags;
+	U_INT32 nSequence;      // one more than the record before it
+} NVLOG_RECORD_HEADER;
+
+#define NVLOG_RECORD_SIZE(len)  (sizeof(NVLOG_RECORD_HEADER) + NVLOG_ALIGN(len) + sizeof(U_INT32))
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// RAM copy of the ring page being appended to, words so the CRC unit and
+// the record headers are aligned.
+static U_INT32 m_nLogPage[FLASH_PAGE_SIZE / sizeof(U_INT32)];
+// The image as the log holds it, saves are compared against this.
+static U_BYTE m_nShadow[NVLOG_MAX_IMAGE];
+static U_INT16 m_nImageLength;
+static U_INT32 m_nFirstPage;
+static U_BYTE m_nPageIndex;
+static U_INT16 m_nWriteOffset;
+static U_INT32 m_nSequence;
+static BOOL m_bNeedSnapshot;
+static BOOL m_bReady = false;
+
+// Put m_NVLogStats in a Live Watch window to see the flash cost of saves.
+NVLOG_STATS m_NVLogStats;
+
+static U_INT16 nvlog_CheckRecord(U_INT16 nOffset);
+static BOOL nvlog_AppendRecord(U_INT16 nMarker, const U_BYTE *pImage, U_INT16 nOffset, U_INT16 nLength, U_INT16 nFlags);
+static void nvlog_StartPage(void);
+static void nvlog_WriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   NVLOG_Recover()
+;
+; Description:
+;   Finds the newest copy of the image in the ring.  The page whose opening
+;   snapshot has the highest sequence number is the newest page; its
+;   snapshot is applied, then each following record until one is erased,
+;   torn or out of sequence.  The records of a save only count once its
+;   last one is read, so a save cut short by a power loss leaves the image
+;   as it was before that save.  Appending carries on in the same page if
+;   the rest of it is still erased, otherwise the next save starts a new
+;   page.
+;
+; Parameters:
+;   U_INT32 nFirstPage => first flash page of the ring
+;   U_BYTE *pImage     => filled with the recovered image
+;   U_INT16 nLength    => bytes of the image kept in the log
+;
+; Returns:
+;   BOOL => false if the ring holds no valid snapshot; pImage is untouched
+;           and the next NVLOG_Commit() writes a snapshot of whatever the
+;           caller loads instead
+;
+; Reentrancy:
+;   No
+;
+; Assumptions:
+;   Called once at power up, before NVLOG_Commit().
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL NVLOG_Recover(U_INT32 nFirstPage, U_BYTE *pImage, U_INT16 nLength)
+{
+	NVLOG_RECORD_HEADER *pHeader = (NVLOG_RECORD_HEADER *)m_nLogPage;
+	U_BYTE *pPage = (U_BYTE *)m_nLogPage;
+	U_BYTE nPage, nNewest = 0;
+	U_INT32 nNewestSequence = 0;
+	BOOL bFound = false;
+	U_INT16 nOffset, nSize, nSaveEnd;
+
+	memset(&m_NVLogStats, 0, sizeof(m_NVLogStats));
+	m_nFirstPage = nFirstPage;
+	m_nImageLength = (nLength > NVLOG_MAX_IMAGE) ? NVLOG_MAX_IMAGE : nLength;
+	m_nPageIndex = NVLOG_PAGES - 1;
+	m_nWriteOffset = FLASH_PAGE_SIZE;
+	m_nSequence = 0;
+	m_bNeedSnapshot = true;
+	m_bReady = true;
+
+	for(nPage = 0; nPage < NVLOG_PAGES; nPage++)
+	{
+		FLASH_ReadThePage(pPage, m_nFirstPage + nPage);
+		if((nvlog_CheckRecord(0) != 0) && (pHeader->nMarker == NVLOG_SNAPSHOT_MARKER)
+			&& (!bFound || (pHeader->nSequence > nNewestSequence)))
+		{
+			nNewest = nPage;
+			nNewestSequence = pHeader->nSequence;
+			bFound = true;
+		}
+	}
+	if(!bFound)
+	{
+		return false;
+	}
+
+	// records are applied to m_nShadow, and pImage takes it at the end of
+	// each save
+	FLASH_ReadThePage(pPage, m_nFirstPage + nNewest);
+	memset(m_nShadow, 0, sizeof(m_nShadow));
+	nOffset = 0;
+	nSaveEnd = 0;
+	while(nOffset < FLASH_PAGE_SIZE)
+	{
+		pHeader = (NVLOG_RECORD_HEADER *)&pPage[nOffset];
+		if(pHeader->nMarker == NVLOG_ERASED_MARKER)
+		{
+			break;
+		}
+		nSize = nvlog_CheckRecord(nOffset);
+		if((nSize == 0) || ((nOffset != 0) && (pHeader->nSequence != (m_nSequence + 1))))
+		{
+			m_NVLogStats.nBadRecords++;
+			break;
+		}
+		memcpy(&m_nShadow[pHeader->nOffset], &pPage[nOffset + sizeof(NVLOG_RECORD_HEADER)], pHeader->nLength);
+		m_nSequence = pHeader->nSequence;
+		nOffset += nSize;
+		if((pHeader->nFlags & NVLOG_MORE_RECORDS) == 0)
+		{
+			memcpy(pImage, m_nShadow, m_nImageLength);
+			nSaveEnd = nOffset;
+		}
+	}
+	memcpy(m_nShadow, pImage, m_nImageLength);
+
+	// keep appending here only if nothing past the last whole save was
+	// touched, a torn record cannot be programmed over and the records of
+	// a torn save must not be finished by the next one.  Otherwise the next
+	// save starts a new page.
+	m_nPageIndex = nNewest;
+	m_nWriteOffset = nSaveEnd;
+	for(nSize = nSaveEnd; nSize < FLASH_PAGE_SIZE; nSize++)
+	{
+		if(pPage[nSize] != 0xFF)
+		{
+			m_nWriteOffset = FLASH_PAGE_SIZE;
+			break;
+		}
+	}
+
+	m_bNeedSnapshot = false;
+	m_NVLogStats.nRecoveredSequence = m_nSequence;
+	m_NVLogStats.nRecoveredPage = nNewest;
+	return true;
+}// End NVLOG_Recover()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   NVLOG_Commit()
+;
+; Description:
+;   Appends a record for each run of bytes that differs from the logged
+;   image and queues the page for programming without an erase.  When the
+;   records do not fit in the rest of the page, or the log has no snapshot
+;   yet, the next ring page is erased and started with a full snapshot
+;   instead.  The previous page is left intact until the ring comes round
+;   to it again, so a power loss during the erase loses nothing.
+;
+; Parameters:
+;   const U_BYTE *pImage => the image to save, the length given at recovery
+;
+; Returns:
+;   BOOL => true if the log now matches pImage, false if the save has to
+;           be tried again later
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL NVLOG_Commit(const U_BYTE *pImage)
+{
+	FLASH_PAGE *pPage = (FLASH_PAGE *)m_nLogPage;
+	U_INT16 nIndex, nRunStart, nRunEnd, nStartOffset;
+	U_INT16 nLastStart = 0, nLastLength = 0;
+	U_INT32 nStartSequence, nStartRecords;
+	BOOL bNewPage = false;
+	BOOL bQueued;
+
+	if(!m_bReady)
+	{
+		return false;
+	}
+	if(!m_bNeedSnapshot && (memcmp(pImage, m_nShadow, m_nImageLength) == 0))
+	{
+		return true;
+	}
+	// checked up front so nothing has to be undone if the queue says no
+	if(FLASH_GetWriteQueueDepth() >= FLASH_WRITE_QUEUE_SIZE)
+	{
+		m_NVLogStats.nQueueFull++;
+		return false;
+	}
+
+	nStartOffset = m_nWriteOffset;
+	nStartSequence = m_nSequence;
+	nStartRecords = m_NVLogStats.nRecords;
+	if(!m_bNeedSnapshot)
+	{
+		// each run is logged once the next is found, so the last record of
+		// the save goes out without NVLOG_MORE_RECORDS
+		nIndex = 0;
+		while(nIndex < m_nImageLength)
+		{
+			if(pImage[nIndex] == m_nShadow[nIndex])
+			{
+				nIndex++;
+				continue;
+			}
+			nRunStart = nIndex;
+			nRunEnd = nIndex;
+			while((nIndex < m_nImageLength) && ((nIndex - nRunEnd) <= NVLOG_MERGE_GAP))
+			{
+				if(pImage[nIndex] != m_nShadow[nIndex])
+				{
+					nRunEnd = nIndex;
+				}
+				nIndex++;
+			}
+			if((nLastLength != 0)
+				&& !nvlog_AppendRecord(NVLOG_DELTA_MARKER, pImage, nLastStart, nLastLength, NVLOG_MORE_RECORDS))
+			{
+				bNewPage = true;
+				break;
+			}
+			nLastStart = nRunStart;
+			nLastLength = (nRunEnd - nRunStart) + 1;
+		}
+		if(!bNewPage && !nvlog_AppendRecord(NVLOG_DELTA_MARKER, pImage, nLastStart, nLastLength, 0))
+		{
+			bNewPage = true;
+		}
+	}
+	if(m_bNeedSnapshot || bNewPage)
+	{
+		// any deltas that did fit are dropped, the snapshot covers them
+		if(bNewPage)
+		{
+			m_nSequence = nStartSequence;
+			m_NVLogStats.nRecords = nStartRecords;
+		}
+		nvlog_StartPage();
+		nStartOffset = 0;
+		(void)nvlog_AppendRecord(NVLOG_SNAPSHOT_MARKER, pImage, 0, m_nImageLength, 0);
+		m_NVLogStats.nSnapshots++;
+		bQueued = FLASH_QueueWriteRaw(pPage, m_nFirstPage + m_nPageIndex, nvlog_WriteDone);
+		m_NVLogStats.nPageErases++;
+	}
+	else
+	{
+		bQueued = FLASH_QueueAppendRaw(pPage, m_nFirstPage + m_nPageIndex, nvlog_WriteDone);
+	}
+	if(!bQueued)
+	{
+		// only a page the driver will not take gets here, start over to be safe
+		m_NVLogStats.nRejected++;
+		m_bNeedSnapshot = true;
+		return false;
+	}
+	m_NVLogStats.nPagePrograms++;
+	m_NVLogStats.nCommits++;
+	m_NVLogStats.nBytesLogged += m_nWriteOffset - nStartOffset;
+	m_bNeedSnapshot = false;
+	memcpy(m_nShadow, pImage, m_nImageLength);
+	return true;
+}// End NVLOG_Commit()
+
+/*******************************************************************************
+*       @details
+*       Returns the size of the valid record at nOffset of m_nLogPage, or 0
+*       if there is none.
+*******************************************************************************/
+static U_INT16 nvlog_CheckRecord(U_INT16 nOffset)
+{
+	U_BYTE *pPage = (U_BYTE *)m_nLogPage;
+	NVLOG_RECORD_HEADER *pHeader = (NVLOG_RECORD_HEADER *)&pPage[nOffset];
+	U_INT32 nCalcCRC, nStoredCRC;
+	U_INT16 nSize;
+
+	if((nOffset + sizeof(NVLOG_RECORD_HEADER)) > FLASH_PAGE_SIZE)
+	{
+		return 0;
+	}
+	if((pHeader->nMarker != NVLOG_SNAPSHOT_MARKER) && (pHeader->nMarker != NVLOG_DELTA_MARKER))
+	{
+		return 0;
+	}
+	if((pHeader->nLength == 0) || ((pHeader->nOffset + pHeader->nLength) > m_nImageLength))
+	{
+		return 0;
+	}
+	nSize = NVLOG_RECORD_SIZE(pHeader->nLength);
+	if((nOffset + nSize) > FLASH_PAGE_SIZE)
+	{
+		return 0;
+	}
+	memcpy(&nStoredCRC, &pPage[nOffset + nSize - sizeof(U_INT32)], sizeof(nStoredCRC));
+	if(!CalculateCRC(&pPage[nOffset], nSize - sizeof(U_INT32), &nCalcCRC) || (nCalcCRC != nStoredCRC))
+	{
+		return 0;
+	}
+	return nSize;
+}// End nvlog_CheckRecord()
+
+/*******************************************************************************
+*       @details
+*       Adds one record to m_nLogPage.  Returns false, leaving the page as
+*       it was, if the record does not fit.
+*******************************************************************************/
+static BOOL nvlog_AppendRecord(U_INT16 nMarker, const U_BYTE *pImage, U_INT16 nOffset, U_INT16 nLength, U_INT16 nFlags)
+{
+	U_BYTE *pPage = (U_BYTE *)m_nLogPage;
+	NVLOG_RECORD_HEADER *pHeader = (NVLOG_RECORD_HEADER *)&pPage[m_nWriteOffset];
+	U_INT16 nSize = NVLOG_RECORD_SIZE(nLength);
+	U_INT32 nCRC;
+
+	if((m_nWriteOffset + nSize) > FLASH_PAGE_SIZE)
+	{
+		return false;
+	}
+	pHeader->nMarker = nMarker;
+	pHeader->nOffset = nOffset;
+	pHeader->nLength = nLength;
+	pHeader->nFlags = nFlags;
+	pHeader->nSequence = ++m_nSequence;
+	memcpy(&pPage[m_nWriteOffset + sizeof(NVLOG_RECORD_HEADER)], &pImage[nOffset], nLength);
+	(void)CalculateCRC(&pPage[m_nWriteOffset], nSize - sizeof(U_INT32), &nCRC);
+	memcpy(&pPage[m_nWriteOffset + nSize - sizeof(U_INT32)], &nCRC, sizeof(nCRC));
+	m_nWriteOffset += nSize;
+	m_NVLogStats.nRecords++;
+	return true;
+}// End nvlog_AppendRecord()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void nvlog_StartPage(void)
+{
+	m_nPageIndex = (m_nPageIndex + 1) % NVLOG_PAGES;
+	memset(m_nLogPage, 0xFF, sizeof(m_nLogPage));
+	m_nWriteOffset = 0;
+}// End nvlog_StartPage()
+
+/*******************************************************************************
+*       @details
+*       A page that failed to program may hold anything, so the next save
+*       moves on to a fresh page with a full snapshot.
+*******************************************************************************/
+static void nvlog_WriteDone(U_INT32 nPageNumber, FLASH_PAGE_STATUS eStatus)
+{
+	if(eStatus != FLASH_PAGE_GOOD)
+	{
+		m_NVLogStats.nFailed++;
+		m_bNeedSnapshot = true;
+	}
+}// End nvlog_WriteDone()
@@ -1,97 +1,465 @@
 /*******************************************************************************
-*       @brief      Implementation file for the serial flash chip
-*       @file       Uphole/src/SerialFlash/csvparser.c
+*       @brief      Streaming CSV line parser for the PC upload.  Characters
+*                   are fed one at a time and each is handled exactly once;
+*                   the parser keeps a cursor for every column instead of
+*                   measuring the field again for each character.
+*       @file       Uphole/src/SerialProtocol/CSVParser.c
 *       @date       October 2023
 *       @copyright  COPYRIGHT (c) 2023 Target Drilling Inc. All rights are
 *                   reserved.  Reproduction in whole or in part is prohibited
 *                   without the prior written consent of the copyright holder.
-*This code for Adesto AT45DB321, 32Mb (512/528 x 8192)Serial Flash Chip
 *******************************************************************************/
-#include "csvparser.h"
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
 #include <stdbool.h>
 #include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include "timer.h"
-#include "SysTick.h"
 #include "portable.h"
-#include "RecordManager.h"
-#include "CommDriver_UART.h"
-#include "SerialCommon.h"
-#include "PCDataTransfer.h"
-#include "timer.h"
-#include "UI_MainTab.h"
-#include "stdio.h"
-#include "stdlib.h"
-#include "lcd.h"
-#include "Manager_DataLink.h"
-#include "TextStrings.h"
-#include "UI_Alphabet.h"
-#include "UI_ScreenUtilities.h"
-#include "UI_LCDScreenInversion.h"
-#include "UI_Frame.h"
-#include "UI_api.h"
-#include "UI_BooleanField.h"
-#include "UI_ToolFacePanels.h"
-#include "UI_InitiateField.h"
-#include "UI_FixedField.h"
-#include "UI_StringField.h"
-#include "UI_JobTab.h"
-#include "RecordManager.h"
-#include "FlashMemory.h"
-// #include "ClearAllHoleSuccessPanel.h"
-// #include "UI_RecordDataPanel.h"
-#include "csvparser.h"
-
-#ifndef _CSVFILE
-#define _CSVFILE
-// Create only one file structure to handle one CSV at a time
-CSVFileStructure FileStructure;
-#endif
-
-#define MAX_COLUMNS 20         // max 20 columns
-#define MAX_COLUMN_LENGTH 50   // each column can have up to 50 characters
-
-// Function to initialize a CSVRowStructure object
-void init_CSVRowStructure(CSVRowStructure* row) {
-    memset(row, 0, sizeof(CSVRowStructure)); // Reset all fields
-}
-
-// Function to add a character to the line parser
-void add_char_to_line_parser(CSVRowStructure* row, char character) {
-    if (row->current_column >= MAX_COLUMNS) {
-        // Too many columns.
-        return;
-    }
-
-    if (character != ',') { // Assuming ',' as the delimiter
-        char* currentItem = row->items[row->current_column];
-        int currentLength = strlen(currentItem);
-
-        if (currentLength >= (MAX_COLUMN_LENGTH - 1)) {
-            // The column is too long.
-            return;
-        }
-
-        currentItem[currentLength] = character; // Append the character
-        currentItem[currentLength + 1] = '\0';  // Null-terminate the string
-    } else {  // If the character is the delimiter
-        row->current_column++;  // Move to the next column
-    }
-}
-CSVFileStructure *getFileStructure(void){
-    return &FileStructure;
-}
-
-CSVRowStructure* parseCsvString(const char* line, CSVRowStructure* row) {
-    init_CSVRowStructure(row);
-    while (*line) {
-        add_char_to_line_parser(row, *line);
-        line++;
-    }
-    return row;
-}
-bool verify_csv_header(const char* line) {
-    const char* expected_header = "BoreName, Rec#, PipeLength, Azimuth, Pitch, Roll, X, Y, Z, Gamma, TimeStamp, WeekDay, Month, Day, Year, DefltPipeLeDeclin, DesiredAz, ToolFace, Statcode, #Branch, #BoreHole";
-    return strcmp(line, expected_header) == 0;
-}
+#include "CSVParser.h"
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void csv_StartLine(CSV_LINE_PARSER *pParser);
+static void csv_SetStatus(CSV_LINE_PARSER *pParser, CSV_STATUS eStatus);
+static void csv_Overflow(CSV_LINE_PARSER *pParser, CSV_STATUS eStatus);
+static void csv_AppendChar(CSV_LINE_PARSER *pParser, char nChar);
+static void csv_NextColumn(CSV_LINE_PARSER *pParser);
+static void csv_EndLine(CSV_LINE_PARSER *pParser);
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void CSV_Init(CSV_LINE_PARSER *pParser)
+{
+	memset(pParser, 0, sizeof(CSV_LINE_PARSER));
+	csv_StartLine(pParser);
+}// End CSV_Init()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   CSV_AddChar()
+;
+; Description:
+;   Feeds one character to the parser.  ',' ends a field, '\r' or '\n' ends
+;   the line, and the '\n' of a CRLF pair is dropped.  Spaces ahead of a
+;   field are skipped.  A field starting with '"' is quoted: commas inside it
+;   are kept and "" stands for one quote.  A line end inside quotes closes
+;   the line with CSV_BAD_QUOTE rather than running on into the next line.
+;
+;   Once the line is complete its fields stay readable until the next
+;   character is added, which starts a new line.
+;
+; Parameters:
+;   CSV_LINE_PARSER *pParser => parser state
+;   char nChar => next character of the input
+;
+; Returns:
+;   BOOL => true when nChar completed a line
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL CSV_AddChar(CSV_LINE_PARSER *pParser, char nChar)
+{
+	if (pParser->bLineComplete)
+	{
+		BOOL bSkipLineFeed = pParser->bSkipLineFeed;
+
+		csv_StartLine(pParser);
+		if (bSkipLineFeed && (nChar == '\n'))
+		{
+			return false;
+		}
+	}
+
+	if ((nChar == '\r') || (nChar == '\n'))
+	{
+		if (pParser->bInQuotes)
+		{
+			csv_SetStatus(pParser, CSV_BAD_QUOTE);
+		}
+		csv_EndLine(pParser);
+		pParser->bSkipLineFeed = (nChar == '\r');
+		return true;
+	}
+
+	if (pParser->bInQuotes)
+	{
+		if (nChar == '"')
+		{
+			pParser->bInQuotes = false;
+			pParser->bQuoteClosed = true;
+		}
+		else
+		{
+			csv_AppendChar(pParser, nChar);
+		}
+	}
+	else if (nChar == ',')
+	{
+		csv_NextColumn(pParser);
+	}
+	else if (pParser->bQuoteClosed)
+	{
+		if (nChar == '"')
+		{
+			// "" inside a quoted field
+			csv_AppendChar(pParser, '"');
+			pParser->bInQuotes = true;
+			pParser->bQuoteClosed = false;
+		}
+		else if (nChar != ' ')
+		{
+			csv_SetStatus(pParser, CSV_BAD_QUOTE);
+		}
+	}
+	else if (pParser->nFieldLength == 0)
+	{
+		if (nChar == '"')
+		{
+			pParser->bInQuotes = true;
+		}
+		else if (nChar != ' ')
+		{
+			csv_AppendChar(pParser, nChar);
+		}
+	}
+	else
+	{
+		csv_AppendChar(pParser, nChar);
+	}
+	return false;
+}// End CSV_AddChar()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   CSV_ParseLine()
+;
+; Description:
+;   Splits one complete line, with or without its line end, into fields.
+;   Anything after the first line end is ignored.
+;
+; Parameters:
+;   CSV_LINE_PARSER *pParser => parser state, holds the fields afterward
+;   const char *pLine => null terminated line
+;
+; Returns:
+;   CSV_STATUS => CSV_OK, or the first problem found in the line
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+CSV_STATUS CSV_ParseLine(CSV_LINE_PARSER *pParser, const char *pLine)
+{
+	CSV_Init(pParser);
+	while (*pLine != '\0')
+	{
+		if (CSV_AddChar(pParser, *pLine++))
+		{
+			return pParser->eStatus;
+		}
+	}
+	CSV_AddChar(pParser, '\n');
+	return pParser->eStatus;
+}// End CSV_ParseLine()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+U_BYTE CSV_GetColumnCount(const CSV_LINE_PARSER *pParser)
+{
+	return pParser->nColumns;
+}// End CSV_GetColumnCount()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const char* CSV_GetField(const CSV_LINE_PARSER *pParser, U_BYTE nColumn)
+{
+	if (!pParser->bLineComplete || (nColumn >= pParser->nColumns))
+	{
+		return NULL;
+	}
+	return &pParser->sText[pParser->nColumnStart[nColumn]];
+}// End CSV_GetField()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL CSV_GetInt(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, INT32 *pValue)
+{
+	return CSV_GetFixed(pParser, nColumn, 0, pValue);
+}// End CSV_GetInt()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   CSV_GetFixed()
+;
+; Description:
+;   Converts a decimal field straight to a scaled integer, so "123.4" with
+;   nDecimals = 1 gives 1234.  Extra fraction digits are truncated, which
+;   matches the (INT16) casts the record fields were always stored with,
+;   but without the binary rounding error of going through a double.
+;
+; Parameters:
+;   const CSV_LINE_PARSER *pParser => parser holding a complete line
+;   U_BYTE nColumn => zero based column
+;   U_BYTE nDecimals => fraction digits to keep
+;   INT32 *pValue => result, untouched on failure
+;
+; Returns:
+;   BOOL => false if the column is missing, empty, not a number or too big
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL CSV_GetFixed(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, U_BYTE nDecimals, INT32 *pValue)
+{
+	const char *pField = CSV_GetField(pParser, nColumn);
+	BOOL bNegative = false;
+	BOOL bDigits = false;
+	INT32 nValue = 0;
+
+	if (pField == NULL)
+	{
+		return false;
+	}
+
+	if ((*pField == '-') || (*pField == '+'))
+	{
+		bNegative = (*pField == '-');
+		pField++;
+	}
+	while ((*pField >= '0') && (*pField <= '9'))
+	{
+		if (nValue > (0x7FFFFFFF / 10) - 1)
+		{
+			return false;
+		}
+		nValue = (nValue * 10) + (*pField++ - '0');
+		bDigits = true;
+	}
+	if (*pField == '.')
+	{
+		pField++;
+		while ((*pField >= '0') && (*pField <= '9'))
+		{
+			if (nDecimals > 0)
+			{
+				if (nValue > (0x7FFFFFFF / 10) - 1)
+				{
+					return false;
+				}
+				nValue = (nValue * 10) + (*pField - '0');
+				nDecimals--;
+			}
+			pField++;
+			bDigits = true;
+		}
+	}
+	while (nDecimals > 0)
+	{
+		if (nValue > (0x7FFFFFFF / 10) - 1)
+		{
+			return false;
+		}
+		nValue *= 10;
+		nDecimals--;
+	}
+	while (*pField == ' ')
+	{
+		pField++;
+	}
+	if (!bDigits || (*pField != '\0'))
+	{
+		return false;
+	}
+
+	*pValue = bNegative ? -nValue : nValue;
+	return true;
+}// End CSV_GetFixed()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   CSV_GetReal()
+;
+; Description:
+;   Converts a plain decimal field, no exponent, to a REAL32.  Only used for
+;   values the record already keeps as REAL32, such as the borehole
+;   northings and eastings.
+;
+; Reentrancy:
+;   Yes
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL CSV_GetReal(const CSV_LINE_PARSER *pParser, U_BYTE nColumn, REAL32 *pValue)
+{
+	const char *pField = CSV_GetField(pParser, nColumn);
+	BOOL bNegative = false;
+	BOOL bDigits = false;
+	REAL32 fValue = 0.0f;
+	REAL32 fScale = 1.0f;
+
+	if (pField == NULL)
+	{
+		return false;
+	}
+
+	if ((*pField == '-') || (*pField == '+'))
+	{
+		bNegative = (*pField == '-');
+		pField++;
+	}
+	while ((*pField >= '0') && (*pField <= '9'))
+	{
+		fValue = (fValue * 10.0f) + (REAL32)(*pField++ - '0');
+		bDigits = true;
+	}
+	if (*pField == '.')
+	{
+		pField++;
+		while ((*pField >= '0') && (*pField <= '9'))
+		{
+			fScale *= 0.1f;
+			fValue += fScale * (REAL32)(*pField++ - '0');
+			bDigits = true;
+		}
+	}
+	while (*pField == ' ')
+	{
+		pField++;
+	}
+	if (!bDigits || (*pField != '\0'))
+	{
+		return false;
+	}
+
+	*pValue = bNegative ? -fValue : fValue;
+	return true;
+}// End CSV_GetReal()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void csv_StartLine(CSV_LINE_PARSER *pParser)
+{
+	pParser->nLength = 0;
+	pParser->nFieldLength = 0;
+	pParser->nColumnStart[0] = 0;
+	pParser->nColumns = 1;
+	pParser->bInQuotes = false;
+	pParser->bQuoteClosed = false;
+	pParser->bLineComplete = false;
+	pParser->bSkipLineFeed = false;
+	pParser->bOverflow = false;
+	pParser->eStatus = CSV_OK;
+}// End csv_StartLine()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void csv_SetStatus(CSV_LINE_PARSER *pParser, CSV_STATUS eStatus)
+{
+	if (pParser->eStatus == CSV_OK)
+	{
+		pParser->eStatus = eStatus;
+	}
+}// End csv_SetStatus()
+
+/*******************************************************************************
+*       @details
+*       Out of columns or line space.  The field in progress is closed and
+*       the rest of the line is thrown away.
+*******************************************************************************/
+static void csv_Overflow(CSV_LINE_PARSER *pParser, CSV_STATUS eStatus)
+{
+	csv_SetStatus(pParser, eStatus);
+	if (pParser->nLength < CSV_MAX_LINE_LENGTH)
+	{
+		pParser->sText[pParser->nLength] = '\0';
+	}
+	pParser->bOverflow = true;
+}// End csv_Overflow()
+
+/*******************************************************************************
+*       @details
+*       sText[nLength] is always kept free for the terminator of the field
+*       in progress.
+*******************************************************************************/
+static void csv_AppendChar(CSV_LINE_PARSER *pParser, char nChar)
+{
+	if (pParser->bOverflow)
+	{
+		return;
+	}
+	if (pParser->nFieldLength >= CSV_MAX_FIELD_LENGTH)
+	{
+		csv_SetStatus(pParser, CSV_FIELD_TOO_LONG);
+		return;
+	}
+	if ((pParser->nLength + 1) >= CSV_MAX_LINE_LENGTH)
+	{
+		csv_Overflow(pParser, CSV_LINE_TOO_LONG);
+		return;
+	}
+	pParser->sText[pParser->nLength++] = nChar;
+	pParser->nFieldLength++;
+}// End csv_AppendChar()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void csv_NextColumn(CSV_LINE_PARSER *pParser)
+{
+	if (pParser->bOverflow)
+	{
+		return;
+	}
+	pParser->sText[pParser->nLength++] = '\0';
+	if (pParser->nLength >= CSV_MAX_LINE_LENGTH)
+	{
+		csv_Overflow(pParser, CSV_LINE_TOO_LONG);
+		return;
+	}
+	if (pParser->nColumns >= CSV_MAX_COLUMNS)
+	{
+		csv_Overflow(pParser, CSV_TOO_MANY_COLUMNS);
+		return;
+	}
+	pParser->nColumnStart[pParser->nColumns++] = pParser->nLength;
+	pParser->nFieldLength = 0;
+	pParser->bQuoteClosed = false;
+}// End csv_NextColumn()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void csv_EndLine(CSV_LINE_PARSER *pParser)
+{
+	if (!pParser->bOverflow)
+	{
+		pParser->sText[pParser->nLength] = '\0';
+	}
+	pParser->bInQuotes = false;
+	pParser->bQuoteClosed = false;
+	pParser->bLineComplete = true;
+}// End csv_EndLine()
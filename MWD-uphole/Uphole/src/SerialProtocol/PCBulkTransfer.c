@@ -0,0 +1,345 @@
+/*******************************************************************************
+*       @brief      This module sends the whole borehole log to the PC as raw
+*                   flash pages in CRC framed blocks, with a sliding window
+*                   of acknowledgements.  It replaces the record by record
+*                   CSV dump when the PC side asks for it.
+*       @file       Uphole/src/SerialProtocol/PCBulkTransfer.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include "portable.h"
+#include "timer.h"
+#include "SysTick.h"
+#include "crc.h"
+#include "CommDriver_UART.h"
+#include "CommDriver_Flash.h"
+#include "RecordManager.h"
+#include "UI_MainTab.h"
+#include "UI_JobTab.h"
+#include "PCBulkTransfer.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define PCBULK_CRC_SIZE             4
+#define PCBULK_FRAME_SIZE           (PCBULK_HEADER_SIZE + FLASH_PAGE_SIZE + PCBULK_CRC_SIZE)
+#define PCBULK_ACK_TIMEOUT          ONE_SECOND
+#define PCBULK_MAX_RETRIES          10
+
+//============================================================================//
+//      FUNCTION PROTOTYPES                                                   //
+//============================================================================//
+
+static void pcBulk_BuildFrame(U_INT16 nSequence);
+static U_BYTE *pcBulk_Put(U_BYTE *pDest, U_INT32 nValue, U_BYTE nBytes);
+static U_BYTE *pcBulk_PutReal(U_BYTE *pDest, REAL32 fValue);
+static void pcBulk_Finish(char *pMessage);
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static BOOL m_bActive = false;
+static U_INT16 m_nHoleInfoPages;
+static U_INT16 m_nRecordPages;
+static U_INT16 m_nBlockCount;           // blocks in the whole transfer
+static U_INT16 m_nBlockAcked;           // oldest block not yet acknowledged
+static U_INT16 m_nBlockNext;            // next block to put on the wire
+static U_BYTE  m_nRetries;
+static TIME_LR m_tAckTimer;
+// word aligned so the CRC unit can run over it directly
+static U_INT32 m_nFrame[(PCBULK_FRAME_SIZE + 3) / 4];
+static U_INT16 m_nFrameLength = 0;
+static U_INT16 m_nFrameSent = 0;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PCBULK_Start()
+;
+; Description:
+;   Sizes the transfer from the current record count and hole number and
+;   starts streaming from the SUMMARY block.  Called when the PC sends
+;   "BEGIN_BIN".
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void PCBULK_Start(void)
+{
+	U_INT32 nRecordCount = GetRecordCount();
+
+	m_nHoleInfoPages = (U_INT16)(CurrentBoreholeNumber() / NEW_HOLE_RECORDS_PER_PAGE + 1);
+	m_nRecordPages = (U_INT16)((nRecordCount + RECORDS_PER_PAGE - 1) / RECORDS_PER_PAGE);
+	m_nBlockCount = 1 + m_nHoleInfoPages + m_nRecordPages + 1;
+	m_nBlockAcked = 0;
+	m_nBlockNext = 0;
+	m_nRetries = 0;
+	m_nFrameLength = 0;
+	m_nFrameSent = 0;
+	m_tAckTimer = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	m_bActive = true;
+	ShowStatusMessage("Downloading, Please Wait...");
+}// End PCBULK_Start()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+BOOL PCBULK_IsActive(void)
+{
+	return m_bActive;
+}// End PCBULK_IsActive()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PCBULK_ProcessLine()
+;
+; Description:
+;   Handles an "ACK n" or "NAK n" line from the PC.  An ACK slides the
+;   window past block n, a NAK rewinds the sender to block n.  Anything
+;   outside the blocks in flight is ignored.
+;
+; Parameters:
+;   const char *pLine => null terminated line, without the '\r'
+;
+; Returns:
+;   true if the line belonged to the bulk transfer
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL PCBULK_ProcessLine(const char *pLine)
+{
+	U_INT32 nSequence;
+
+	if (!m_bActive)
+	{
+		return false;
+	}
+	if (strncmp(pLine, "ACK ", 4) == 0)
+	{
+		nSequence = strtoul(&pLine[4], NULL, 10);
+		if ((nSequence >= m_nBlockAcked) && (nSequence < m_nBlockNext))
+		{
+			m_nBlockAcked = (U_INT16)(nSequence + 1);
+			m_nRetries = 0;
+			m_tAckTimer = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		}
+		return true;
+	}
+	if (strncmp(pLine, "NAK ", 4) == 0)
+	{
+		nSequence = strtoul(&pLine[4], NULL, 10);
+		if ((nSequence >= m_nBlockAcked) && (nSequence < m_nBlockNext))
+		{
+			m_nBlockAcked = (U_INT16)nSequence;
+			m_nBlockNext = (U_INT16)nSequence;
+			m_tAckTimer = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		}
+		return true;
+	}
+	return false;
+}// End PCBULK_ProcessLine()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   PCBULK_Service()
+;
+; Description:
+;   Keeps the PC port busy while a transfer is running.  Each frame is
+;   queued on the UART whole and the next one is built while it is on the
+;   wire, so the port never waits on the main loop.  A frame the UART has
+;   no room for yet is offered again on the next pass, which is why this
+;   is called from the main loop rather than the 10 ms tick.  When the
+;   window is full and no ACK arrives
+;   within PCBULK_ACK_TIMEOUT, everything from the oldest unacknowledged
+;   block is sent again.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void PCBULK_Service(void)
+{
+	if (!m_bActive)
+	{
+		return;
+	}
+
+	if (m_nFrameSent < m_nFrameLength)
+	{
+		if (UART_SendMessage(CLIENT_PC_COMM, (const U_BYTE *)m_nFrame, m_nFrameLength))
+		{
+			m_nFrameSent = m_nFrameLength;
+		}
+		return;
+	}
+
+	if (m_nBlockAcked >= m_nBlockCount)
+	{
+		pcBulk_Finish("Xfer done - Please Remove USB Cable");
+	}
+	else if ((m_nBlockNext < m_nBlockCount) && (m_nBlockNext < (m_nBlockAcked + PCBULK_WINDOW)))
+	{
+		if (m_nBlockNext == m_nBlockAcked)
+		{
+			m_tAckTimer = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		}
+		pcBulk_BuildFrame(m_nBlockNext++);
+	}
+	else if (ElapsedTimeLowRes(m_tAckTimer) > PCBULK_ACK_TIMEOUT)
+	{
+		if (++m_nRetries > PCBULK_MAX_RETRIES)
+		{
+			pcBulk_Finish("Xfer failed - No reply from PC");
+		}
+		else
+		{
+			m_nBlockNext = m_nBlockAcked;
+			m_tAckTimer = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		}
+	}
+}// End PCBULK_Service()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   pcBulk_BuildFrame()
+;
+; Description:
+;   Fills m_nFrame with the block for the given sequence number.  Blocks are
+;   rebuilt from flash each time they are sent, so a resend needs no copy
+;   of the frames in flight.
+;
+; Parameters:
+;   U_INT16 nSequence => block to build
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void pcBulk_BuildFrame(U_INT16 nSequence)
+{
+	U_BYTE *pFrame = (U_BYTE *)m_nFrame;
+	U_BYTE *pPayload = &pFrame[PCBULK_HEADER_SIZE];
+	U_INT16 nPayloadLength = 0;
+	U_BYTE nStatus = 0;
+	PCBULK_BLOCK_TYPE eType;
+	U_INT32 nCRC;
+
+	if (nSequence == 0)
+	{
+		BOREHOLE_STATISTICS bs;
+		U_BYTE *pField = pPayload;
+
+		// field by field, so the PC sees the same bytes whatever the
+		// compiler makes of PCBULK_SUMMARY
+		GetBoreholeStats(&bs);
+		pField = pcBulk_Put(pField, GetRecordCount(), 4);
+		pField = pcBulk_Put(pField, sizeof(STRUCT_RECORD_DATA), 2);
+		pField = pcBulk_Put(pField, RECORDS_PER_PAGE, 2);
+		pField = pcBulk_Put(pField, m_nRecordPages, 2);
+		pField = pcBulk_Put(pField, sizeof(NEWHOLE_INFO), 2);
+		pField = pcBulk_Put(pField, NEW_HOLE_RECORDS_PER_PAGE, 2);
+		pField = pcBulk_Put(pField, m_nHoleInfoPages, 2);
+		pField = pcBulk_Put(pField, CurrentBoreholeNumber(), 2);
+		pField = pcBulk_Put(pField, 0, 2);
+		pField = pcBulk_Put(pField, bs.TotalLength, 4);
+		pField = pcBulk_Put(pField, (U_INT32)bs.TotalDepth, 4);
+		pField = pcBulk_PutReal(pField, bs.TotalNorthings);
+		pField = pcBulk_PutReal(pField, bs.TotalEastings);
+		strncpy((char *)pField, GetBoreholeName(), PCBULK_NAME_SIZE);
+		pField += PCBULK_NAME_SIZE;
+		nPayloadLength = (U_INT16)(pField - pPayload);
+		eType = PCBULK_BLOCK_SUMMARY;
+	}
+	else if (nSequence <= m_nHoleInfoPages)
+	{
+		nStatus = (U_BYTE)RECORD_ReadHoleInfoPage((FLASH_PAGE *)pPayload, nSequence - 1);
+		nPayloadLength = FLASH_PAGE_SIZE;
+		eType = PCBULK_BLOCK_HOLE_INFO;
+	}
+	else if (nSequence <= (m_nHoleInfoPages + m_nRecordPages))
+	{
+		nStatus = (U_BYTE)RECORD_ReadRecordPage((FLASH_PAGE *)pPayload, nSequence - 1 - m_nHoleInfoPages);
+		nPayloadLength = FLASH_PAGE_SIZE;
+		eType = PCBULK_BLOCK_RECORDS;
+	}
+	else
+	{
+		eType = PCBULK_BLOCK_END;
+	}
+
+	pFrame[0] = PCBULK_SOH;
+	pFrame[1] = (U_BYTE)eType;
+	pFrame[2] = (U_BYTE)(nSequence & 0xFF);
+	pFrame[3] = (U_BYTE)(nSequence >> 8);
+	pFrame[4] = (U_BYTE)(nPayloadLength & 0xFF);
+	pFrame[5] = (U_BYTE)(nPayloadLength >> 8);
+	pFrame[6] = nStatus;
+	pFrame[7] = 0;
+	(void)CalculateCRC(pFrame, PCBULK_HEADER_SIZE + nPayloadLength, &nCRC);
+	(void)pcBulk_Put(&pPayload[nPayloadLength], nCRC, PCBULK_CRC_SIZE);
+
+	m_nFrameLength = PCBULK_HEADER_SIZE + nPayloadLength + PCBULK_CRC_SIZE;
+	m_nFrameSent = 0;
+}// End pcBulk_BuildFrame()
+
+/*******************************************************************************
+*       @details
+*       Stores the low nBytes of nValue little endian and returns the byte
+*       after them.
+*******************************************************************************/
+static U_BYTE *pcBulk_Put(U_BYTE *pDest, U_INT32 nValue, U_BYTE nBytes)
+{
+	while (nBytes--)
+	{
+		*pDest++ = (U_BYTE)(nValue & 0xFF);
+		nValue >>= 8;
+	}
+	return pDest;
+}// End pcBulk_Put()
+
+/*******************************************************************************
+*       @details
+*       IEEE single, little endian like the core.
+*******************************************************************************/
+static U_BYTE *pcBulk_PutReal(U_BYTE *pDest, REAL32 fValue)
+{
+	memcpy(pDest, &fValue, sizeof(REAL32));
+	return pDest + sizeof(REAL32);
+}// End pcBulk_PutReal()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void pcBulk_Finish(char *pMessage)
+{
+	m_bActive = false;
+	m_nFrameLength = 0;
+	m_nFrameSent = 0;
+	ShowStatusMessage(pMessage);
+}// End pcBulk_Finish()
@@ -43,9 +43,11 @@
 #include "UI_JobTab.h"
 #include "RecordManager.h"
 #include "FlashMemory.h"
+#include "Profile.h"
+#include "PCBulkTransfer.h"
 // #include "ClearAllHoleSuccessPanel.h"
 // #include "UI_RecordDataPanel.h"
-#include "csvparser.h"
+#include "CSVParser.h"
 //============================================================================//
 //      CONSTANTS                                                             //
 //============================================================================//
@@ -61,18 +63,42 @@ int csv_buffer_index = 0; // Current index in csv_buffer
 char csv_line[500]; // Store a single CSV line for parsing
 BOOL csv_header_verified = false;
 bool bFirstLine = false; // first line passed?
-#define RECORD_AREA_BASE_ADDRESS    128
-#define RECORDS_PER_PAGE            (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(STRUCT_RECORD_DATA))
 #define FLASH_PAGE_FILLER           ((FLASH_PAGE_SIZE - 4) - (sizeof(STRUCT_RECORD_DATA) * RECORDS_PER_PAGE))
-#define NEW_HOLE_RECORDS_PER_PAGE   (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(NEWHOLE_INFO))
 #define NEW_HOLE_FLASH_PAGE_FILLER  ((FLASH_PAGE_SIZE - 4) - (sizeof(NEWHOLE_INFO) * NEW_HOLE_RECORDS_PER_PAGE))
 
 #define NULL_PAGE 0xFFFFFFFF
 #define BranchStatusCode 100
 
+// Windowed upload: the PC sends "<seq>:<csv line>\r" and may run ahead of
+// the parser by up to PCDT_UPLOAD_WINDOW lines.  See uploadWindow_Service().
+#define PCDT_UPLOAD_WINDOW      4
+#define PCDT_UPLOAD_LINE_SIZE   256
+
 const char* BEGIN_CSV = "BEGIN_CSV";
 const char* END_CSV = "END_CSV";
-void ProcessCsvLine(char* line);
+// Label line of the branch table that ends a dump, see PCDT_STATE_SEND_BRANCH.
+// The table is worked out again from the surveys, so an upload skips it.
+const char* BRANCH_LABELS = "Branch, Parent, FirstRec, EndRec, TieInRec, Surveys, TotalLength, TotalDepth, TotalNorthings, TotalEastings";
+BOOL ProcessCsvLine(const char* line);
+
+// Uploaded survey line layout.  CSV_SKIP columns are text or are not stored,
+// the rest are decimal numbers stored scaled by 10^n.
+#define PCDT_CSV_COLUMNS    35
+#define CSV_SKIP            0xFF
+static const U_BYTE m_nCsvDecimals[PCDT_CSV_COLUMNS] =
+{
+    CSV_SKIP, 0, 0,                         // name, record #, pipe length
+    1, 1, 1,                                // azimuth, pitch, roll
+    1, 2, 1,                                // X, Y, Z
+    0, 0, 0, 0, 0, 0,                       // gamma, time stamp, date
+    CSV_SKIP, CSV_SKIP, CSV_SKIP, CSV_SKIP, // hole settings
+    0, 0, CSV_SKIP,                         // status code, branches, hole #
+    0, 0, 0, 0, 0, 0, 0, 0, 0,              // temperature .. branch set
+    0, 0, CSV_SKIP, CSV_SKIP                // length, depth, northings, eastings
+};
+static CSV_LINE_PARSER m_CsvParser;
+U_INT32 m_nCsvRejectedLines = 0;
+static BOOL m_bCsvBranchTable = false;  // past BRANCH_LABELS, nothing more to store
 
 // Changed above times from 7000, 1000, and 100 to speed up the download. MB 6/21/2021
 
@@ -89,7 +115,8 @@ typedef enum
     PCDT_STATE_IDLE, PCDT_STATE_SEND_INTRO, PCDT_STATE_SEND_LABELS1,
     PCDT_STATE_SEND_LABELS2, PCDT_STATE_SEND_LABELS3, PCDT_STATE_GET_RECORD,
     PCDT_STATE_SEND_LOG1, PCDT_STATE_SEND_LOG2, PCDT_STATE_SEND_LOG3, PCDT_STATE_SEND_LOG3B, PCDT_STATE_SEND_LOG3C,
-    PCDT_STATE_SEND_LOG4, UnmountUSB, Holdon
+    PCDT_STATE_SEND_LOG4, PCDT_STATE_SEND_BRANCH_LABELS, PCDT_STATE_SEND_BRANCH,
+    UnmountUSB, Holdon
 } PCDT_states;
 static PCDT_states SendLogToPC_state = PCDT_STATE_IDLE;
 
@@ -97,11 +124,26 @@ typedef enum
 {
     PCDTU_STATE_FILE_IDLE,
     PCDTU_STATE_FILE_RETRIEVAL,
+    PCDTU_STATE_WINDOW_RETRIEVAL,
     PCDTU_STATE_FILE_VERIFICATION,
     PCDTU_STATE_COMPLETED
 } PCDTU_states;
 static PCDTU_states RetrieveLogFromPC_state = PCDTU_STATE_FILE_IDLE;
 
+// one received line of a windowed upload, waiting to be parsed
+typedef struct
+{
+    BOOL bFull;
+    U_INT16 nSequence;
+    char sLine[PCDT_UPLOAD_LINE_SIZE];
+} PCDT_UPLOAD_SLOT;
+
+static PCDT_UPLOAD_SLOT m_UploadRing[PCDT_UPLOAD_WINDOW];
+static U_INT16 m_nUploadReceived;       // every line below this has arrived
+static U_INT16 m_nUploadCommitted;      // every line below this is in flash
+static BOOL m_bUploadStatusPending;     // an ACK/NAK is owed to the PC
+static BOOL m_bUploadEndPending;        // END_CSV committed, "END" not sent yet
+
 struct STRUCT_RECORD_DATA
 {
     char BoreName[100];
@@ -148,6 +190,8 @@ typedef struct Date
 } Date;
 
 char nBuffer[500];
+static void uploadWindow_Start(void);
+static void uploadWindow_Service(void);
 void DownloadData(void);
 void ShowFinishedMessage(void);
 void ShowUploadFinishedMessage(void);
@@ -187,7 +231,9 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
     static NEWHOLE_INFO HoleInfoRecord;
     static U_INT32 HoleNum = 0;
     static U_INT16 recordNumber = 1;
+    static U_INT16 nBranch;
     BOREHOLE_STATISTICS bs;
+    RECORD_BRANCH branch;
 
     // whs 26Jan2022 this should say SendLogToThumbDrive because this is where it happens
     switch (SendLogToPC_state) // Switch statement to handle different states
@@ -308,6 +354,8 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
         case PCDT_STATE_SEND_LOG1:
             if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check if enough time has elapsed based on the low-res timer
             {
+                // Timed a record at a time, a whole dump outlasts the cycle counter
+                PROFILE_Start(PROFILE_PC_DOWNLOAD);
                 if (strlen(HoleInfoRecord.BoreholeName)) // Check if the Borehole Name exists
                 {
                     snprintf(nBuffer, 500, "%s, %d, %d, %.1f, %.1f, %.1f, ", // Create the message for the first part of the log data
@@ -419,6 +467,7 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
         case PCDT_STATE_SEND_LOG4:
             if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check if enough time has elapsed based on the low-res timer
             {
+                PROFILE_Stop(PROFILE_PC_DOWNLOAD);
                 recordNumber++; // Increment the record number to fetch the next record
                 if (recordNumber < count) // Check if we have more records to process
                 {
@@ -426,7 +475,49 @@ void PCPORT_StateMachine(void)  // whs 26Jan2022 should be ThumbDrivePort
                 }
                 else
                 {
-                    SendLogToPC_state = PCDT_STATE_IDLE; // If no more records, reset to idle state
+                    // the branch table of the hole follows the surveys
+                    nBranch = 0;
+                    tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR)0); // Reset the timer
+                    SendLogToPC_state = PCDT_STATE_SEND_BRANCH_LABELS;
+                }
+            }
+            break;
+
+          // Sending the labels of the branch table
+        case PCDT_STATE_SEND_BRANCH_LABELS:
+            if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check for elapsed time before proceeding
+            {
+                snprintf(nBuffer, 500, "%s \r\n", BRANCH_LABELS);
+                UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)nBuffer, strlen(nBuffer)); // Send the message over UART
+                tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR)0); // Reset timer
+                SendLogToPC_state = PCDT_STATE_SEND_BRANCH;
+            }
+            break;
+
+          // Sending one branch a pass, RECORD_GetBranch() fails past the last one
+        case PCDT_STATE_SEND_BRANCH:
+            if (ElapsedTimeLowRes(tPCDTGapTimer) >= PCDT_DELAY3) // Check if enough time has elapsed based on the low-res timer
+            {
+                if (RECORD_GetBranch(&branch, nBranch))
+                {
+                    snprintf(nBuffer, 500, "%d, %d, %d, %d, %d, %d, %lu, %ld, %f, %f\r\n",
+                        nBranch,
+                        (branch.nParent == RECORD_NO_BRANCH) ? -1 : branch.nParent,
+                        branch.nFirstRecord,
+                        branch.nEndRecord,
+                        branch.nTieInRecord,
+                        branch.nSurveys,
+                        branch.TotalLength,
+                        branch.TotalDepth,
+                        branch.TotalNorthings,
+                        branch.TotalEastings);
+                    UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)nBuffer, strlen(nBuffer)); // Send the message via UART
+                    tPCDTGapTimer = ElapsedTimeLowRes((TIME_LR)0); // Reset the timer
+                    nBranch++;
+                }
+                else
+                {
+                    SendLogToPC_state = PCDT_STATE_IDLE; // If no more branches, reset to idle state
                     RepaintNow(&WindowFrame); // Repaint the window frame to update the UI
                     FinishedMessage = 1; // Set the FinishedMessage flag to 1, indicating the process is complete
                 }
@@ -447,23 +538,39 @@ void PCPORT_UPLOAD_StateMachine(void)
     switch (RetrieveLogFromPC_state)
     {
         case PCDTU_STATE_FILE_IDLE:
-            fullLine = UART_ReceiveMessage((U_BYTE*)uart_message_buffer);
+            fullLine = UART_ReceiveMessage(CLIENT_PC_COMM, (U_BYTE*)uart_message_buffer, sizeof(uart_message_buffer));
 
             if (fullLine)
             {
-                if (strstr(uart_message_buffer, "BEGIN_CSV") != NULL)
+                if (PCBULK_ProcessLine(uart_message_buffer))
+                {
+                    // acknowledgement for a binary download in progress
+                }
+                else if (strstr(uart_message_buffer, "BEGIN_BIN") != NULL)
+                {
+                    PCBULK_Start();
+                }
+                else if (strstr(uart_message_buffer, "BEGIN_WCSV") != NULL)
+                {
+                    LoggingManager_StartLogging();
+                    SetLoggingState(CLEAR_ALL_HOLE);
+                    uploadWindow_Start();
+                    RetrieveLogFromPC_state = PCDTU_STATE_WINDOW_RETRIEVAL;
+                }
+                else if (strstr(uart_message_buffer, "BEGIN_CSV") != NULL)
                 {
                     LoggingManager_StartLogging();
                     SetLoggingState(CLEAR_ALL_HOLE);
                     UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)"BEGIN\r", strlen("BEGIN\r"));
                     RetrieveLogFromPC_state = PCDTU_STATE_FILE_RETRIEVAL;
                     bFirstLine = true;
+                    m_bCsvBranchTable = false;
                 }
             }
             break;
 
         case PCDTU_STATE_FILE_RETRIEVAL:
-            fullLine = UART_ReceiveMessage((U_BYTE*)csv_buffer + csv_buffer_index);
+            fullLine = UART_ReceiveMessage(CLIENT_PC_COMM, (U_BYTE*)csv_buffer + csv_buffer_index, sizeof(csv_buffer) - csv_buffer_index);
             if (fullLine)
             {
                 if (!bFirstLine)
@@ -477,7 +584,9 @@ void PCPORT_UPLOAD_StateMachine(void)
                     else
                     {
                         // parse the line and add it
+                        PROFILE_Start(PROFILE_PC_UPLOAD_LINE);
                         ProcessCsvLine(csv_buffer);
+                        PROFILE_Stop(PROFILE_PC_UPLOAD_LINE);
                         UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)"ACK\r", strlen("ACK\r"));
                         ShowStatusMessage("Data Uploading - Please Wait...");
                     }
@@ -491,6 +600,10 @@ void PCPORT_UPLOAD_StateMachine(void)
             }
             break;
 
+        case PCDTU_STATE_WINDOW_RETRIEVAL:
+            uploadWindow_Service();
+            break;
+
         case PCDTU_STATE_COMPLETED:
             RepaintNow(&WindowFrame);
             ShowStatusMessage("Data Upload Success - Please Wait...");
@@ -503,122 +616,232 @@ void PCPORT_UPLOAD_StateMachine(void)
 }
 
 
-void ProcessCsvLine(char* line)
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ProcessCsvLine()
+;
+; Description:
+;   Splits one uploaded survey line and builds the record straight from the
+;   fields.  Angles, X and Z come in as degrees/feet and are stored x10, Y is
+;   stored x100, see m_nCsvDecimals[].  A line that is short, malformed or has
+;   a non numeric value is counted in m_nCsvRejectedLines and not stored.
+;   The branch table a dump ends with is skipped from its label line on.
+;
+; Parameters:
+;   const char* line => one CSV line, header line already skipped
+;
+; Returns:
+;   BOOL => true if the record was stored
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL ProcessCsvLine(const char* line)
 {
     STRUCT_RECORD_DATA record;
     BOREHOLE_STATISTICS bs;
-    char* token;
-    double fTemp;
-
-    token = strtok((char*)line, ",");                   // 1
-    // the first token is the name
-
-    token = strtok(NULL, ",");                          // 2
-    sscanf(token, "%d", (int*)(&record.nRecordNumber));
-
-    token = strtok(NULL, ",");                          // 3
-    sscanf(token, "%d", (int*)(&record.nTotalLength));
-
-    token = strtok(NULL, ",");                          // 4
-    sscanf(token, "%lf", &fTemp);
-    record.nAzimuth = (INT16)(fTemp * 10.0);
-
-    token = strtok(NULL, ",");                          // 5
-    sscanf(token, "%lf", &fTemp);
-    record.nPitch = (INT16)(fTemp * 10.0);
-
-    token = strtok(NULL, ",");                          //6
-    sscanf(token, "%lf", &fTemp);
-    record.nRoll = (INT16)(fTemp * 10.0);
-
-    token = strtok(NULL, ",");                          // 7
-    sscanf(token, "%lf", &fTemp);
-    record.X = (INT16)(fTemp * 10.0);
-
-    token = strtok(NULL, ",");                          // 8
-    sscanf(token, "%lf", &fTemp);
-    record.Y = (INT16)(fTemp * 100.0);
-
-    token = strtok(NULL, ",");                          // 9
-    sscanf(token, "%lf", &fTemp);
-    record.Z = (INT16)(fTemp * 10.0);
-
-    token = strtok(NULL, ",");                          // 10
-    sscanf(token, "%d", (int*)(&record.nGamma));
-
-    token = strtok(NULL, ",");                          // 11
-    sscanf(token, "%d", (int*)(&record.tSurveyTimeStamp));
+    INT32 nValue[PCDT_CSV_COLUMNS];
+    U_BYTE nColumn;
 
-    token = strtok(NULL, ",");                          // 12
-    sscanf(token, "%d", (int*)(&record.date.RTC_WeekDay));
-
-    token = strtok(NULL, ",");                          // 13
-    sscanf(token, "%d", (int*)&record.date.RTC_Month);
-
-    token = strtok(NULL, ",");                          // 14
-    sscanf(token, "%d", (int*)&record.date.RTC_Date);
-
-    token = strtok(NULL, ",");                          // 15
-    sscanf(token, "%d", (int*)&record.date.RTC_Year);
-
-    // throw the next 4 away
-    token = strtok(NULL, ",");                          // 16
-    token = strtok(NULL, ",");                          // 17
-    token = strtok(NULL, ",");                          // 18
-    token = strtok(NULL, ",");                          // 19
-    sscanf(token, "%d", (int*)(&record.date.RTC_Year));
-
-    token = strtok(NULL, ",");                          // 20
-    sscanf(token, "%d", (int*)(&record.StatusCode));
-
-    token = strtok(NULL, ",");                          // 21
-    sscanf(token, "%d", (int*)(&record.NumOfBranch));
-
-    // throw the next one away
-    token = strtok(NULL, ",");                          // 22
-
-    token = strtok(NULL, ",");                          // 23
-    sscanf(token, "%d", (int*)&record.nTemperature);
-
-    token = strtok(NULL, ",");                          // 24
-    sscanf(token, "%d", (int*)&record.nGTF);
-
-    token = strtok(NULL, ",");                          // 25
-    sscanf(token, "%d", (int*)&record.NextBranchRecordNum);
-
-    token = strtok(NULL, ",");                          // 26
-    sscanf(token, "%d", (int*)&record.PreviousBranchRecordNum);
-
-    token = strtok(NULL, ",");                          // 27
-    sscanf(token, "%d", (int*)&record.PreviousRecordIndex);
-
-    token = strtok(NULL, ",");                          // 28
-    sscanf(token, "%d", (int*)&record.GammaShotLock);
-
-    token = strtok(NULL, ",");                          // 29
-    sscanf(token, "%d", (int*)&record.GammaShotNumCorrected);
-
-    INT16 nTemp;
-    token = strtok(NULL, ",");                          // 30
-    sscanf(token, "%d", (int*)&nTemp);
-    record.InvalidDataFlag = nTemp > 0, true, false;
+    if (m_bCsvBranchTable || (strstr(line, BRANCH_LABELS) != NULL))
+    {
+        m_bCsvBranchTable = true;
+        return false;
+    }
+    if ((CSV_ParseLine(&m_CsvParser, line) != CSV_OK) ||
+        (CSV_GetColumnCount(&m_CsvParser) < PCDT_CSV_COLUMNS))
+    {
+        m_nCsvRejectedLines++;
+        return false;
+    }
+    for (nColumn = 0; nColumn < PCDT_CSV_COLUMNS; nColumn++)
+    {
+        nValue[nColumn] = 0;
+        if ((m_nCsvDecimals[nColumn] != CSV_SKIP) &&
+            !CSV_GetFixed(&m_CsvParser, nColumn, m_nCsvDecimals[nColumn], &nValue[nColumn]))
+        {
+            m_nCsvRejectedLines++;
+            return false;
+        }
+    }
+    memset(&bs, 0, sizeof(bs));
+    if (!CSV_GetReal(&m_CsvParser, 33, &bs.TotalNorthings) ||
+        !CSV_GetReal(&m_CsvParser, 34, &bs.TotalEastings))
+    {
+        m_nCsvRejectedLines++;
+        return false;
+    }
 
-    token = strtok(NULL, ",");                          // 31
-    sscanf(token, "%d", (int*)&nTemp);
-    record.branchWasSet = nTemp > 0, true, false;
+    // column 0 is the borehole name, 15 to 18 and 21 are not kept per record
+    memset(&record, 0, sizeof(record));
+    record.nRecordNumber = (U_INT16)nValue[1];
+    record.nTotalLength = (U_INT16)nValue[2];
+    record.nAzimuth = (INT16)nValue[3];
+    record.nPitch = (INT16)nValue[4];
+    record.nRoll = (INT16)nValue[5];
+    record.X = (INT16)nValue[6];
+    record.Y = (INT16)nValue[7];
+    record.Z = nValue[8];
+    record.nGamma = (INT16)nValue[9];
+    record.tSurveyTimeStamp = (TIME_RT)nValue[10];
+    record.date.RTC_WeekDay = (U_BYTE)nValue[11];
+    record.date.RTC_Month = (U_BYTE)nValue[12];
+    record.date.RTC_Date = (U_BYTE)nValue[13];
+    record.date.RTC_Year = (U_BYTE)nValue[14];
+    record.StatusCode = (INT16)nValue[19];
+    record.NumOfBranch = (INT16)nValue[20];
+    record.nTemperature = (INT16)nValue[22];
+    record.nGTF = (INT16)nValue[23];
+    record.NextBranchRecordNum = (INT16)nValue[24];
+    record.PreviousBranchRecordNum = (INT16)nValue[25];
+    record.PreviousRecordIndex = (INT16)nValue[26];
+    record.GammaShotLock = (INT16)nValue[27];
+    record.GammaShotNumCorrected = (INT16)nValue[28];
+    record.InvalidDataFlag = (nValue[29] > 0) ? true : false;
+    record.branchWasSet = (nValue[30] > 0) ? true : false;
+
+    bs.TotalLength = (U_INT32)nValue[31];
+    bs.TotalDepth = nValue[32];
+    SetBoreholeStats(&bs);
 
-    token = strtok(NULL, ",");                          // 32
-    sscanf(token, "%d", (U_INT32*)&bs.TotalLength);
+    StoreUploadedRecord(&record);
+    return true;
+}
 
-    token = strtok(NULL, ",");                          // 33
-    sscanf(token, "%d", (U_INT32*)&bs.TotalDepth);
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void uploadWindow_Start(void)
+{
+    char sReply[24];
+
+    memset(m_UploadRing, 0, sizeof(m_UploadRing));
+    m_nUploadReceived = 0;
+    m_nUploadCommitted = 0;
+    m_bUploadStatusPending = false;
+    m_bUploadEndPending = false;
+    m_bCsvBranchTable = false;
+    snprintf(sReply, sizeof(sReply), "BEGIN %d\r", PCDT_UPLOAD_WINDOW);
+    UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)sReply, strlen(sReply));
+}
 
-    token = strtok(NULL, ",");                          // 34
-    sscanf(token, "%f", (REAL32*)&bs.TotalNorthings);
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   uploadWindow_Service()
+;
+; Description:
+;   Runs one pass of the windowed upload.  Every complete "<seq>:<line>"
+;   waiting on the PC port is dropped into the ring, then at most one line
+;   is parsed and stored, so the PC keeps sending while the previous line
+;   goes to flash.  Line 0 is the CSV header and is skipped, a line of
+;   END_CSV finishes the upload.
+;
+;   The PC is told "ACK n m" when every line up to n has arrived and it may
+;   send up to line m, or "NAK e m" when line e is missing but later lines
+;   have arrived, so only line e needs to be sent again.  Lines outside
+;   the window and repeats are dropped and answered with the current state.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void uploadWindow_Service(void)
+{
+    PCDT_UPLOAD_SLOT* pSlot;
+    char* pLine;
+    U_INT32 nSequence;
+    U_INT16 nWindowEnd;
+    U_BYTE nSlot;
+    BOOL bGap;
+
+    // receive everything the UART has
+    while (UART_ReceiveMessage(CLIENT_PC_COMM, (U_BYTE*)csv_buffer, sizeof(csv_buffer)))
+    {
+        nSequence = strtoul(csv_buffer, &pLine, 10);
+        if ((pLine == csv_buffer) || (*pLine != ':') || (strlen(pLine + 1) >= PCDT_UPLOAD_LINE_SIZE))
+        {
+            continue;
+        }
+        m_bUploadStatusPending = true;
+        if ((nSequence < m_nUploadReceived) || (nSequence >= (U_INT32)m_nUploadCommitted + PCDT_UPLOAD_WINDOW))
+        {
+            continue;
+        }
+        pSlot = &m_UploadRing[nSequence % PCDT_UPLOAD_WINDOW];
+        if (!pSlot->bFull)
+        {
+            strcpy(pSlot->sLine, pLine + 1);
+            pSlot->nSequence = (U_INT16)nSequence;
+            pSlot->bFull = true;
+        }
+        while (m_UploadRing[m_nUploadReceived % PCDT_UPLOAD_WINDOW].bFull &&
+               (m_UploadRing[m_nUploadReceived % PCDT_UPLOAD_WINDOW].nSequence == m_nUploadReceived))
+        {
+            m_nUploadReceived++;
+        }
+    }
 
-    token = strtok(NULL, ",");                          // 35
-    sscanf(token, "%f", (REAL32*)&bs.TotalEastings);
-    SetBoreholeStats(&bs);
+    // parse and store the oldest line
+    pSlot = &m_UploadRing[m_nUploadCommitted % PCDT_UPLOAD_WINDOW];
+    if (!m_bUploadEndPending && pSlot->bFull && (pSlot->nSequence == m_nUploadCommitted))
+    {
+        if (strstr(pSlot->sLine, "END_CSV") != NULL)
+        {
+            m_bUploadEndPending = true;
+        }
+        else if (m_nUploadCommitted != 0)
+        {
+            PROFILE_Start(PROFILE_PC_UPLOAD_LINE);
+            ProcessCsvLine(pSlot->sLine);
+            PROFILE_Stop(PROFILE_PC_UPLOAD_LINE);
+        }
+        pSlot->bFull = false;
+        m_nUploadCommitted++;
+        m_bUploadStatusPending = true;
+    }
 
-    StoreUploadedRecord(&record);
-}
\ No newline at end of file
+    // answers queue behind each other on the UART, one that does not fit
+    // stays pending until the next pass
+    if (m_bUploadEndPending)
+    {
+        if (UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)"END\r", strlen("END\r")))
+        {
+            RetrieveLogFromPC_state = PCDTU_STATE_COMPLETED;
+        }
+    }
+    else if (m_bUploadStatusPending)
+    {
+        bGap = false;
+        for (nSlot = 0; nSlot < PCDT_UPLOAD_WINDOW; nSlot++)
+        {
+            if (m_UploadRing[nSlot].bFull && (m_UploadRing[nSlot].nSequence > m_nUploadReceived))
+            {
+                bGap = true;
+            }
+        }
+        nWindowEnd = m_nUploadCommitted + PCDT_UPLOAD_WINDOW - 1;
+        if (bGap)
+        {
+            snprintf(nBuffer, sizeof(nBuffer), "NAK %d %d\r", m_nUploadReceived, nWindowEnd);
+        }
+        else if (m_nUploadReceived > 0)
+        {
+            snprintf(nBuffer, sizeof(nBuffer), "ACK %d %d\r", m_nUploadReceived - 1, nWindowEnd);
+        }
+        else
+        {
+            nBuffer[0] = '\0';
+        }
+        if (nBuffer[0] == '\0')
+        {
+            m_bUploadStatusPending = false;
+        }
+        else if (UART_SendMessage(CLIENT_PC_COMM, (U_BYTE const*)nBuffer, strlen(nBuffer)))
+        {
+            ShowStatusMessage("Data Uploading - Please Wait...");
+            m_bUploadStatusPending = false;
+        }
+    }
+}
@@ -42,6 +42,12 @@ BOOL AwakeTimePending = 0;
 BOOL SaveDataToLog_flag = false;
 U_INT16 AwakeTimeSetting = 0;
 U_INT16 RX_message_receptions = 0;
+// Put m_TargetLinkStats in a Live Watch window to read the link performance.
+TARGET_LINK_STATS m_TargetLinkStats = {0, 0, 0, 0, 0, 0xFFFFFFFF, 0, 0, 0};
+static BOOL m_bPollOutstanding = false;
+static TIME_LR m_tPollSent = (TIME_LR)0;
+static TIME_LR m_tPollMinute = (TIME_LR)0;
+static U_INT32 m_nPollsThisMinute = 0;
 
 typedef struct
 {
@@ -69,6 +75,8 @@ static void pushTXbuffer16(U_INT16 someTXData, U_BYTE addtoChecksum);
 //static void pushTXbufferi16(INT16 someTXData, U_BYTE addtoChecksum);
 //static void pushTXbuffer32(U_INT32 someTXData, U_BYTE addtoChecksum);
 static void TargProtocol_RequestSendDownholeAwakeTime(U_INT16 awakeTime);
+static void linkStats_PollAnswered(void);
+static void linkStats_RollMinute(void);
 
 #define MAX_VERSION_LEN 7
 #define	DATE_STRING_LEN 16
@@ -160,6 +168,7 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 			if(checksum == theData[index])
 			{
 	RX_message_receptions++;
+				linkStats_PollAnswered();
 				SetSurveyCommsState(surveyCommsState); // whs 14dec2021
 				SetSurveyAzimuth(Azimuth);
 				SetSurveyPitch(Pitch);
@@ -176,6 +185,10 @@ void ProcessTargetRXMessage(U_BYTE *theData, U_INT16 nLength)
 				SetDownholeSWDate(pDateString, DATE_STRING_LEN);
 				SetCurrentAwakeTime(CurrentOnTime);
 			}
+			else
+			{
+				m_TargetLinkStats.nChecksumErrors++;
+			}
 			break;
 		case CMD_SEND_DOWNHOLE_ON_TIME:
 		case CMD_SEND_DOWNHOLE_GAMMA_ENABLE:
@@ -276,7 +289,18 @@ void TargProtocol_RequestAllData(void)
 	pushTXbuffer( 0, false );
 	// now push the checksum that we built up
 	pushTXbuffer( getTXChecksum(), false );
-	Modem_MessageToSend(port.tx.buffer, port.tx.count);
+	// an identical poll still queued or in flight is merged with this one
+	if(Modem_QueueMessage(port.tx.buffer, port.tx.count, MODEM_TX_PRIORITY_POLL) == MODEM_TX_QUEUED)
+	{
+		linkStats_RollMinute();
+		if(m_bPollOutstanding)
+		{
+			m_TargetLinkStats.nRepliesMissed++;
+		}
+		m_TargetLinkStats.nRequestsSent++;
+		m_bPollOutstanding = true;
+		m_tPollSent = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	}
 //	SaveDataToLog_flag = false;
 }
 
@@ -372,3 +396,77 @@ void TargProtocol_SetSensorPowerState(BOOL bState)
 	pushTXbuffer( getTXChecksum(), false );
 	Modem_MessageToSend(port.tx.buffer, port.tx.count);
 }
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+const TARGET_LINK_STATS* TargProtocol_GetLinkStats(void)
+{
+	return &m_TargetLinkStats;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+void TargProtocol_ResetLinkStats(void)
+{
+	memset(&m_TargetLinkStats, 0, sizeof(m_TargetLinkStats));
+	m_TargetLinkStats.nMinRoundTrip = 0xFFFFFFFF;
+	m_bPollOutstanding = false;
+	m_nPollsThisMinute = 0;
+	m_tPollMinute = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   linkStats_PollAnswered()
+;
+; Description:
+;   Folds the time since the last CMD_GET_FULL_DATA_SET poll went to the
+;   modem into the round trip statistics.  Only one poll can be in the modem
+;   at a time, so an answer always belongs to the most recent poll.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static void linkStats_PollAnswered(void)
+{
+	U_INT32 nRoundTrip;
+
+	linkStats_RollMinute();
+	if(!m_bPollOutstanding)
+	{
+		// unsolicited or duplicate answer, not a completed poll
+		return;
+	}
+	m_bPollOutstanding = false;
+	m_nPollsThisMinute++;
+	m_TargetLinkStats.nRepliesReceived++;
+	nRoundTrip = ElapsedTimeLowRes(m_tPollSent);
+	m_TargetLinkStats.nLastRoundTrip = nRoundTrip;
+	m_TargetLinkStats.nTotalRoundTrip += nRoundTrip;
+	if(nRoundTrip < m_TargetLinkStats.nMinRoundTrip)
+	{
+		m_TargetLinkStats.nMinRoundTrip = nRoundTrip;
+	}
+	if(nRoundTrip > m_TargetLinkStats.nMaxRoundTrip)
+	{
+		m_TargetLinkStats.nMaxRoundTrip = nRoundTrip;
+	}
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void linkStats_RollMinute(void)
+{
+	if(ElapsedTimeLowRes(m_tPollMinute) >= ONE_MINUTE)
+	{
+		m_TargetLinkStats.nPollsPerMinute = m_nPollsThisMinute;
+		m_nPollsThisMinute = 0;
+		m_tPollMinute = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+	}
+}
@@ -615,4 +615,5 @@ static void UI_DrawLogo(void)
     U_BYTE *pData = GetLcdForegroundPage();
     pData += 2400;
     memcpy(pData, nMwdLogo, 4760);
+    LCD_MarkRowsDirty(LCD_FOREGROUND_PAGE, 2400 / MAX_PIXEL_COL_STORAGE, (2400 + 4760 - 1) / MAX_PIXEL_COL_STORAGE);
 }
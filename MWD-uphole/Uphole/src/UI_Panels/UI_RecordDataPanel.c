@@ -58,6 +58,8 @@ static void RecordData_KeyPressed(TAB_ENTRY *tab, BUTTON_VALUE key);
 static void RecordData_TimerElapsed(TAB_ENTRY *tab);
 //   Gets selected survey variable
 static U_INT32 RecordData_RetrieveSelectSurveyIndex(void);
+//   Moves the selection a stand up or down the hole
+static void RecordData_SelectByDepth(BOOL bDown);
 static REAL32 RealValue(INT16 value);
 static REAL32 RealValue32(INT32 value);
 //============================================================================//
@@ -445,6 +447,14 @@ void RecordData_KeyPressed(TAB_ENTRY *tab, BUTTON_VALUE key)
             RepaintNow(&WindowFrame);
         }
         break;
+    case BUTTON_FIVE:
+        RecordData_SelectByDepth(true);
+        RepaintNow(&WindowFrame);
+        break;
+    case BUTTON_SIX:
+        RecordData_SelectByDepth(false);
+        RepaintNow(&WindowFrame);
+        break;
     case BUTTON_DASH:
         LoggingManager_StartUpload();
         RepaintNow(&WindowFrame);
@@ -487,6 +497,44 @@ static void RecordData_TimerElapsed(TAB_ENTRY *tab)
     //	RepaintNow(&WindowFrame);
 }
 
+/*******************************************************************************
+ *       @details
+ *       Selects the deepest survey of the hole being drilled that is no
+ *       deeper than one default pipe length below, or above, the selected
+ *       one, and scrolls it to the top.  Nothing moves when there is no such
+ *       survey.
+ *******************************************************************************/
+static void RecordData_SelectByDepth(BOOL bDown)
+{
+    STRUCT_RECORD_DATA record;
+    U_INT32 nDepth, nFound;
+    INT16 nStand = GetDefaultPipeLength();
+
+    if (!RECORD_GetRecord(&record, surveySelect) || (nStand <= 0))
+    {
+        return;
+    }
+    nDepth = record.nTotalLength;
+    if (bDown)
+    {
+        nDepth += nStand;
+    }
+    else if (nDepth >= (U_INT32)nStand)
+    {
+        nDepth -= nStand;
+    }
+    else
+    {
+        return;
+    }
+    nFound = RECORD_FindRecordByDepth(nDepth);
+    if (nFound > PreviousHoleEndingRecordNumber())
+    {
+        surveySelect = nFound;
+        RecordOffset = nFound;
+    }
+}
+
 /*******************************************************************************
  *       @details
  *******************************************************************************/
@@ -191,7 +191,12 @@ INT16 GetDesiredAzimuth(void)
 *******************************************************************************/
 void SetDesiredAzimuth(INT16 value)
 {
+	// the surveys already taken were worked out against the old one
+	if(NVRAM_data.nDesiredAzimuth != value)
+	{
 		NVRAM_data.nDesiredAzimuth = value;
+		RECORD_RequestRecompute();
+	}
 }
 /*******************************************************************************
 *       @details
@@ -52,7 +52,20 @@ void UI_DrawLine(U_BYTE *pMemoryBase, U_INT32 nTop, U_INT32 nLeft, U_INT32 nLeng
 	INT32 nLeftOffset = 0;
 	U_INT32 nLengthCount = 0;
 	U_INT32 nBitCount = 0;
+	BOOL bPage = (pMemoryBase == GetLcdBackgroundPage()) ? LCD_BACKGROUND_PAGE : LCD_FOREGROUND_PAGE;
 
+	if(bDirectionDown)
+	{
+		for(nLengthCount = 0; nLengthCount < nLength; nLengthCount++)
+		{
+			LCD_MarkDirty(bPage, nTop + nLengthCount, nLeft / 8, nLeft / 8);
+		}
+		nLengthCount = 0;
+	}
+	else if(nLength != 0)
+	{
+		LCD_MarkDirty(bPage, nTop, nLeft / 8, (nLeft + nLength - 1) / 8);
+	}
 	pBBMemoryBaseAddress = (U_INT32 *)((((U_INT32)pMemoryBase - SRAM1_BASE) * 32) + SRAM1_BB_BASE);
 	pBBMemoryBaseAddress += (nTop * 320);
 	pBBMemoryBaseAddress += (nLeft / 8) * 8;
@@ -234,6 +247,10 @@ void UI_PrintLine(U_INT16 nYOrigin, U_INT16 nXOrigin, U_INT16 nHieght, U_INT16 n
 		nWorkingLength = nBytesOrigin + nBytesLength + nCalc;
 		nWorkingPosition = nBytesOrigin;
 		nLineIndex = 0;
+		if(nWorkingLength > nBytesOrigin)
+		{
+			LCD_MarkDirty(LCD_FOREGROUND_PAGE, nYOrigin, nBytesOrigin, nWorkingLength - 1);
+		}
 		while(nWorkingPosition < nWorkingLength)
 		{
 			m_nPixelData[nYOrigin][nWorkingPosition++] |= nLineBuffer[nScanRow][nLineIndex++];
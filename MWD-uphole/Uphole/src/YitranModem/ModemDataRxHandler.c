@@ -25,15 +25,40 @@
 //      CONSTANTS                                                             //
 //============================================================================//
 
+// A frame is the start byte, a two byte length, the type, the opcode, the
+// data and a checksum.  The length counts the type, opcode and data.
+#define MODEM_FRAME_HEADER_SIZE     3
+#define MODEM_FRAME_OVERHEAD        4
+#define MODEM_FRAME_MIN_LENGTH      2
+#define MODEM_FRAME_MAX_LENGTH      (MODEM_MESSAGE_BUFFER_SIZE + 2)
+
+// The IT700 sends a frame without gaps, so the rest of a frame that has
+// not turned up in this long never will and its start byte was noise.
+#define MODEM_FRAME_TIMEOUT         FIFTY_MILLI_SECONDS
+
 //============================================================================//
 //      DATA DECLARATIONS                                                     //
 //============================================================================//
 
+// Replies that arrived while the one before them was still being handled.
+typedef struct {
+    MODEM_REPLY_DATA_STRUCT Entries[MODEM_REPLY_QUEUE_SIZE];
+    U_BYTE nHead;
+    U_BYTE nCount;
+}MODEM_REPLY_QUEUE;
+
 //============================================================================//
 //      FUNCTION PROTOTYPES                                                   //
 //============================================================================//
 
 static void modemData_ProcessRxMessage(void);
+static BOOL modemData_QueueReply(MODEM_REPLY_DATA_STRUCT *pCurrent, MODEM_REPLY_QUEUE *pQueue, U_BYTE *pMaxDepth);
+static void modemData_NextReply(MODEM_REPLY_DATA_STRUCT *pCurrent, MODEM_REPLY_QUEUE *pQueue);
+static U_INT16 bufferBytesWaiting(void);
+static U_INT16 bufferBytesFree(void);
+static U_BYTE peekBufferByte(U_INT16 nOffset);
+static void peekBufferBytes(U_BYTE *pData, U_INT16 nOffset, U_INT16 nCount);
+static void releaseBufferBytes(U_INT16 nCount);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -43,13 +68,13 @@ static TIME_LR tMessageGapTimer;
 U_BYTE m_nModemReceiveBuffer[MODEM_RECEIVE_BUFFER_SIZE];
 U_INT16 m_nModemReceiveBufferHead;
 U_INT16 m_nModemReceiveBufferTail;
-static MODEM_STATE_RX m_nModemStateMachine_RX;
-MODEM_COMMAND_STRUCT m_nModemRxCommand;
-U_BYTE  m_nModemReceivedLengthByteCount;
-U_INT16 m_nModemReceivedDataByteCount;
+static MODEM_COMMAND_STRUCT m_nModemRxCommand;
 static const MODEM_REPLY_DATA_STRUCT m_nDefaultModemReplyData = {0, INVALID_MODEM_REPLY, {0}, false};
 MODEM_REPLY_DATA_STRUCT m_nResponse = {0, INVALID_MODEM_REPLY, {0}, false};
 MODEM_REPLY_DATA_STRUCT m_nIndication = {0, INVALID_MODEM_REPLY, {0}, false};
+static MODEM_REPLY_QUEUE m_ResponseQueue;
+static MODEM_REPLY_QUEUE m_IndicationQueue;
+MODEM_RX_STATS m_ModemRxStats;
 static const U_BYTE m_nModemReplyOpCodeList[MAX_MODEM_REPLY] = {
 	MODEM_OPCODE_NOP,
 	MODEM_OPCODE_RESET,
@@ -73,96 +98,6 @@ static const U_BYTE m_nModemReplyOpCodeList[MAX_MODEM_REPLY] = {
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
 
-/*******************************************************************************
-*       @details
-*******************************************************************************/
-void ModemData_ReceiveRxData(U_BYTE nData)
-{
-	m_nModemReceiveBuffer[m_nModemReceiveBufferHead++] = nData;
-	if(m_nModemReceiveBufferHead >= MODEM_RECEIVE_BUFFER_SIZE)
-	{
-		m_nModemReceiveBufferHead = 0;
-	}
-}//end ModemData_ReceiveRxData
-
-/*******************************************************************************
-*       @details
-*******************************************************************************/
-void ModemData_ProcessRxData(void)
-{
-	BOOL bMessageProcessingPending = false;
-
-	while((m_nModemReceiveBufferHead != m_nModemReceiveBufferTail) &&
-		(bMessageProcessingPending == false))
-	{
-		switch(m_nModemStateMachine_RX)
-		{
-			case MODEM_RX_WAITING_FOR_COMMAND:
-			{
-				U_BYTE nTempData = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-				if((nTempData == CONFIGURATION_CONSTANT) || (nTempData == COMMAND_CONSTANT))
-				{
-					m_nModemRxCommand.nCommand = nTempData;
-					m_nModemReceivedLengthByteCount = 0;
-					m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_LENGTH;
-				}
-			}
-			break;
-
-			case MODEM_RX_WAITING_FOR_LENGTH:
-			{
-				m_nModemRxCommand.nLength.AsBytes[m_nModemReceivedLengthByteCount++] = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-				if(m_nModemReceivedLengthByteCount >= sizeof( m_nModemRxCommand.nLength))
-				{
-					m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_TYPE;
-				}
-			}
-			break;
-
-			case MODEM_RX_WAITING_FOR_TYPE:
-			{
-				m_nModemRxCommand.nType = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-				m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_OPCODE;
-			}
-			break;
-
-			case MODEM_RX_WAITING_FOR_OPCODE:
-			{
-				m_nModemRxCommand.nOpCode = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-				m_nModemReceivedDataByteCount = 0;
-				m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_DATA;
-			}
-			break;
-
-			case MODEM_RX_WAITING_FOR_DATA:
-			{
-				if(m_nModemReceivedDataByteCount >= (m_nModemRxCommand.nLength.AsHalfWord - 2))
-				{
-					m_nModemRxCommand.nCheckSum = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-					if(computeCheckSum(&m_nModemRxCommand, false))
-					{
-						bMessageProcessingPending = true;
-					}
-					m_nModemStateMachine_RX = MODEM_RX_WAITING_FOR_COMMAND;
-				}
-				else
-				{
-					m_nModemRxCommand.nData[m_nModemReceivedDataByteCount++] = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-				}
-			}
-			break;
-		}
-		if(m_nModemReceiveBufferTail >= MODEM_RECEIVE_BUFFER_SIZE)
-		{
-			m_nModemReceiveBufferTail = 0;
-		}
-	}
-	if(bMessageProcessingPending)
-	{
-		modemData_ProcessRxMessage();
-	}
-}//end Modem_ProcessRxData
-
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -178,22 +113,16 @@ static void modemData_ProcessRxMessage(void)
 		case COMMAND_CONSTANT:
 			switch(m_nModemRxCommand.nType)
 			{
-				case TYPE_RESPONSE:
-					m_nResponse.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-					m_nResponse.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-					memcpy((void *)&m_nResponse.nData, (const void *)&m_nModemRxCommand.nData, m_nResponse.nLength);
-					if(m_nResponse.eReply != INVALID_MODEM_REPLY)
+				case TYPE_RESPONSE: // 0x01
+					if(!modemData_QueueReply(&m_nResponse, &m_ResponseQueue, &m_ModemRxStats.nMaxResponseDepth))
 					{
-						m_nResponse.bReplyReady = true;
+						m_ModemRxStats.nResponsesDropped++;
 					}
 					break;
-				case TYPE_INDICATION:
-					m_nIndication.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-					m_nIndication.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-					memcpy((void *)&m_nIndication.nData, (const void *)&m_nModemRxCommand.nData, m_nIndication.nLength);
-					if(m_nIndication.eReply != INVALID_MODEM_REPLY)
+				case TYPE_INDICATION: // 0x02
+					if(!modemData_QueueReply(&m_nIndication, &m_IndicationQueue, &m_ModemRxStats.nMaxIndicationDepth))
 					{
-						m_nIndication.bReplyReady = true;
+						m_ModemRxStats.nIndicationsDropped++;
 					}
 					break;
 				default:
@@ -205,6 +134,83 @@ static void modemData_ProcessRxMessage(void)
 	}
 }//end modem_ProcessRxMessage
 
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   modemData_QueueReply()
+;
+; Description:
+;   Hands the frame in m_nModemRxCommand to ModemManager.  It goes straight
+;   into the current reply if that is free, otherwise it waits in the queue
+;   until the replies ahead of it have been reset.  Replies with an opcode
+;   we do not know are ignored, as before.
+;
+; Parameters:
+;   MODEM_REPLY_DATA_STRUCT *pCurrent => m_nResponse or m_nIndication
+;   MODEM_REPLY_QUEUE *pQueue => replies waiting behind it
+;   U_BYTE *pMaxDepth => deepest the queue has been, for m_ModemRxStats
+;
+; Returns:
+;   BOOL => false if the queue was full and the reply was dropped
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+static BOOL modemData_QueueReply(MODEM_REPLY_DATA_STRUCT *pCurrent, MODEM_REPLY_QUEUE *pQueue, U_BYTE *pMaxDepth)
+{
+	MODEM_REPLY_DATA_STRUCT *pReply;
+	MODEM_REPLY_TYPE eReply;
+
+	eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
+	if(eReply == INVALID_MODEM_REPLY)
+	{
+		return true;
+	}
+
+	if(!pCurrent->bReplyReady)
+	{
+		pReply = pCurrent;
+	}
+	else if(pQueue->nCount < MODEM_REPLY_QUEUE_SIZE)
+	{
+		pReply = &pQueue->Entries[(pQueue->nHead + pQueue->nCount) % MODEM_REPLY_QUEUE_SIZE];
+		pQueue->nCount++;
+		if(pQueue->nCount > *pMaxDepth)
+		{
+			*pMaxDepth = pQueue->nCount;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	pReply->nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
+	pReply->eReply = eReply;
+	memcpy((void *)pReply->nData, (const void *)m_nModemRxCommand.nData, pReply->nLength);
+	pReply->bReplyReady = true;
+	return true;
+}//end modemData_QueueReply
+
+/*******************************************************************************
+*       @details
+*       Moves the oldest queued reply into the current one, or clears it if
+*       nothing is waiting.
+*******************************************************************************/
+static void modemData_NextReply(MODEM_REPLY_DATA_STRUCT *pCurrent, MODEM_REPLY_QUEUE *pQueue)
+{
+	if(pQueue->nCount == 0)
+	{
+		*pCurrent = m_nDefaultModemReplyData;
+		return;
+	}
+	*pCurrent = pQueue->Entries[pQueue->nHead];
+	pQueue->nHead = (pQueue->nHead + 1) % MODEM_REPLY_QUEUE_SIZE;
+	pQueue->nCount--;
+}//end modemData_NextReply
+
 /*******************************************************************************
 *       @details
 *******************************************************************************/
@@ -241,27 +247,43 @@ MODEM_REPLY_TYPE getReplyOpCodeIndex(U_BYTE nOpCode)
 
 /*******************************************************************************
 *       @details
+*       Done with m_nResponse, the next queued response takes its place.
 *******************************************************************************/
 void ModemData_ResetRxResponse(void)
 {
-	m_nResponse = m_nDefaultModemReplyData;
+	modemData_NextReply(&m_nResponse, &m_ResponseQueue);
 }
 
 /*******************************************************************************
 *       @details
+*       Done with m_nIndication, the next queued indication takes its place.
 *******************************************************************************/
 void ModemData_ResetRxIndication(void)
 {
-	m_nIndication = m_nDefaultModemReplyData;
+	modemData_NextReply(&m_nIndication, &m_IndicationQueue);
 }
 
-// timed buffer method..
+/*******************************************************************************
+*       @details
+*       Throws away the current response and every queued one, for when the
+*       modem is reset and anything it said before is out of date.
+*******************************************************************************/
+void ModemData_FlushRxResponses(void)
+{
+	m_ResponseQueue.nCount = 0;
+	m_nResponse = m_nDefaultModemReplyData;
+}
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
 void ModemData_ReceiveData(U_BYTE nData)
 {
+	if(bufferBytesFree() == 0)
+	{
+		m_ModemRxStats.nOverruns++;
+		return;
+	}
 	m_nModemReceiveBuffer[m_nModemReceiveBufferHead++] = nData;
 	if(m_nModemReceiveBufferHead >= MODEM_RECEIVE_BUFFER_SIZE)
 	{
@@ -272,89 +294,188 @@ void ModemData_ReceiveData(U_BYTE nData)
 
 /*******************************************************************************
 *       @details
+*       Same as ModemData_ReceiveData() for a span of the UART receive
+*       buffer, copied in at most two pieces.  Only as much as there is room
+*       for is taken, the caller keeps the rest and offers it again once
+*       ProcessModemBuffer() has made room.
 *******************************************************************************/
-U_BYTE getBufferByte(void)
+U_INT16 ModemData_ReceiveSpan(const U_BYTE *pData, U_INT16 nLength)
 {
-	U_BYTE nTempData = m_nModemReceiveBuffer[m_nModemReceiveBufferTail++];
-	if(m_nModemReceiveBufferTail >= MODEM_RECEIVE_BUFFER_SIZE)
+	U_INT16 nTaken;
+	U_INT16 nPiece;
+
+	nTaken = bufferBytesFree();
+	if(nTaken > nLength)
 	{
-		m_nModemReceiveBufferTail = 0;
+		nTaken = nLength;
 	}
-	return nTempData;
-} // getBufferByte
-
-/****************************************************************************
- *
- * Function Name:   ProcessModemBuffer
- *
- * Abstract:        wait for and process modem serial messages
- *
- ****************************************************************************/
-void ProcessModemBuffer(void)
+	nLength = nTaken;
+	while(nLength > 0)
+	{
+		nPiece = MODEM_RECEIVE_BUFFER_SIZE - m_nModemReceiveBufferHead;
+		if(nPiece > nLength)
+		{
+			nPiece = nLength;
+		}
+		memcpy(&m_nModemReceiveBuffer[m_nModemReceiveBufferHead], pData, nPiece);
+		m_nModemReceiveBufferHead += nPiece;
+		if(m_nModemReceiveBufferHead >= MODEM_RECEIVE_BUFFER_SIZE)
+		{
+			m_nModemReceiveBufferHead = 0;
+		}
+		pData += nPiece;
+		nLength -= nPiece;
+	}
+	if(nTaken > 0)
+	{
+		tMessageGapTimer = ElapsedTimeLowRes((TIME_LR)0);
+	}
+	return nTaken;
+}//end ModemData_ReceiveSpan
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_INT16 bufferBytesWaiting(void)
+{
+	return (U_INT16)((m_nModemReceiveBufferHead + MODEM_RECEIVE_BUFFER_SIZE - m_nModemReceiveBufferTail) % MODEM_RECEIVE_BUFFER_SIZE);
+}
+
+/*******************************************************************************
+*       @details
+*       One byte is always left empty, head == tail means empty and never
+*       full.
+*******************************************************************************/
+static U_INT16 bufferBytesFree(void)
+{
+	return (U_INT16)(MODEM_RECEIVE_BUFFER_SIZE - 1 - bufferBytesWaiting());
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static U_BYTE peekBufferByte(U_INT16 nOffset)
 {
-	U_BYTE nTempData;
-	U_INT16 nModemReceivedDataByteCount;
-	BOOL bResult;
-
-	// only process if there are characters
-	if(m_nModemReceiveBufferHead == m_nModemReceiveBufferTail) return;
-	// and some time has passed..
-	if(ElapsedTimeLowRes(tMessageGapTimer) < 10) return;
-	// we have a message, process it
-	nTempData = getBufferByte();
-	if((nTempData != CONFIGURATION_CONSTANT) && (nTempData != COMMAND_CONSTANT)) return;
-	m_nModemRxCommand.nCommand = nTempData;
-	m_nModemReceivedLengthByteCount = 0;
-	m_nModemRxCommand.nLength.AsBytes[m_nModemReceivedLengthByteCount++] = getBufferByte();
-	getBufferByte();
-	m_nModemRxCommand.nType = getBufferByte();
-	m_nModemRxCommand.nOpCode = getBufferByte();
-	nModemReceivedDataByteCount = 0;
-	while(nModemReceivedDataByteCount < (m_nModemRxCommand.nLength.AsHalfWord - 2))
+	return m_nModemReceiveBuffer[(m_nModemReceiveBufferTail + nOffset) % MODEM_RECEIVE_BUFFER_SIZE];
+}
+
+/*******************************************************************************
+*       @details
+*       Copies bytes out of the receive buffer without releasing them, in at
+*       most two pieces.
+*******************************************************************************/
+static void peekBufferBytes(U_BYTE *pData, U_INT16 nOffset, U_INT16 nCount)
+{
+	U_INT16 nIndex;
+	U_INT16 nPiece;
+
+	nIndex = (m_nModemReceiveBufferTail + nOffset) % MODEM_RECEIVE_BUFFER_SIZE;
+	while(nCount > 0)
 	{
-		m_nModemRxCommand.nData[nModemReceivedDataByteCount++] = getBufferByte();
+		nPiece = MODEM_RECEIVE_BUFFER_SIZE - nIndex;
+		if(nPiece > nCount)
+		{
+			nPiece = nCount;
+		}
+		memcpy((void *)pData, (const void *)&m_nModemReceiveBuffer[nIndex], nPiece);
+		pData += nPiece;
+		nCount -= nPiece;
+		nIndex = 0;
 	}
-	m_nModemRxCommand.nCheckSum = getBufferByte();
-	bResult = computeCheckSum(&m_nModemRxCommand, false);
-	if(bResult)
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void releaseBufferBytes(U_INT16 nCount)
+{
+	m_nModemReceiveBufferTail = (m_nModemReceiveBufferTail + nCount) % MODEM_RECEIVE_BUFFER_SIZE;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ProcessModemBuffer()
+;
+; Description:
+;   Decodes every whole frame in the receive buffer and hands each one on as
+;   soon as its last byte is in, instead of waiting for the line to go quiet.
+;   A frame stays in the buffer until all of it has arrived, so it may be
+;   split across calls.  Bytes before a start byte, a start byte with an
+;   impossible length, a frame with a bad checksum, or a frame whose tail
+;   never arrives cost one byte and the search starts again after it, so a
+;   real frame hidden behind noise is still found.
+;
+; Reentrancy:
+;   No
+;
+; Assumptions:
+;   This function is called from main.
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void ProcessModemBuffer(void)
+{
+	U_INT16 nWaiting;
+	U_INT16 nLength;
+	U_BYTE nStart;
+
+	nWaiting = bufferBytesWaiting();
+	while(nWaiting > 0)
 	{
-		switch(m_nModemRxCommand.nCommand)
+		nStart = peekBufferByte(0);
+		if((nStart != CONFIGURATION_CONSTANT) && (nStart != COMMAND_CONSTANT))
+		{
+			m_ModemRxStats.nSkippedBytes++;
+			releaseBufferBytes(1);
+			nWaiting--;
+			continue;
+		}
+		if(nWaiting < MODEM_FRAME_HEADER_SIZE)
+		{
+			nLength = 0;
+		}
+		else
 		{
-			case CONFIGURATION_CONSTANT:
-				//This is for auto modem detection.
-				SetModemIsPresent(true);
-				//Nothing else to do here.  This is the welcome message for firmware upgrade.
-				break;
-			case COMMAND_CONSTANT:
+			m_nModemRxCommand.nLength.AsBytes[0] = peekBufferByte(1);
+			m_nModemRxCommand.nLength.AsBytes[1] = peekBufferByte(2);
+			nLength = m_nModemRxCommand.nLength.AsHalfWord;
+			if((nLength < MODEM_FRAME_MIN_LENGTH) || (nLength > MODEM_FRAME_MAX_LENGTH))
 			{
-				switch(m_nModemRxCommand.nType)
-				{
-					case TYPE_RESPONSE: // 0x01
-						m_nResponse.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-						m_nResponse.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-						memcpy((void *)&m_nResponse.nData, (const void *)&m_nModemRxCommand.nData, m_nResponse.nLength);
-						if(m_nResponse.eReply != INVALID_MODEM_REPLY)
-						{
-							m_nResponse.bReplyReady = true;
-						}
-						break;
-					case TYPE_INDICATION: // 0x02
-						m_nIndication.nLength = m_nModemRxCommand.nLength.AsHalfWord - 2;
-						m_nIndication.eReply = getReplyOpCodeIndex(m_nModemRxCommand.nOpCode);
-						memcpy((void *)&m_nIndication.nData, (const void *)&m_nModemRxCommand.nData, m_nIndication.nLength);
-						if(m_nIndication.eReply != INVALID_MODEM_REPLY)
-						{
-							m_nIndication.bReplyReady = true;
-						}
-						break;
-					default:
-						break;
-				}
+				m_ModemRxStats.nBadLengths++;
+				releaseBufferBytes(1);
+				nWaiting--;
+				continue;
 			}
-			break;
+		}
+		if((nLength == 0) || (nWaiting < (nLength + MODEM_FRAME_OVERHEAD)))
+		{
+			// wait for the rest of the frame, unless it is clearly not coming
+			if(ElapsedTimeLowRes(tMessageGapTimer) < MODEM_FRAME_TIMEOUT)
+			{
+				return;
+			}
+			m_ModemRxStats.nTimeouts++;
+			releaseBufferBytes(1);
+			nWaiting--;
+			continue;
+		}
 
-			default:
-			break;
+		m_nModemRxCommand.nCommand = nStart;
+		m_nModemRxCommand.nType = peekBufferByte(MODEM_FRAME_HEADER_SIZE);
+		m_nModemRxCommand.nOpCode = peekBufferByte(MODEM_FRAME_HEADER_SIZE + 1);
+		peekBufferBytes(m_nModemRxCommand.nData, MODEM_FRAME_HEADER_SIZE + 2, nLength - 2);
+		m_nModemRxCommand.nCheckSum = peekBufferByte(nLength + MODEM_FRAME_HEADER_SIZE);
+		if(!computeCheckSum(&m_nModemRxCommand, false))
+		{
+			m_ModemRxStats.nChecksumErrors++;
+			releaseBufferBytes(1);
+			nWaiting--;
+			continue;
 		}
+		releaseBufferBytes(nLength + MODEM_FRAME_OVERHEAD);
+		nWaiting -= (nLength + MODEM_FRAME_OVERHEAD);
+		m_ModemRxStats.nFrames++;
+		modemData_ProcessRxMessage();
 	}
 } // end ProcessModemBuffer
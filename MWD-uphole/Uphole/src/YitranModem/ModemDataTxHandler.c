@@ -19,6 +19,9 @@
 #include "ModemDataHandler.h"
 #include "ModemDataTxHandler.h"
 #include "ModemNetworkHandler.h"
+#include "ModemManager.h"
+#include "SysTick.h"
+#include "timer.h"
 
 //============================================================================//
 //      CONSTANTS                                                             //
@@ -36,12 +39,24 @@ typedef struct {
     U_INT16 nDataLength;
 }MODEM_REQUEST_STRUCT;
 
+typedef enum {
+    TX_SLOT_FREE,
+    TX_SLOT_WAITING,
+    TX_SLOT_IN_FLIGHT,
+}TX_SLOT_STATE;
+
+// A queued downhole message.  nTransaction is given out when the message is
+// queued, orders the queue, and goes out with every send of the message so
+// a resend carries the same number as the first try.
 typedef struct {
-    BOOL    bMessageInBuffer;
-    BOOL    bMessageSent;
-    U_INT16 nMessageLength;
-    U_BYTE  nMessageData[MODEM_MESSAGE_BUFFER_SIZE];
-}MODEM_MESSAGE_STRUCT;
+    TX_SLOT_STATE     eState;
+    MODEM_TX_PRIORITY ePriority;
+    U_BYTE            nRetries;
+    U_INT32           nTransaction;
+    TIME_LR           tSent;
+    U_INT16           nMessageLength;
+    U_BYTE            nMessageData[MODEM_TX_MESSAGE_MAX];
+}MODEM_TX_SLOT;
 
 typedef struct {
     U_BYTE nDataServiceType;
@@ -60,6 +75,8 @@ typedef struct {
 //============================================================================//
 
 static U_INT16 copyMessageToTxBuffer(void);
+static MODEM_TX_SLOT *txQueue_OldestWaiting(MODEM_TX_PRIORITY ePriority);
+static void txQueue_UpdateRtt(TIME_LR tSample);
 
 //============================================================================//
 //      DATA DEFINITIONS                                                      //
@@ -67,8 +84,13 @@ static U_INT16 copyMessageToTxBuffer(void);
 
 static MODEM_COMMAND_STRUCT m_nModemTxCommand;
 static U_BYTE m_nModemTransmitBuffer[MODEM_TRANSMIT_BUFFER_SIZE];
-static const MODEM_MESSAGE_STRUCT m_nDefaultModemTxMessage = {false, false, 0, {0}};
-static MODEM_MESSAGE_STRUCT m_nSendingMessage = {false, false, 0, {0}};
+static MODEM_TX_SLOT m_TxQueue[MODEM_TX_QUEUE_SIZE];
+static MODEM_TX_SLOT *m_pTxInFlight = NULL;
+static const U_BYTE m_nTxRetryLimit[MAX_MODEM_TX_PRIORITY] = {
+	0,                          // MODEM_TX_PRIORITY_POLL
+	MODEM_TX_CONTROL_RETRIES,   // MODEM_TX_PRIORITY_CONTROL
+};
+MODEM_TX_STATS m_ModemTxStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, MODEM_STALE_MESSAGE_TIMEOUT};
 static U_BYTE m_nSaveNcNodeRequestData[] = {0xFF};
 static U_BYTE m_nDbSizeRequestData[]     = {0x01};
 static const MODEM_REQUEST_STRUCT m_nModemRequestList[MAX_MODEM_REQUEST] = {
@@ -102,7 +124,6 @@ static const U_INT16 m_nConfigParameterTableIndex[MAX_CONFIG_PARAMETER_COUNT] =
 	MODEM_CONFIG_NETWORK_ID_MODE,
 };
 static U_INT16 m_nTxPacketTag = 0;
-static U_INT32 m_nTxMessageTransactionCounter = 0;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -110,51 +131,269 @@ static U_INT32 m_nTxMessageTransactionCounter = 0;
 
 /*******************************************************************************
 *       @details
+*       Queues a message for the downhole at control priority.  Kept for the
+*       callers that only need to know whether the message was taken.
 *******************************************************************************/
 BOOL Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength)
 {
-	if(pData == NULL) return false;
-	if(nLength == 0ul) return false;
-	if(m_nSendingMessage.bMessageInBuffer) return false;
-	m_nSendingMessage.nMessageLength = nLength;
-	memcpy((void*)m_nSendingMessage.nMessageData, (const void*)pData, m_nSendingMessage.nMessageLength);
-	m_nSendingMessage.bMessageInBuffer = true;
-	m_nSendingMessage.bMessageSent = false;
-	return true;
+	return (Modem_QueueMessage(pData, nLength, MODEM_TX_PRIORITY_CONTROL) != MODEM_TX_REJECTED);
 }
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   Modem_QueueMessage()
+;
+; Description:
+;   Puts a message in the transmit queue for ModemManager to send.  A poll
+;   that matches one already waiting or in flight is merged with it rather
+;   than queued twice.  When the queue is full a control message takes the
+;   slot of the oldest poll that has not been sent yet, so a backlog of
+;   polls can never lock out a command.
+;
+; Parameters:
+;   const U_BYTE *pData => message to send
+;   U_INT32 nLength => bytes in the message
+;   MODEM_TX_PRIORITY ePriority => poll or control
+;
+; Returns:
+;   MODEM_TX_RESULT => queued, merged with an earlier poll, or refused
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+MODEM_TX_RESULT Modem_QueueMessage(const U_BYTE *pData, U_INT32 nLength, MODEM_TX_PRIORITY ePriority)
+{
+	static U_INT32 nNextTransaction = 0;
+	MODEM_TX_SLOT *pSlot = NULL;
+	U_BYTE nSlot;
+	U_INT16 nInUse = 0;
+
+	if((pData == NULL) || (nLength == 0ul) || (nLength > MODEM_TX_MESSAGE_MAX) || (ePriority >= MAX_MODEM_TX_PRIORITY))
+	{
+		m_ModemTxStats.nRejected++;
+		return MODEM_TX_REJECTED;
+	}
+
+	for(nSlot = 0; nSlot < MODEM_TX_QUEUE_SIZE; nSlot++)
+	{
+		if(m_TxQueue[nSlot].eState == TX_SLOT_FREE)
+		{
+			if(pSlot == NULL)
+			{
+				pSlot = &m_TxQueue[nSlot];
+			}
+		}
+		else if((ePriority == MODEM_TX_PRIORITY_POLL) &&
+		        (m_TxQueue[nSlot].ePriority == MODEM_TX_PRIORITY_POLL) &&
+		        (m_TxQueue[nSlot].nMessageLength == nLength) &&
+		        (memcmp((const void *)m_TxQueue[nSlot].nMessageData, (const void *)pData, nLength) == 0))
+		{
+			m_ModemTxStats.nCoalesced++;
+			return MODEM_TX_COALESCED;
+		}
+	}
+
+	if((pSlot == NULL) && (ePriority == MODEM_TX_PRIORITY_CONTROL))
+	{
+		pSlot = txQueue_OldestWaiting(MODEM_TX_PRIORITY_POLL);
+		if(pSlot != NULL)
+		{
+			m_ModemTxStats.nEvicted++;
+		}
+	}
+	if(pSlot == NULL)
+	{
+		m_ModemTxStats.nRejected++;
+		return MODEM_TX_REJECTED;
+	}
+
+	pSlot->eState = TX_SLOT_WAITING;
+	pSlot->ePriority = ePriority;
+	pSlot->nRetries = 0;
+	pSlot->nTransaction = ++nNextTransaction;
+	pSlot->nMessageLength = (U_INT16)nLength;
+	memcpy((void *)pSlot->nMessageData, (const void *)pData, nLength);
+	m_ModemTxStats.nQueued++;
+
+	for(nSlot = 0; nSlot < MODEM_TX_QUEUE_SIZE; nSlot++)
+	{
+		if(m_TxQueue[nSlot].eState != TX_SLOT_FREE)
+		{
+			nInUse++;
+		}
+	}
+	if(nInUse > m_ModemTxStats.nMaxDepth)
+	{
+		m_ModemTxStats.nMaxDepth = nInUse;
+	}
+	return MODEM_TX_QUEUED;
+}// End Modem_QueueMessage()
+
+/*******************************************************************************
+*       @details
+*       Throws away everything in the transmit queue, including the packet in
+*       flight.
+*******************************************************************************/
 void ModemData_ResetTxMessage(void)
 {
-	m_nSendingMessage = m_nDefaultModemTxMessage;
+	U_BYTE nSlot;
+
+	for(nSlot = 0; nSlot < MODEM_TX_QUEUE_SIZE; nSlot++)
+	{
+		m_TxQueue[nSlot].eState = TX_SLOT_FREE;
+	}
+	m_pTxInFlight = NULL;
 }
 
 /*******************************************************************************
 *       @details
+*       True if a queued message is waiting to be sent.
 *******************************************************************************/
 BOOL TxMessageInBuffer(void)
 {
-	return m_nSendingMessage.bMessageInBuffer;
+	return ((txQueue_OldestWaiting(MODEM_TX_PRIORITY_CONTROL) != NULL) ||
+	        (txQueue_OldestWaiting(MODEM_TX_PRIORITY_POLL) != NULL));
 }
 
 /*******************************************************************************
 *       @details
+*       True while a packet is waiting for its transmit confirmation.
 *******************************************************************************/
 BOOL TxMessageSent(void)
 {
-	return m_nSendingMessage.bMessageSent;
+	return (m_pTxInFlight != NULL);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ModemData_TxMessageAcknowledged()
+;
+; Description:
+;   Frees the packet in flight once the modem confirms it was delivered.
+;   The time it took feeds the confirmation timeout, unless the packet had
+;   been resent: then there is no telling which send was confirmed and the
+;   sample is left out (Karn's rule).
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+void ModemData_TxMessageAcknowledged(void)
+{
+	if(m_pTxInFlight == NULL)
+	{
+		return;
+	}
+	if(m_pTxInFlight->nRetries == 0)
+	{
+		txQueue_UpdateRtt(ElapsedTimeLowRes(m_pTxInFlight->tSent));
+	}
+	m_pTxInFlight->eState = TX_SLOT_FREE;
+	m_pTxInFlight = NULL;
+	m_ModemTxStats.nAcked++;
+}// End ModemData_TxMessageAcknowledged()
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ModemData_RetryTxMessage()
+;
+; Description:
+;   Called when the packet in flight has not been confirmed in time.  If it
+;   has retries left it goes back to the queue to be sent again, ahead of
+;   anything newer of the same priority; otherwise it is dropped.
+;
+; Returns:
+;   BOOL => true if the packet will be resent, false if it was dropped
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+BOOL ModemData_RetryTxMessage(void)
+{
+	MODEM_TX_SLOT *pSlot = m_pTxInFlight;
+
+	if(pSlot == NULL)
+	{
+		return false;
+	}
+	m_pTxInFlight = NULL;
+	if(pSlot->nRetries < m_nTxRetryLimit[pSlot->ePriority])
+	{
+		pSlot->nRetries++;
+		pSlot->eState = TX_SLOT_WAITING;
+		m_ModemTxStats.nRetries++;
+		return true;
+	}
+	pSlot->eState = TX_SLOT_FREE;
+	m_ModemTxStats.nDropped++;
+	return false;
+}// End ModemData_RetryTxMessage()
+
+/*******************************************************************************
+*       @details
+*       How long the packet in flight may go unconfirmed.  The timeout is
+*       doubled for each resend of the packet, up to
+*       MODEM_STALE_MESSAGE_TIMEOUT.
+*******************************************************************************/
+TIME_LR ModemData_GetTxAckTimeout(void)
+{
+	TIME_LR tTimeout = m_ModemTxStats.tAckTimeout;
+	U_BYTE nRetry;
+
+	if(m_pTxInFlight != NULL)
+	{
+		for(nRetry = 0; (nRetry < m_pTxInFlight->nRetries) && (tTimeout < MODEM_STALE_MESSAGE_TIMEOUT); nRetry++)
+		{
+			tTimeout *= 2;
+		}
+	}
+	return (tTimeout > MODEM_STALE_MESSAGE_TIMEOUT) ? MODEM_STALE_MESSAGE_TIMEOUT : tTimeout;
 }
 
 /*******************************************************************************
 *       @details
 *******************************************************************************/
+/*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+; Function:
+;   ModemData_ProcessTxPacketRequest()
+;
+; Description:
+;   Sends the next queued message to the connected node: the oldest control
+;   message, or if there is none the oldest poll.  Only one packet is in
+;   flight at a time because the modem's transmit confirmation does not say
+;   which packet it belongs to.
+;
+; Reentrancy:
+;   No
+;~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 void ModemData_ProcessTxPacketRequest(void)
 {
 	BOOL bConnected;
 	MODEM_TX_PACKET_STRUCT nPacketHeader;
-	U_BYTE nDataToTx[256];
+	U_BYTE nDataToTx[MODEM_MESSAGE_BUFFER_SIZE];
+	MODEM_TX_SLOT *pSlot;
+
+	if(m_pTxInFlight != NULL)
+	{
+		return;
+	}
+	pSlot = txQueue_OldestWaiting(MODEM_TX_PRIORITY_CONTROL);
+	if(pSlot == NULL)
+	{
+		pSlot = txQueue_OldestWaiting(MODEM_TX_PRIORITY_POLL);
+	}
+	if(pSlot == NULL)
+	{
+		return;
+	}
 
 	nPacketHeader.nDataServiceType = 1;
 	nPacketHeader.nPriority = 0;
@@ -176,17 +415,17 @@ void ModemData_ProcessTxPacketRequest(void)
 	nDataToTx[8] = nPacketHeader.nDestinationPort;
 	memcpy((void *)&nDataToTx[9], (const void*)&nPacketHeader.nDestinationAddress, 2);
 
-	m_nTxMessageTransactionCounter++;
-
-	memcpy((void *)&nDataToTx[11], (const void*)&m_nTxMessageTransactionCounter, sizeof(m_nTxMessageTransactionCounter));
-	memcpy((void *)&nDataToTx[15], (const void*)m_nSendingMessage.nMessageData, m_nSendingMessage.nMessageLength);
+	memcpy((void *)&nDataToTx[11], (const void*)&pSlot->nTransaction, sizeof(pSlot->nTransaction));
+	memcpy((void *)&nDataToTx[MODEM_TX_PACKET_HEADER_SIZE], (const void*)pSlot->nMessageData, pSlot->nMessageLength);
 
 	if(bConnected)
 	{
-		ModemData_ProcessRequest(MODEM_REQUEST_TX_PACKET, nDataToTx, (11 + 4 + m_nSendingMessage.nMessageLength));
-		m_nSendingMessage.bMessageSent = true;
+		ModemData_ProcessRequest(MODEM_REQUEST_TX_PACKET, nDataToTx, (MODEM_TX_PACKET_HEADER_SIZE + pSlot->nMessageLength));
+		pSlot->eState = TX_SLOT_IN_FLIGHT;
+		pSlot->tSent = ElapsedTimeLowRes(START_LOW_RES_TIMER);
+		m_pTxInFlight = pSlot;
 	}
-}
+}// End ModemData_ProcessTxPacketRequest()
 
 /*******************************************************************************
 *       @details
@@ -270,3 +509,63 @@ static U_INT16 copyMessageToTxBuffer(void)
 	*pData++ = m_nModemTxCommand.nCheckSum;
 	return (U_INT16)(m_nModemTxCommand.nLength.AsHalfWord + 4);
 }//end copyMessageToTxBuffer
+
+/*******************************************************************************
+*       @details
+*       Oldest message of the given priority that is waiting to be sent, NULL
+*       if there is none.
+*******************************************************************************/
+static MODEM_TX_SLOT *txQueue_OldestWaiting(MODEM_TX_PRIORITY ePriority)
+{
+	MODEM_TX_SLOT *pOldest = NULL;
+	U_BYTE nSlot;
+
+	for(nSlot = 0; nSlot < MODEM_TX_QUEUE_SIZE; nSlot++)
+	{
+		if((m_TxQueue[nSlot].eState == TX_SLOT_WAITING) &&
+		   (m_TxQueue[nSlot].ePriority == ePriority) &&
+		   ((pOldest == NULL) || (m_TxQueue[nSlot].nTransaction < pOldest->nTransaction)))
+		{
+			pOldest = &m_TxQueue[nSlot];
+		}
+	}
+	return pOldest;
+}
+
+/*******************************************************************************
+*       @details
+*       Folds a confirmation time into the smoothed round trip and its mean
+*       deviation and works out the next confirmation timeout from them, the
+*       same way TCP sets its retransmit timer (RFC 6298).
+*******************************************************************************/
+static void txQueue_UpdateRtt(TIME_LR tSample)
+{
+	TIME_LR tError;
+	TIME_LR tTimeout;
+
+	if(tSample == 0)
+	{
+		tSample = MILLI_SECOND;
+	}
+	if(m_ModemTxStats.tSmoothedRtt == 0)
+	{
+		m_ModemTxStats.tSmoothedRtt = tSample;
+		m_ModemTxStats.tRttVariance = tSample / 2;
+	}
+	else
+	{
+		tError = (m_ModemTxStats.tSmoothedRtt > tSample) ? (m_ModemTxStats.tSmoothedRtt - tSample) : (tSample - m_ModemTxStats.tSmoothedRtt);
+		m_ModemTxStats.tRttVariance = ((3 * m_ModemTxStats.tRttVariance) + tError) / 4;
+		m_ModemTxStats.tSmoothedRtt = ((7 * m_ModemTxStats.tSmoothedRtt) + tSample) / 8;
+	}
+	tTimeout = m_ModemTxStats.tSmoothedRtt + (4 * m_ModemTxStats.tRttVariance);
+	if(tTimeout < MODEM_TX_MIN_ACK_TIMEOUT)
+	{
+		tTimeout = MODEM_TX_MIN_ACK_TIMEOUT;
+	}
+	else if(tTimeout > MODEM_STALE_MESSAGE_TIMEOUT)
+	{
+		tTimeout = MODEM_STALE_MESSAGE_TIMEOUT;
+	}
+	m_ModemTxStats.tAckTimeout = tTimeout;
+}
@@ -73,6 +73,8 @@ typedef enum {
 
 static U_INT16 m_nNodeToDelete = 0;
 volatile BOOL WakeUpModemReset = 0;
+// number of times MODEM_RESPONSE_WAIT gave up and reset the modem
+U_INT32 m_nModemResponseTimeouts = 0;
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
 //============================================================================//
@@ -141,7 +143,7 @@ void ModemManager(void)
 			{
 				bFirstRunTrough = true;
 				tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
-				ModemData_ResetRxResponse();
+				ModemData_FlushRxResponses();
 				ModemDriver_PutInHardwareReset(false);
 				nModemManagerStateMachine = MODEM_RESET_WAIT;
 			}
@@ -150,7 +152,7 @@ void ModemManager(void)
 		case MODEM_SW_RESET:
 		{
 			tDelayTimeout = ElapsedTimeLowRes(START_LOW_RES_TIMER);
-			ModemData_ResetRxResponse();
+			ModemData_FlushRxResponses();
 			ModemData_ProcessRequest(MODEM_REQUEST_SW_RESET, NULL, 0);
 			nModemManagerStateMachine = MODEM_RESET_WAIT;
 		}
@@ -458,8 +460,9 @@ void ModemManager(void)
 				nModemManagerStateMachine = nSavedModemManagerStateMachine;
 				nSavedModemManagerStateMachine = MODEM_HW_RESET;
 			}
-			else if(ElapsedTimeLowRes(tDelayTimeout) > FIVE_SECOND)
+			else if(ElapsedTimeLowRes(tDelayTimeout) > MODEM_RESPONSE_TIMEOUT)
 			{
+				m_nModemResponseTimeouts++;
 				nModemManagerStateMachine = MODEM_HW_RESET;
 				nSavedModemManagerStateMachine = MODEM_HW_RESET;
 			}
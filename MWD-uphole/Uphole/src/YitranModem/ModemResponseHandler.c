@@ -38,6 +38,8 @@
 BOOL bFirstResponseReceived;
 BOOL bLookingForResponse;
 TIME_LR tResponse;
+// number of downhole packets dropped without a transmit confirmation
+U_INT32 m_nModemStaleMessages = 0;
 
 //============================================================================//
 //      FUNCTION IMPLEMENTATIONS                                              //
@@ -84,8 +86,8 @@ MODEM_REPLY_TYPE ProcessOnlineResponse(void)
 						case 3:
 							if(bFirstResponseReceived)
 							{
+								ModemData_TxMessageAcknowledged();
 								ModemData_ResetTxMessageResponse();
-								ModemData_ResetTxMessage();
 							}
 							break;
 						default:
@@ -129,12 +131,18 @@ void ModemData_SetResponseExpected(void)
 
 /*******************************************************************************
 *       @details
+*       Gives up waiting on the packet in flight once its confirmation timeout
+*       has passed.  It is queued to be sent again if it has retries left,
+*       otherwise it is dropped and counted as stale.
 *******************************************************************************/
 void ModemData_CheckForStaleMessage(void)
 {
-	if(bLookingForResponse && (ElapsedTimeLowRes(tResponse) > FIVE_SECOND))
+	if(bLookingForResponse && (ElapsedTimeLowRes(tResponse) > ModemData_GetTxAckTimeout()))
 	{
+		if(!ModemData_RetryTxMessage())
+		{
+			m_nModemStaleMessages++;
+		}
 		ModemData_ResetTxMessageResponse();
-		ModemData_ResetTxMessage();
 	}
 }
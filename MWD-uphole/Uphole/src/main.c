@@ -23,6 +23,7 @@
 #include "adc.h"
 #include "board.h"
 #include "buzzer.h"
+#include "CommDriver_Flash.h"
 #include "CommDriver_SPI.h"
 #include "CommDriver_UART.h"
 #include "ModemDriver.h"
@@ -37,11 +38,14 @@
 #include "SysTick.h"
 #include "timer.h"
 #include "wdt.h"
+#include "Profile.h"
 #include "UI_api.h"
 #include "UI_BoxSetupTab.h"
 #include "TargetProtocol.h"
 #include "PCDataTransfer.h"
+#include "PCBulkTransfer.h"
 #include "LoggingManager.h"
+#include "RecordManager.h"
 #include "tone_generator.h"
 
 //============================================================================//
@@ -152,6 +156,11 @@ void main(void)
 	// Initialize the SysTick (1ms) interrupt
 	//-------------------------------------------------------------
 	SysTick_Init();
+	//-------------------------------------------------------------
+	// Start the cycle counter used to time the graph, flash and
+	// PC transfer code paths (see Profile.h)
+	//-------------------------------------------------------------
+	PROFILE_Init();
 	__enable_interrupt();
 	//-------------------------------------------------------------
 	// Detect serial flash, test it, and get our secure parameters
@@ -178,6 +187,12 @@ void main(void)
 	// whether checksum is OK or not, check boundaries
 	//-------------------------------------------------------------
 	Check_NV_data_boundaries();
+	//-------------------------------------------------------------
+	// fold any surveys left in the journal into their record pages,
+	// then drop any half done change to the borehole statistics
+	//-------------------------------------------------------------
+	RECORD_JournalRecover();
+	RECORD_RecoverBoreholeStats();
      
 #if 0
 	if(!Serflash_read_Borehole_Block())
@@ -209,20 +224,22 @@ void main(void)
 		KickWatchdog();
 		// simple timer based beeper on/off control
 		BuzzerHandler();
-		// This function moves serial data from the DMA receiving buffer to the
-		// main receive buffer for the UART module.  It should be big enough to
-		// handle a full Cycle Handler's worth of data
-		UART_ServiceRxBufferDMA();
-		// This function moves serial data from the UART receiving buffer to the
-		// applications message buffer.  It should be big enough to handle a
-		// full Serial Message.
+		// This function hands the data link's received data from the DMA
+		// receiving buffer to the modem.  The PC port's lines are read
+		// straight out of the DMA buffer by PCDataTransfer.
 		UART_ServiceRxBuffer();
 		// mainly looks to process modem data
 		UART_ProcessRxData();
+		// streams the binary borehole download as fast as the PC port allows
+		PCBULK_Service();
 		// the flags are created in the systimer interrupt
 		if(Ten_mS_tick_flag)
 		{
 			Ten_mS_tick_flag = 0;
+			// one step of any queued flash page write, never waits on the chip
+			FLASH_WriteService();
+			// one record page of a desired azimuth recompute, if one is running
+			RECORD_RecomputeService();
 //			Keypad_StartCapture();
 			ModemManager();
 			if (UI_StartupComplete())
@@ -238,6 +255,7 @@ void main(void)
 			UpdateRTC();
 			LCD_Update();
 			Serflash_check_NV_Block();
+			RECORD_JournalService();
 //			Serflash_check_Borehole_Block();
 //			Serflash_check_Newhole_Block();
 		}
@@ -294,6 +312,9 @@ void main(void)
 			{
 				nSleepCounter = 0;
 				SetUIKeyPressEvent();
+				// standby loses SRAM and the flash write queue with it
+				RECORD_JournalFlush();
+				(void)FLASH_FlushWrites();
 				PWR_ClearFlag(PWR_FLAG_SB | PWR_FLAG_WU);
 				PWR_EnterSTANDBYMode();
 				SystemInit();
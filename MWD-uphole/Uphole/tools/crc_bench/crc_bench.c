@@ -0,0 +1,216 @@
+/*******************************************************************************
+*       @brief      Host check of CRC_CalculateOnSpan() against a bit by bit
+*                   model of the STM32F4 CRC unit, and a timing of the table
+*                   against that model.  Not part of the firmware build.
+*       @file       Uphole/tools/crc_bench/crc_bench.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           crc_bench.c ../../src/crc.c -o crc_bench && ./crc_bench
+*
+*       It exits non zero if any checksum differs from the model.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "crc.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CRC_POLYNOMIAL      0x04C11DB7u
+#define CRC_SEED            0xFFFFFFFFu
+
+#define CHECK_RUNS          2000    // random messages checked
+#define CHECK_MAX_LENGTH    600     // longer than any RASP frame
+#define BENCH_LENGTH        4096
+#define BENCH_RUNS          20000
+#define MODEL_RUNS          (BENCH_RUNS / 20)   // the model is that much slower
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       The firmware never calls these here, CalculateCRC() needs them to link.
+*******************************************************************************/
+void CRC_ResetDR(void)
+{
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t pBuffer[], uint32_t BufferLength)
+{
+    (void)pBuffer;
+    (void)BufferLength;
+    return 0;
+}
+
+/*******************************************************************************
+*       @details
+*       One write of a 32-bit word to CRC->DR: MSB first, no reflection, no
+*       final XOR (RM0090 CRC calculation unit).
+*******************************************************************************/
+static uint32_t ModelWord(uint32_t nCRC, uint32_t nWord)
+{
+    int nBit;
+
+    nCRC ^= nWord;
+    for (nBit = 0; nBit < 32; nBit++)
+    {
+        nCRC = (nCRC & 0x80000000u) ? ((nCRC << 1) ^ CRC_POLYNOMIAL) : (nCRC << 1);
+    }
+    return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*       Each byte goes to the unit as its own word, the way RASP feeds it.
+*******************************************************************************/
+static uint32_t ModelSpan(uint32_t nCRC, const U_BYTE *pData, int nLength)
+{
+    int nIndex;
+
+    for (nIndex = 0; nIndex < nLength; nIndex++)
+    {
+        nCRC = ModelWord(nCRC, pData[nIndex]);
+    }
+    return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+/*******************************************************************************
+*       @details
+*       Random messages split into random spans, so running values carried
+*       between calls are checked as well as whole messages.  Only the low 32
+*       bits of U_INT32 are compared, it is wider on a 64-bit host.
+*******************************************************************************/
+static int CheckBitExact(void)
+{
+    static U_BYTE nMessage[CHECK_MAX_LENGTH];
+    U_INT32 nSpanCRC, nByteCRC;
+    uint32_t nModel;
+    int nRun, nLength, nIndex, nSpan;
+
+    srand(1);
+    for (nRun = 0; nRun < CHECK_RUNS; nRun++)
+    {
+        nLength = rand() % CHECK_MAX_LENGTH;
+        for (nIndex = 0; nIndex < nLength; nIndex++)
+        {
+            nMessage[nIndex] = (U_BYTE)rand();
+        }
+        nModel = ModelSpan(CRC_SEED, nMessage, nLength);
+
+        ResetCRC(&nSpanCRC);
+        for (nIndex = 0; nIndex < nLength; nIndex += nSpan)
+        {
+            nSpan = rand() % 50;
+            if (nSpan > (nLength - nIndex))
+            {
+                nSpan = nLength - nIndex;
+            }
+            CRC_CalculateOnSpan(&nSpanCRC, &nMessage[nIndex], (U_INT16)nSpan);
+        }
+
+        ResetCRC(&nByteCRC);
+        for (nIndex = 0; nIndex < nLength; nIndex++)
+        {
+            CRC_CalculateOnByte(&nByteCRC, nMessage[nIndex]);
+        }
+
+        if (((uint32_t)nSpanCRC != nModel) || ((uint32_t)nByteCRC != nModel))
+        {
+            printf("MISMATCH length %d: model %08lX span %08lX byte %08lX\n", nLength,
+                   (unsigned long)nModel, (unsigned long)(uint32_t)nSpanCRC,
+                   (unsigned long)(uint32_t)nByteCRC);
+            return 0;
+        }
+    }
+    printf("bit exact: %d messages up to %d bytes\n", CHECK_RUNS, CHECK_MAX_LENGTH);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Bench(void)
+{
+    static U_BYTE nBuffer[BENCH_LENGTH];
+    volatile uint32_t nSink = 0;
+    U_INT32 nCRC;
+    double fStart, fModel, fSpan, fByte;
+    int nRun, nIndex;
+
+    for (nIndex = 0; nIndex < BENCH_LENGTH; nIndex++)
+    {
+        nBuffer[nIndex] = (U_BYTE)rand();
+    }
+
+    fStart = Seconds();
+    for (nRun = 0; nRun < MODEL_RUNS; nRun++)
+    {
+        nSink ^= ModelSpan(CRC_SEED, nBuffer, BENCH_LENGTH);
+    }
+    fModel = Seconds();
+    for (nRun = 0; nRun < BENCH_RUNS; nRun++)
+    {
+        ResetCRC(&nCRC);
+        CRC_CalculateOnSpan(&nCRC, nBuffer, BENCH_LENGTH);
+        nSink ^= (uint32_t)nCRC;
+    }
+    fSpan = Seconds();
+    for (nRun = 0; nRun < BENCH_RUNS; nRun++)
+    {
+        ResetCRC(&nCRC);
+        for (nIndex = 0; nIndex < BENCH_LENGTH; nIndex++)
+        {
+            CRC_CalculateOnByte(&nCRC, nBuffer[nIndex]);
+        }
+        nSink ^= (uint32_t)nCRC;
+    }
+    fByte = Seconds();
+
+    printf("bit by bit model    %6.2f ns/byte\n", (fModel - fStart) * 1e9 / ((double)MODEL_RUNS * BENCH_LENGTH));
+    printf("table, one span     %6.2f ns/byte\n", (fSpan - fModel) * 1e9 / ((double)BENCH_RUNS * BENCH_LENGTH));
+    printf("table, byte a call  %6.2f ns/byte\n", (fByte - fSpan) * 1e9 / ((double)BENCH_RUNS * BENCH_LENGTH));
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    if (!CheckBitExact())
+    {
+        return 1;
+    }
+    Bench();
+    return 0;
+}
@@ -0,0 +1,458 @@
+/*******************************************************************************
+*       @brief      Host fuzz check of the streaming CSV parser used by the PC
+*                   upload, and a timing of CSV_AddChar() on survey lines and
+*                   on full length fields.  Not part of the firmware build.
+*       @file       Uphole/tools/csv_bench/csv_bench.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/SerialProtocol -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           csv_bench.c ../../src/SerialProtocol/CSVParser.c -o csv_bench
+*           && ./csv_bench [seed] [lines]
+*
+*       Add -g -fsanitize=address,undefined to run the fuzz under the
+*       sanitizers.  It exits non zero if a well formed line parses to
+*       anything but the fields it was built from, or if random input leaves
+*       the parser in a state that breaks its own limits.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "CSVParser.h"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CHECK_LINES         200000  // well formed lines, and random lines
+#define RANDOM_MAX_LENGTH   (CSV_MAX_LINE_LENGTH * 3)   // runs into every limit
+#define BENCH_BYTES         (4 * 1024 * 1024)
+#define SURVEY_COLUMNS      35      // columns of a survey upload line
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// One generated line: the text fed to the parser and the fields it must give
+typedef struct
+{
+    char sLine[CSV_MAX_LINE_LENGTH * 3];
+    int nLength;
+    char sField[CSV_MAX_COLUMNS][CSV_MAX_FIELD_LENGTH + 1];
+    int nFixed[CSV_MAX_COLUMNS];        // value * 10, or -1 if not a number
+    int nColumns;
+} EXPECTED_LINE;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Append(EXPECTED_LINE *pLine, char nChar)
+{
+    pLine->sLine[pLine->nLength++] = nChar;
+}
+
+/*******************************************************************************
+*       @details
+*       Any printable character but the line ends.  Commas and quotes come up
+*       often so quoting is exercised on most lines.
+*******************************************************************************/
+static char RandomText(void)
+{
+    switch (rand() % 8)
+    {
+        case 0:
+            return ',';
+        case 1:
+            return '"';
+        case 2:
+            return ' ';
+        default:
+            return (char)(' ' + (rand() % 95));
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Builds a line the parser must take without complaint: the fields fit
+*       CSV_MAX_FIELD_LENGTH and CSV_MAX_LINE_LENGTH together, unquoted fields
+*       hold no comma or quote and do not start with a space, and quoted
+*       fields double their quotes.  About a third of the fields are decimal
+*       numbers so CSV_GetFixed() is checked against the value written.
+*******************************************************************************/
+static void BuildLine(EXPECTED_LINE *pLine)
+{
+    int nRoom = CSV_MAX_LINE_LENGTH - 1;
+    int nColumn, nIndex, nFieldLength, nValue;
+    char *pField;
+
+    pLine->nLength = 0;
+    pLine->nColumns = 1 + (rand() % CSV_MAX_COLUMNS);
+    for (nColumn = 0; nColumn < pLine->nColumns; nColumn++)
+    {
+        pField = pLine->sField[nColumn];
+        pLine->nFixed[nColumn] = -1;
+        nFieldLength = rand() % (CSV_MAX_FIELD_LENGTH + 1);
+        if (nFieldLength > (nRoom - (pLine->nColumns - nColumn)))
+        {
+            nFieldLength = nRoom - (pLine->nColumns - nColumn);
+        }
+        if (nFieldLength < 0)
+        {
+            nFieldLength = 0;
+        }
+
+        if (nColumn > 0)
+        {
+            Append(pLine, ',');
+        }
+
+        if ((rand() % 3) == 0)
+        {
+            nValue = rand() % 36000;
+            nIndex = sprintf(pField, "%d.%d", nValue / 10, nValue % 10);
+            if (nIndex <= nFieldLength)
+            {
+                pLine->nFixed[nColumn] = nValue;
+                memcpy(&pLine->sLine[pLine->nLength], pField, nIndex);
+                pLine->nLength += nIndex;
+                nRoom -= nIndex + 1;
+                continue;
+            }
+        }
+
+        for (nIndex = 0; nIndex < nFieldLength; nIndex++)
+        {
+            pField[nIndex] = RandomText();
+        }
+        pField[nFieldLength] = '\0';
+
+        if ((strpbrk(pField, ",\"") != NULL) || (pField[0] == ' ') || (rand() % 4 == 0))
+        {
+            Append(pLine, '"');
+            for (nIndex = 0; nIndex < nFieldLength; nIndex++)
+            {
+                if (pField[nIndex] == '"')
+                {
+                    Append(pLine, '"');
+                }
+                Append(pLine, pField[nIndex]);
+            }
+            Append(pLine, '"');
+        }
+        else
+        {
+            memcpy(&pLine->sLine[pLine->nLength], pField, nFieldLength);
+            pLine->nLength += nFieldLength;
+        }
+        nRoom -= nFieldLength + 1;
+    }
+
+    // a lone empty field is written as "" so no line is blank, a blank line
+    // after a '\r' would be taken as the rest of a CRLF
+    if (pLine->nLength == 0)
+    {
+        Append(pLine, '"');
+        Append(pLine, '"');
+    }
+
+    switch (rand() % 3)
+    {
+        case 0:
+            Append(pLine, '\n');
+            break;
+        case 1:
+            Append(pLine, '\r');
+            Append(pLine, '\n');
+            break;
+        default:
+            Append(pLine, '\r');
+            break;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Streams well formed lines through one parser, so the CRLF carry over
+*       between lines is checked too, and compares every field.
+*******************************************************************************/
+static int CheckWellFormed(int nLines)
+{
+    static EXPECTED_LINE line;
+    CSV_LINE_PARSER parser;
+    const char *pField;
+    INT32 nFixed;
+    int nRun, nIndex, nColumn, nCompleted;
+
+    CSV_Init(&parser);
+    for (nRun = 0; nRun < nLines; nRun++)
+    {
+        BuildLine(&line);
+        nCompleted = 0;
+        for (nIndex = 0; nIndex < line.nLength; nIndex++)
+        {
+            if (!CSV_AddChar(&parser, line.sLine[nIndex]))
+            {
+                continue;
+            }
+            nCompleted++;
+
+            if ((parser.eStatus != CSV_OK) || (CSV_GetColumnCount(&parser) != line.nColumns))
+            {
+                printf("MISMATCH line %d: status %d, %d columns, expected %d\n", nRun,
+                       (int)parser.eStatus, CSV_GetColumnCount(&parser), line.nColumns);
+                return 0;
+            }
+            for (nColumn = 0; nColumn < line.nColumns; nColumn++)
+            {
+                pField = CSV_GetField(&parser, (U_BYTE)nColumn);
+                if ((pField == NULL) || (strcmp(pField, line.sField[nColumn]) != 0))
+                {
+                    printf("MISMATCH line %d column %d: \"%s\", expected \"%s\"\n", nRun, nColumn,
+                           pField ? pField : "(null)", line.sField[nColumn]);
+                    return 0;
+                }
+                if ((line.nFixed[nColumn] >= 0) &&
+                    (!CSV_GetFixed(&parser, (U_BYTE)nColumn, 1, &nFixed) || (nFixed != line.nFixed[nColumn])))
+                {
+                    printf("MISMATCH line %d column %d: \"%s\" fixed %ld, expected %d\n", nRun, nColumn,
+                           pField, (long)nFixed, line.nFixed[nColumn]);
+                    return 0;
+                }
+            }
+        }
+        if (nCompleted != 1)
+        {
+            printf("MISMATCH line %d: completed %d times\n", nRun, nCompleted);
+            return 0;
+        }
+    }
+    printf("well formed: %d lines, every field matches\n", nLines);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       The limits CSVParser.h promises for a finished line, whatever came in.
+*       A field's terminator has to sit inside sText, so reading a field never
+*       runs past the buffer.
+*******************************************************************************/
+static int CheckLimits(const CSV_LINE_PARSER *pParser, int nRun)
+{
+    const char *pField;
+    const char *pEnd;
+    INT32 nFixed;
+    REAL32 fReal;
+    int nColumn;
+
+    if ((pParser->nColumns < 1) || (pParser->nColumns > CSV_MAX_COLUMNS) ||
+        (pParser->nLength > CSV_MAX_LINE_LENGTH) || (pParser->eStatus > CSV_BAD_QUOTE))
+    {
+        printf("MISMATCH random line %d: %d columns, length %d, status %d\n", nRun,
+               pParser->nColumns, pParser->nLength, (int)pParser->eStatus);
+        return 0;
+    }
+    for (nColumn = 0; nColumn < pParser->nColumns; nColumn++)
+    {
+        pField = CSV_GetField(pParser, (U_BYTE)nColumn);
+        if ((pField < pParser->sText) || (pField >= &pParser->sText[CSV_MAX_LINE_LENGTH]))
+        {
+            printf("MISMATCH random line %d column %d: field outside the line\n", nRun, nColumn);
+            return 0;
+        }
+        pEnd = memchr(pField, '\0', &pParser->sText[CSV_MAX_LINE_LENGTH] - pField);
+        if ((pEnd == NULL) || ((pEnd - pField) > CSV_MAX_FIELD_LENGTH))
+        {
+            printf("MISMATCH random line %d column %d: field not terminated in %d characters\n",
+                   nRun, nColumn, CSV_MAX_FIELD_LENGTH);
+            return 0;
+        }
+        (void)CSV_GetFixed(pParser, (U_BYTE)nColumn, 9, &nFixed);
+        (void)CSV_GetReal(pParser, (U_BYTE)nColumn, &fReal);
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Random bytes of every value, heavy on the ones the parser acts on, in
+*       lines long enough to run out of fields, columns and line space.  A
+*       stray '\r' now and then splits a line early, so a line may begin
+*       with the '\n' of a CRLF.
+*******************************************************************************/
+static int CheckRandom(int nLines)
+{
+    static const char sSpecial[] = { ',', ',', ',', '"', ' ', '-', '.', '0' };
+    CSV_LINE_PARSER *pParser = malloc(sizeof(CSV_LINE_PARSER));
+    int nRun, nIndex, nLength, nStatus[CSV_BAD_QUOTE + 1] = { 0 };
+    char nChar;
+
+    if (pParser == NULL)
+    {
+        return 0;
+    }
+    CSV_Init(pParser);
+    for (nRun = 0; nRun < nLines; nRun++)
+    {
+        nLength = rand() % RANDOM_MAX_LENGTH;
+        for (nIndex = 0; nIndex <= nLength; nIndex++)
+        {
+            if (nIndex == nLength)
+            {
+                nChar = '\n';
+            }
+            else if ((rand() % 400) == 0)
+            {
+                nChar = '\r';
+            }
+            else if ((rand() % 3) == 0)
+            {
+                nChar = sSpecial[rand() % sizeof(sSpecial)];
+            }
+            else
+            {
+                nChar = (char)rand();
+                if ((nChar == '\n') || (nChar == '\r'))
+                {
+                    nChar = ',';    // keep most lines long enough to overflow
+                }
+            }
+            if (CSV_AddChar(pParser, nChar))
+            {
+                if (!CheckLimits(pParser, nRun))
+                {
+                    free(pParser);
+                    return 0;
+                }
+                nStatus[pParser->eStatus]++;
+            }
+        }
+    }
+    free(pParser);
+    printf("random: %d lines, ok %d, columns %d, field %d, line %d, quote %d\n", nLines,
+           nStatus[CSV_OK], nStatus[CSV_TOO_MANY_COLUMNS], nStatus[CSV_FIELD_TOO_LONG],
+           nStatus[CSV_LINE_TOO_LONG], nStatus[CSV_BAD_QUOTE]);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static double TimeParse(const char *pText, int nLength, int *pLines)
+{
+    CSV_LINE_PARSER parser;
+    double fStart;
+    int nIndex;
+
+    *pLines = 0;
+    CSV_Init(&parser);
+    fStart = Seconds();
+    for (nIndex = 0; nIndex < nLength; nIndex++)
+    {
+        if (CSV_AddChar(&parser, pText[nIndex]))
+        {
+            (*pLines)++;
+        }
+    }
+    return Seconds() - fStart;
+}
+
+/*******************************************************************************
+*       @details
+*       Survey lines shaped like the upload, then lines of full length
+*       fields.  With a cursor per column the cost per byte should not grow
+*       with the field length.
+*******************************************************************************/
+static void Bench(void)
+{
+    char *pText = malloc(BENCH_BYTES + CSV_MAX_LINE_LENGTH);
+    double fSeconds;
+    int nLength, nColumn, nIndex, nLines;
+
+    if (pText == NULL)
+    {
+        return;
+    }
+
+    for (nLength = 0; nLength < BENCH_BYTES; )
+    {
+        nLength += sprintf(&pText[nLength], "%d,2026-10-17,12:%02d:%02d", rand() % 10000,
+                           rand() % 60, rand() % 60);
+        for (nColumn = 3; nColumn < SURVEY_COLUMNS; nColumn++)
+        {
+            nLength += sprintf(&pText[nLength], ",%d.%d", rand() % 3600, rand() % 10);
+        }
+        pText[nLength++] = '\r';
+        pText[nLength++] = '\n';
+    }
+    fSeconds = TimeParse(pText, nLength, &nLines);
+    printf("survey lines        %6.2f ns/byte, %8.0f lines/s\n", fSeconds * 1e9 / nLength,
+           nLines / fSeconds);
+
+    for (nLength = 0; nLength < BENCH_BYTES; )
+    {
+        for (nColumn = 0; nColumn < 3; nColumn++)
+        {
+            for (nIndex = 0; nIndex < CSV_MAX_FIELD_LENGTH; nIndex++)
+            {
+                pText[nLength++] = (char)('a' + (rand() % 26));
+            }
+            pText[nLength++] = ',';
+        }
+        pText[nLength - 1] = '\n';
+    }
+    fSeconds = TimeParse(pText, nLength, &nLines);
+    printf("%d char fields      %6.2f ns/byte, %8.0f lines/s\n", CSV_MAX_FIELD_LENGTH,
+           fSeconds * 1e9 / nLength, nLines / fSeconds);
+
+    free(pText);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    int nLines = CHECK_LINES;
+
+    srand((argc > 1) ? (unsigned)strtoul(argv[1], NULL, 0) : 1);
+    if (argc > 2)
+    {
+        nLines = atoi(argv[2]);
+    }
+
+    if (!CheckWellFormed(nLines) || !CheckRandom(nLines))
+    {
+        return 1;
+    }
+    Bench();
+    return 0;
+}
@@ -0,0 +1,702 @@
+/*******************************************************************************
+*       @brief      Host check of the survey journal in RecordManager.c:
+*                   random uploads and removals into a model of the serial
+*                   flash, cut off by power losses that tear the page being
+*                   programmed, each followed by the power up recovery.
+*                   Not part of the firmware build.
+*       @file       Uphole/tools/journal_check/journal_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc.  The battery
+*       backed variables are IAR placed, so RecordManager.c is first copied
+*       with them turned into plain statics:
+*
+*       sed -e 's/^__no_init //' -e 's/^@ "[A-Z_]*";/;/'
+*           ../../src/DataManagers/RecordManager.c > record_host.c &&
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/DataManagers -I../../inc/SerialFlash
+*           -I../../inc/CommDrivers -I../../inc/Logging -I../../inc/RealTimeCLock
+*           -I../../inc/HardwareInterfaces -I../../inc/Graph_Plot
+*           -I../../inc/UI_Panels -I../../inc/UI_Tabs -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           journal_check.c ../../src/crc.c -lm -o journal_check && ./journal_check
+*
+*       U_INT32 is 64 bits on a 64 bit host, so fewer records fit a page
+*       than on the target; the journal depends on neither.
+*       A survey counts as saved once a write holding it, its record page or
+*       a journal entry, is programmed.  It exits non zero if a saved survey
+*       does not read back from its record page after the recovery, one is
+*       left out by an orderly shutdown, or a page is programmed over bytes
+*       that are not erased.  A record page whose own write fails or is torn
+*       loses what it held, as it always has, and its surveys are let go.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32f4xx.h"
+#include "portable.h"
+
+// rtc.h needs the IAR intrinsics and the panel and tab headers pull in the
+// whole user interface, so RecordManager.c gets these instead.
+#define RTC_H
+#define UI_RECORD_DATA_PANEL_H
+#define UI_CHANGEPIPELENGTHCORRECT_DECISION_PANEL_H
+#define UI_ENTERNEWPIPELENGTH_PANEL_H
+#define UI_JOB_TAB_H
+
+typedef U_INT32 TIME_RT;
+U_INT32 RTC_GetSeconds(void);
+void RecordData_StoreSelectSurveyIndex(U_INT32 index);
+BOOL GetChangePipeLengthFlag(void);
+void SetChangePipeLengthFlag(BOOL bFlag);
+INT16 GetNewPipeLength(void);
+void SetNewPipeLength(INT16 length);
+INT16 GetDesiredAzimuth(void);
+INT16 GetDefaultPipeLength(void);
+INT16 GetDeclination(void);
+char* GetBoreholeName(void);
+extern volatile BOOL Shift_Button_Pushed_Flag;
+
+#include "record_host.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CRC_POLYNOMIAL      0x04C11DB7u
+#define CRC_SEED            0xFFFFFFFFu
+
+#define JOURNAL_START_PAGE  192     // leaves 64 record pages
+#define FLASH_PAGES         (JOURNAL_START_PAGE + RECORD_JOURNAL_PAGES)
+#define PAGE_BYTES          (FLASH_PAGE_SIZE + sizeof(uint32_t))
+#define MAX_RECORDS         (64 * RECORDS_PER_PAGE)
+#define POWER_CYCLES        3000
+#define MAX_STEPS           40     // uploads and removals between power losses
+
+// Chances are in 1000.
+#define CHANCE_FAIL         4       // a queued write fails part way
+#define CHANCE_TEAR         700     // a power loss tears the write in progress
+#define CHANCE_SHUTDOWN     150     // the power goes off after RECORD_JournalFlush()
+#define CHANCE_REMOVE       80
+#define CHANCE_SERVICE      300     // the 100 ms tick runs RECORD_JournalService()
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A page write waiting for the model flash, as the driver queues it.  The
+// CRC word follows the page when bWithCrc is set.
+typedef struct
+{
+    U_BYTE nData[PAGE_BYTES];
+    U_INT32 nPageNumber;
+    BOOL bWithCrc;
+    BOOL bErase;
+    FLASH_WRITE_CALLBACK pCallback;
+} QUEUED_WRITE;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// Stand ins for what RecordManager.c calls outside the journal.
+volatile Flash_chip_type Serial_Flash_Chip;
+BOREHOLE_STATISTICS boreholeStatistics;
+NEWHOLE_INFO newHole_tracker;
+volatile BOOL Shift_Button_Pushed_Flag;
+volatile BOOL SurveyTakenFlag;
+volatile BOOL SystemArmedFlag;
+volatile INT16 TakeSurvey_Time_Out_Seconds;
+
+static U_BYTE m_nFlash[FLASH_PAGES][PAGE_BYTES];
+static QUEUED_WRITE m_Queue[FLASH_WRITE_QUEUE_SIZE];
+static int m_nQueueHead;
+static int m_nQueueCount;
+static BOOL m_bWriteFailed;
+static BOOL m_bFailures;        // queued writes may fail
+static BOOL m_bProgrammedOver;
+static TIME_LR m_tNow;
+
+// The newest copy of each survey of the file, and whether it is saved.
+static STRUCT_RECORD_DATA m_Expected[MAX_RECORDS];
+static BOOL m_bStored[MAX_RECORDS];
+static BOOL m_bSaved[MAX_RECORDS];
+static U_INT32 m_nVersion;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       The STM32F4 CRC unit, a word at a time: MSB first, no reflection, no
+*       final XOR (RM0090 CRC calculation unit).  CalculateCRC() feeds it.
+*******************************************************************************/
+void CRC_ResetDR(void)
+{
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t pBuffer[], uint32_t BufferLength)
+{
+    uint32_t nCRC = CRC_SEED;
+    uint32_t nWord;
+    int nBit;
+
+    for (nWord = 0; nWord < BufferLength; nWord++)
+    {
+        nCRC ^= pBuffer[nWord];
+        for (nBit = 0; nBit < 32; nBit++)
+        {
+            nCRC = (nCRC & 0x80000000u) ? ((nCRC << 1) ^ CRC_POLYNOMIAL) : (nCRC << 1);
+        }
+    }
+    return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*       Stand ins for the rest of the firmware.  Only the time moves.
+*******************************************************************************/
+TIME_LR ElapsedTimeLowRes(TIME_LR nOldTime)
+{
+    return m_tNow - nOldTime;
+}
+
+U_INT32 RTC_GetSeconds(void)
+{
+    return m_tNow / 1000;
+}
+
+void RTC_GetDate(uint32_t RTC_Format, RTC_DateTypeDef* RTC_DateStruct)
+{
+    memset(RTC_DateStruct, 0, sizeof(*RTC_DateStruct));
+}
+
+BOOL Calc_MinCurveTenths(EASTING_NORTHING_DATA_STRUCT *nResult, const MIN_CURVE_STATION *nStarting,
+                         const MIN_CURVE_STATION *nEnding, INT16 nDesiredAzimuth)
+{
+    memset(nResult, 0, sizeof(*nResult));
+    return true;
+}
+
+void PROFILE_Start(PROFILE_PROBE nProbe)
+{
+}
+
+void PROFILE_Stop(PROFILE_PROBE nProbe)
+{
+}
+
+STATE_OF_LOGGING GetLoggingState(void)
+{
+    return SURVEY_REQUEST_SUCCESS;
+}
+
+void RecordData_StoreSelectSurveyIndex(U_INT32 index)
+{
+}
+
+void TRAJECTORY_Truncate(U_INT32 nRecord)
+{
+}
+
+BOOL GetChangePipeLengthFlag(void)
+{
+    return false;
+}
+
+void SetChangePipeLengthFlag(BOOL bFlag)
+{
+}
+
+INT16 GetNewPipeLength(void)
+{
+    return 0;
+}
+
+void SetNewPipeLength(INT16 length)
+{
+}
+
+INT16 GetDesiredAzimuth(void)
+{
+    return 0;
+}
+
+INT16 GetDefaultPipeLength(void)
+{
+    return 30;
+}
+
+INT16 GetDeclination(void)
+{
+    return 0;
+}
+
+INT16 GetToolface(void)
+{
+    return 0;
+}
+
+char* GetBoreholeName(void)
+{
+    return "HOST";
+}
+
+/*******************************************************************************
+*       @details
+*       Marks the surveys a programmed write holds as saved: those in a
+*       record page, or in the entries of a journal page.  A record page
+*       that fails or is torn loses what it held.
+*******************************************************************************/
+static void NoteWrite(const QUEUED_WRITE *pWrite, BOOL bWhole)
+{
+    U_INT32 nPage = pWrite->nPageNumber - RECORD_AREA_BASE_ADDRESS;
+    U_INT32 nRecord;
+    U_INT16 nOffset = 0;
+    U_INT16 nSize;
+    U_INT32 nCRC;
+    RECORD_JOURNAL_HEADER header;
+
+    if (pWrite->nPageNumber < RECORD_AREA_BASE_ADDRESS)
+    {
+        return;
+    }
+    if (pWrite->nPageNumber < JOURNAL_START_PAGE)
+    {
+        for (nRecord = nPage * RECORDS_PER_PAGE; nRecord < (nPage + 1) * RECORDS_PER_PAGE; nRecord++)
+        {
+            if (!bWhole)
+            {
+                m_bStored[nRecord] = false;
+            }
+            else if (m_bStored[nRecord] &&
+                     memcmp(&pWrite->nData[PageOffset(nRecord) * sizeof(STRUCT_RECORD_DATA)],
+                            &m_Expected[nRecord], sizeof(STRUCT_RECORD_DATA)) == 0)
+            {
+                m_bSaved[nRecord] = true;
+            }
+        }
+        return;
+    }
+    while (bWhole && (nOffset + sizeof(header)) <= FLASH_PAGE_SIZE)
+    {
+        memcpy(&header, &pWrite->nData[nOffset], sizeof(header));
+        if ((header.nMarker != RECORD_JOURNAL_SURVEY_MARKER) && (header.nMarker != RECORD_JOURNAL_CHECKPOINT_MARKER))
+        {
+            break;
+        }
+        nSize = RECORD_JOURNAL_ENTRY_SIZE(header.nMarker);
+        (void)CalculateCRC((U_BYTE*)&pWrite->nData[nOffset], nSize - sizeof(U_INT32), &nCRC);
+        if ((nOffset + nSize) > FLASH_PAGE_SIZE || memcmp(&nCRC, &pWrite->nData[nOffset + nSize - sizeof(U_INT32)], sizeof(nCRC)) != 0)
+        {
+            break;
+        }
+        if ((header.nMarker == RECORD_JOURNAL_SURVEY_MARKER) && (header.nRecord < MAX_RECORDS) &&
+            m_bStored[header.nRecord] &&
+            memcmp(&pWrite->nData[nOffset + sizeof(header)], &m_Expected[header.nRecord], sizeof(STRUCT_RECORD_DATA)) == 0)
+        {
+            m_bSaved[header.nRecord] = true;
+        }
+        nOffset += nSize;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       The flash driver as RecordManager.c sees it, coalescing included.
+*       The head of the queue is always the write the engine is on, and
+*       reads see the newest queued copy of a page.
+*******************************************************************************/
+static QUEUED_WRITE* FindQueuedWrite(U_INT32 nPageNumber, BOOL bIncludeActive)
+{
+    int nIndex = m_nQueueCount;
+
+    while (nIndex-- > (bIncludeActive ? 0 : 1))
+    {
+        QUEUED_WRITE *pWrite = &m_Queue[(m_nQueueHead + nIndex) % FLASH_WRITE_QUEUE_SIZE];
+        if (pWrite->nPageNumber == nPageNumber)
+        {
+            return pWrite;
+        }
+    }
+    return NULL;
+}
+
+static BOOL QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, BOOL bWithCrc, BOOL bErase, FLASH_WRITE_CALLBACK pCallback)
+{
+    QUEUED_WRITE *pWrite;
+    U_INT32 nCRC;
+    uint32_t nCRC32;
+
+    if ((page == NULL) || (nPageNumber >= FLASH_PAGES))
+    {
+        return false;
+    }
+    pWrite = FindQueuedWrite(nPageNumber, false);
+    if ((pWrite != NULL) && (pWrite->bWithCrc == bWithCrc) && (pWrite->pCallback == pCallback))
+    {
+        bErase = bErase || pWrite->bErase;
+    }
+    else if (m_nQueueCount < FLASH_WRITE_QUEUE_SIZE)
+    {
+        pWrite = &m_Queue[(m_nQueueHead + m_nQueueCount++) % FLASH_WRITE_QUEUE_SIZE];
+    }
+    else
+    {
+        return false;
+    }
+    memset(pWrite->nData, 0xFF, sizeof(pWrite->nData));
+    memcpy(pWrite->nData, page->AsBytes, FLASH_PAGE_SIZE);
+    if (bWithCrc)
+    {
+        (void)CalculateCRC(pWrite->nData, FLASH_PAGE_SIZE, &nCRC);
+        nCRC32 = (uint32_t)nCRC;
+        memcpy(&pWrite->nData[FLASH_PAGE_SIZE], &nCRC32, sizeof(nCRC32));
+    }
+    pWrite->nPageNumber = nPageNumber;
+    pWrite->bWithCrc = bWithCrc;
+    pWrite->bErase = bErase;
+    pWrite->pCallback = pCallback;
+    return true;
+}
+
+BOOL FLASH_QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, true, true, pCallback);
+}
+
+BOOL FLASH_QueueWriteRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, false, true, pCallback);
+}
+
+BOOL FLASH_QueueAppendRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, false, false, pCallback);
+}
+
+U_BYTE FLASH_GetWriteQueueDepth(void)
+{
+    return (U_BYTE)m_nQueueCount;
+}
+
+FLASH_PAGE_STATUS FLASH_ReadPage(FLASH_PAGE *page, U_INT32 nPageNumber)
+{
+    QUEUED_WRITE *pWrite = FindQueuedWrite(nPageNumber, true);
+    U_INT32 nCRC;
+    uint32_t nStored;
+
+    memset(page, 0xFF, sizeof(FLASH_PAGE));
+    if (pWrite != NULL)
+    {
+        memcpy(page->AsBytes, pWrite->nData, FLASH_PAGE_SIZE);
+        return FLASH_PAGE_GOOD;
+    }
+    if (nPageNumber >= FLASH_PAGES)
+    {
+        return FLASH_PAGE_CORRUPT;
+    }
+    (void)CalculateCRC(m_nFlash[nPageNumber], FLASH_PAGE_SIZE, &nCRC);
+    memcpy(&nStored, &m_nFlash[nPageNumber][FLASH_PAGE_SIZE], sizeof(nStored));
+    if (nCRC == nStored)
+    {
+        memcpy(page->AsBytes, m_nFlash[nPageNumber], FLASH_PAGE_SIZE);
+        return FLASH_PAGE_GOOD;
+    }
+    if ((nCRC == EMPTY_SLOT_CRC) && (nStored == 0xFFFFFFFF))
+    {
+        return FLASH_PAGE_EMPTY;
+    }
+    return FLASH_PAGE_CORRUPT;
+}
+
+void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber)
+{
+    QUEUED_WRITE *pWrite = FindQueuedWrite(pageNumber, true);
+
+    memcpy(page, (pWrite != NULL) ? pWrite->nData : m_nFlash[pageNumber], FLASH_PAGE_SIZE);
+}
+
+/*******************************************************************************
+*       @details
+*       Programs the oldest queued write, the first nBytes of it if it is cut
+*       short.  Programming only clears bits, so a byte that needs one set
+*       again was not erased first.  The callback runs unless the power went.
+*******************************************************************************/
+static void ApplyWrite(int nBytes, FLASH_PAGE_STATUS eStatus, BOOL bPowerLost)
+{
+    QUEUED_WRITE *pWrite = &m_Queue[m_nQueueHead];
+    U_BYTE *pFlash = m_nFlash[pWrite->nPageNumber];
+    int nIndex;
+
+    if (pWrite->bErase)
+    {
+        memset(pFlash, 0xFF, PAGE_BYTES);
+    }
+    for (nIndex = 0; nIndex < nBytes; nIndex++)
+    {
+        if ((pFlash[nIndex] & pWrite->nData[nIndex]) != pWrite->nData[nIndex])
+        {
+            m_bProgrammedOver = true;
+        }
+        pFlash[nIndex] &= pWrite->nData[nIndex];
+    }
+    NoteWrite(pWrite, (nBytes == (int)PAGE_BYTES) && (eStatus == FLASH_PAGE_GOOD));
+    m_nQueueHead = (m_nQueueHead + 1) % FLASH_WRITE_QUEUE_SIZE;
+    m_nQueueCount--;
+    if (eStatus != FLASH_PAGE_GOOD)
+    {
+        m_bWriteFailed = true;
+    }
+    if (!bPowerLost && (pWrite->pCallback != NULL))
+    {
+        pWrite->pCallback(pWrite->nPageNumber, eStatus);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Serves the head of the queue, now and then failing it part way.
+*******************************************************************************/
+static void ServeWrite(void)
+{
+    if (m_bFailures && (rand() % 1000 < CHANCE_FAIL))
+    {
+        ApplyWrite(rand() % PAGE_BYTES, FLASH_PAGE_CORRUPT, false);
+    }
+    else
+    {
+        ApplyWrite(PAGE_BYTES, FLASH_PAGE_GOOD, false);
+    }
+}
+
+BOOL FLASH_FlushWrites(void)
+{
+    m_bWriteFailed = false;
+    while (m_nQueueCount > 0)
+    {
+        ServeWrite();
+    }
+    return !m_bWriteFailed;
+}
+
+FLASH_PAGE_STATUS FLASH_WritePage(FLASH_PAGE *page, U_INT32 nPageNumber)
+{
+    (void)FLASH_FlushWrites();
+    if (!FLASH_QueueWrite(page, nPageNumber, NULL))
+    {
+        return FLASH_PAGE_CORRUPT;
+    }
+    return FLASH_FlushWrites() ? FLASH_PAGE_GOOD : FLASH_PAGE_CORRUPT;
+}
+
+/*******************************************************************************
+*       @details
+*       A reset: the queue and the RAM the record manager keeps are lost,
+*       the RECORD_STORAGE_BBRAM variables are not.  Then the power up
+*       recovery main() runs.  The statistics are left to add up.
+*******************************************************************************/
+static void PowerUp(void)
+{
+    m_nQueueCount = 0;
+    memset(m_PageCache, 0, sizeof(m_PageCache));
+    memset(m_nPageCacheLastUse, 0, sizeof(m_nPageCacheLastUse));
+    m_nPageCacheClock = 0;
+    m_pReadPage = &m_PageCache[0];
+    m_nDepthIndexCount = 0;
+    m_bDepthIndexValid = false;
+    m_bDepthIndexOverflow = false;
+    memset(&m_BranchTree, 0, sizeof(m_BranchTree));
+    m_nStatsSequence = 0;
+    memset(m_nJournalPage, 0, sizeof(m_nJournalPage));
+    m_nJournalPageIndex = RECORD_JOURNAL_PAGES - 1;
+    m_nJournalOffset = FLASH_PAGE_SIZE;
+    m_nJournalSequence = 0;
+    m_nJournalPagesOpen = 0;
+    m_nJournalPendingPage = NULL_PAGE;
+    m_tJournalLastWrite = 0;
+    m_bJournalReady = false;
+    m_bJournalDirty = false;
+    m_bJournalCheckpointDue = false;
+    memset(&m_Swap, 0, sizeof(m_Swap));
+    m_bRecomputeTailQueued = false;
+    m_bRecomputeShadowFailed = false;
+    nNewHoleRecordCount = 0;
+
+    RECORD_JournalRecover();
+    RECORD_RecoverBoreholeStats();
+}
+
+/*******************************************************************************
+*       @details
+*       Reads every survey of the file back from the flash itself.  A saved
+*       one has to be there; bAll asks the same of every survey stored.
+*******************************************************************************/
+static int CheckRecords(BOOL bAll, const char *pWhen, int nCycle)
+{
+    U_INT32 nRecord;
+    U_INT32 nPage;
+    FLASH_PAGE flashPage;
+
+    m_bFailures = false;
+    (void)FLASH_FlushWrites();
+    for (nRecord = 1; nRecord < boreholeStats.RecordCount; nRecord++)
+    {
+        if (!m_bStored[nRecord] || (!bAll && !m_bSaved[nRecord]))
+        {
+            continue;
+        }
+        nPage = PageNumber(nRecord);
+        if ((FLASH_ReadPage(&flashPage, nPage + RECORD_AREA_BASE_ADDRESS) != FLASH_PAGE_GOOD) ||
+            memcmp(&flashPage.AsBytes[PageOffset(nRecord) * sizeof(STRUCT_RECORD_DATA)],
+                   &m_Expected[nRecord], sizeof(STRUCT_RECORD_DATA)) != 0)
+        {
+            printf("MISMATCH %s survey %lu of %lu not in its page, %s, power up %d\n",
+                   m_bSaved[nRecord] ? "saved" : "stored", (unsigned long)nRecord,
+                   (unsigned long)boreholeStats.RecordCount, pWhen, nCycle);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Uploads a survey, or takes the last one off again.
+*******************************************************************************/
+static void Step(void)
+{
+    U_INT32 nRecord = boreholeStats.RecordCount;
+    STRUCT_RECORD_DATA survey;
+
+    if ((nRecord > 2) && (PageOffset(nRecord - 1) != 0) && (rand() % 1000 < CHANCE_REMOVE))
+    {
+        // m_WritePage only holds the page of the last upload
+        m_bStored[nRecord - 1] = false;
+        RECORD_removeLastRecord();
+        return;
+    }
+    if (nRecord >= MAX_RECORDS)
+    {
+        RECORD_OpenLoggingFile();
+        memset(m_bStored, 0, sizeof(m_bStored));
+        return;
+    }
+
+    memset(&survey, 0, sizeof(survey));
+    survey.tSurveyTimeStamp = ++m_nVersion;
+    survey.nAzimuth = (INT16)(rand() % 3600);
+    survey.nPitch = (INT16)(rand() % 1800 - 900);
+    survey.nRoll = (INT16)(rand() % 3600);
+    survey.nTemperature = (INT16)(rand() % 1000);
+    survey.nGamma = (INT16)(rand() % 500);
+    survey.nRecordNumber = (U_INT16)nRecord;
+    survey.nTotalLength = (U_INT16)(nRecord * 30);
+    survey.PreviousRecordIndex = (INT16)(nRecord - 1);
+    memcpy(&m_Expected[nRecord], &survey, sizeof(survey));
+    m_bStored[nRecord] = true;
+    m_bSaved[nRecord] = false;
+    StoreUploadedRecord(&survey);
+}
+
+/*******************************************************************************
+*       @details
+*       Runs uploads with the write queue served at random, at a rate drawn
+*       each power up so some runs keep the queue backed up, then loses the
+*       power, maybe in the middle of a page program, or shuts down in
+*       order, and recovers.
+*******************************************************************************/
+static int CheckPowerCycles(void)
+{
+    U_INT32 nSurveys = 0;
+    U_INT32 nRecord;
+    int nCycle;
+    int nStep;
+    int nServeChance;
+    BOOL bShutdown;
+
+    memset(m_nFlash, 0xFF, sizeof(m_nFlash));
+    Serial_Flash_Chip.ext_flash_working = true;
+    Serial_Flash_Chip.Record_journal_start_page = JOURNAL_START_PAGE;
+    PowerUp();
+    RECORD_OpenLoggingFile();
+    for (nCycle = 0; nCycle < POWER_CYCLES; nCycle++)
+    {
+        m_bFailures = true;
+        nServeChance = 100 + rand() % 800;
+        for (nStep = rand() % MAX_STEPS; nStep > 0; nStep--)
+        {
+            Step();
+            nSurveys++;
+            m_tNow += rand() % 1500;
+            while ((m_nQueueCount > 0) && (rand() % 1000 < nServeChance))
+            {
+                ServeWrite();
+            }
+            if (rand() % 1000 < CHANCE_SERVICE)
+            {
+                RECORD_JournalService();
+            }
+            if (m_bProgrammedOver)
+            {
+                printf("MISMATCH a page was programmed over bytes not erased, power up %d\n", nCycle);
+                return 0;
+            }
+        }
+
+        bShutdown = (rand() % 1000 < CHANCE_SHUTDOWN);
+        if (bShutdown)
+        {
+            m_bFailures = false;
+            RECORD_JournalFlush();
+            if (!CheckRecords(true, "after a shutdown", nCycle))
+            {
+                return 0;
+            }
+        }
+        else if ((m_nQueueCount > 0) && (rand() % 1000 < CHANCE_TEAR))
+        {
+            ApplyWrite(rand() % PAGE_BYTES, FLASH_PAGE_CORRUPT, true);
+        }
+        PowerUp();
+        if (!CheckRecords(false, "after a power loss", nCycle))
+        {
+            return 0;
+        }
+        // what did not reach the flash is gone
+        for (nRecord = 0; nRecord < MAX_RECORDS; nRecord++)
+        {
+            m_bStored[nRecord] = m_bStored[nRecord] && m_bSaved[nRecord];
+        }
+    }
+    printf("%d power ups, %lu uploads and removals: %lu surveys journaled, %lu record page writes, "
+           "%lu entries replayed\n", POWER_CYCLES, (unsigned long)nSurveys,
+           (unsigned long)m_RecordJournalStats.nEntries, (unsigned long)m_RecordJournalStats.nPageWrites,
+           (unsigned long)m_RecordJournalStats.nReplayed);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    srand(1);
+    if (!CheckPowerCycles())
+    {
+        return 1;
+    }
+    return 0;
+}
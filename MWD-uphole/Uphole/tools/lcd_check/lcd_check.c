@@ -0,0 +1,539 @@
+/*******************************************************************************
+*       @brief      Host check of the dirty span update in lcd.c: random
+*                   drawing, then LCD_Update() into a model of the SED1335
+*                   display memory.  Not part of the firmware build.
+*       @file       Uphole/tools/lcd_check/lcd_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc.  The two bus
+*       ports are IAR placed variables, so lcd.c is first copied with them
+*       turned into calls that hand the written byte to the model:
+*
+*       sed -e '/<intrinsics.h>/d'
+*           -e 's/^__no_init static U_BYTE m_nLcd\([A-Za-z]*\)Port @ [^;]*;/#define m_nLcd\1Port (*HostPort_\1())/'
+*           ../../src/HardwareInterfaces/lcd.c > lcd_host.c &&
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/HardwareInterfaces -I../../inc/DataManagers
+*           -I../../inc/SerialFlash -I../../inc/UI_Frame -I../../inc/UI_Tools
+*           -I../../inc/UI_Panels -I../../inc/Graph_Plot -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           lcd_check.c -o lcd_check && ./lcd_check
+*
+*       After every update the spans on the bus are compared with the dirty
+*       rows merged by LCD_SPAN_MERGE_GAP, and each page sent is compared
+*       with its pixel buffer.  It exits non zero if a span differs, a sent
+*       page differs from its buffer, the bytes counted in m_LcdUpdateStats
+*       differ from those on the bus, or LCD_MarkDirty() keeps a row or byte
+*       outside the display.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32f4xx.h"
+#include "portable.h"
+
+// The frame and panel headers pull in the whole user interface, and
+// FlashMemory.h the IAR intrinsics, so lcd.c gets these instead.
+#define FLASH_MEMORY_H
+#define UI_FRAME_H
+#define UI_LCD_SCREEN_INVERSION_H
+#define UI_COMPASS_DECISION_PANEL_H
+
+typedef struct
+{
+    int nUnused;
+} FRAME;
+
+const FRAME HomeFrame;
+FRAME WindowFrame;
+void PaintNow(const FRAME* frame);
+BOOL getCompassDecisionPanelActive(void);
+static U_BYTE* HostPort_Data(void);
+static U_BYTE* HostPort_Command(void);
+
+#include "lcd_host.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define PAGE_SIZE           (MAX_PIXEL_ROW * MAX_PIXEL_COL_STORAGE)
+#define DISPLAY_MEMORY      (LCD_BACKGROUND_ADDRESS + PAGE_SIZE)
+#define MAX_RUNS            (2 * MAX_PIXEL_ROW)
+#define ROUNDS              20000
+#define MAX_DRAWS           12
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A cursor move and the bytes written after it.
+typedef struct
+{
+    U_INT16 nAddress;
+    U_INT16 nLength;
+} RUN;
+
+// What the SED1335 is sent.  A byte on either port is held until the next
+// one, as the sed copy of lcd.c only gives the address of the port.
+typedef struct
+{
+    U_BYTE nMemory[DISPLAY_MEMORY];
+    U_BYTE nLatch;
+    BOOL bLatchCommand;
+    BOOL bLatchFull;
+    U_BYTE nCommand;
+    U_INT32 nParameter;
+    U_INT16 nCursor;
+    U_INT32 nBusBytes;
+    RUN Runs[MAX_RUNS];
+    int nRuns;
+    BOOL bOverrun;
+} DISPLAY;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static DISPLAY m_Display;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       Stand ins for what lcd.c calls outside the update.
+*******************************************************************************/
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct)
+{
+    (void)GPIOx;
+    (void)GPIO_InitStruct;
+}
+
+void GPIO_StructInit(GPIO_InitTypeDef* GPIO_InitStruct)
+{
+    memset(GPIO_InitStruct, 0, sizeof(*GPIO_InitStruct));
+}
+
+void GPIO_SetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    (void)GPIOx;
+    (void)GPIO_Pin;
+}
+
+void GPIO_ResetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    (void)GPIOx;
+    (void)GPIO_Pin;
+}
+
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal)
+{
+    (void)GPIOx;
+    (void)GPIO_Pin;
+    (void)BitVal;
+}
+
+void GPIO_PinAFConfig(GPIO_TypeDef* GPIOx, uint16_t GPIO_PinSource, uint8_t GPIO_AF)
+{
+    (void)GPIOx;
+    (void)GPIO_PinSource;
+    (void)GPIO_AF;
+}
+
+void FSMC_NORSRAMStructInit(FSMC_NORSRAMInitTypeDef* FSMC_NORSRAMInitStruct)
+{
+    (void)FSMC_NORSRAMInitStruct;
+}
+
+void FSMC_NORSRAMInit(FSMC_NORSRAMInitTypeDef* FSMC_NORSRAMInitStruct)
+{
+    (void)FSMC_NORSRAMInitStruct;
+}
+
+void FSMC_NORSRAMCmd(uint32_t FSMC_Bank, FunctionalState NewState)
+{
+    (void)FSMC_Bank;
+    (void)NewState;
+}
+
+void Delay5us(void)
+{
+}
+
+TIME_LR ElapsedTimeLowRes(TIME_LR nOldTime)
+{
+    return nOldTime;
+}
+
+BOOL getCompassDecisionPanelActive(void)
+{
+    return false;
+}
+
+void DrawCompass(void)
+{
+}
+
+void PaintNow(const FRAME* frame)
+{
+    (void)frame;
+}
+
+void PROFILE_Start(PROFILE_PROBE nProbe)
+{
+    (void)nProbe;
+}
+
+void PROFILE_Stop(PROFILE_PROBE nProbe)
+{
+    (void)nProbe;
+}
+
+/*******************************************************************************
+*       @details
+*       Acts on the byte held from the last port write.  CSRW takes the
+*       cursor low byte then high byte, MWRITE stores at the cursor and moves
+*       it on.  The set up commands of LCD_Init() only take parameters.
+*******************************************************************************/
+static void DisplayFlush(void)
+{
+    DISPLAY *pDisplay = &m_Display;
+
+    if (!pDisplay->bLatchFull)
+    {
+        return;
+    }
+    pDisplay->bLatchFull = false;
+    pDisplay->nBusBytes++;
+    if (pDisplay->bLatchCommand)
+    {
+        pDisplay->nCommand = pDisplay->nLatch;
+        pDisplay->nParameter = 0;
+        if (pDisplay->nCommand == SED1335_MWRITE)
+        {
+            if (pDisplay->nRuns < MAX_RUNS)
+            {
+                pDisplay->Runs[pDisplay->nRuns].nAddress = pDisplay->nCursor;
+                pDisplay->Runs[pDisplay->nRuns].nLength = 0;
+            }
+            pDisplay->nRuns++;
+        }
+        return;
+    }
+    if (pDisplay->nCommand == SED1335_CSRW)
+    {
+        if (pDisplay->nParameter == 0)
+        {
+            pDisplay->nCursor = pDisplay->nLatch;
+        }
+        else if (pDisplay->nParameter == 1)
+        {
+            pDisplay->nCursor |= (U_INT16)(pDisplay->nLatch << 8);
+        }
+    }
+    else if (pDisplay->nCommand == SED1335_MWRITE)
+    {
+        if (pDisplay->nCursor >= DISPLAY_MEMORY)
+        {
+            pDisplay->bOverrun = true;
+        }
+        else
+        {
+            pDisplay->nMemory[pDisplay->nCursor++] = pDisplay->nLatch;
+        }
+        if (pDisplay->nRuns <= MAX_RUNS)
+        {
+            pDisplay->Runs[pDisplay->nRuns - 1].nLength++;
+        }
+    }
+    pDisplay->nParameter++;
+}
+
+static U_BYTE* HostPort_Data(void)
+{
+    DisplayFlush();
+    m_Display.bLatchCommand = false;
+    m_Display.bLatchFull = true;
+    return &m_Display.nLatch;
+}
+
+static U_BYTE* HostPort_Command(void)
+{
+    DisplayFlush();
+    m_Display.bLatchCommand = true;
+    m_Display.bLatchFull = true;
+    return &m_Display.nLatch;
+}
+
+/*******************************************************************************
+*       @details
+*       The runs one page should go out as.  Every byte from the low to the
+*       high mark of a dirty row is marked, then clean gaps no longer than
+*       LCD_SPAN_MERGE_GAP between marked bytes are bridged.
+*******************************************************************************/
+static int ExpectedRuns(RUN *pRuns, U_BYTE nLo[MAX_PIXEL_ROW], U_BYTE nHi[MAX_PIXEL_ROW], U_INT16 nBase)
+{
+    static BOOL bMarked[PAGE_SIZE];
+    int nRuns = 0;
+    int nAddress;
+    int nRow;
+    int nCol;
+    int nLastMarked = -1;
+
+    memset(bMarked, 0, sizeof(bMarked));
+    for (nRow = 0; nRow < MAX_PIXEL_ROW; nRow++)
+    {
+        for (nCol = nLo[nRow]; nCol <= nHi[nRow]; nCol++)
+        {
+            bMarked[nRow * MAX_PIXEL_COL_STORAGE + nCol] = true;
+        }
+    }
+    for (nAddress = 0; nAddress < PAGE_SIZE; nAddress++)
+    {
+        if (!bMarked[nAddress])
+        {
+            continue;
+        }
+        if (nLastMarked < 0 || nAddress - nLastMarked - 1 > LCD_SPAN_MERGE_GAP)
+        {
+            pRuns[nRuns].nAddress = (U_INT16)(nBase + nAddress);
+            pRuns[nRuns].nLength = 0;
+            nRuns++;
+        }
+        pRuns[nRuns - 1].nLength = (U_INT16)(nBase + nAddress + 1 - pRuns[nRuns - 1].nAddress);
+        nLastMarked = nAddress;
+    }
+    return nRuns;
+}
+
+/*******************************************************************************
+*       @details
+*       Changes the pixel buffers through the calls the user interface uses,
+*       and by writing bytes and marking them as UI_Primitives.c does.
+*******************************************************************************/
+static void Draw(void)
+{
+    BOOL bPage = (BOOL)(rand() & 1);
+    U_BYTE *pPage = bPage ? &m_nPixelBackground[0][0] : &m_nPixelData[0][0];
+    int nRow = rand() % MAX_PIXEL_ROW;
+    int nLo = rand() % MAX_PIXEL_COL;
+    int nHi = nLo + rand() % (MAX_PIXEL_COL - nLo);
+    int nByte;
+
+    switch (rand() % 9)
+    {
+        case 0:
+        case 1:
+            // a text cell or a short line, the most common change
+            nLo = rand() % MAX_PIXEL_COL_STORAGE;
+            nHi = nLo + rand() % 3;
+            for (nByte = nLo; nByte <= nHi && nByte < MAX_PIXEL_COL_STORAGE; nByte++)
+            {
+                pPage[nRow * MAX_PIXEL_COL_STORAGE + nByte] = (U_BYTE)rand();
+            }
+            LCD_MarkDirty(bPage, (U_INT16)nRow, (U_INT16)nLo, (U_INT16)nHi);
+            break;
+        case 2:
+            LCD_ClearRow((U_INT16)nRow, (U_INT16)nLo, (U_INT16)nHi, bPage);
+            break;
+        case 3:
+            LCD_InvertRow((U_INT16)nRow, (U_INT16)nLo, (U_INT16)nHi, bPage);
+            break;
+        case 4:
+            LCD_ClearPixel((U_INT16)nLo, (U_BYTE)nRow, bPage);
+            break;
+        case 5:
+            GLCD_SetPixel((unsigned int)nLo, (unsigned int)nRow);
+            break;
+        case 6:
+            GLCD_Line(nLo, nRow, rand() % MAX_PIXEL_COL, rand() % MAX_PIXEL_ROW);
+            break;
+        case 7:
+            nHi = nRow + rand() % 4;
+            for (nByte = nRow * MAX_PIXEL_COL_STORAGE; nByte < (nHi + 1) * MAX_PIXEL_COL_STORAGE && nByte < PAGE_SIZE; nByte++)
+            {
+                pPage[nByte] = (U_BYTE)rand();
+            }
+            LCD_MarkRowsDirty(bPage, (U_INT16)nRow, (U_INT16)nHi);
+            break;
+        default:
+            if (rand() % 50 == 0)
+            {
+                clearLCD();
+            }
+            break;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       One LCD_Update() of whatever pages are flagged, against the dirty rows
+*       lcd.c held before it.
+*******************************************************************************/
+static int CheckUpdate(BOOL bForeground, BOOL bBackground)
+{
+    static RUN expected[MAX_RUNS];
+    U_BYTE nLo[2][MAX_PIXEL_ROW];
+    U_BYTE nHi[2][MAX_PIXEL_ROW];
+    U_INT32 nSpans = m_LcdUpdateStats.nSpans;
+    int nExpected = 0;
+    int nRun;
+
+    memcpy(nLo, m_nDirtyLo, sizeof(nLo));
+    memcpy(nHi, m_nDirtyHi, sizeof(nHi));
+    if (bBackground)
+    {
+        nExpected += ExpectedRuns(&expected[nExpected], nLo[LCD_BACKGROUND_PAGE], nHi[LCD_BACKGROUND_PAGE], LCD_BACKGROUND_ADDRESS);
+        LCD_Refresh(LCD_BACKGROUND_PAGE);
+    }
+    if (bForeground)
+    {
+        nExpected += ExpectedRuns(&expected[nExpected], nLo[LCD_FOREGROUND_PAGE], nHi[LCD_FOREGROUND_PAGE], LCD_FOREGROUND_ADDRESS);
+        LCD_Refresh(LCD_FOREGROUND_PAGE);
+    }
+
+    m_Display.nRuns = 0;
+    m_Display.nBusBytes = 0;
+    LCD_Update();
+    DisplayFlush();
+
+    if (m_Display.bOverrun || m_Display.nRuns != nExpected)
+    {
+        printf("MISMATCH %d runs sent, %d expected%s\n", m_Display.nRuns, nExpected,
+               m_Display.bOverrun ? ", written past the display memory" : "");
+        return 0;
+    }
+    for (nRun = 0; nRun < nExpected; nRun++)
+    {
+        if (m_Display.Runs[nRun].nAddress != expected[nRun].nAddress ||
+            m_Display.Runs[nRun].nLength != expected[nRun].nLength)
+        {
+            printf("MISMATCH run %d sent 0x%04X+%u, expected 0x%04X+%u\n", nRun,
+                   m_Display.Runs[nRun].nAddress, m_Display.Runs[nRun].nLength,
+                   expected[nRun].nAddress, expected[nRun].nLength);
+            return 0;
+        }
+    }
+    if (m_Display.nBusBytes != m_LcdUpdateStats.nLastBytes ||
+        m_LcdUpdateStats.nSpans - nSpans != (U_INT32)nExpected)
+    {
+        printf("MISMATCH %lu bytes and %d spans on the bus, %lu and %lu counted\n",
+               (unsigned long)m_Display.nBusBytes, nExpected,
+               (unsigned long)m_LcdUpdateStats.nLastBytes,
+               (unsigned long)(m_LcdUpdateStats.nSpans - nSpans));
+        return 0;
+    }
+    if ((bBackground && memcmp(&m_Display.nMemory[LCD_BACKGROUND_ADDRESS], m_nPixelBackground, PAGE_SIZE) != 0) ||
+        (bForeground && memcmp(&m_Display.nMemory[LCD_FOREGROUND_ADDRESS], m_nPixelData, PAGE_SIZE) != 0))
+    {
+        printf("MISMATCH a page sent differs from its pixel buffer\n");
+        return 0;
+    }
+    if ((!bBackground && memcmp(m_nDirtyHi[LCD_BACKGROUND_PAGE], nHi[LCD_BACKGROUND_PAGE], MAX_PIXEL_ROW) != 0) ||
+        (!bForeground && memcmp(m_nDirtyHi[LCD_FOREGROUND_PAGE], nHi[LCD_FOREGROUND_PAGE], MAX_PIXEL_ROW) != 0))
+    {
+        printf("MISMATCH a page not sent lost its dirty rows\n");
+        return 0;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Marks outside the display are dropped or cut at the row end, and
+*       marking rows past the bottom stops at the last row.
+*******************************************************************************/
+static int CheckClipping(void)
+{
+    U_BYTE nLo[MAX_PIXEL_ROW];
+    U_BYTE nHi[MAX_PIXEL_ROW];
+
+    LCD_MarkDirty(LCD_FOREGROUND_PAGE, MAX_PIXEL_ROW, 0, 1);
+    LCD_MarkDirty(LCD_FOREGROUND_PAGE, 0xFFFF, 0, 1);
+    LCD_MarkDirty(LCD_FOREGROUND_PAGE, 5, MAX_PIXEL_COL_STORAGE, MAX_PIXEL_COL_STORAGE + 5);
+    LCD_MarkDirty(LCD_FOREGROUND_PAGE, 5, 7, 3);
+    LCD_MarkDirty(LCD_FOREGROUND_PAGE, 7, MAX_PIXEL_COL_STORAGE - 2, 200);
+    LCD_MarkRowsDirty(LCD_FOREGROUND_PAGE, MAX_PIXEL_ROW - 2, 0xFFFF);
+
+    memset(nLo, 0xFF, sizeof(nLo));
+    memset(nHi, 0x00, sizeof(nHi));
+    nLo[7] = MAX_PIXEL_COL_STORAGE - 2;
+    nHi[7] = MAX_PIXEL_COL_STORAGE - 1;
+    nLo[MAX_PIXEL_ROW - 2] = nLo[MAX_PIXEL_ROW - 1] = 0;
+    nHi[MAX_PIXEL_ROW - 2] = nHi[MAX_PIXEL_ROW - 1] = MAX_PIXEL_COL_STORAGE - 1;
+    if (memcmp(nLo, m_nDirtyLo[LCD_FOREGROUND_PAGE], sizeof(nLo)) != 0 ||
+        memcmp(nHi, m_nDirtyHi[LCD_FOREGROUND_PAGE], sizeof(nHi)) != 0)
+    {
+        printf("MISMATCH marks outside the display were not clipped\n");
+        return 0;
+    }
+    return CheckUpdate(true, true);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static int CheckRandomUpdates(void)
+{
+    U_INT64 nBytes = 0;
+    U_INT32 nUpdates = 0;
+    int nRound;
+    int nDraws;
+    int nPages;
+
+    for (nRound = 0; nRound < ROUNDS; nRound++)
+    {
+        for (nDraws = rand() % (MAX_DRAWS + 1); nDraws > 0; nDraws--)
+        {
+            Draw();
+        }
+        // now and then a page is left flagged for a later update
+        nPages = rand() % 4;
+        if (!CheckUpdate((BOOL)(nPages != 1), (BOOL)(nPages != 2)))
+        {
+            printf("in round %d\n", nRound);
+            return 0;
+        }
+        if (nPages == 3)
+        {
+            nBytes += m_LcdUpdateStats.nLastBytes;
+            nUpdates++;
+        }
+    }
+    printf("%d rounds, %.0f bytes a two page update against %d for whole pages\n", ROUNDS,
+           (double)nBytes / nUpdates, 2 * (PAGE_SIZE + 4));
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    srand(1);
+    LCD_Init();
+    DisplayFlush();
+    if (memcmp(&m_Display.nMemory[LCD_FOREGROUND_ADDRESS], m_nPixelData, PAGE_SIZE) != 0 ||
+        memcmp(&m_Display.nMemory[LCD_BACKGROUND_ADDRESS], m_nPixelBackground, PAGE_SIZE) != 0)
+    {
+        printf("MISMATCH LCD_Init() did not send both pages\n");
+        return 1;
+    }
+    if (!CheckClipping() || !CheckRandomUpdates())
+    {
+        return 1;
+    }
+    return 0;
+}
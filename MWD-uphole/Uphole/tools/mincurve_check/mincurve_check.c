@@ -0,0 +1,449 @@
+/*******************************************************************************
+*       @brief      Host check of Calc_MinCurveTenths() against the minimum
+*                   curvature formula worked in double precision, over every
+*                   stored angle and over random trajectories, and a timing of
+*                   it against Calc_AveAngleMinCurve().  Not part of the
+*                   firmware build.
+*       @file       Uphole/tools/mincurve_check/mincurve_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/Logging -I../../inc/UI_Tabs -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           mincurve_check.c -lm -o mincurve_check && ./mincurve_check
+*
+*       It exits non zero if any delta is further from the reference than
+*       ERROR_BOUND of the course length, for doglegs up to DOGLEG_LIMIT.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "portable.h"
+
+// The firmware source is built in here.  It takes GetDesiredAzimuth() from
+// UI_JobTab.h, whose includes only resolve on the IAR host's case blind file
+// system, so that header is marked as read and the one call declared.
+#define UI_JOB_TAB_H
+INT16 GetDesiredAzimuth(void);
+#include "../../src/Logging/Calc_AveAngleMinCurve.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define REFERENCE_PI        3.14159265358979323846
+
+#define ERROR_BOUND         1e-5    // of the course length, per delta
+#define DOGLEG_LIMIT        150.0   // degrees, the ratio factor runs away past it
+#define MAX_INCLINATION     1800    // tenths, straight down to straight up
+#define COURSE_LENGTH       1000    // nPipeLength units for the sweeps
+
+#define RANDOM_PAIRS        5000000
+#define TRAJECTORIES        2000
+#define TRAJECTORY_STATIONS 500     // about the longest hole logged
+#define TRAJECTORY_BOUND    ERROR_BOUND     // of the hole, the deltas add at most that
+#define BENCH_RUNS          2000000
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// Worst error seen, in units of the course length
+typedef struct
+{
+    double fWorst;
+    long nChecked;
+    long nPastLimit;        // doglegs over DOGLEG_LIMIT, not held to the bound
+    double fWorstPastLimit;
+} ERROR_STATS;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static INT16 m_nDesiredAzimuth;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       Calc_AveAngleMinCurve() reads the job setting, only the timing calls it.
+*******************************************************************************/
+INT16 GetDesiredAzimuth(void)
+{
+    return m_nDesiredAzimuth;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static double Seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+/*******************************************************************************
+*       @details
+*       Angles just short of 360 count as small positive ones, as in both
+*       firmware versions; the check is of the arithmetic, not of that rule.
+*******************************************************************************/
+static double Radians(INT32 nTenths)
+{
+    if (nTenths >= 3595)
+    {
+        nTenths = THREE_SIXTY_TIMES_TEN - nTenths;
+    }
+    return nTenths * (REFERENCE_PI / 1800.0);
+}
+
+/*******************************************************************************
+*       @details
+*       The minimum curvature deltas in double, scaled the way the firmware
+*       stores them.  The dogleg comes from its versine through asin(), which
+*       keeps the small angles that acos() rounds away, and the ratio factor
+*       from tan() directly.  Returns the dogleg in degrees.
+*******************************************************************************/
+static double Reference(EASTING_NORTHING_DATA_STRUCT *pResult, const MIN_CURVE_STATION *pStart,
+                        const MIN_CURVE_STATION *pEnd, INT16 nDesiredAzimuth)
+{
+    double fStartInc = Radians(pStart->nInclination);
+    double fEndInc = Radians(pEnd->nInclination);
+    double fStartAz = Radians(pStart->nAzimuth);
+    double fEndAz = Radians(pEnd->nAzimuth);
+    double fDesired = nDesiredAzimuth * (REFERENCE_PI / 1800.0);
+    double fVersine, fBeta, fRatio, fScale;
+
+    fVersine = (1.0 - cos(fEndInc - fStartInc)) + sin(fStartInc) * sin(fEndInc) * (1.0 - cos(fEndAz - fStartAz));
+    fBeta = 2.0 * asin(sqrt(fVersine * 0.5));
+    fRatio = (fBeta < 1e-6) ? (1.0 + (fBeta * fBeta / 12.0)) : ((2.0 / fBeta) * tan(fBeta * 0.5));
+    fScale = fRatio * (pEnd->nPipeLength - pStart->nPipeLength) * 0.5;
+
+    pResult->fNorthing = (REAL32)(fScale * (sin(fStartInc) + sin(fEndInc)) * 100.0);
+    pResult->fEasting = (REAL32)(fScale * (sin(fStartAz - fDesired) * cos(fStartInc)
+                                         + sin(fEndAz - fDesired) * cos(fEndInc)) * 10.0);
+    pResult->fDepth = (REAL32)(fScale * (cos(fStartAz - fDesired) * cos(fStartInc)
+                                       + cos(fEndAz - fDesired) * cos(fEndInc)) * 100.0);
+    if (pResult->fDepth < 0.0f)
+    {
+        pResult->fDepth = 0.0f;
+    }
+    return fBeta * (180.0 / REFERENCE_PI);
+}
+
+/*******************************************************************************
+*       @details
+*       One survey pair.  Each delta is compared in units of the course
+*       length, after taking out the 100, 10, 100 the deltas are stored at.
+*       Returns 0 and prints the pair when the bound is broken.
+*******************************************************************************/
+static int CheckPair(ERROR_STATS *pStats, const MIN_CURVE_STATION *pStart, const MIN_CURVE_STATION *pEnd,
+                     INT16 nDesiredAzimuth)
+{
+    EASTING_NORTHING_DATA_STRUCT table, reference;
+    double fCourse = fabs((double)(pEnd->nPipeLength - pStart->nPipeLength));
+    double fDogleg, fError, fWorst;
+
+    Calc_MinCurveTenths(&table, pStart, pEnd, nDesiredAzimuth);
+    fDogleg = Reference(&reference, pStart, pEnd, nDesiredAzimuth);
+    if (fCourse == 0.0)
+    {
+        fCourse = 1.0;
+    }
+
+    fWorst = fabs(table.fNorthing - reference.fNorthing) / (fCourse * 100.0);
+    fError = fabs(table.fEasting - reference.fEasting) / (fCourse * 10.0);
+    fWorst = (fError > fWorst) ? fError : fWorst;
+    fError = fabs(table.fDepth - reference.fDepth) / (fCourse * 100.0);
+    fWorst = (fError > fWorst) ? fError : fWorst;
+
+    if (fDogleg > DOGLEG_LIMIT)
+    {
+        pStats->nPastLimit++;
+        pStats->fWorstPastLimit = (fWorst > pStats->fWorstPastLimit) ? fWorst : pStats->fWorstPastLimit;
+        return 1;
+    }
+    pStats->nChecked++;
+    if (fWorst > pStats->fWorst)
+    {
+        pStats->fWorst = fWorst;
+    }
+    if (fWorst > ERROR_BOUND)
+    {
+        printf("MISMATCH inc %d -> %d, az %d -> %d, desired %d, course %ld: error %.3g, dogleg %.1f\n",
+               pStart->nInclination, pEnd->nInclination, pStart->nAzimuth, pEnd->nAzimuth,
+               nDesiredAzimuth, (long)fCourse, fWorst, fDogleg);
+        printf("    table %g %g %g, reference %g %g %g\n", table.fNorthing, table.fEasting, table.fDepth,
+               reference.fNorthing, reference.fEasting, reference.fDepth);
+        return 0;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Report(const char *pName, const ERROR_STATS *pStats)
+{
+    printf("%-24s %9ld pairs, worst %.2e of course", pName, pStats->nChecked, pStats->fWorst);
+    if (pStats->nPastLimit > 0)
+    {
+        printf(", %ld past %.0f deg (worst %.2e)", pStats->nPastLimit, DOGLEG_LIMIT, pStats->fWorstPastLimit);
+    }
+    printf("\n");
+}
+
+/*******************************************************************************
+*       @details
+*       Every pair of inclinations at four azimuth turns, every pair of
+*       azimuths at a handful of inclinations, and every desired azimuth
+*       against a few surveys, so each table entry and each quadrant fold is
+*       reached.
+*******************************************************************************/
+static int CheckSweeps(void)
+{
+    static const INT16 nTurns[] = { 0, 1, 450, 1800 };
+    static const INT16 nInclinations[] = { 1, 50, 450, 900, 1350, 1799 };
+    ERROR_STATS stats = { 0 };
+    MIN_CURVE_STATION start = { 0, 0, 0 };
+    MIN_CURVE_STATION end = { 0, 0, COURSE_LENGTH };
+    int nTurn, nFirst, nSecond, nDesired;
+
+    for (nTurn = 0; nTurn < (int)(sizeof(nTurns) / sizeof(nTurns[0])); nTurn++)
+    {
+        start.nAzimuth = 1234;
+        end.nAzimuth = (INT16)((1234 + nTurns[nTurn]) % THREE_SIXTY_TIMES_TEN);
+        for (nFirst = 0; nFirst <= MAX_INCLINATION; nFirst++)
+        {
+            for (nSecond = 0; nSecond <= MAX_INCLINATION; nSecond++)
+            {
+                start.nInclination = (INT16)nFirst;
+                end.nInclination = (INT16)nSecond;
+                if (!CheckPair(&stats, &start, &end, 900))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+    Report("inclination sweep", &stats);
+
+    stats = (ERROR_STATS){ 0 };
+    for (nTurn = 0; nTurn < (int)(sizeof(nInclinations) / sizeof(nInclinations[0])); nTurn++)
+    {
+        start.nInclination = nInclinations[nTurn];
+        end.nInclination = nInclinations[nTurn];
+        for (nFirst = 0; nFirst < THREE_SIXTY_TIMES_TEN; nFirst++)
+        {
+            for (nSecond = 0; nSecond < THREE_SIXTY_TIMES_TEN; nSecond += 7)
+            {
+                start.nAzimuth = (INT16)nFirst;
+                end.nAzimuth = (INT16)nSecond;
+                if (!CheckPair(&stats, &start, &end, 0))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+    Report("azimuth sweep", &stats);
+
+    stats = (ERROR_STATS){ 0 };
+    for (nDesired = 0; nDesired < THREE_SIXTY_TIMES_TEN; nDesired++)
+    {
+        for (nFirst = 0; nFirst < THREE_SIXTY_TIMES_TEN; nFirst += 11)
+        {
+            start.nAzimuth = (INT16)nFirst;
+            start.nInclination = 872;
+            end.nAzimuth = (INT16)((nFirst + 25) % THREE_SIXTY_TIMES_TEN);
+            end.nInclination = 884;
+            if (!CheckPair(&stats, &start, &end, (INT16)nDesired))
+            {
+                return 0;
+            }
+        }
+    }
+    Report("desired azimuth sweep", &stats);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Unrelated surveys anywhere in range with any course length, most of
+*       them short so the small dogleg series is well covered.
+*******************************************************************************/
+static int CheckRandomPairs(void)
+{
+    ERROR_STATS stats = { 0 };
+    MIN_CURVE_STATION start, end;
+    long nRun;
+
+    for (nRun = 0; nRun < RANDOM_PAIRS; nRun++)
+    {
+        start.nAzimuth = (INT16)(rand() % THREE_SIXTY_TIMES_TEN);
+        start.nInclination = (INT16)(rand() % (MAX_INCLINATION + 1));
+        start.nPipeLength = rand() % 100000;
+        if ((rand() % 2) == 0)
+        {
+            end.nAzimuth = (INT16)(rand() % THREE_SIXTY_TIMES_TEN);
+            end.nInclination = (INT16)(rand() % (MAX_INCLINATION + 1));
+        }
+        else
+        {
+            end.nAzimuth = (INT16)((start.nAzimuth + THREE_SIXTY_TIMES_TEN + (rand() % 41) - 20) % THREE_SIXTY_TIMES_TEN);
+            end.nInclination = (INT16)(start.nInclination + (rand() % 21) - 10);
+            if ((end.nInclination < 0) || (end.nInclination > MAX_INCLINATION))
+            {
+                end.nInclination = start.nInclination;
+            }
+        }
+        end.nPipeLength = start.nPipeLength + 1 + (rand() % 2000);
+        if (!CheckPair(&stats, &start, &end, (INT16)(rand() % THREE_SIXTY_TIMES_TEN)))
+        {
+            return 0;
+        }
+    }
+    Report("random pairs", &stats);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Holes built the way RecordManager sums them, a survey a stand with
+*       the angles wandering, checked on the totals.  The float sums in the
+*       firmware lose more than the deltas do, so the totals are summed in
+*       double on both sides and only the deltas' own error adds up.
+*******************************************************************************/
+static int CheckTrajectories(void)
+{
+    EASTING_NORTHING_DATA_STRUCT table, reference;
+    MIN_CURVE_STATION previous, station;
+    double fTable[3], fReference[3], fError, fWorst = 0.0;
+    INT16 nDesired;
+    int nRun, nStation, nAxis;
+
+    for (nRun = 0; nRun < TRAJECTORIES; nRun++)
+    {
+        nDesired = (INT16)(rand() % THREE_SIXTY_TIMES_TEN);
+        station.nAzimuth = (INT16)((nDesired + THREE_SIXTY_TIMES_TEN + (rand() % 201) - 100) % THREE_SIXTY_TIMES_TEN);
+        station.nInclination = (INT16)(rand() % (MAX_INCLINATION + 1));
+        station.nPipeLength = 0;
+        fTable[0] = fTable[1] = fTable[2] = 0.0;
+        fReference[0] = fReference[1] = fReference[2] = 0.0;
+
+        for (nStation = 0; nStation < TRAJECTORY_STATIONS; nStation++)
+        {
+            previous = station;
+            station.nAzimuth = (INT16)((station.nAzimuth + THREE_SIXTY_TIMES_TEN + (rand() % 31) - 15) % THREE_SIXTY_TIMES_TEN);
+            station.nInclination = (INT16)(station.nInclination + (rand() % 31) - 15);
+            if ((station.nInclination < 0) || (station.nInclination > MAX_INCLINATION))
+            {
+                station.nInclination = previous.nInclination;
+            }
+            station.nPipeLength += 90 + (rand() % 20);
+
+            Calc_MinCurveTenths(&table, &previous, &station, nDesired);
+            Reference(&reference, &previous, &station, nDesired);
+            fTable[0] += table.fNorthing / 100.0;
+            fTable[1] += table.fEasting / 10.0;
+            fTable[2] += table.fDepth / 100.0;
+            fReference[0] += reference.fNorthing / 100.0;
+            fReference[1] += reference.fEasting / 10.0;
+            fReference[2] += reference.fDepth / 100.0;
+        }
+
+        for (nAxis = 0; nAxis < 3; nAxis++)
+        {
+            fError = fabs(fTable[nAxis] - fReference[nAxis]) / station.nPipeLength;
+            fWorst = (fError > fWorst) ? fError : fWorst;
+            if (fError > TRAJECTORY_BOUND)
+            {
+                printf("MISMATCH trajectory %d axis %d: %.6f against %.6f over %ld\n", nRun, nAxis,
+                       fTable[nAxis], fReference[nAxis], (long)station.nPipeLength);
+                return 0;
+            }
+        }
+    }
+    printf("%-24s %9d holes of %d stations, worst %.2e of hole length\n", "random trajectories",
+           TRAJECTORIES, TRAJECTORY_STATIONS, fWorst);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Only a rough guide to the firmware: the host does double in hardware,
+*       where the M4F does it in the software library.
+*******************************************************************************/
+static void Bench(void)
+{
+    static MIN_CURVE_STATION stations[1024];
+    static POSITION_DATA_STRUCT positions[1024];
+    EASTING_NORTHING_DATA_STRUCT result;
+    POSITION_DATA_STRUCT start, end;
+    volatile REAL32 fSink = 0.0f;
+    double fStart, fTable, fDouble;
+    int nRun, nIndex;
+
+    for (nIndex = 0; nIndex < 1024; nIndex++)
+    {
+        stations[nIndex].nAzimuth = (INT16)(rand() % THREE_SIXTY_TIMES_TEN);
+        stations[nIndex].nInclination = (INT16)(rand() % (MAX_INCLINATION + 1));
+        stations[nIndex].nPipeLength = nIndex * 100;
+        positions[nIndex].nAzimuth.fDeg = stations[nIndex].nAzimuth / 10.0;
+        positions[nIndex].nInclination.fDeg = stations[nIndex].nInclination / 10.0;
+        positions[nIndex].nPipeLength = stations[nIndex].nPipeLength;
+    }
+    m_nDesiredAzimuth = 900;
+
+    fStart = Seconds();
+    for (nRun = 0; nRun < BENCH_RUNS; nRun++)
+    {
+        nIndex = nRun & 1022;
+        Calc_MinCurveTenths(&result, &stations[nIndex], &stations[nIndex + 1], 900);
+        fSink += result.fDepth;
+    }
+    fTable = Seconds();
+    for (nRun = 0; nRun < BENCH_RUNS; nRun++)
+    {
+        nIndex = nRun & 1022;
+        start = positions[nIndex];  // it writes back into its inputs
+        end = positions[nIndex + 1];
+        Calc_AveAngleMinCurve(&result, &start, &end);
+        fSink += result.fDepth;
+    }
+    fDouble = Seconds();
+
+    printf("table, single         %6.1f ns/pair\n", (fTable - fStart) * 1e9 / BENCH_RUNS);
+    printf("double reference      %6.1f ns/pair\n", (fDouble - fTable) * 1e9 / BENCH_RUNS);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    srand(1);
+    if (!CheckSweeps() || !CheckRandomPairs() || !CheckTrajectories())
+    {
+        return 1;
+    }
+    Bench();
+    return 0;
+}
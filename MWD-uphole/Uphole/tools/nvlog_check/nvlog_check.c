@@ -0,0 +1,389 @@
+/*******************************************************************************
+*       @brief      Host check of the NV settings log: random saves into a
+*                   model of the serial flash, cut off by power losses that
+*                   tear the page being programmed, each followed by
+*                   NVLOG_Recover().  Not part of the firmware build.
+*       @file       Uphole/tools/nvlog_check/nvlog_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/SerialFlash -I../../inc/CommDrivers -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           nvlog_check.c ../../src/crc.c -o nvlog_check && ./nvlog_check
+*
+*       U_INT32 is 64 bits on a 64 bit host, so the records are bigger than
+*       on the target, fewer fit a page and their sequence numbers are not
+*       always 8 byte aligned; the scan depends on neither.
+*       It exits non zero if a recovered image is not the last save that
+*       reached the flash (or a save torn on its way there), a snapshot is
+*       lost, a record out of sequence is replayed, or a page is programmed
+*       over bytes that are not erased.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "portable.h"
+#include "crc.h"
+#include "CommDriver_Flash.h"
+
+// FlashMemory.h pulls in the record and logging managers, NVLog.c only
+// reads pages through it.
+#define FLASH_MEMORY_H
+void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber);
+
+#include "../../src/SerialFlash/NVLog.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CRC_POLYNOMIAL      0x04C11DB7u
+#define CRC_SEED            0xFFFFFFFFu
+
+#define FIRST_PAGE          4080    // ring start, any page number will do
+#define IMAGE_LENGTH        200     // short of NVLOG_MAX_IMAGE, like NV_LOGGED_BYTES
+#define POWER_CYCLES        4000
+#define MAX_SAVES           400     // saves between power losses
+#define SAVE_HISTORY        64      // saves kept to compare a recovery against
+
+// Chances are in 1000.
+#define CHANCE_FAIL         10      // a queued write fails part way
+#define CHANCE_TEAR         700     // a power loss tears the write in progress
+#define CHANCE_BIG_CHANGE   30      // a save changes most of the image
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A page write waiting for the model flash, and the save it belongs to.
+typedef struct
+{
+    FLASH_PAGE page;
+    U_INT32 nPageNumber;
+    BOOL bErase;
+    FLASH_WRITE_CALLBACK pCallback;
+    U_INT32 nSave;
+} QUEUED_WRITE;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                     //
+//============================================================================//
+
+static U_BYTE m_nFlash[NVLOG_PAGES][FLASH_PAGE_SIZE];
+static QUEUED_WRITE m_Queue[FLASH_WRITE_QUEUE_SIZE];
+static int m_nQueueHead;
+static int m_nQueueCount;
+static BOOL m_bProgrammedOver;
+
+// Saves are numbered from 1; an image is kept for each of the latest.
+static U_BYTE m_nSaved[SAVE_HISTORY][IMAGE_LENGTH];
+static BOOL m_bTorn[SAVE_HISTORY];
+static U_INT32 m_nSaves;
+static U_INT32 m_nLastApplied;  // newest save whose write reached the flash whole
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       The STM32F4 CRC unit, a word at a time: MSB first, no reflection, no
+*       final XOR (RM0090 CRC calculation unit).  CalculateCRC() feeds it.
+*******************************************************************************/
+void CRC_ResetDR(void)
+{
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t pBuffer[], uint32_t BufferLength)
+{
+    uint32_t nCRC = CRC_SEED;
+    uint32_t nWord;
+    int nBit;
+
+    for (nWord = 0; nWord < BufferLength; nWord++)
+    {
+        nCRC ^= pBuffer[nWord];
+        for (nBit = 0; nBit < 32; nBit++)
+        {
+            nCRC = (nCRC & 0x80000000u) ? ((nCRC << 1) ^ CRC_POLYNOMIAL) : (nCRC << 1);
+        }
+    }
+    return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*       The flash driver as NVLog.c sees it.  Writes are queued whole and
+*       reach the model flash when ApplyWrite() runs.
+*******************************************************************************/
+void FLASH_ReadThePage(U_BYTE *page, U_INT32 pageNumber)
+{
+    memcpy(page, m_nFlash[pageNumber - FIRST_PAGE], FLASH_PAGE_SIZE);
+}
+
+U_BYTE FLASH_GetWriteQueueDepth(void)
+{
+    return (U_BYTE)m_nQueueCount;
+}
+
+static BOOL QueueWrite(const FLASH_PAGE *page, U_INT32 nPageNumber, BOOL bErase, FLASH_WRITE_CALLBACK pCallback)
+{
+    QUEUED_WRITE *pWrite;
+
+    if (m_nQueueCount >= FLASH_WRITE_QUEUE_SIZE ||
+        nPageNumber < FIRST_PAGE || nPageNumber >= FIRST_PAGE + NVLOG_PAGES)
+    {
+        return false;
+    }
+    pWrite = &m_Queue[(m_nQueueHead + m_nQueueCount++) % FLASH_WRITE_QUEUE_SIZE];
+    memcpy(&pWrite->page, page, sizeof(pWrite->page));
+    pWrite->nPageNumber = nPageNumber;
+    pWrite->bErase = bErase;
+    pWrite->pCallback = pCallback;
+    pWrite->nSave = m_nSaves + 1;
+    return true;
+}
+
+BOOL FLASH_QueueWriteRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, true, pCallback);
+}
+
+BOOL FLASH_QueueAppendRaw(const FLASH_PAGE *page, U_INT32 nPageNumber, FLASH_WRITE_CALLBACK pCallback)
+{
+    return QueueWrite(page, nPageNumber, false, pCallback);
+}
+
+/*******************************************************************************
+*       @details
+*       Programs the oldest queued write, the first nBytes of it if it is cut
+*       short.  Programming only clears bits, so a byte that needs one set
+*       again was not erased first.  The callback runs unless the power went.
+*******************************************************************************/
+static void ApplyWrite(int nBytes, FLASH_PAGE_STATUS eStatus, BOOL bPowerLost)
+{
+    QUEUED_WRITE *pWrite = &m_Queue[m_nQueueHead];
+    U_BYTE *pFlash = m_nFlash[pWrite->nPageNumber - FIRST_PAGE];
+    int nIndex;
+
+    if (pWrite->bErase)
+    {
+        memset(pFlash, 0xFF, FLASH_PAGE_SIZE);
+    }
+    for (nIndex = 0; nIndex < nBytes; nIndex++)
+    {
+        if ((pFlash[nIndex] & pWrite->page.AsBytes[nIndex]) != pWrite->page.AsBytes[nIndex])
+        {
+            m_bProgrammedOver = true;
+        }
+        pFlash[nIndex] &= pWrite->page.AsBytes[nIndex];
+    }
+    if (nBytes == FLASH_PAGE_SIZE && eStatus == FLASH_PAGE_GOOD)
+    {
+        m_nLastApplied = pWrite->nSave;
+    }
+    else
+    {
+        m_bTorn[pWrite->nSave % SAVE_HISTORY] = true;
+    }
+    m_nQueueHead = (m_nQueueHead + 1) % FLASH_WRITE_QUEUE_SIZE;
+    m_nQueueCount--;
+    if (!bPowerLost)
+    {
+        pWrite->pCallback(pWrite->nPageNumber, eStatus);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       What a recovery may give back: the newest save that reached the flash
+*       whole, or a later one whose write was torn after its last record.
+*******************************************************************************/
+static int CheckRecovery(BOOL bRecovered, const U_BYTE *pImage)
+{
+    U_INT32 nSave;
+
+    if (!bRecovered)
+    {
+        if (m_nLastApplied == 0)
+        {
+            return 1;
+        }
+        printf("MISMATCH no snapshot found, save %lu reached the flash\n", (unsigned long)m_nLastApplied);
+        return 0;
+    }
+    if (m_nSaves - m_nLastApplied >= SAVE_HISTORY)
+    {
+        printf("MISMATCH more saves failed than SAVE_HISTORY keeps\n");
+        return 0;
+    }
+    for (nSave = m_nLastApplied; nSave <= m_nSaves; nSave++)
+    {
+        if ((nSave == m_nLastApplied || m_bTorn[nSave % SAVE_HISTORY]) &&
+            memcmp(pImage, m_nSaved[nSave % SAVE_HISTORY], IMAGE_LENGTH) == 0)
+        {
+            return 1;
+        }
+    }
+    printf("MISMATCH recovered image is neither save %lu nor a torn later one, %lu saves\n",
+           (unsigned long)m_nLastApplied, (unsigned long)m_nSaves);
+    return 0;
+}
+
+/*******************************************************************************
+*       @details
+*       Changes a few bytes, or now and then most of the image.
+*******************************************************************************/
+static void Edit(U_BYTE *pImage)
+{
+    int nChanges = (rand() % 1000 < CHANCE_BIG_CHANGE) ? IMAGE_LENGTH : 1 + rand() % 4;
+    int nIndex;
+
+    while (nChanges-- > 0)
+    {
+        nIndex = rand() % IMAGE_LENGTH;
+        pImage[nIndex] = (U_BYTE)(pImage[nIndex] + 1 + rand() % 255);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Runs saves with the write queue served at random, then loses the
+*       power, maybe in the middle of a page program, and recovers.
+*******************************************************************************/
+static int CheckPowerCycles(void)
+{
+    U_BYTE image[IMAGE_LENGTH];
+    U_INT32 nSaves = 0;
+    U_INT32 nErases = 0;
+    int nCycle;
+    int nSave;
+
+    memset(m_nFlash, 0xFF, sizeof(m_nFlash));
+    m_nSaves = 0;
+    m_nLastApplied = 0;
+    for (nCycle = 0; nCycle < POWER_CYCLES; nCycle++)
+    {
+        memset(image, 0x5A, sizeof(image));
+        if (!CheckRecovery(NVLOG_Recover(FIRST_PAGE, image, IMAGE_LENGTH), image))
+        {
+            printf("at power up %d\n", nCycle);
+            return 0;
+        }
+        if (m_nLastApplied != 0 || m_NVLogStats.nRecoveredSequence != 0)
+        {
+            // what the flash holds is now the newest save
+            memcpy(m_nSaved[m_nSaves % SAVE_HISTORY], image, IMAGE_LENGTH);
+            m_bTorn[m_nSaves % SAVE_HISTORY] = false;
+            m_nLastApplied = m_nSaves;
+        }
+
+        for (nSave = rand() % MAX_SAVES; nSave > 0; nSave--)
+        {
+            Edit(image);
+            if (NVLOG_Commit(image) && m_nQueueCount > 0 &&
+                m_Queue[(m_nQueueHead + m_nQueueCount - 1) % FLASH_WRITE_QUEUE_SIZE].nSave == m_nSaves + 1)
+            {
+                m_nSaves++;
+                memcpy(m_nSaved[m_nSaves % SAVE_HISTORY], image, IMAGE_LENGTH);
+                m_bTorn[m_nSaves % SAVE_HISTORY] = false;
+            }
+            while (m_nQueueCount > 0 && rand() % 3 != 0)
+            {
+                if (rand() % 1000 < CHANCE_FAIL)
+                {
+                    ApplyWrite(rand() % FLASH_PAGE_SIZE, FLASH_PAGE_CORRUPT, false);
+                }
+                else
+                {
+                    ApplyWrite(FLASH_PAGE_SIZE, FLASH_PAGE_GOOD, false);
+                }
+            }
+            if (m_bProgrammedOver)
+            {
+                printf("MISMATCH a page was programmed over bytes not erased, cycle %d\n", nCycle);
+                return 0;
+            }
+        }
+
+        if (m_nQueueCount > 0 && rand() % 1000 < CHANCE_TEAR)
+        {
+            ApplyWrite(rand() % FLASH_PAGE_SIZE, FLASH_PAGE_CORRUPT, true);
+        }
+        m_nQueueCount = 0;
+        nSaves += m_NVLogStats.nCommits;
+        nErases += m_NVLogStats.nPageErases;
+    }
+    printf("%d power cycles, %lu saves took %lu page erases, one each before the log\n",
+           POWER_CYCLES, (unsigned long)nSaves, (unsigned long)nErases);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       A record that checks out but skips a sequence number, as left by an
+*       older pass of the ring, ends the replay.  It is written with the
+*       log's own append after the sequence is moved on by one.
+*******************************************************************************/
+static int CheckOutOfSequence(void)
+{
+    U_BYTE image[IMAGE_LENGTH];
+    U_BYTE stale[IMAGE_LENGTH];
+
+    memset(m_nFlash, 0xFF, sizeof(m_nFlash));
+    m_nQueueCount = 0;
+    (void)NVLOG_Recover(FIRST_PAGE, image, IMAGE_LENGTH);
+    memset(image, 0x11, sizeof(image));
+    if (!NVLOG_Commit(image) || m_nQueueCount != 1)
+    {
+        printf("MISMATCH first save not queued\n");
+        return 0;
+    }
+    ApplyWrite(FLASH_PAGE_SIZE, FLASH_PAGE_GOOD, false);
+
+    memset(stale, 0x5A, sizeof(stale));
+    (void)NVLOG_Recover(FIRST_PAGE, stale, IMAGE_LENGTH);
+    memset(stale, 0x22, sizeof(stale));
+    m_nSequence++;
+    if (!nvlog_AppendRecord(NVLOG_DELTA_MARKER, stale, 0, 8, 0))
+    {
+        printf("MISMATCH no room for the stale record\n");
+        return 0;
+    }
+    memcpy(m_nFlash[m_nPageIndex], m_nLogPage, FLASH_PAGE_SIZE);
+
+    memset(stale, 0x5A, sizeof(stale));
+    if (!NVLOG_Recover(FIRST_PAGE, stale, IMAGE_LENGTH) ||
+        memcmp(stale, image, IMAGE_LENGTH) != 0 || m_NVLogStats.nBadRecords != 1)
+    {
+        printf("MISMATCH a record out of sequence was replayed\n");
+        return 0;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    srand(1);
+    if (!CheckOutOfSequence() || !CheckPowerCycles())
+    {
+        return 1;
+    }
+    return 0;
+}
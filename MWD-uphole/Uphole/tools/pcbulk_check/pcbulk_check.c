@@ -0,0 +1,1167 @@
+/*******************************************************************************
+*       @brief      Reference PC side decoder of the binary borehole download
+*                   (PCBulkTransfer.c), run against the firmware sender over
+*                   a lossy link and checked against the CSV download.  Not
+*                   part of the firmware build.
+*       @file       Uphole/tools/pcbulk_check/pcbulk_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/SerialProtocol -I../../inc/CommDrivers
+*           -I../../inc/DataManagers -I../../inc/UI_Tabs -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           pcbulk_check.c ../../src/crc.c -o pcbulk_check && ./pcbulk_check
+*
+*       Given a file it decodes a captured download instead, every byte the
+*       PC received after "BEGIN_BIN", and writes the CSV to stdout:
+*
+*       ./pcbulk_check capture.bin > hole.csv
+*
+*       The decoder only knows the frame layout in PCBulkTransfer.h and the
+*       byte offsets the IAR build gives the records and hole info.  Its CSV
+*       is what PCPORT_StateMachine() writes for the same flash on the first
+*       download after power up, up to the branch table, which the binary
+*       download does not carry.  It exits non zero if a transfer fails or
+*       its CSV differs from the one written from the records themselves.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "stm32f4xx.h"
+#include "portable.h"
+#include "CommDriver_Flash.h"
+
+// RecordManager.h and the UI headers pull in the IAR intrinsics, so
+// PCBulkTransfer.c gets these instead.  The records are laid out as the IAR
+// build lays them out, fixed width where U_INT32 is 64 bits on this host.
+#define RECORD_MANAGER_H
+#define UI_MAIN_TAB_H
+#define UI_JOB_TAB_H
+
+typedef struct
+{
+    uint32_t tSurveyTimeStamp;
+    INT16 nAzimuth;
+    INT16 nPitch;
+    INT16 nRoll;
+    INT16 nTemperature;
+    INT16 nGamma;
+    INT16 nGTF;
+    INT16 Y;
+    INT16 X;
+    int32_t Z;
+    U_INT16 nRecordNumber;
+    U_INT16 nTotalLength;
+    RTC_DateTypeDef date;
+    INT16 StatusCode;
+    INT16 NumOfBranch;
+    INT16 NextBranchRecordNum;
+    INT16 PreviousBranchRecordNum;
+    INT16 PreviousRecordIndex;
+    INT16 GammaShotLock;
+    INT16 GammaShotNumCorrected;
+    BOOL InvalidDataFlag;
+    BOOL branchWasSet;
+} STRUCT_RECORD_DATA;
+
+typedef struct
+{
+    char BoreholeName[16];
+    U_INT16 BoreholeNumber;
+    U_INT16 StartingRecordNumber;
+    U_INT16 EndingRecordNumber;
+    INT16 DefaultPipeLength;
+    INT16 Declination;
+    INT16 Toolface;
+    INT16 DesiredAzimuth;
+} NEWHOLE_INFO;
+
+typedef struct
+{
+    uint32_t TotalLength;
+    int32_t TotalDepth;
+    REAL32 TotalNorthings;
+    REAL32 TotalEastings;
+} BOREHOLE_STATISTICS;
+
+#define RECORDS_PER_PAGE            (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(STRUCT_RECORD_DATA))
+#define NEW_HOLE_RECORDS_PER_PAGE   (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(NEWHOLE_INFO))
+
+U_INT32 GetRecordCount(void);
+U_INT16 CurrentBoreholeNumber(void);
+void GetBoreholeStats(BOREHOLE_STATISTICS* stats);
+FLASH_PAGE_STATUS RECORD_ReadRecordPage(FLASH_PAGE* pPage, U_INT32 pageNumber);
+FLASH_PAGE_STATUS RECORD_ReadHoleInfoPage(FLASH_PAGE* pPage, U_INT32 pageNumber);
+void ShowStatusMessage(char* message);
+char* GetBoreholeName(void);
+
+#include "../../src/SerialProtocol/PCBulkTransfer.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define CRC_POLYNOMIAL      0x04C11DB7u
+#define CRC_SEED            0xFFFFFFFFu
+#define CRC_SIZE            4
+#define FRAME_MAX           (PCBULK_HEADER_SIZE + FLASH_PAGE_SIZE + CRC_SIZE)
+#define SUMMARY_SIZE        52
+
+// STRUCT_RECORD_DATA as the IAR build lays it out
+#define RECORD_SIZE         48
+#define REC_TIMESTAMP       0
+#define REC_AZIMUTH         4
+#define REC_PITCH           6
+#define REC_ROLL            8
+#define REC_TEMPERATURE     10
+#define REC_GAMMA           12
+#define REC_GTF             14
+#define REC_Y               16
+#define REC_X               18
+#define REC_Z               20
+#define REC_NUMBER          24
+#define REC_LENGTH          26
+#define REC_WEEKDAY         28
+#define REC_MONTH           29
+#define REC_DATE            30
+#define REC_YEAR            31
+#define REC_STATUS          32
+#define REC_BRANCHES        34
+#define REC_NEXT_BRANCH     36
+#define REC_PREV_BRANCH     38
+#define REC_PREV_INDEX      40
+#define REC_GAMMA_LOCK      42
+#define REC_GAMMA_CORRECTED 44
+#define REC_INVALID         46
+#define REC_BRANCH_SET      47
+
+// NEWHOLE_INFO as the IAR build lays it out
+#define HOLE_SIZE           30
+#define HOLE_NAME           0
+#define HOLE_NUMBER         16
+#define HOLE_START          18
+#define HOLE_END            20
+#define HOLE_PIPE           22
+#define HOLE_DECLINATION    24
+#define HOLE_TOOLFACE       26
+#define HOLE_DESIRED_AZ     28
+
+#define MAX_RECORDS         2400    // 240 record pages
+#define MAX_HOLES           40      // three hole info pages
+#define LINK_SIZE           (FRAME_MAX * 16)
+#define REPLY_QUEUE_SIZE    64
+#define PASS_LIMIT          20000000L   // 1 ms passes, over five hours
+#define CHECK_RUNS          40
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// What a PC program keeps while it decodes one download.
+typedef struct
+{
+    // SUMMARY block
+    U_INT32 nRecordCount;
+    U_INT16 nRecordsPerPage;
+    U_INT16 nRecordPages;
+    U_INT16 nHoleInfoPerPage;
+    U_INT16 nHoleInfoPages;
+    U_INT16 nBoreholeNumber;
+    uint32_t nTotalLength;
+    int32_t nTotalDepth;
+    REAL32 fTotalNorthings;
+    REAL32 fTotalEastings;
+    char sName[PCBULK_NAME_SIZE + 1];
+    // raw flash pages, as they came
+    U_BYTE *pHoleInfo;
+    U_BYTE *pRecords;
+    // block stream
+    U_INT16 nBlockCount;
+    U_INT16 nExpected;          // next block wanted
+    long nNakFor;               // block a NAK was last sent for
+    BOOL bDone;
+    BOOL bFailed;
+    U_BYTE nStream[FRAME_MAX * 2];
+    int nStreamLength;
+    void (*pfReply)(const char *pLine);
+    // statistics
+    U_INT32 nCrcErrors;
+    U_INT32 nNaks;
+} DECODER;
+
+// Where the CSV writer gets its hole info and records from.
+typedef struct _CSV_SOURCE
+{
+    BOOL (*pfHoleInfo)(const struct _CSV_SOURCE *pSource, U_INT32 nHole, NEWHOLE_INFO *pHole);
+    BOOL (*pfRecord)(const struct _CSV_SOURCE *pSource, U_INT32 nRecord, STRUCT_RECORD_DATA *pRecord);
+    const DECODER *pDecoder;
+    U_INT32 nRecordCount;
+    uint32_t nTotalLength;
+    int32_t nTotalDepth;
+    REAL32 fTotalNorthings;
+    REAL32 fTotalEastings;
+    const char *pName;
+} CSV_SOURCE;
+
+typedef struct
+{
+    char *pText;
+    size_t nLength;
+    size_t nSize;
+} CSV_TEXT;
+
+// How badly the link behaves, each a chance in 10000
+typedef struct
+{
+    const char *pName;
+    int nUartBusy;          // UART_SendMessage() has no room this pass
+    int nFrameLoss;         // whole frame lost
+    int nByteError;         // a byte changed on the wire, per byte
+    int nByteLoss;          // a byte lost on the wire, per byte
+    int nReplyLoss;         // ACK or NAK line lost
+    int nReplyDelay;        // passes before a reply reaches the firmware
+    int nReadMax;           // most bytes the PC reads in a pass
+} LINK_PROFILE;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// the hole as the record manager has it
+static STRUCT_RECORD_DATA m_Records[MAX_RECORDS];
+static NEWHOLE_INFO m_Holes[MAX_HOLES + 1];
+static U_INT32 m_nRecordCount;
+static U_INT16 m_nBoreholeNumber;
+static BOREHOLE_STATISTICS m_Stats;
+static char m_sBoreholeName[PCBULK_NAME_SIZE + 1];
+
+// the link
+static const LINK_PROFILE *m_pLink;
+static U_BYTE m_nLink[LINK_SIZE];
+static int m_nLinkLength;
+static U_INT32 m_nFramesSent;
+static U_INT32 m_nWireBytes;
+static char m_sReplies[REPLY_QUEUE_SIZE][16];
+static long m_nReplyDue[REPLY_QUEUE_SIZE];
+static int m_nReplyHead;
+static int m_nReplyCount;
+static long m_nNow;
+static const char *m_pStatus;
+
+static const LINK_PROFILE m_Links[] =
+{
+    { "clean", 0,   0,   0, 0,   0,  0, 2000 },
+    { "busy",  3000, 0,  0, 0,   0, 20,  100 },
+    { "lossy", 3000, 300, 1, 1, 500, 20, 600 },
+};
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       Stand ins for what PCBulkTransfer.c calls.  The pages come from the
+*       hole made up by MakeHole(), as RecordManager.c would return them.
+*******************************************************************************/
+U_INT32 GetRecordCount(void)
+{
+    return m_nRecordCount;
+}
+
+U_INT16 CurrentBoreholeNumber(void)
+{
+    return m_nBoreholeNumber;
+}
+
+void GetBoreholeStats(BOREHOLE_STATISTICS* stats)
+{
+    *stats = m_Stats;
+}
+
+char* GetBoreholeName(void)
+{
+    return m_sBoreholeName;
+}
+
+void ShowStatusMessage(char* message)
+{
+    m_pStatus = message;
+}
+
+TIME_LR ElapsedTimeLowRes(TIME_LR nOldTime)
+{
+    return (TIME_LR)(m_nNow - (long)nOldTime);
+}
+
+FLASH_PAGE_STATUS RECORD_ReadRecordPage(FLASH_PAGE* pPage, U_INT32 pageNumber)
+{
+    U_INT32 nRecord = pageNumber * RECORDS_PER_PAGE;
+    U_INT32 nSlot;
+
+    memset(pPage, 0xFF, sizeof(FLASH_PAGE));
+    for (nSlot = 0; (nSlot < RECORDS_PER_PAGE) && (nRecord < m_nRecordCount); nSlot++, nRecord++)
+    {
+        memcpy(&pPage->AsBytes[nSlot * sizeof(STRUCT_RECORD_DATA)], &m_Records[nRecord], sizeof(STRUCT_RECORD_DATA));
+    }
+    return FLASH_PAGE_GOOD;
+}
+
+FLASH_PAGE_STATUS RECORD_ReadHoleInfoPage(FLASH_PAGE* pPage, U_INT32 pageNumber)
+{
+    U_INT32 nHole = pageNumber * NEW_HOLE_RECORDS_PER_PAGE;
+    U_INT32 nSlot;
+
+    memset(pPage, 0, sizeof(FLASH_PAGE));
+    for (nSlot = 0; (nSlot < NEW_HOLE_RECORDS_PER_PAGE) && (nHole <= m_nBoreholeNumber); nSlot++, nHole++)
+    {
+        memcpy(&pPage->AsBytes[nSlot * sizeof(NEWHOLE_INFO)], &m_Holes[nHole], sizeof(NEWHOLE_INFO));
+    }
+    return FLASH_PAGE_GOOD;
+}
+
+/*******************************************************************************
+*       @details
+*       The CRC unit, one 32-bit word a write (RM0090).  CalculateCRC() hands
+*       it the frame a word at a time, so each word is the next four bytes
+*       little endian.
+*******************************************************************************/
+static uint32_t ModelWord(uint32_t nCRC, uint32_t nWord)
+{
+    int nBit;
+
+    nCRC ^= nWord;
+    for (nBit = 0; nBit < 32; nBit++)
+    {
+        nCRC = (nCRC & 0x80000000u) ? ((nCRC << 1) ^ CRC_POLYNOMIAL) : (nCRC << 1);
+    }
+    return nCRC;
+}
+
+void CRC_ResetDR(void)
+{
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t pBuffer[], uint32_t BufferLength)
+{
+    const U_BYTE *pBytes = (const U_BYTE *)pBuffer;
+    uint32_t nCRC = CRC_SEED;
+    uint32_t nWord;
+
+    for (nWord = 0; nWord < BufferLength; nWord++, pBytes += 4)
+    {
+        nCRC = ModelWord(nCRC, pBytes[0] | (pBytes[1] << 8) | (pBytes[2] << 16) | ((uint32_t)pBytes[3] << 24));
+    }
+    return nCRC;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static uint32_t Get16(const U_BYTE *pData)
+{
+    return pData[0] | (pData[1] << 8);
+}
+
+static uint32_t Get32(const U_BYTE *pData)
+{
+    return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((uint32_t)pData[3] << 24);
+}
+
+static REAL32 GetReal(const U_BYTE *pData)
+{
+    uint32_t nBits = Get32(pData);
+    REAL32 fValue;
+
+    memcpy(&fValue, &nBits, sizeof(fValue));
+    return fValue;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Decoder_Reply(DECODER *pDecoder, const char *pFormat, unsigned nBlock)
+{
+    char sLine[16];
+
+    if (pDecoder->pfReply != NULL)
+    {
+        snprintf(sLine, sizeof(sLine), pFormat, nBlock);
+        pDecoder->pfReply(sLine);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Lays out the download from the SUMMARY block.  Anything this decoder
+*       cannot read the records of fails the transfer.
+*******************************************************************************/
+static int Decoder_Summary(DECODER *pDecoder, const U_BYTE *pPayload, int nLength)
+{
+    if (nLength < SUMMARY_SIZE)
+    {
+        printf("MISMATCH summary of %d bytes\n", nLength);
+        return 0;
+    }
+    pDecoder->nRecordCount = Get32(&pPayload[0]);
+    pDecoder->nRecordsPerPage = (U_INT16)Get16(&pPayload[6]);
+    pDecoder->nRecordPages = (U_INT16)Get16(&pPayload[8]);
+    pDecoder->nHoleInfoPerPage = (U_INT16)Get16(&pPayload[12]);
+    pDecoder->nHoleInfoPages = (U_INT16)Get16(&pPayload[14]);
+    pDecoder->nBoreholeNumber = (U_INT16)Get16(&pPayload[16]);
+    pDecoder->nTotalLength = Get32(&pPayload[20]);
+    pDecoder->nTotalDepth = (int32_t)Get32(&pPayload[24]);
+    pDecoder->fTotalNorthings = GetReal(&pPayload[28]);
+    pDecoder->fTotalEastings = GetReal(&pPayload[32]);
+    memcpy(pDecoder->sName, &pPayload[36], PCBULK_NAME_SIZE);
+    pDecoder->sName[PCBULK_NAME_SIZE] = 0;
+
+    if ((Get16(&pPayload[4]) != RECORD_SIZE) || (Get16(&pPayload[10]) != HOLE_SIZE) ||
+        (pDecoder->nRecordsPerPage != (FLASH_PAGE_SIZE - 4) / RECORD_SIZE) ||
+        (pDecoder->nHoleInfoPerPage != (FLASH_PAGE_SIZE - 4) / HOLE_SIZE) ||
+        ((U_INT32)pDecoder->nRecordPages * pDecoder->nRecordsPerPage < pDecoder->nRecordCount) ||
+        ((U_INT32)pDecoder->nHoleInfoPages * pDecoder->nHoleInfoPerPage <= pDecoder->nBoreholeNumber))
+    {
+        printf("MISMATCH summary: record %u bytes %u a page, hole info %u bytes %u a page\n",
+               (unsigned)Get16(&pPayload[4]), (unsigned)pDecoder->nRecordsPerPage,
+               (unsigned)Get16(&pPayload[10]), (unsigned)pDecoder->nHoleInfoPerPage);
+        return 0;
+    }
+    pDecoder->nBlockCount = 1 + pDecoder->nHoleInfoPages + pDecoder->nRecordPages + 1;
+    pDecoder->pHoleInfo = calloc(pDecoder->nHoleInfoPages, FLASH_PAGE_SIZE);
+    pDecoder->pRecords = calloc(pDecoder->nRecordPages + 1, FLASH_PAGE_SIZE);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Takes one block that passed its CRC.  Blocks are only kept in order,
+*       a block ahead of the one wanted asks for a resend from there, one
+*       already kept acknowledges everything kept again in case that ACK
+*       was lost.
+*******************************************************************************/
+static void Decoder_Block(DECODER *pDecoder, const U_BYTE *pFrame)
+{
+    U_INT16 nBlock = (U_INT16)Get16(&pFrame[2]);
+    int nLength = (int)Get16(&pFrame[4]);
+    const U_BYTE *pPayload = &pFrame[PCBULK_HEADER_SIZE];
+    int nWanted;
+
+    if (nBlock < pDecoder->nExpected)
+    {
+        Decoder_Reply(pDecoder, "ACK %u", pDecoder->nExpected - 1);
+        return;
+    }
+    if (pDecoder->bDone)
+    {
+        return;
+    }
+    if (nBlock > pDecoder->nExpected)
+    {
+        if (pDecoder->nNakFor != pDecoder->nExpected)
+        {
+            pDecoder->nNaks++;
+            pDecoder->nNakFor = pDecoder->nExpected;
+            Decoder_Reply(pDecoder, "NAK %u", pDecoder->nExpected);
+        }
+        return;
+    }
+
+    if (nBlock == 0)
+    {
+        nWanted = PCBULK_BLOCK_SUMMARY;
+    }
+    else if (nBlock <= pDecoder->nHoleInfoPages)
+    {
+        nWanted = PCBULK_BLOCK_HOLE_INFO;
+    }
+    else if (nBlock <= pDecoder->nHoleInfoPages + pDecoder->nRecordPages)
+    {
+        nWanted = PCBULK_BLOCK_RECORDS;
+    }
+    else
+    {
+        nWanted = PCBULK_BLOCK_END;
+    }
+    if ((pFrame[1] != nWanted) || ((nWanted == PCBULK_BLOCK_HOLE_INFO || nWanted == PCBULK_BLOCK_RECORDS) && (nLength != FLASH_PAGE_SIZE)))
+    {
+        printf("MISMATCH block %u: type %u of %d bytes, expected type %d\n", nBlock, pFrame[1], nLength, nWanted);
+        pDecoder->bFailed = true;
+        return;
+    }
+
+    switch (nWanted)
+    {
+        case PCBULK_BLOCK_SUMMARY:
+            if (!Decoder_Summary(pDecoder, pPayload, nLength))
+            {
+                pDecoder->bFailed = true;
+                return;
+            }
+            break;
+        case PCBULK_BLOCK_HOLE_INFO:
+            memcpy(&pDecoder->pHoleInfo[(nBlock - 1) * FLASH_PAGE_SIZE], pPayload, FLASH_PAGE_SIZE);
+            break;
+        case PCBULK_BLOCK_RECORDS:
+            memcpy(&pDecoder->pRecords[(nBlock - 1 - pDecoder->nHoleInfoPages) * FLASH_PAGE_SIZE], pPayload, FLASH_PAGE_SIZE);
+            break;
+        default:
+            pDecoder->bDone = true;
+            break;
+    }
+    pDecoder->nExpected++;
+    Decoder_Reply(pDecoder, "ACK %u", nBlock);
+}
+
+/*******************************************************************************
+*       @details
+*       Bytes from the PC port, in any size of piece.  A frame is only taken
+*       once its CRC matches, anything else costs one byte and the hunt for
+*       SOH starts again from the next.
+*******************************************************************************/
+static void Decoder_Feed(DECODER *pDecoder, const U_BYTE *pData, int nLength)
+{
+    U_BYTE *pStream = pDecoder->nStream;
+    int nTake, nPayload, nFrame, nDrop;
+
+    while ((nLength > 0) && !pDecoder->bFailed)
+    {
+        nTake = (int)sizeof(pDecoder->nStream) - pDecoder->nStreamLength;
+        if (nTake > nLength)
+        {
+            nTake = nLength;
+        }
+        memcpy(&pStream[pDecoder->nStreamLength], pData, nTake);
+        pDecoder->nStreamLength += nTake;
+        pData += nTake;
+        nLength -= nTake;
+
+        while ((pDecoder->nStreamLength > 0) && !pDecoder->bFailed)
+        {
+            nDrop = 1;
+            if (pStream[0] == PCBULK_SOH)
+            {
+                if (pDecoder->nStreamLength < PCBULK_HEADER_SIZE)
+                {
+                    break;
+                }
+                nPayload = (int)Get16(&pStream[4]);
+                if ((pStream[1] >= PCBULK_BLOCK_SUMMARY) && (pStream[1] <= PCBULK_BLOCK_END) &&
+                    (nPayload <= FLASH_PAGE_SIZE) && ((nPayload % 4) == 0) && (pStream[7] == 0))
+                {
+                    nFrame = PCBULK_HEADER_SIZE + nPayload + CRC_SIZE;
+                    if (pDecoder->nStreamLength < nFrame)
+                    {
+                        break;
+                    }
+                    if (CRC_CalcBlockCRC((uint32_t *)pStream, (PCBULK_HEADER_SIZE + nPayload) / 4) ==
+                        Get32(&pStream[PCBULK_HEADER_SIZE + nPayload]))
+                    {
+                        Decoder_Block(pDecoder, pStream);
+                        nDrop = nFrame;
+                    }
+                    else
+                    {
+                        pDecoder->nCrcErrors++;
+                    }
+                }
+            }
+            pDecoder->nStreamLength -= nDrop;
+            memmove(pStream, &pStream[nDrop], pDecoder->nStreamLength);
+        }
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Decoder_Free(DECODER *pDecoder)
+{
+    free(pDecoder->pHoleInfo);
+    free(pDecoder->pRecords);
+}
+
+/*******************************************************************************
+*       @details
+*       NewHole_Info_Read() and RECORD_GetRecord() over the decoded pages,
+*       reading each field at its offset in the IAR layout.
+*******************************************************************************/
+static BOOL Decoded_HoleInfo(const CSV_SOURCE *pSource, U_INT32 nHole, NEWHOLE_INFO *pHole)
+{
+    const DECODER *pDecoder = pSource->pDecoder;
+    const U_BYTE *pEntry;
+
+    if (nHole > pDecoder->nBoreholeNumber)
+    {
+        return false;
+    }
+    pEntry = &pDecoder->pHoleInfo[(nHole / pDecoder->nHoleInfoPerPage) * FLASH_PAGE_SIZE +
+                                  (nHole % pDecoder->nHoleInfoPerPage) * HOLE_SIZE];
+    memcpy(pHole->BoreholeName, &pEntry[HOLE_NAME], sizeof(pHole->BoreholeName));
+    pHole->BoreholeNumber = (U_INT16)Get16(&pEntry[HOLE_NUMBER]);
+    pHole->StartingRecordNumber = (U_INT16)Get16(&pEntry[HOLE_START]);
+    pHole->EndingRecordNumber = (U_INT16)Get16(&pEntry[HOLE_END]);
+    pHole->DefaultPipeLength = (INT16)Get16(&pEntry[HOLE_PIPE]);
+    pHole->Declination = (INT16)Get16(&pEntry[HOLE_DECLINATION]);
+    pHole->Toolface = (INT16)Get16(&pEntry[HOLE_TOOLFACE]);
+    pHole->DesiredAzimuth = (INT16)Get16(&pEntry[HOLE_DESIRED_AZ]);
+    return true;
+}
+
+static BOOL Decoded_Record(const CSV_SOURCE *pSource, U_INT32 nRecord, STRUCT_RECORD_DATA *pRecord)
+{
+    const DECODER *pDecoder = pSource->pDecoder;
+    const U_BYTE *pEntry;
+
+    if (nRecord >= pDecoder->nRecordCount)
+    {
+        return false;
+    }
+    pEntry = &pDecoder->pRecords[(nRecord / pDecoder->nRecordsPerPage) * FLASH_PAGE_SIZE +
+                                 (nRecord % pDecoder->nRecordsPerPage) * RECORD_SIZE];
+    pRecord->tSurveyTimeStamp = Get32(&pEntry[REC_TIMESTAMP]);
+    pRecord->nAzimuth = (INT16)Get16(&pEntry[REC_AZIMUTH]);
+    pRecord->nPitch = (INT16)Get16(&pEntry[REC_PITCH]);
+    pRecord->nRoll = (INT16)Get16(&pEntry[REC_ROLL]);
+    pRecord->nTemperature = (INT16)Get16(&pEntry[REC_TEMPERATURE]);
+    pRecord->nGamma = (INT16)Get16(&pEntry[REC_GAMMA]);
+    pRecord->nGTF = (INT16)Get16(&pEntry[REC_GTF]);
+    pRecord->Y = (INT16)Get16(&pEntry[REC_Y]);
+    pRecord->X = (INT16)Get16(&pEntry[REC_X]);
+    pRecord->Z = (int32_t)Get32(&pEntry[REC_Z]);
+    pRecord->nRecordNumber = (U_INT16)Get16(&pEntry[REC_NUMBER]);
+    pRecord->nTotalLength = (U_INT16)Get16(&pEntry[REC_LENGTH]);
+    pRecord->date.RTC_WeekDay = pEntry[REC_WEEKDAY];
+    pRecord->date.RTC_Month = pEntry[REC_MONTH];
+    pRecord->date.RTC_Date = pEntry[REC_DATE];
+    pRecord->date.RTC_Year = pEntry[REC_YEAR];
+    pRecord->StatusCode = (INT16)Get16(&pEntry[REC_STATUS]);
+    pRecord->NumOfBranch = (INT16)Get16(&pEntry[REC_BRANCHES]);
+    pRecord->NextBranchRecordNum = (INT16)Get16(&pEntry[REC_NEXT_BRANCH]);
+    pRecord->PreviousBranchRecordNum = (INT16)Get16(&pEntry[REC_PREV_BRANCH]);
+    pRecord->PreviousRecordIndex = (INT16)Get16(&pEntry[REC_PREV_INDEX]);
+    pRecord->GammaShotLock = (INT16)Get16(&pEntry[REC_GAMMA_LOCK]);
+    pRecord->GammaShotNumCorrected = (INT16)Get16(&pEntry[REC_GAMMA_CORRECTED]);
+    pRecord->InvalidDataFlag = pEntry[REC_INVALID];
+    pRecord->branchWasSet = pEntry[REC_BRANCH_SET];
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       The same two reads straight from the hole MakeHole() built.
+*******************************************************************************/
+static BOOL Source_HoleInfo(const CSV_SOURCE *pSource, U_INT32 nHole, NEWHOLE_INFO *pHole)
+{
+    (void)pSource;
+    if (nHole > m_nBoreholeNumber)
+    {
+        return false;
+    }
+    *pHole = m_Holes[nHole];
+    return true;
+}
+
+static BOOL Source_Record(const CSV_SOURCE *pSource, U_INT32 nRecord, STRUCT_RECORD_DATA *pRecord)
+{
+    (void)pSource;
+    if (nRecord >= m_nRecordCount)
+    {
+        return false;
+    }
+    *pRecord = m_Records[nRecord];
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Csv_Printf(CSV_TEXT *pText, const char *pFormat, ...)
+{
+    va_list args;
+    int nLength;
+
+    for (;;)
+    {
+        va_start(args, pFormat);
+        nLength = vsnprintf(&pText->pText[pText->nLength], pText->nSize - pText->nLength, pFormat, args);
+        va_end(args);
+        if ((size_t)nLength < (pText->nSize - pText->nLength))
+        {
+            pText->nLength += nLength;
+            return;
+        }
+        pText->nSize = (pText->nSize * 2) + nLength;
+        pText->pText = realloc(pText->pText, pText->nSize);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       PCPORT_StateMachine() from PCDT_STATE_IDLE to PCDT_STATE_SEND_LOG4
+*       with the pacing taken out: the same holes in the same order, the same
+*       rows with the same formats and the same casts.  The hole info starts
+*       zeroed as the static in the firmware does, and stays as it was when
+*       the next hole has none, which is how the surveys of the open hole
+*       come out under the last closed one.
+*******************************************************************************/
+static void Csv_Write(CSV_TEXT *pText, const CSV_SOURCE *pSource)
+{
+    STRUCT_RECORD_DATA record;
+    NEWHOLE_INFO HoleInfoRecord;
+    U_INT32 HoleNum = 0;
+    U_INT32 recordNumber = 1;
+    BOOL flag_start_dump = true;
+
+    memset(&HoleInfoRecord, 0, sizeof(HoleInfoRecord));
+    pText->nLength = 0;
+    pText->pText[0] = 0;
+    while (flag_start_dump)
+    {
+        flag_start_dump = false;
+        HoleNum += 1;
+        (void)pSource->pfHoleInfo(pSource, HoleNum, &HoleInfoRecord);
+        if (HoleNum > (U_INT32)HoleInfoRecord.BoreholeNumber + 1)
+        {
+            return;
+        }
+
+        Csv_Printf(pText, "BoreName, Rec#, SurveyDepth, Azimuth, Pitch, Roll, X, Y, ");
+        Csv_Printf(pText, "Z, Gamma, TimeStamp, WeekDay, Month, Day, Year, DefltPipeLen, ");
+        Csv_Printf(pText, "Declin, DesiredAz, ToolFace, Statcode, #Branch, #BoreHole \r\n");
+
+        while (pSource->pfRecord(pSource, recordNumber, &record))
+        {
+            if (recordNumber > HoleInfoRecord.EndingRecordNumber)
+            {
+                if (HoleNum >= (U_INT32)HoleInfoRecord.BoreholeNumber + 1)
+                {
+                    if (HoleNum != (U_INT32)HoleInfoRecord.BoreholeNumber + 1)
+                    {
+                        flag_start_dump = false;
+                        break;
+                    }
+                    (void)pSource->pfHoleInfo(pSource, HoleNum, &HoleInfoRecord);
+                    flag_start_dump = true;
+                }
+                else
+                {
+                    flag_start_dump = true;
+                    break;
+                }
+            }
+
+            Csv_Printf(pText, "%.16s, %d, %d, %.1f, %.1f, %.1f, ",
+                       strlen(HoleInfoRecord.BoreholeName) ? HoleInfoRecord.BoreholeName : pSource->pName,
+                       record.nRecordNumber,
+                       record.nTotalLength,
+                       (REAL32)record.nAzimuth / 10.0,
+                       (REAL32)record.nPitch / 10.0,
+                       (REAL32)record.nRoll / 10.0);
+            Csv_Printf(pText, "%.1f, %.1f, %.1f, %d, %d, %d, %d, ",
+                       (REAL32)(record.X) / 10.0,
+                       (REAL32)(record.Y / 100),
+                       (REAL32)(record.Z / 10),
+                       record.nGamma,
+                       (int32_t)record.tSurveyTimeStamp,
+                       record.date.RTC_WeekDay,
+                       record.date.RTC_Month);
+            Csv_Printf(pText, "%d, %d, %d, %d, %d, %d, %d, %d, %d, ",
+                       record.date.RTC_Date,
+                       record.date.RTC_Year,
+                       HoleInfoRecord.DefaultPipeLength,
+                       HoleInfoRecord.Declination,
+                       HoleInfoRecord.DesiredAzimuth,
+                       HoleInfoRecord.Toolface,
+                       record.StatusCode,
+                       record.NumOfBranch,
+                       HoleInfoRecord.BoreholeNumber);
+            Csv_Printf(pText, "%d, %d, %d, %d, %d, %d, %d, %d, %d, ",
+                       record.nTemperature,
+                       record.nGTF,
+                       record.NextBranchRecordNum,
+                       record.PreviousBranchRecordNum,
+                       record.PreviousRecordIndex,
+                       record.GammaShotLock,
+                       record.GammaShotNumCorrected,
+                       record.InvalidDataFlag,
+                       record.branchWasSet);
+            Csv_Printf(pText, "%d, %d, %f, %f\n\r",
+                       (int32_t)pSource->nTotalLength,
+                       pSource->nTotalDepth,
+                       pSource->fTotalNorthings,
+                       pSource->fTotalEastings);
+
+            recordNumber++;
+            if (recordNumber >= pSource->nRecordCount)
+            {
+                // the branch table comes next
+                return;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Csv_FromDecoder(CSV_TEXT *pText, const DECODER *pDecoder)
+{
+    CSV_SOURCE source;
+
+    source.pfHoleInfo = Decoded_HoleInfo;
+    source.pfRecord = Decoded_Record;
+    source.pDecoder = pDecoder;
+    source.nRecordCount = pDecoder->nRecordCount;
+    source.nTotalLength = pDecoder->nTotalLength;
+    source.nTotalDepth = pDecoder->nTotalDepth;
+    source.fTotalNorthings = pDecoder->fTotalNorthings;
+    source.fTotalEastings = pDecoder->fTotalEastings;
+    source.pName = pDecoder->sName;
+    Csv_Write(pText, &source);
+}
+
+static void Csv_FromHole(CSV_TEXT *pText)
+{
+    CSV_SOURCE source;
+
+    source.pfHoleInfo = Source_HoleInfo;
+    source.pfRecord = Source_Record;
+    source.pDecoder = NULL;
+    source.nRecordCount = m_nRecordCount;
+    source.nTotalLength = m_Stats.TotalLength;
+    source.nTotalDepth = m_Stats.TotalDepth;
+    source.fTotalNorthings = m_Stats.TotalNorthings;
+    source.fTotalEastings = m_Stats.TotalEastings;
+    source.pName = m_sBoreholeName;
+    Csv_Write(pText, &source);
+}
+
+/*******************************************************************************
+*       @details
+*       Closed holes with a run of surveys each, then mostly some surveys of
+*       the open hole, which has no hole info yet.  Values cover the whole
+*       range of each field so signs and widths are checked.
+*******************************************************************************/
+static void MakeHole(void)
+{
+    U_INT32 nRecord, nHole, nEnd;
+    STRUCT_RECORD_DATA *pRecord;
+
+    memset(m_Records, 0, sizeof(m_Records));
+    memset(m_Holes, 0, sizeof(m_Holes));
+    m_nRecordCount = (rand() % 8 == 0) ? (U_INT32)(rand() % 3) : 1 + (U_INT32)(rand() % (MAX_RECORDS - 1));
+    m_nBoreholeNumber = (U_INT16)(rand() % (MAX_HOLES + 1));
+    snprintf(m_sBoreholeName, sizeof(m_sBoreholeName), "HOLE %d", rand() % 1000);
+
+    for (nRecord = 1; nRecord < m_nRecordCount; nRecord++)
+    {
+        pRecord = &m_Records[nRecord];
+        pRecord->tSurveyTimeStamp = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        pRecord->nAzimuth = (INT16)rand();
+        pRecord->nPitch = (INT16)rand();
+        pRecord->nRoll = (INT16)rand();
+        pRecord->nTemperature = (INT16)rand();
+        pRecord->nGamma = (INT16)rand();
+        pRecord->nGTF = (INT16)rand();
+        pRecord->Y = (INT16)rand();
+        pRecord->X = (INT16)rand();
+        pRecord->Z = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+        pRecord->nTotalLength = (U_INT16)rand();
+        pRecord->date.RTC_WeekDay = (uint8_t)(1 + rand() % 7);
+        pRecord->date.RTC_Month = (uint8_t)(1 + rand() % 12);
+        pRecord->date.RTC_Date = (uint8_t)(1 + rand() % 31);
+        pRecord->date.RTC_Year = (uint8_t)(rand() % 100);
+        pRecord->StatusCode = (INT16)rand();
+        pRecord->NumOfBranch = (INT16)(rand() % 4);
+        pRecord->NextBranchRecordNum = (INT16)rand();
+        pRecord->PreviousBranchRecordNum = (INT16)rand();
+        pRecord->PreviousRecordIndex = (INT16)rand();
+        pRecord->GammaShotLock = (INT16)(rand() % 2);
+        pRecord->GammaShotNumCorrected = (INT16)rand();
+        pRecord->InvalidDataFlag = (BOOL)(rand() % 2);
+        pRecord->branchWasSet = (BOOL)(rand() % 2);
+    }
+
+    // each closed hole takes at least one survey
+    if (m_nBoreholeNumber >= m_nRecordCount)
+    {
+        m_nBoreholeNumber = (U_INT16)((m_nRecordCount > 0) ? (m_nRecordCount - 1) : 0);
+    }
+    nRecord = 1;
+    for (nHole = 1; nHole <= m_nBoreholeNumber; nHole++)
+    {
+        nEnd = nRecord + (U_INT32)rand() % (((m_nRecordCount - nRecord) / (m_nBoreholeNumber - nHole + 1)) + 1);
+        if ((nEnd >= m_nRecordCount) || ((nHole == m_nBoreholeNumber) && (rand() % 4 == 0)))
+        {
+            nEnd = m_nRecordCount - 1;
+        }
+        if (rand() % 8)
+        {
+            snprintf(m_Holes[nHole].BoreholeName, sizeof(m_Holes[nHole].BoreholeName), "WELL-%u", (unsigned)nHole);
+        }
+        m_Holes[nHole].BoreholeNumber = (U_INT16)nHole;
+        m_Holes[nHole].StartingRecordNumber = (U_INT16)nRecord;
+        m_Holes[nHole].EndingRecordNumber = (U_INT16)nEnd;
+        m_Holes[nHole].DefaultPipeLength = (INT16)rand();
+        m_Holes[nHole].Declination = (INT16)rand();
+        m_Holes[nHole].Toolface = (INT16)rand();
+        m_Holes[nHole].DesiredAzimuth = (INT16)rand();
+        for (; nRecord <= nEnd; nRecord++)
+        {
+            m_Records[nRecord].nRecordNumber = (U_INT16)(nRecord - m_Holes[nHole].StartingRecordNumber + 1);
+        }
+    }
+    for (; nRecord < m_nRecordCount; nRecord++)
+    {
+        m_Records[nRecord].nRecordNumber = (U_INT16)(nRecord - (m_nBoreholeNumber ? m_Holes[m_nBoreholeNumber].EndingRecordNumber : 0));
+    }
+
+    m_Stats.TotalLength = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    m_Stats.TotalDepth = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+    m_Stats.TotalNorthings = (REAL32)(rand() - (RAND_MAX / 2)) / 7.0f;
+    m_Stats.TotalEastings = (REAL32)(rand() - (RAND_MAX / 2)) / 3.0f;
+}
+
+/*******************************************************************************
+*       @details
+*       The PC port as PCBulkTransfer.c sees it.  A frame the UART takes goes
+*       on the wire whole, or not at all, with bytes changed or lost as the
+*       link profile says.
+*******************************************************************************/
+BOOL UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen)
+{
+    int nIndex;
+
+    (void)eClient;
+    if (((rand() % 10000) < m_pLink->nUartBusy) || ((m_nLinkLength + nDataLen) > LINK_SIZE))
+    {
+        return false;
+    }
+    m_nFramesSent++;
+    if ((rand() % 10000) < m_pLink->nFrameLoss)
+    {
+        return true;
+    }
+    for (nIndex = 0; nIndex < nDataLen; nIndex++)
+    {
+        if ((rand() % 10000) < m_pLink->nByteLoss)
+        {
+            continue;
+        }
+        m_nLink[m_nLinkLength++] = pData[nIndex];
+        if ((rand() % 10000) < m_pLink->nByteError)
+        {
+            m_nLink[m_nLinkLength - 1] ^= (U_BYTE)(1 + rand() % 255);
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       ACK and NAK lines on their way back to PCBULK_ProcessLine().
+*******************************************************************************/
+static void QueueReply(const char *pLine)
+{
+    int nSlot;
+
+    if (((rand() % 10000) < m_pLink->nReplyLoss) || (m_nReplyCount == REPLY_QUEUE_SIZE))
+    {
+        return;
+    }
+    nSlot = (m_nReplyHead + m_nReplyCount++) % REPLY_QUEUE_SIZE;
+    strcpy(m_sReplies[nSlot], pLine);
+    m_nReplyDue[nSlot] = m_nNow + (m_pLink->nReplyDelay ? rand() % m_pLink->nReplyDelay : 0);
+}
+
+static void DeliverReplies(void)
+{
+    while ((m_nReplyCount > 0) && (m_nReplyDue[m_nReplyHead] <= m_nNow))
+    {
+        (void)PCBULK_ProcessLine(m_sReplies[m_nReplyHead]);
+        m_nReplyHead = (m_nReplyHead + 1) % REPLY_QUEUE_SIZE;
+        m_nReplyCount--;
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       One download of the hole from "BEGIN_BIN" to the status message, a
+*       pass of the main loop a millisecond.  Returns 1 if the decoder's CSV
+*       is the one the records give.
+*******************************************************************************/
+static int Transfer(const LINK_PROFILE *pLink, CSV_TEXT *pExpected, CSV_TEXT *pDecoded, long *pnPasses)
+{
+    static DECODER decoder;
+    int nRead, nResult = 1;
+
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.nNakFor = -1;
+    decoder.pfReply = QueueReply;
+    m_pLink = pLink;
+    m_nLinkLength = 0;
+    m_nReplyCount = 0;
+    m_nFramesSent = 0;
+    m_nWireBytes = 0;
+    m_nNow = 1;
+    m_pStatus = NULL;
+
+    PCBULK_Start();
+    for (*pnPasses = 0; PCBULK_IsActive() && (*pnPasses < PASS_LIMIT); (*pnPasses)++)
+    {
+        PCBULK_Service();
+        nRead = (pLink->nReadMax > 0) ? (rand() % pLink->nReadMax) + 1 : m_nLinkLength;
+        if (nRead > m_nLinkLength)
+        {
+            nRead = m_nLinkLength;
+        }
+        Decoder_Feed(&decoder, m_nLink, nRead);
+        m_nWireBytes += nRead;
+        m_nLinkLength -= nRead;
+        memmove(m_nLink, &m_nLink[nRead], m_nLinkLength);
+        DeliverReplies();
+        m_nNow++;
+    }
+
+    if (PCBULK_IsActive() || (m_pStatus == NULL) || (strcmp(m_pStatus, "Xfer done - Please Remove USB Cable") != 0) ||
+        !decoder.bDone || decoder.bFailed)
+    {
+        printf("MISMATCH %s link, %lu records %u holes: %s after %ld passes, decoder %s\n", pLink->pName,
+               (unsigned long)m_nRecordCount, (unsigned)m_nBoreholeNumber,
+               (m_pStatus != NULL) ? m_pStatus : "still running", *pnPasses,
+               decoder.bFailed ? "failed" : (decoder.bDone ? "done" : "waiting"));
+        nResult = 0;
+    }
+    else
+    {
+        Csv_FromHole(pExpected);
+        Csv_FromDecoder(pDecoded, &decoder);
+        if ((pExpected->nLength != pDecoded->nLength) || (memcmp(pExpected->pText, pDecoded->pText, pExpected->nLength) != 0))
+        {
+            printf("MISMATCH %s link, %lu records %u holes: CSV of %lu bytes decoded as %lu\n", pLink->pName,
+                   (unsigned long)m_nRecordCount, (unsigned)m_nBoreholeNumber,
+                   (unsigned long)pExpected->nLength, (unsigned long)pDecoded->nLength);
+            nResult = 0;
+        }
+    }
+    if (nResult && (pLink == &m_Links[0]) && ((decoder.nCrcErrors != 0) || (decoder.nNaks != 0)))
+    {
+        printf("MISMATCH clean link: %lu CRC errors, %lu NAKs\n", (unsigned long)decoder.nCrcErrors, (unsigned long)decoder.nNaks);
+        nResult = 0;
+    }
+    Decoder_Free(&decoder);
+    return nResult;
+}
+
+/*******************************************************************************
+*       @details
+*       Every link profile over many made up holes, including the empty log.
+*******************************************************************************/
+static int CheckTransfers(unsigned nSeed)
+{
+    CSV_TEXT expected = { malloc(4096), 0, 4096 };
+    CSV_TEXT decoded = { malloc(4096), 0, 4096 };
+    U_INT32 nLink, nRun, nRecords, nBlocks, nFrames;
+    unsigned long nCsvBytes, nWireBytes;
+    long nPasses, nTotalPasses;
+    int nResult = 1;
+
+    for (nLink = 0; (nLink < sizeof(m_Links) / sizeof(m_Links[0])) && nResult; nLink++)
+    {
+        srand(nSeed + nLink);
+        nRecords = nBlocks = nFrames = 0;
+        nCsvBytes = nWireBytes = 0;
+        nTotalPasses = 0;
+        for (nRun = 0; (nRun < CHECK_RUNS) && nResult; nRun++)
+        {
+            MakeHole();
+            nResult = Transfer(&m_Links[nLink], &expected, &decoded, &nPasses);
+            nRecords += m_nRecordCount;
+            nBlocks += m_nBlockCount;
+            nFrames += m_nFramesSent;
+            nCsvBytes += expected.nLength;
+            nWireBytes += m_nWireBytes;
+            nTotalPasses += nPasses;
+        }
+        if (nResult)
+        {
+            printf("%-5s link: %2u downloads, %6lu records, %5lu blocks sent %5lu times, "
+                   "%7lu wire bytes for %8lu CSV bytes, %6.1f s\n",
+                   m_Links[nLink].pName, (unsigned)nRun, (unsigned long)nRecords, (unsigned long)nBlocks,
+                   (unsigned long)nFrames, nWireBytes, nCsvBytes, nTotalPasses / 1000.0);
+        }
+    }
+    free(expected.pText);
+    free(decoded.pText);
+    return nResult;
+}
+
+/*******************************************************************************
+*       @details
+*       Decodes a captured download with no one to answer, so repeated blocks
+*       are taken once and a missing one ends the decode.
+*******************************************************************************/
+static int DecodeCapture(const char *pFileName)
+{
+    static DECODER decoder;
+    CSV_TEXT csv = { malloc(4096), 0, 4096 };
+    U_BYTE nBuffer[4096];
+    size_t nRead;
+    FILE *pFile = fopen(pFileName, "rb");
+    int nResult = 0;
+
+    if (pFile == NULL)
+    {
+        perror(pFileName);
+        return 1;
+    }
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.nNakFor = -1;
+    while ((nRead = fread(nBuffer, 1, sizeof(nBuffer), pFile)) > 0)
+    {
+        Decoder_Feed(&decoder, nBuffer, (int)nRead);
+    }
+    fclose(pFile);
+
+    if (decoder.bDone && !decoder.bFailed)
+    {
+        Csv_FromDecoder(&csv, &decoder);
+        fwrite(csv.pText, 1, csv.nLength, stdout);
+    }
+    else
+    {
+        fprintf(stderr, "%s: block %u missing, %lu CRC errors\n", pFileName, (unsigned)decoder.nExpected,
+                (unsigned long)decoder.nCrcErrors);
+        nResult = 1;
+    }
+    free(csv.pText);
+    Decoder_Free(&decoder);
+    return nResult;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        return DecodeCapture(argv[1]);
+    }
+    return CheckTransfers(1) ? 0 : 1;
+}
@@ -0,0 +1,770 @@
+/*******************************************************************************
+*       @brief      Host check of the RASP receiver, dispatch and reply queue.
+*                   Requests are framed here, fed to RASP.c in random pieces
+*                   and every reply the UART is handed is decoded and matched
+*                   to its request.  Not part of the firmware build.
+*       @file       Uphole/tools/rasp_check/rasp_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/RASP -I../../inc/CommDrivers
+*           -I../../inc/YitranModem -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           rasp_check.c ../../src/crc.c -o rasp_check && ./rasp_check
+*
+*       Add -g -fsanitize=address,undefined to run it under the sanitizers.
+*       It exits non zero if a request reaches the wrong handler, a rejected
+*       one reaches any, or a reply is lost, reordered or carries the wrong
+*       sequence tag.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stm32f4xx.h>
+#include "portable.h"
+
+// RASP.c spells its booleans TRUE and FALSE, which nothing in this tree
+// defines
+#define TRUE    1
+#define FALSE   0
+
+// RASP.c is built in here so its statics can be checked.  The interface
+// handlers are replaced below, so their headers, which pull in the record
+// manager and the IAR intrinsics, are marked as read and their names
+// declared here instead.
+#define INTF0001_H
+#define INTF0002_H
+#define INTF0003_H
+#define INTF0004_H
+#define INTF0007_H
+#define INTF0008_H
+#define PCHOLEINTERFACE_H
+#include "RASP.h"
+
+extern const CMD_VALIDATION g_aCmdVal0001[];
+extern const CMD_VALIDATION g_aCmdVal0002[];
+extern const CMD_VALIDATION g_aCmdVal0003[];
+extern const CMD_VALIDATION g_aCmdVal0004[];
+extern const CMD_VALIDATION g_pcCmdValidation[];
+extern const CMD_VALIDATION g_diagCmdVal0007[];
+extern const CMD_VALIDATION g_statusCmdVal0008[];
+void Interface0001Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void Interface0002Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void Interface0003Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void Interface0004Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void PCHoleInterface(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void DiagnosticHandler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+void DownholeStatusHandler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen);
+
+// The handler timing reads the DWT cycle counter; point it at a copy the
+// fake handlers can advance.
+static DWT_Type m_HostDWT;
+#undef DWT
+#define DWT (&m_HostDWT)
+
+#include "../../src/RASP/RASP.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define HANDLER_CYCLES      1000    // each fake handler call takes this long
+#define MAX_INTERFACE_ID    0x08
+#define STREAM_REQUESTS     20000
+#define STREAM_SIZE         (STREAM_REQUESTS * RASP_TX_FRAME_SIZE)
+#define FUZZ_BYTES          2000000
+#define CAPTURE_SIZE        (64 * RASP_TX_FRAME_SIZE)
+#define SPIN_LIMIT          100000  // RASPManager() calls without progress
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// A request as the PC would send it, and what should come of it
+typedef struct
+{
+    U_BYTE nHeader[RASP_TAGGED_HEADER_LEN + 2];
+    U_BYTE nHeaderLen;
+    U_BYTE nData[MSG_BUF_LEN];
+    U_BYTE nDataLen;
+    BOOL bHandled;          // should reach its handler
+    BOOL bReply;            // and be answered
+    BOOL bUnknown;          // no such interface or command
+} REQUEST;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+// Same command metadata as the interface sources, so the length checks act
+// as they do in the firmware
+const CMD_VALIDATION g_aCmdVal0001[] =
+{
+    {0xFF, NULL, 0xFF}, {0xFF, NULL, 1}, {1, NULL, 0}, {0, NULL, 0}
+};
+const CMD_VALIDATION g_aCmdVal0002[] =
+{
+    {0, NULL, 0}, {0, NULL, 0}
+};
+const CMD_VALIDATION g_aCmdVal0003[] =
+{
+    {0xFF, NULL, 0}, {2, NULL, 0}, {2, NULL, 0}, {2, NULL, 0}, {2, NULL, 0}, {2, NULL, 0}, {0xFF, NULL, 0}
+};
+const CMD_VALIDATION g_aCmdVal0004[] =
+{
+    {0xFF, NULL, 0}, {0xFF, NULL, 0}, {0xFF, NULL, 0}, {10, NULL, 0}, {0xFF, NULL, 0}
+};
+const CMD_VALIDATION g_pcCmdValidation[] =
+{
+    {0xFF, NULL, 0}, {0xFF, NULL, 8}, {0xFF, NULL, 10}, {0xFF, NULL, 56}
+};
+const CMD_VALIDATION g_diagCmdVal0007[] =
+{
+    {0xFF, NULL, 0}
+};
+const CMD_VALIDATION g_statusCmdVal0008[] =
+{
+    {0xFF, NULL, 0}, {0xFF, NULL, 0}
+};
+
+static BOOL m_bUartReady = TRUE;
+static U_BYTE m_nCapture[CAPTURE_SIZE];
+static U_INT32 m_nCaptureLength;
+static U_INT32 m_nHandlerCalls;
+static U_INT16 m_nLastInterface;
+static U_BYTE m_nLastCommand;
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       The firmware never calls these here, CalculateCRC() needs them to link.
+*******************************************************************************/
+void CRC_ResetDR(void)
+{
+}
+
+uint32_t CRC_CalcBlockCRC(uint32_t pBuffer[], uint32_t BufferLength)
+{
+    (void)pBuffer;
+    (void)BufferLength;
+    return 0;
+}
+
+/*******************************************************************************
+*       @details
+*       The UART takes whole frames or nothing, like the firmware's copy ring.
+*******************************************************************************/
+BOOL UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen)
+{
+    (void)eClient;
+    if (!m_bUartReady || ((m_nCaptureLength + nDataLen) > CAPTURE_SIZE))
+    {
+        return FALSE;
+    }
+    memcpy(&m_nCapture[m_nCaptureLength], pData, nDataLen);
+    m_nCaptureLength += nDataLen;
+    return TRUE;
+}
+
+BOOL Modem_MessageToSend(U_BYTE *pData, U_INT32 nLength)
+{
+    (void)pData;
+    (void)nLength;
+    return FALSE;
+}
+
+BOOL GetModemIsPresent(void)
+{
+    return FALSE;
+}
+
+TIME_LR ElapsedTimeLowRes(TIME_LR nOldTime)
+{
+    (void)nOldTime;
+    return 0;
+}
+
+/*******************************************************************************
+*       @details
+*       Every handler notes the call, takes HANDLER_CYCLES and echoes the
+*       request data back, which is longer than some commands' nMaxReplySize
+*       on purpose.
+*******************************************************************************/
+static void EchoHandler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    m_nHandlerCalls++;
+    m_nLastInterface = (U_INT16)((pHeader[IID_HIGH_BYTE_POS] << 8) | pHeader[IID_LOW_BYTE_POS]);
+    m_nLastCommand = pHeader[CMD_ID_POS];
+    m_HostDWT.CYCCNT += HANDLER_CYCLES;
+    RASPReplyNoError(pHeader, pData, nDataLen);
+}
+
+void Interface0001Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void Interface0002Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void Interface0003Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void Interface0004Handler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void PCHoleInterface(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void DiagnosticHandler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+void DownholeStatusHandler(U_BYTE* pHeader, U_BYTE* pData, U_INT16 nDataLen)
+{
+    EchoHandler(pHeader, pData, nDataLen);
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void ResetAll(void)
+{
+    InitRASP();
+    memset(m_RaspCmdStats, 0, sizeof(m_RaspCmdStats));
+    memset(&m_RaspTxStats, 0, sizeof(m_RaspTxStats));
+    memset(&m_HostDWT, 0, sizeof(m_HostDWT));
+    m_nRaspUnknownCmds = 0;
+    m_nCaptureLength = 0;
+    m_nHandlerCalls = 0;
+    m_bUartReady = TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*       Frames a request the way the PC does: DLE SOH, header, DLE STX, data,
+*       DLE ETX with every DLE inside doubled, then the checksum of the
+*       unescaped header and data, low byte first and not escaped.
+*******************************************************************************/
+static U_INT32 Frame(U_BYTE *pOut, const U_BYTE *pHeader, int nHeaderLen, const U_BYTE *pData, int nDataLen)
+{
+    U_INT32 nLength = 0;
+    U_INT32 nCRC;
+    int nIndex;
+
+    ResetCRC(&nCRC);
+    CRC_CalculateOnSpan(&nCRC, pHeader, (U_INT16)nHeaderLen);
+    CRC_CalculateOnSpan(&nCRC, pData, (U_INT16)nDataLen);
+
+    pOut[nLength++] = DLE;
+    pOut[nLength++] = SOH;
+    for (nIndex = 0; nIndex < nHeaderLen; nIndex++)
+    {
+        if (pHeader[nIndex] == DLE)
+        {
+            pOut[nLength++] = DLE;
+        }
+        pOut[nLength++] = pHeader[nIndex];
+    }
+    pOut[nLength++] = DLE;
+    pOut[nLength++] = STX;
+    for (nIndex = 0; nIndex < nDataLen; nIndex++)
+    {
+        if (pData[nIndex] == DLE)
+        {
+            pOut[nLength++] = DLE;
+        }
+        pOut[nLength++] = pData[nIndex];
+    }
+    pOut[nLength++] = DLE;
+    pOut[nLength++] = ETX;
+    for (nIndex = 0; nIndex < 4; nIndex++)
+    {
+        pOut[nLength++] = (U_BYTE)(nCRC >> (8 * nIndex));
+    }
+    return nLength;
+}
+
+/*******************************************************************************
+*       @details
+*       Takes one reply off the front of the captured UART output and checks
+*       its framing and checksum.  The firmware sends sizeof(U_INT32) bytes of
+*       checksum, which is 8 on a 64-bit host where only the low 4 are the
+*       CRC.  Returns FALSE if there is no whole, valid reply.
+*******************************************************************************/
+static BOOL TakeReply(U_INT32 *pPosition, U_BYTE *pHeader, int *pHeaderLen, U_BYTE *pData, int *pDataLen)
+{
+    U_INT32 nPosition = *pPosition;
+    U_INT32 nCRC, nSent = 0;
+    int nPart, nIndex;
+    U_BYTE nChar;
+
+    if (((nPosition + 2) > m_nCaptureLength) || (m_nCapture[nPosition] != DLE) ||
+        (m_nCapture[nPosition + 1] != SOH))
+    {
+        return FALSE;
+    }
+    nPosition += 2;
+    *pHeaderLen = 0;
+    *pDataLen = 0;
+    for (nPart = 0; nPart < 2; nPart++)
+    {
+        for (;;)
+        {
+            if ((nPosition + 1) >= m_nCaptureLength)
+            {
+                return FALSE;
+            }
+            nChar = m_nCapture[nPosition++];
+            if (nChar == DLE)
+            {
+                nChar = m_nCapture[nPosition++];
+                if (nChar != DLE)
+                {
+                    if (nChar != ((nPart == 0) ? STX : ETX))
+                    {
+                        return FALSE;
+                    }
+                    break;
+                }
+            }
+            if (nPart == 0)
+            {
+                if (*pHeaderLen >= RASP_TAGGED_HEADER_LEN)
+                {
+                    return FALSE;
+                }
+                pHeader[(*pHeaderLen)++] = nChar;
+            }
+            else
+            {
+                if (*pDataLen >= MSG_BUF_LEN)
+                {
+                    return FALSE;
+                }
+                pData[(*pDataLen)++] = nChar;
+            }
+        }
+    }
+
+    if ((nPosition + sizeof(U_INT32)) > m_nCaptureLength)
+    {
+        return FALSE;
+    }
+    for (nIndex = 0; nIndex < 4; nIndex++)
+    {
+        nSent |= (U_INT32)m_nCapture[nPosition + nIndex] << (8 * nIndex);
+    }
+    ResetCRC(&nCRC);
+    CRC_CalculateOnSpan(&nCRC, pHeader, (U_INT16)*pHeaderLen);
+    CRC_CalculateOnSpan(&nCRC, pData, (U_INT16)*pDataLen);
+    if ((nCRC & 0xFFFFFFFFu) != nSent)
+    {
+        return FALSE;
+    }
+    *pPosition = nPosition + sizeof(U_INT32);
+    return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*       The interface table as RASP.c has it: which IDs have a handler and
+*       the last command of each.
+*******************************************************************************/
+static const CMD_VALIDATION* LookUp(U_INT16 nInterface, U_BYTE nCommand, BOOL *pbExists)
+{
+    *pbExists = (nInterface < MAX_NUM_INTERFACES) && (Interfaces[nInterface].pfInterfaceHandler != NULL) &&
+                (nCommand <= Interfaces[nInterface].nMaxCmdID);
+    if (!*pbExists || (Interfaces[nInterface].pCmdValidation == NULL))
+    {
+        return NULL;
+    }
+    return &Interfaces[nInterface].pCmdValidation[nCommand];
+}
+
+/*******************************************************************************
+*       @details
+*       A random request: mostly real interfaces and commands with the data
+*       length they expect, some of each kind of bad one, about half tagged.
+*       Sequence tags count up so replies can be matched in order, and the
+*       tag and IDs land on DLE often enough to test the escaping.
+*******************************************************************************/
+static void RandomRequest(REQUEST *pRequest, U_BYTE nTag)
+{
+    const CMD_VALIDATION *pCmd;
+    U_INT16 nInterface;
+    U_BYTE nCommand;
+    BOOL bExists;
+    int nIndex;
+
+    switch (rand() % 20)
+    {
+        case 0:
+            nInterface = (U_INT16)rand();                      // anything at all
+            break;
+        case 1:
+            nInterface = (U_INT16)(MAX_INTERFACE_ID + 1 + (rand() % 8));   // just past the table
+            break;
+        default:
+            nInterface = (U_INT16)(rand() % (MAX_INTERFACE_ID + 1));
+            break;
+    }
+    if ((rand() % 12) == 0)
+    {
+        nCommand = (U_BYTE)rand();
+    }
+    else if (nInterface < MAX_NUM_INTERFACES)
+    {
+        nCommand = (U_BYTE)(rand() % (Interfaces[nInterface].nMaxCmdID + 2));   // up to one past the last
+    }
+    else
+    {
+        nCommand = (U_BYTE)(rand() % 8);
+    }
+    if ((rand() % 20) == 0)
+    {
+        nCommand = DLE;
+    }
+
+    pRequest->nHeader[IID_HIGH_BYTE_POS] = (U_BYTE)(nInterface >> 8);
+    pRequest->nHeader[IID_LOW_BYTE_POS] = (U_BYTE)nInterface;
+    pRequest->nHeader[CMD_ID_POS] = nCommand;
+    pRequest->nHeaderLen = RASP_HEADER_LEN;
+    if ((rand() % 2) == 0)
+    {
+        pRequest->nHeader[SEQUENCE_POS] = nTag;
+        pRequest->nHeaderLen = RASP_TAGGED_HEADER_LEN;
+    }
+
+    pCmd = LookUp(nInterface, nCommand, &bExists);
+    if ((pCmd != NULL) && (pCmd->nExpectedDataSize != 0xFF) && ((rand() % 8) != 0))
+    {
+        pRequest->nDataLen = pCmd->nExpectedDataSize;
+    }
+    else
+    {
+        pRequest->nDataLen = (U_BYTE)(rand() % 24);
+    }
+    for (nIndex = 0; nIndex < pRequest->nDataLen; nIndex++)
+    {
+        pRequest->nData[nIndex] = ((rand() % 8) == 0) ? DLE : (U_BYTE)rand();
+    }
+
+    pRequest->bUnknown = !bExists;
+    pRequest->bHandled = bExists && ((pCmd == NULL) || (pCmd->nExpectedDataSize == 0xFF) ||
+                                     (pCmd->nExpectedDataSize == pRequest->nDataLen));
+    // interface 0 is handled inside RASP.c and does not answer
+    pRequest->bReply = pRequest->bHandled && (nInterface != 0);
+}
+
+/*******************************************************************************
+*       @details
+*       Feeds a stream to RASP the way the UART does: a random amount is
+*       offered, only what RASP uses is released, and RASPManager() runs in
+*       between.  The UART is sometimes full so replies back up in the queue
+*       and requests back up behind them.
+*******************************************************************************/
+static BOOL Pump(const U_BYTE *pStream, U_INT32 nLength, int nBusyOneIn)
+{
+    U_INT32 nPosition = 0;
+    U_INT16 nOffer, nUsed;
+    int nSpins = 0;
+
+    while ((nPosition < nLength) || (m_CommSessionTx.nCount > 0) || m_CommSessionRx.bMsgComplete)
+    {
+        m_bUartReady = (nBusyOneIn == 0) || ((rand() % nBusyOneIn) != 0);
+        nOffer = (U_INT16)(1 + (rand() % 64));
+        if (nOffer > (nLength - nPosition))
+        {
+            nOffer = (U_INT16)(nLength - nPosition);
+        }
+        nUsed = ServiceRxRASPSpan(&pStream[nPosition], nOffer);
+        nPosition += nUsed;
+        RASPManager();
+        nSpins = (nUsed == 0) ? (nSpins + 1) : 0;
+        if (nSpins > SPIN_LIMIT)
+        {
+            printf("MISMATCH stalled at byte %lu of %lu\n", (unsigned long)nPosition, (unsigned long)nLength);
+            return FALSE;
+        }
+    }
+    m_bUartReady = TRUE;
+    RASPManager();
+    return TRUE;
+}
+
+/*******************************************************************************
+*       @details
+*       One request at a time through every interface ID up to past the
+*       table, every command up to past the last, tagged and untagged, with
+*       the right data length and a wrong one.  Checks which handler ran,
+*       the reply header and data, and the counters RASP.c keeps.
+*******************************************************************************/
+static int CheckDispatch(void)
+{
+    static U_BYTE nStream[RASP_TX_FRAME_SIZE];
+    U_BYTE nReplyHeader[RASP_TAGGED_HEADER_LEN], nReplyData[MSG_BUF_LEN];
+    REQUEST request;
+    const CMD_VALIDATION *pCmd;
+    U_INT32 nPosition, nExpectUnknown = 0, nExpectRejected, nExpectOversize;
+    int nInterface, nCommand, nTagged, nWrong, nHeaderLen, nDataLen, nChecked = 0;
+    BOOL bExists;
+
+    for (nInterface = 0; nInterface <= (MAX_INTERFACE_ID + 2); nInterface++)
+    {
+        for (nCommand = 0; nCommand < RASP_CMDS_PER_INTERFACE; nCommand++)
+        {
+            for (nTagged = 0; nTagged < 2; nTagged++)
+            {
+                for (nWrong = 0; nWrong < 2; nWrong++)
+                {
+                    ResetAll();
+                    pCmd = LookUp((U_INT16)nInterface, (U_BYTE)nCommand, &bExists);
+                    request.nHeader[IID_HIGH_BYTE_POS] = 0;
+                    request.nHeader[IID_LOW_BYTE_POS] = (U_BYTE)nInterface;
+                    request.nHeader[CMD_ID_POS] = (U_BYTE)nCommand;
+                    request.nHeader[SEQUENCE_POS] = (U_BYTE)(0x40 + nCommand);
+                    request.nHeaderLen = nTagged ? RASP_TAGGED_HEADER_LEN : RASP_HEADER_LEN;
+                    request.nDataLen = ((pCmd != NULL) && (pCmd->nExpectedDataSize != 0xFF)) ?
+                                       pCmd->nExpectedDataSize : 12;
+                    if (nWrong)
+                    {
+                        request.nDataLen++;
+                    }
+                    memset(request.nData, 0xA0 + nCommand, request.nDataLen);
+                    request.bHandled = bExists && (!nWrong || (pCmd == NULL) || (pCmd->nExpectedDataSize == 0xFF));
+                    request.bReply = request.bHandled && (nInterface != 0);
+                    nExpectUnknown = bExists ? 0 : 1;
+                    nExpectRejected = (bExists && !request.bHandled) ? 1 : 0;
+                    nExpectOversize = (request.bReply && (pCmd != NULL) && (pCmd->nMaxReplySize != 0xFF) &&
+                                       (request.nDataLen > pCmd->nMaxReplySize)) ? 1 : 0;
+
+                    if (!Pump(nStream, Frame(nStream, request.nHeader, request.nHeaderLen, request.nData,
+                                             request.nDataLen), 0))
+                    {
+                        return 0;
+                    }
+
+                    if ((m_nHandlerCalls != (request.bReply ? 1u : 0u)) ||
+                        (request.bReply && ((m_nLastInterface != nInterface) || (m_nLastCommand != nCommand))) ||
+                        (m_nRaspUnknownCmds != nExpectUnknown) ||
+                        (bExists && ((m_RaspCmdStats[nInterface][nCommand].nCalls != (request.bHandled ? 1u : 0u)) ||
+                                     (m_RaspCmdStats[nInterface][nCommand].nRejected != nExpectRejected) ||
+                                     (m_RaspCmdStats[nInterface][nCommand].nOversizeReplies != nExpectOversize) ||
+                                     (m_RaspCmdStats[nInterface][nCommand].nTotalCycles !=
+                                      (request.bReply ? HANDLER_CYCLES : 0)))))
+                    {
+                        printf("MISMATCH interface %d command %d tagged %d wrong length %d: %lu calls, "
+                               "%lu unknown\n", nInterface, nCommand, nTagged, nWrong,
+                               (unsigned long)m_nHandlerCalls, (unsigned long)m_nRaspUnknownCmds);
+                        return 0;
+                    }
+
+                    nPosition = 0;
+                    if (request.bReply)
+                    {
+                        if (!TakeReply(&nPosition, nReplyHeader, &nHeaderLen, nReplyData, &nDataLen) ||
+                            (nHeaderLen != request.nHeaderLen) ||
+                            (memcmp(nReplyHeader, request.nHeader, nHeaderLen) != 0) ||
+                            (nDataLen != request.nDataLen) ||
+                            (memcmp(nReplyData, request.nData, nDataLen) != 0))
+                        {
+                            printf("MISMATCH interface %d command %d tagged %d: bad reply\n", nInterface,
+                                   nCommand, nTagged);
+                            return 0;
+                        }
+                    }
+                    if (nPosition != m_nCaptureLength)
+                    {
+                        printf("MISMATCH interface %d command %d tagged %d: %lu bytes sent, expected %lu\n",
+                               nInterface, nCommand, nTagged, (unsigned long)m_nCaptureLength,
+                               (unsigned long)nPosition);
+                        return 0;
+                    }
+                    nChecked++;
+                }
+            }
+        }
+    }
+    printf("dispatch: %d requests, handlers, rejects, tags and counters match\n", nChecked);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Long runs of back to back random requests, some with a broken
+*       checksum, offered in random pieces while the UART is busy one call
+*       in three.  Every request that should be answered must be, once and
+*       in order, with its own tag, and nothing may be dropped.
+*******************************************************************************/
+static int CheckPipelined(void)
+{
+    static REQUEST requests[STREAM_REQUESTS];
+    static U_BYTE nStream[STREAM_SIZE];
+    U_BYTE nReplyHeader[RASP_TAGGED_HEADER_LEN], nReplyData[MSG_BUF_LEN];
+    U_INT32 nLength = 0, nFrameLength, nPosition = 0, nReplies = 0, nUnknown = 0, nCorrupt = 0;
+    U_BYTE nMaxDepth = 0;
+    int nRequest, nHeaderLen, nDataLen, nNext = 0, nBatch, nStart;
+
+    for (nStart = 0; nStart < STREAM_REQUESTS; nStart += nBatch)
+    {
+        // the capture buffer holds a few dozen replies, so pump in batches
+        nBatch = 32;
+        if (nBatch > (STREAM_REQUESTS - nStart))
+        {
+            nBatch = STREAM_REQUESTS - nStart;
+        }
+        ResetAll();
+        nLength = 0;
+        for (nRequest = nStart; nRequest < (nStart + nBatch); nRequest++)
+        {
+            RandomRequest(&requests[nRequest], (U_BYTE)nRequest);
+            nFrameLength = Frame(&nStream[nLength], requests[nRequest].nHeader, requests[nRequest].nHeaderLen,
+                                 requests[nRequest].nData, requests[nRequest].nDataLen);
+            if ((rand() % 50) == 0)
+            {
+                // spoil the last checksum byte, but not into a DLE, which
+                // the receiver would pair with the next frame's DLE SOH
+                nStream[nLength + nFrameLength - 1] ^= (nStream[nLength + nFrameLength - 1] == (DLE ^ 0x5A)) ? 0x5B : 0x5A;
+                requests[nRequest].bHandled = FALSE;
+                requests[nRequest].bReply = FALSE;
+                requests[nRequest].bUnknown = FALSE;
+                nCorrupt++;
+            }
+            nUnknown += requests[nRequest].bUnknown ? 1 : 0;
+            nLength += nFrameLength;
+        }
+        if (!Pump(nStream, nLength, 3))
+        {
+            return 0;
+        }
+
+        if (m_RaspTxStats.nMaxDepth > nMaxDepth)
+        {
+            nMaxDepth = m_RaspTxStats.nMaxDepth;
+        }
+
+        nPosition = 0;
+        for (nNext = nStart; nNext < (nStart + nBatch); nNext++)
+        {
+            if (!requests[nNext].bReply)
+            {
+                continue;
+            }
+            if (!TakeReply(&nPosition, nReplyHeader, &nHeaderLen, nReplyData, &nDataLen) ||
+                (nHeaderLen != requests[nNext].nHeaderLen) ||
+                (memcmp(nReplyHeader, requests[nNext].nHeader, nHeaderLen) != 0) ||
+                (nDataLen != requests[nNext].nDataLen) ||
+                (memcmp(nReplyData, requests[nNext].nData, nDataLen) != 0))
+            {
+                printf("MISMATCH request %d: reply missing, out of order or wrong\n", nNext);
+                return 0;
+            }
+            nReplies++;
+        }
+        if ((nPosition != m_nCaptureLength) || (m_RaspTxStats.nDropped != 0))
+        {
+            printf("MISMATCH requests %d to %d: %lu extra bytes sent, %lu replies dropped\n", nStart,
+                   nStart + nBatch - 1, (unsigned long)(m_nCaptureLength - nPosition),
+                   (unsigned long)m_RaspTxStats.nDropped);
+            return 0;
+        }
+    }
+    printf("pipelined: %d requests, %lu replies in order, %lu unknown, %lu bad checksums ignored, "
+           "up to %d replies queued\n", STREAM_REQUESTS, (unsigned long)nReplies, (unsigned long)nUnknown,
+           (unsigned long)nCorrupt, nMaxDepth);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       Random bytes, heavy on the framing characters, then one good request.
+*       The receiver must never run off its buffers and must pick up the
+*       good request however the noise left it.
+*******************************************************************************/
+static int CheckNoise(void)
+{
+    static const U_BYTE nSpecial[] = { DLE, DLE, SOH, STX, ETX };
+    static U_BYTE nNoise[4096];
+    static U_BYTE nFrame[RASP_TX_FRAME_SIZE];
+    U_BYTE nHeader[RASP_TAGGED_HEADER_LEN] = { 0x00, 0x03, 0x01, 0x77 };
+    U_BYTE nData[2] = { 0x12, DLE };
+    U_INT32 nFed, nFrameLength, nCalls;
+    int nIndex, nLength;
+
+    ResetAll();
+    nFrameLength = Frame(nFrame, nHeader, RASP_TAGGED_HEADER_LEN, nData, sizeof(nData));
+    for (nFed = 0; nFed < FUZZ_BYTES; nFed += nLength)
+    {
+        nLength = rand() % (int)sizeof(nNoise);
+        for (nIndex = 0; nIndex < nLength; nIndex++)
+        {
+            nNoise[nIndex] = ((rand() % 4) == 0) ? nSpecial[rand() % sizeof(nSpecial)] : (U_BYTE)rand();
+        }
+        if (!Pump(nNoise, nLength, 0))
+        {
+            return 0;
+        }
+        m_nCaptureLength = 0;
+
+        // a DLE ETX in the noise can leave the receiver reading a checksum;
+        // the PC resends an unanswered request, so allow one retry
+        nCalls = m_RaspCmdStats[3][1].nCalls;
+        if (!Pump(nFrame, nFrameLength, 0))
+        {
+            return 0;
+        }
+        if (m_RaspCmdStats[3][1].nCalls == nCalls)
+        {
+            if (!Pump(nFrame, nFrameLength, 0))
+            {
+                return 0;
+            }
+        }
+        if (m_RaspCmdStats[3][1].nCalls != (nCalls + 1))
+        {
+            printf("MISMATCH good request after %lu bytes of noise was not handled once\n", (unsigned long)nFed);
+            return 0;
+        }
+        m_nCaptureLength = 0;
+    }
+    printf("noise: %d random bytes, receiver recovered every time\n", FUZZ_BYTES);
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    srand((argc > 1) ? (unsigned)strtoul(argv[1], NULL, 0) : 1);
+    if (!CheckDispatch() || !CheckPipelined() || !CheckNoise())
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,754 @@
+/*******************************************************************************
+*       @brief      Reference PC side sender of the windowed CSV upload, run
+*                   in a loopback against uploadWindow_Service() and
+*                   checked line for line against the records stored.  Not
+*                   part of the firmware build.
+*       @file       Uphole/tools/upload_check/upload_check.c
+*       @date       October 2026
+*       @copyright  COPYRIGHT (c) 2026 Target Drilling Inc. All rights are
+*                   reserved.  Reproduction in whole or in part is prohibited
+*                   without the prior written consent of the copyright holder.
+*
+*       Build and run from this directory with any host gcc:
+*
+*       gcc -O2 -std=gnu99 -DUSE_STDPERIPH_DRIVER -DSTM32F40_41xxx
+*           -I../../inc -I../../inc/SerialProtocol -I../../inc/CommDrivers
+*           -I../../inc/DataManagers -I../../inc/UI_Tabs -I../../inc/UI_Tools
+*           -I../../inc/UI_Frame -I../../inc/UI_DataFields -I../../inc/UI_Panels
+*           -I../../inc/HardwareInterfaces -I../../inc/SerialFlash
+*           -I../../inc/Logging -I../..
+*           -I../../../../Libraries/Libraries/CMSIS/Include
+*           -I../../../../Libraries/Libraries/CMSIS/Device/ST/STM32F4xx/Include
+*           -I../../../../Libraries/Libraries/STM32F4xx_StdPeriph_Driver/inc
+*           upload_check.c ../../src/SerialProtocol/CSVParser.c
+*           -o upload_check && ./upload_check
+*
+*       The sender sends "<seq>:<line>\r" as far ahead as the last
+*       "ACK n m" or "NAK e m" allows, sends line e again on a NAK, and goes
+*       back to the oldest unacknowledged line when the replies stop.  Lines
+*       and replies are lost, delayed and held up by a busy UART as the link
+*       profile says, but never changed, as there is no checksum on a line.
+*       The stop and wait upload ("BEGIN_CSV") is timed over the links that
+*       lose nothing for comparison.  It exits non zero if a record is missing, repeated,
+*       out of order or differs from its line.
+*******************************************************************************/
+
+//============================================================================//
+//      INCLUDES                                                              //
+//============================================================================//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32f4xx.h"
+#include "portable.h"
+#include "CommDriver_Flash.h"
+
+// RecordManager.h and the UI headers pull in the IAR intrinsics and the
+// graphics, so PCDataTransfer.c gets these instead.
+#define RECORD_MANAGER_H
+#define UI_MAIN_TAB_H
+#define UI_JOB_TAB_H
+#define LCD_H
+#define MANAGER_DATALINK_H
+#define TEXTSTRINGS_H
+#define UI_ALPHABET_H
+#define UI_SCREEN_UTILITIES_H
+#define UI_LCD_SCREEN_INVERSION_H
+#define UI_FRAME_H
+#define UI_API_H
+#define UI_BOOLEAN_FIELD_H
+#define UI_TOOL_FACE_PANELS_H
+#define UI_INITIATE_FIELD_H
+#define UI_FIXED_FIELD_H
+#define UI_STRING_FIELD_H
+#define FLASH_MEMORY_H
+
+typedef U_INT32 TIME_RT;
+
+typedef struct
+{
+    TIME_RT tSurveyTimeStamp;
+    INT16 nAzimuth;
+    INT16 nPitch;
+    INT16 nRoll;
+    INT16 nTemperature;
+    INT16 nGamma;
+    INT16 nGTF;
+    INT16 Y;
+    INT16 X;
+    INT32 Z;
+    U_INT16 nRecordNumber;
+    U_INT16 nTotalLength;
+    RTC_DateTypeDef date;
+    INT16 StatusCode;
+    INT16 NumOfBranch;
+    INT16 NextBranchRecordNum;
+    INT16 PreviousBranchRecordNum;
+    INT16 PreviousRecordIndex;
+    INT16 GammaShotLock;
+    INT16 GammaShotNumCorrected;
+    BOOL InvalidDataFlag;
+    BOOL branchWasSet;
+} STRUCT_RECORD_DATA;
+
+typedef struct
+{
+    char BoreholeName[16];
+    U_INT16 BoreholeNumber;
+    U_INT16 StartingRecordNumber;
+    U_INT16 EndingRecordNumber;
+    INT16 DefaultPipeLength;
+    INT16 Declination;
+    INT16 Toolface;
+    INT16 DesiredAzimuth;
+} NEWHOLE_INFO;
+
+typedef struct
+{
+    U_INT32 TotalLength;
+    INT32 TotalDepth;
+    REAL32 TotalNorthings;
+    REAL32 TotalEastings;
+} BOREHOLE_STATISTICS;
+
+typedef struct
+{
+    U_INT16 nFirstRecord;
+    U_INT16 nEndRecord;
+    U_INT16 nTieInRecord;
+    U_INT16 nParent;
+    U_INT16 nLevel;
+    U_INT16 nSurveys;
+    U_INT32 TotalLength;
+    INT32 TotalDepth;
+    REAL32 TotalNorthings;
+    REAL32 TotalEastings;
+} RECORD_BRANCH;
+
+typedef struct
+{
+    int nUnused;
+} MENU_ITEM;
+
+typedef struct
+{
+    int nUnused;
+} FRAME;
+
+#define RECORD_NO_BRANCH            0xFFFF
+#define RECORDS_PER_PAGE            (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(STRUCT_RECORD_DATA))
+#define NEW_HOLE_RECORDS_PER_PAGE   (U_INT32)((FLASH_PAGE_SIZE-4)/sizeof(NEWHOLE_INFO))
+#define CLEAR_ALL_HOLE              0
+
+FRAME WindowFrame;
+void ShowStatusMessage(char* message);
+void RepaintNow(const FRAME* frame);
+char* GetBoreholeName(void);
+U_INT32 GetRecordCount(void);
+BOOL RECORD_GetRecord(STRUCT_RECORD_DATA* record, U_INT32 recordNumber);
+BOOL RECORD_GetBranch(RECORD_BRANCH* pBranch, U_INT16 nBranch);
+BOOL NewHole_Info_Read(NEWHOLE_INFO* NewHoleInfo, U_INT32 HoleNumber);
+void GetBoreholeStats(BOREHOLE_STATISTICS* stats);
+void SetBoreholeStats(BOREHOLE_STATISTICS* stats);
+void StoreUploadedRecord(STRUCT_RECORD_DATA* record);
+void LoggingManager_StartLogging(void);
+void SetLoggingState(int newState);
+
+#include "../../src/SerialProtocol/PCDataTransfer.c"
+
+//============================================================================//
+//      CONSTANTS                                                             //
+//============================================================================//
+
+#define LINE_SIZE           300
+#define MAX_LINES           3000
+#define MAX_TABLE_LINES     4
+#define QUEUE_SIZE          256
+#define REPLY_TIMEOUT       200     // passes without a reply before going back
+#define PASS_LIMIT          10000000L
+#define CHECK_RUNS          10
+
+//============================================================================//
+//      DATA DECLARATIONS                                                     //
+//============================================================================//
+
+// How the link behaves.  Chances are in 10000.
+typedef struct
+{
+    const char *pName;
+    int nLatency;           // passes a line or a reply takes to arrive
+    int nUartBusy;          // UART_SendMessage() has no room this pass
+    int nLineLoss;          // line to the firmware lost
+    int nReplyLoss;         // reply to the PC lost
+    int nRunAhead;          // the PC sends one line past the window
+} LINK_PROFILE;
+
+// Lines on their way from one end to the other.
+typedef struct
+{
+    char sLine[QUEUE_SIZE][LINE_SIZE];
+    long nDue[QUEUE_SIZE];
+    int nHead;
+    int nCount;
+} LINE_QUEUE;
+
+// What the PC program keeps while it uploads.
+typedef struct
+{
+    int nLines;             // header, surveys and END_CSV
+    int nBase;              // oldest line not acknowledged
+    int nNext;              // next line to put on the wire
+    int nWindowEnd;         // last line the firmware will take
+    int nLastNak;
+    long tLastNak;
+    long tLastReply;
+    BOOL bStarted;
+    BOOL bDone;
+    // statistics
+    U_INT32 nSent;
+    U_INT32 nNaks;
+    U_INT32 nTimeouts;
+} SENDER;
+
+//============================================================================//
+//      DATA DEFINITIONS                                                      //
+//============================================================================//
+
+static char m_sLines[MAX_LINES + MAX_TABLE_LINES + 2][LINE_SIZE];
+static STRUCT_RECORD_DATA m_Sent[MAX_LINES];
+static STRUCT_RECORD_DATA m_Stored[MAX_LINES];
+static int m_nStored;
+static int m_nSurveys;
+
+static const LINK_PROFILE *m_pLink;
+static LINE_QUEUE m_ToFirmware;
+static LINE_QUEUE m_ToPC;
+static long m_nNow;
+
+static const LINK_PROFILE m_Links[] =
+{
+    { "local", 1,    0,   0,   0,   0 },
+    { "usb",   8,    0,   0,   0,   0 },
+    { "busy",  8, 3000,   0,   0,   0 },
+    { "lossy", 8, 3000, 200, 200, 100 },
+};
+
+//============================================================================//
+//      FUNCTION IMPLEMENTATIONS                                              //
+//============================================================================//
+
+/*******************************************************************************
+*       @details
+*       Stand ins for what PCDataTransfer.c calls.  Only the upload is run,
+*       so the download side has nothing to read.
+*******************************************************************************/
+void ShowStatusMessage(char* message)
+{
+    (void)message;
+}
+
+void RepaintNow(const FRAME* frame)
+{
+    (void)frame;
+}
+
+void DelayHalfSecond(void)
+{
+}
+
+char* GetBoreholeName(void)
+{
+    return "";
+}
+
+U_INT32 GetRecordCount(void)
+{
+    return 0;
+}
+
+BOOL RECORD_GetRecord(STRUCT_RECORD_DATA* record, U_INT32 recordNumber)
+{
+    (void)record;
+    (void)recordNumber;
+    return false;
+}
+
+BOOL RECORD_GetBranch(RECORD_BRANCH* pBranch, U_INT16 nBranch)
+{
+    (void)pBranch;
+    (void)nBranch;
+    return false;
+}
+
+BOOL NewHole_Info_Read(NEWHOLE_INFO* NewHoleInfo, U_INT32 HoleNumber)
+{
+    (void)NewHoleInfo;
+    (void)HoleNumber;
+    return false;
+}
+
+void GetBoreholeStats(BOREHOLE_STATISTICS* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void SetBoreholeStats(BOREHOLE_STATISTICS* stats)
+{
+    (void)stats;
+}
+
+void StoreUploadedRecord(STRUCT_RECORD_DATA* record)
+{
+    if (m_nStored < MAX_LINES)
+    {
+        memcpy(&m_Stored[m_nStored], record, sizeof(*record));
+    }
+    m_nStored++;
+}
+
+void LoggingManager_StartLogging(void)
+{
+}
+
+void SetLoggingState(int newState)
+{
+    (void)newState;
+}
+
+void PROFILE_Start(PROFILE_PROBE nProbe)
+{
+    (void)nProbe;
+}
+
+void PROFILE_Stop(PROFILE_PROBE nProbe)
+{
+    (void)nProbe;
+}
+
+TIME_LR ElapsedTimeLowRes(TIME_LR nOldTime)
+{
+    return (TIME_LR)(m_nNow - (long)nOldTime);
+}
+
+BOOL PCBULK_ProcessLine(const char *pLine)
+{
+    (void)pLine;
+    return false;
+}
+
+void PCBULK_Start(void)
+{
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Queue_Put(LINE_QUEUE *pQueue, const char *pLine, int nLoss)
+{
+    int nSlot;
+
+    if (((rand() % 10000) < nLoss) || (pQueue->nCount == QUEUE_SIZE))
+    {
+        return;
+    }
+    nSlot = (pQueue->nHead + pQueue->nCount++) % QUEUE_SIZE;
+    snprintf(pQueue->sLine[nSlot], LINE_SIZE, "%s", pLine);
+    // lines keep their order, as on a serial link
+    pQueue->nDue[nSlot] = m_nNow + m_pLink->nLatency;
+}
+
+static const char *Queue_Get(LINE_QUEUE *pQueue)
+{
+    const char *pLine;
+
+    if ((pQueue->nCount == 0) || (pQueue->nDue[pQueue->nHead] > m_nNow))
+    {
+        return NULL;
+    }
+    pLine = pQueue->sLine[pQueue->nHead];
+    pQueue->nHead = (pQueue->nHead + 1) % QUEUE_SIZE;
+    pQueue->nCount--;
+    return pLine;
+}
+
+/*******************************************************************************
+*       @details
+*       The PC port as PCDataTransfer.c sees it: whole lines in, without the
+*       '\r', cut to fit as UART_ReceiveMessage() does, and whole replies
+*       out.
+*******************************************************************************/
+BOOL UART_ReceiveMessage(UART_CLIENT eClient, U_BYTE *pData, U_INT16 nDataLen)
+{
+    const char *pLine = Queue_Get(&m_ToFirmware);
+
+    (void)eClient;
+    if (pLine == NULL)
+    {
+        return false;
+    }
+    snprintf((char *)pData, nDataLen, "%s", pLine);
+    return true;
+}
+
+BOOL UART_SendMessage(UART_CLIENT eClient, const U_BYTE *pData, U_INT16 nDataLen)
+{
+    char sReply[LINE_SIZE];
+
+    (void)eClient;
+    if ((rand() % 10000) < m_pLink->nUartBusy)
+    {
+        return false;
+    }
+    snprintf(sReply, sizeof(sReply), "%.*s", (int)nDataLen, (const char *)pData);
+    sReply[strcspn(sReply, "\r")] = 0;
+    Queue_Put(&m_ToPC, sReply, m_pLink->nReplyLoss);
+    return true;
+}
+
+/*******************************************************************************
+*       @details
+*       A hole as the CSV download writes it, every value one the upload
+*       stores exactly: Y in whole hundredths and Z in whole tenths, as the
+*       download rounds them.  Returns the number of lines, END_CSV last.
+*******************************************************************************/
+static int MakeLines(int nSurveys)
+{
+    STRUCT_RECORD_DATA *pRecord;
+    int nLine;
+    int nBranch;
+
+    m_nSurveys = nSurveys;
+    snprintf(m_sLines[0], LINE_SIZE, "BoreName, Rec#, SurveyDepth, Azimuth, Pitch, Roll, X, Y, "
+             "Z, Gamma, TimeStamp, WeekDay, Month, Day, Year, DefltPipeLen, "
+             "Declin, DesiredAz, ToolFace, Statcode, #Branch, #BoreHole ");
+    for (nLine = 1; nLine <= nSurveys; nLine++)
+    {
+        pRecord = &m_Sent[nLine - 1];
+        memset(pRecord, 0, sizeof(*pRecord));
+        pRecord->nRecordNumber = (U_INT16)nLine;
+        pRecord->nTotalLength = (U_INT16)rand();
+        pRecord->nAzimuth = (INT16)(rand() % 3600);
+        pRecord->nPitch = (INT16)((rand() % 1800) - 900);
+        pRecord->nRoll = (INT16)(rand() % 3600);
+        pRecord->X = (INT16)rand();
+        pRecord->Y = (INT16)(((rand() % 655) - 327) * 100);
+        pRecord->Z = ((rand() % 2000001) - 1000000) * 10;
+        pRecord->nGamma = (INT16)rand();
+        pRecord->tSurveyTimeStamp = (TIME_RT)rand();
+        pRecord->date.RTC_WeekDay = (uint8_t)(1 + rand() % 7);
+        pRecord->date.RTC_Month = (uint8_t)(1 + rand() % 12);
+        pRecord->date.RTC_Date = (uint8_t)(1 + rand() % 31);
+        pRecord->date.RTC_Year = (uint8_t)(rand() % 100);
+        pRecord->StatusCode = (INT16)rand();
+        pRecord->NumOfBranch = (INT16)(rand() % 4);
+        pRecord->nTemperature = (INT16)rand();
+        pRecord->nGTF = (INT16)rand();
+        pRecord->NextBranchRecordNum = (INT16)rand();
+        pRecord->PreviousBranchRecordNum = (INT16)rand();
+        pRecord->PreviousRecordIndex = (INT16)rand();
+        pRecord->GammaShotLock = (INT16)(rand() % 2);
+        pRecord->GammaShotNumCorrected = (INT16)rand();
+        pRecord->InvalidDataFlag = (BOOL)(rand() % 2);
+        pRecord->branchWasSet = (BOOL)(rand() % 2);
+
+        snprintf(m_sLines[nLine], LINE_SIZE,
+                 "HOLE 1, %d, %d, %.1f, %.1f, %.1f, "
+                 "%.1f, %.1f, %.1f, %d, %d, %d, %d, "
+                 "%d, %d, %d, %d, %d, %d, %d, %d, %d, "
+                 "%d, %d, %d, %d, %d, %d, %d, %d, %d, "
+                 "%d, %d, %f, %f",
+                 pRecord->nRecordNumber, pRecord->nTotalLength,
+                 (REAL32)pRecord->nAzimuth / 10.0, (REAL32)pRecord->nPitch / 10.0, (REAL32)pRecord->nRoll / 10.0,
+                 (REAL32)(pRecord->X) / 10.0, (REAL32)(pRecord->Y / 100), (REAL32)(pRecord->Z / 10),
+                 pRecord->nGamma, (int)pRecord->tSurveyTimeStamp, pRecord->date.RTC_WeekDay, pRecord->date.RTC_Month,
+                 pRecord->date.RTC_Date, pRecord->date.RTC_Year, 0, 0, 0, 0,
+                 pRecord->StatusCode, pRecord->NumOfBranch, 1,
+                 pRecord->nTemperature, pRecord->nGTF, pRecord->NextBranchRecordNum,
+                 pRecord->PreviousBranchRecordNum, pRecord->PreviousRecordIndex, pRecord->GammaShotLock,
+                 pRecord->GammaShotNumCorrected, pRecord->InvalidDataFlag, pRecord->branchWasSet,
+                 1000, 900, 12.5, -3.25);
+    }
+    // the branch table a dump ends with, which the upload must skip
+    snprintf(m_sLines[nLine++], LINE_SIZE, "%s ", BRANCH_LABELS);
+    for (nBranch = 0; nBranch < nSurveys % 4; nBranch++)
+    {
+        snprintf(m_sLines[nLine++], LINE_SIZE, "%d, %d, %d, %d, %d, %d, %d, %d, %f, %f",
+                 nBranch, nBranch - 1, nBranch * 10, nBranch * 10 + 10, nBranch * 10 - 1, nBranch * 10 + 10,
+                 1000, 900, 12.5, -3.25);
+    }
+    snprintf(m_sLines[nLine], LINE_SIZE, "END_CSV");
+    return nLine + 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static void Sender_SendLine(SENDER *pSender, int nLine)
+{
+    char sLine[LINE_SIZE + 8];
+
+    snprintf(sLine, sizeof(sLine), "%d:%s", nLine, m_sLines[nLine]);
+    Queue_Put(&m_ToFirmware, sLine, m_pLink->nLineLoss);
+    pSender->nSent++;
+}
+
+/*******************************************************************************
+*       @details
+*       One reply from the firmware.  "ACK n m" acknowledges everything up to
+*       n, "NAK e m" everything below e and asks for e alone, as the lines
+*       after it have arrived.  A NAK for the same line is only answered
+*       again once the resend has had time to get there.
+*******************************************************************************/
+static void Sender_Reply(SENDER *pSender, const char *pReply)
+{
+    int nFirst, nLast;
+
+    pSender->tLastReply = m_nNow;
+    if (sscanf(pReply, "BEGIN %d", &nLast) == 1)
+    {
+        pSender->bStarted = true;
+        pSender->nWindowEnd = nLast - 1;
+    }
+    else if (strcmp(pReply, "END") == 0)
+    {
+        pSender->bDone = true;
+    }
+    else if (sscanf(pReply, "ACK %d %d", &nFirst, &nLast) == 2)
+    {
+        if (nFirst + 1 > pSender->nBase)
+        {
+            pSender->nBase = nFirst + 1;
+        }
+        if (pSender->nNext < pSender->nBase)
+        {
+            pSender->nNext = pSender->nBase;
+        }
+        pSender->nWindowEnd = nLast;
+    }
+    else if (sscanf(pReply, "NAK %d %d", &nFirst, &nLast) == 2)
+    {
+        if (nFirst > pSender->nBase)
+        {
+            pSender->nBase = nFirst;
+        }
+        pSender->nWindowEnd = nLast;
+        if ((nFirst != pSender->nLastNak) || ((m_nNow - pSender->tLastNak) > (2 * m_pLink->nLatency + 2)))
+        {
+            pSender->nNaks++;
+            pSender->nLastNak = nFirst;
+            pSender->tLastNak = m_nNow;
+            Sender_SendLine(pSender, nFirst);
+        }
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Fills the window, or goes back to the oldest line not acknowledged
+*       when nothing has come back for REPLY_TIMEOUT passes.  If "BEGIN n"
+*       never arrives the upload starts anyway with a window of one line,
+*       the first ACK gives the real one.  Now and then a lossy link has the
+*       PC send past the window, which the firmware must drop.
+*******************************************************************************/
+static void Sender_Service(SENDER *pSender)
+{
+    if ((m_nNow - pSender->tLastReply) > REPLY_TIMEOUT)
+    {
+        pSender->tLastReply = m_nNow;
+        pSender->nTimeouts++;
+        if (!pSender->bStarted)
+        {
+            pSender->bStarted = true;
+            pSender->nWindowEnd = 0;
+        }
+        pSender->nNext = pSender->nBase;
+    }
+    while (pSender->bStarted && (pSender->nNext <= pSender->nWindowEnd) && (pSender->nNext < pSender->nLines))
+    {
+        Sender_SendLine(pSender, pSender->nNext++);
+    }
+    if (pSender->bStarted && ((rand() % 10000) < m_pLink->nRunAhead) && (pSender->nWindowEnd + 1 < pSender->nLines))
+    {
+        Sender_SendLine(pSender, pSender->nWindowEnd + 1);
+    }
+}
+
+/*******************************************************************************
+*       @details
+*       Resets the link and the firmware's upload state between runs.
+*******************************************************************************/
+static void Link_Start(const LINK_PROFILE *pLink)
+{
+    m_pLink = pLink;
+    memset(&m_ToFirmware, 0, sizeof(m_ToFirmware));
+    memset(&m_ToPC, 0, sizeof(m_ToPC));
+    m_nStored = 0;
+    m_nCsvRejectedLines = 0;
+    m_nNow = 1;
+    RetrieveLogFromPC_state = PCDTU_STATE_FILE_IDLE;
+}
+
+/*******************************************************************************
+*       @details
+*       Every record stored once, in order, the same as the one its line was
+*       written from, and the branch table skipped without a rejected line.
+*******************************************************************************/
+static int CheckStored(const char *pMode)
+{
+    int nRecord;
+
+    if ((m_nStored != m_nSurveys) || (m_nCsvRejectedLines != 0))
+    {
+        printf("MISMATCH %s over %s link: %d of %d records stored, %lu lines rejected\n", pMode, m_pLink->pName,
+               m_nStored, m_nSurveys, (unsigned long)m_nCsvRejectedLines);
+        return 0;
+    }
+    for (nRecord = 0; nRecord < m_nSurveys; nRecord++)
+    {
+        if (memcmp(&m_Stored[nRecord], &m_Sent[nRecord], sizeof(STRUCT_RECORD_DATA)) != 0)
+        {
+            printf("MISMATCH %s over %s link: record %d differs from its line\n%s\n", pMode, m_pLink->pName,
+                   nRecord + 1, m_sLines[nRecord + 1]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*       One windowed upload, "BEGIN_WCSV" to "END", a main loop pass a tick.
+*******************************************************************************/
+static int UploadWindowed(const LINK_PROFILE *pLink, int nLines, long *pnPasses, SENDER *pSender)
+{
+    const char *pReply;
+
+    Link_Start(pLink);
+    memset(pSender, 0, sizeof(*pSender));
+    pSender->nLines = nLines;
+    pSender->nLastNak = -1;
+    Queue_Put(&m_ToFirmware, "BEGIN_WCSV", 0);
+
+    for (*pnPasses = 0; !pSender->bDone && (*pnPasses < PASS_LIMIT); (*pnPasses)++)
+    {
+        PCPORT_UPLOAD_StateMachine();
+        while ((pReply = Queue_Get(&m_ToPC)) != NULL)
+        {
+            Sender_Reply(pSender, pReply);
+        }
+        Sender_Service(pSender);
+        m_nNow++;
+    }
+    // the firmware's last pass after "END"
+    PCPORT_UPLOAD_StateMachine();
+
+    if (!pSender->bDone || (RetrieveLogFromPC_state != PCDTU_STATE_FILE_IDLE))
+    {
+        printf("MISMATCH windowed over %s link: no END after %ld passes, line %d acknowledged\n",
+               pLink->pName, *pnPasses, pSender->nBase);
+        return 0;
+    }
+    return CheckStored("windowed");
+}
+
+/*******************************************************************************
+*       @details
+*       The same lines with "BEGIN_CSV", one line a reply.  It has no way to
+*       recover a lost line or an "ACK" the UART had no room for, so it is
+*       only timed on links that lose neither.
+*******************************************************************************/
+static int UploadStopAndWait(const LINK_PROFILE *pLink, int nLines, long *pnPasses)
+{
+    const char *pReply;
+    int nLine = 0;
+    BOOL bDone = false;
+
+    Link_Start(pLink);
+    Queue_Put(&m_ToFirmware, "BEGIN_CSV", 0);
+
+    for (*pnPasses = 0; !bDone && (*pnPasses < PASS_LIMIT); (*pnPasses)++)
+    {
+        PCPORT_UPLOAD_StateMachine();
+        while ((pReply = Queue_Get(&m_ToPC)) != NULL)
+        {
+            if ((strcmp(pReply, "BEGIN") == 0) || (strcmp(pReply, "ACK") == 0))
+            {
+                Queue_Put(&m_ToFirmware, m_sLines[nLine++], 0);
+            }
+            else if (strcmp(pReply, "END") == 0)
+            {
+                bDone = true;
+            }
+        }
+        m_nNow++;
+    }
+    PCPORT_UPLOAD_StateMachine();
+
+    if (!bDone)
+    {
+        printf("MISMATCH stop and wait over %s link: no END after %ld passes\n", pLink->pName, *pnPasses);
+        return 0;
+    }
+    return CheckStored("stop and wait");
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+static int CheckUploads(void)
+{
+    SENDER sender;
+    U_INT32 nLink, nRun;
+    long nPasses, nWindowPasses, nWaitPasses;
+    unsigned long nSurveys, nSent, nNaks, nTimeouts;
+    int nLines;
+
+    for (nLink = 0; nLink < sizeof(m_Links) / sizeof(m_Links[0]); nLink++)
+    {
+        srand(nLink + 1);
+        nSurveys = nSent = nNaks = nTimeouts = 0;
+        nWindowPasses = nWaitPasses = 0;
+        for (nRun = 0; nRun < CHECK_RUNS; nRun++)
+        {
+            nLines = MakeLines((nRun == 0) ? 0 : 1 + (rand() % MAX_LINES));
+            if (!UploadWindowed(&m_Links[nLink], nLines, &nPasses, &sender))
+            {
+                return 0;
+            }
+            nSurveys += m_nSurveys;
+            nSent += sender.nSent;
+            nNaks += sender.nNaks;
+            nTimeouts += sender.nTimeouts;
+            nWindowPasses += nPasses;
+
+            if ((m_Links[nLink].nLineLoss == 0) && (m_Links[nLink].nReplyLoss == 0) &&
+                (m_Links[nLink].nUartBusy == 0))
+            {
+                if (!UploadStopAndWait(&m_Links[nLink], nLines, &nPasses))
+                {
+                    return 0;
+                }
+                nWaitPasses += nPasses;
+            }
+        }
+        printf("%-5s link: %6lu surveys, %6lu lines sent, %4lu NAKs, %3lu timeouts, "
+               "%5.2f passes a line", m_Links[nLink].pName, nSurveys, nSent, nNaks, nTimeouts,
+               (double)nWindowPasses / nSurveys);
+        if (nWaitPasses != 0)
+        {
+            printf(", stop and wait %5.2f", (double)nWaitPasses / nSurveys);
+        }
+        printf("\n");
+    }
+    return 1;
+}
+
+/*******************************************************************************
+*       @details
+*******************************************************************************/
+int main(void)
+{
+    return CheckUploads() ? 0 : 1;
+}